@@ -44,36 +44,46 @@ struct cso_cache {
    void                 *sanitize_data;
 };
 
-#if 1
+static inline uint64_t rotl64(uint64_t x, unsigned r)
+{
+   return (x << r) | (x >> (64 - r));
+}
+
+/**
+ * A 64-bit multiply/rotate hash built from xxHash's primes, folded to 32
+ * bits.  The states hashed here are a few dozen bytes, so this works on 8
+ * bytes at a time, and the per-word multiply is kept off the dependency
+ * chain so the loop isn't bound by multiply latency.
+ */
 static unsigned hash_key(const void *key, unsigned key_size)
 {
-   unsigned *ikey = (unsigned *)key;
-   unsigned hash = 0, i;
+   static const uint64_t prime1 = 0x9e3779b185ebca87ull;
+   static const uint64_t prime2 = 0xc2b2ae3d27d4eb4full;
+   static const uint64_t prime3 = 0x165667b19e3779f9ull;
+   const uint8_t *p = (const uint8_t *)key;
+   const uint8_t *end = p + key_size;
+   uint64_t hash = prime3 + key_size;
 
    assert(key_size % 4 == 0);
 
-   /* I'm sure this can be improved on:
-    */
-   for (i = 0; i < key_size/4; i++)
-      hash ^= ikey[i];
+   for (; p + 8 <= end; p += 8) {
+      uint64_t k;
+      memcpy(&k, p, sizeof k);
+      hash = (hash ^ rotl64(k * prime2, 31)) * prime1;
+   }
 
-   return hash;
-}
-#else
-static unsigned hash_key(const unsigned char *p, int n)
-{
-   unsigned h = 0;
-   unsigned g;
-
-   while (n--) {
-      h = (h << 4) + *p++;
-      if ((g = (h & 0xf0000000)) != 0)
-         h ^= g >> 23;
-      h &= ~g;
+   if (p < end) {
+      uint32_t k;
+      memcpy(&k, p, sizeof k);
+      hash = (hash ^ rotl64(k * prime2, 31)) * prime1;
    }
-   return h;
+
+   hash ^= hash >> 29;
+   hash *= prime2;
+   hash ^= hash >> 32;
+
+   return (unsigned)hash;
 }
-#endif
 
 unsigned cso_construct_key(void *item, int item_size)
 {
@@ -216,7 +226,7 @@ void *cso_hash_find_data_from_template( struct cso_hash *hash,
 	  */
          return iter_data;
       }
-      iter = cso_hash_iter_next(iter);
+      iter = cso_hash_find_next(iter);
    }
    return NULL;
 }
@@ -231,7 +241,7 @@ struct cso_hash_iter cso_find_state_template(struct cso_cache *sc,
       void *iter_data = cso_hash_iter_data(iter);
       if (!memcmp(iter_data, templ, size))
          return iter;
-      iter = cso_hash_iter_next(iter);
+      iter = cso_hash_find_next(iter);
    }
    return iter;
 }
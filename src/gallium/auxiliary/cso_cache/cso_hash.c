@@ -35,380 +35,303 @@
 
 #include "cso_hash.h"
 
-#ifndef MAX
-#define MAX(a, b) ((a > b) ? (a) : (b))
-#endif
 
-static const int MinNumBits = 4;
-
-static const unsigned char prime_deltas[] = {
-   0,  0,  1,  3,  1,  5,  3,  3,  1,  9,  7,  5,  3,  9, 25,  3,
-   1, 21,  3, 21,  7, 15,  9,  5,  3, 29, 15,  0,  0,  0,  0,  0
+enum {
+   NODE_EMPTY = 0,
+   NODE_USED,
+   NODE_DELETED
 };
 
-static int primeForNumBits(int numBits)
-{
-   return (1 << numBits) + prime_deltas[numBits];
-}
+static const unsigned MinNumBits = 4;
 
-/*
-    Returns the smallest integer n such that
-    primeForNumBits(n) >= hint.
-*/
-static int countBits(int hint)
-{
-   int numBits = 0;
-   int bits = hint;
 
-   while (bits > 1) {
-      bits >>= 1;
-      numBits++;
-   }
-
-   if (numBits >= (int)sizeof(prime_deltas)) {
-      numBits = sizeof(prime_deltas) - 1;
-   } else if (primeForNumBits(numBits) < hint) {
-      ++numBits;
-   }
-   return numBits;
-}
-
-struct cso_hash_data {
-   struct cso_node *fakeNext;
-   struct cso_node **buckets;
-   int size;
-   int nodeSize;
-   short userNumBits;
-   short numBits;
-   int numBuckets;
-};
-
-static void *cso_data_allocate_node(struct cso_hash_data *hash)
+/* The keys are often small or structured numbers, so spread them over the
+ * table with a multiplicative hash and use the top bits.
+ */
+static inline unsigned
+cso_hash_home(const struct cso_hash *hash, unsigned key)
 {
-   return MALLOC(hash->nodeSize);
+   return (key * 0x9e3779b1u) >> (32 - hash->num_bits);
 }
 
-static void cso_free_node(struct cso_node *node)
+static inline unsigned
+cso_hash_wrap(const struct cso_hash *hash, unsigned i)
 {
-   FREE(node);
+   return i & (hash->num_nodes - 1);
 }
 
 static struct cso_node *
-cso_hash_create_node(struct cso_hash *hash,
-                      unsigned akey, void *avalue,
-                      struct cso_node **anextNode)
+cso_hash_find_node(struct cso_hash *hash, unsigned akey)
 {
-   struct cso_node *node = cso_data_allocate_node(hash->data.d);
+   unsigned i;
 
-   if (!node)
+   if (!hash->num_nodes)
       return NULL;
 
-   node->key = akey;
-   node->value = avalue;
+   /* there is always an empty node, which ends the probing */
+   for (i = cso_hash_home(hash, akey); ; i = cso_hash_wrap(hash, i + 1)) {
+      struct cso_node *node = &hash->nodes[i];
+      if (node->state == NODE_EMPTY)
+         return NULL;
+      if (node->state == NODE_USED && node->key == akey)
+         return node;
+   }
+}
+
+static struct cso_node *
+cso_hash_free_node(struct cso_hash *hash, unsigned akey)
+{
+   unsigned i;
 
-   node->next = (struct cso_node*)(*anextNode);
-   *anextNode = node;
-   ++hash->data.d->size;
-   return node;
+   for (i = cso_hash_home(hash, akey); ; i = cso_hash_wrap(hash, i + 1)) {
+      struct cso_node *node = &hash->nodes[i];
+      if (node->state != NODE_USED)
+         return node;
+   }
 }
 
-static void cso_data_rehash(struct cso_hash_data *hash, int hint)
+/*
+ * Reallocate the table with 2^num_bits nodes, which also drops the
+ * deleted nodes.
+ */
+static boolean
+cso_hash_rehash(struct cso_hash *hash, unsigned num_bits)
 {
-   if (hint < 0) {
-      hint = countBits(-hint);
-      if (hint < MinNumBits)
-         hint = MinNumBits;
-      hash->userNumBits = (short)hint;
-      while (primeForNumBits(hint) < (hash->size >> 1))
-         ++hint;
-   } else if (hint < MinNumBits) {
-      hint = MinNumBits;
+   struct cso_node *old_nodes = hash->nodes;
+   unsigned old_num_nodes = hash->num_nodes;
+   unsigned i;
+
+   hash->nodes = CALLOC(1 << num_bits, sizeof(struct cso_node));
+   if (!hash->nodes) {
+      hash->nodes = old_nodes;
+      return FALSE;
    }
 
-   if (hash->numBits != hint) {
-      struct cso_node *e = (struct cso_node *)(hash);
-      struct cso_node **oldBuckets = hash->buckets;
-      int oldNumBuckets = hash->numBuckets;
-      int  i = 0;
-
-      hash->numBits = (short)hint;
-      hash->numBuckets = primeForNumBits(hint);
-      hash->buckets = MALLOC(sizeof(struct cso_node*) * hash->numBuckets);
-      for (i = 0; i < hash->numBuckets; ++i)
-         hash->buckets[i] = e;
-
-      for (i = 0; i < oldNumBuckets; ++i) {
-         struct cso_node *firstNode = oldBuckets[i];
-         while (firstNode != e) {
-            unsigned h = firstNode->key;
-            struct cso_node *lastNode = firstNode;
-            struct cso_node *afterLastNode;
-            struct cso_node **beforeFirstNode;
-            
-            while (lastNode->next != e && lastNode->next->key == h)
-               lastNode = lastNode->next;
-
-            afterLastNode = lastNode->next;
-            beforeFirstNode = &hash->buckets[h % hash->numBuckets];
-            while (*beforeFirstNode != e)
-               beforeFirstNode = &(*beforeFirstNode)->next;
-            lastNode->next = *beforeFirstNode;
-            *beforeFirstNode = firstNode;
-            firstNode = afterLastNode;
-         }
-      }
-      FREE(oldBuckets);
+   hash->num_bits = num_bits;
+   hash->num_nodes = 1 << num_bits;
+   hash->num_deleted = 0;
+
+   for (i = 0; i < old_num_nodes; ++i) {
+      if (old_nodes[i].state == NODE_USED)
+         *cso_hash_free_node(hash, old_nodes[i].key) = old_nodes[i];
    }
+
+   FREE(old_nodes);
+   return TRUE;
 }
 
-static void cso_data_might_grow(struct cso_hash_data *hash)
+/*
+ * Make room for one more entry.  The table is rebuilt when more than 3/4
+ * of its nodes would be used, or more than 1/8 of them are deleted, so
+ * there is always an empty node.  Afterwards at most half are used.
+ */
+static boolean
+cso_hash_might_grow(struct cso_hash *hash)
 {
-   if (hash->size >= hash->numBuckets)
-      cso_data_rehash(hash, hash->numBits + 1);
+   unsigned num_bits = MinNumBits;
+
+   if ((hash->size + 1) * 4 <= hash->num_nodes * 3 &&
+       hash->num_deleted * 8 <= hash->num_nodes)
+      return TRUE;
+
+   while ((1u << num_bits) < (hash->size + 1) * 2)
+      ++num_bits;
+
+   if (cso_hash_rehash(hash, num_bits))
+      return TRUE;
+
+   /* keep going in the old table while it has free nodes */
+   return hash->size + hash->num_deleted + 1 < hash->num_nodes;
 }
 
-static void cso_data_has_shrunk(struct cso_hash_data *hash)
+/*
+ * Remove the entry of a used node.  The node only has to become a
+ * tombstone if a probe sequence may go on past it; otherwise it, and the
+ * tombstones right before it, end probe sequences from now on.
+ */
+static void
+cso_hash_remove_node(struct cso_hash *hash, struct cso_node *node)
 {
-   if (hash->size <= (hash->numBuckets >> 3) &&
-       hash->numBits > hash->userNumBits) {
-      int max = MAX(hash->numBits-2, hash->userNumBits);
-      cso_data_rehash(hash,  max);
+   unsigned i = node - hash->nodes;
+
+   --hash->size;
+
+   if (hash->nodes[cso_hash_wrap(hash, i + 1)].state != NODE_EMPTY) {
+      node->state = NODE_DELETED;
+      ++hash->num_deleted;
+      return;
+   }
+
+   node->state = NODE_EMPTY;
+   for (i = cso_hash_wrap(hash, i - 1);
+        hash->nodes[i].state == NODE_DELETED;
+        i = cso_hash_wrap(hash, i - 1)) {
+      hash->nodes[i].state = NODE_EMPTY;
+      --hash->num_deleted;
    }
 }
 
-static struct cso_node *cso_data_first_node(struct cso_hash_data *hash)
+static struct cso_node *
+cso_hash_next_node(struct cso_hash_iter iter)
 {
-   struct cso_node *e = (struct cso_node *)(hash);
-   struct cso_node **bucket = hash->buckets;
-   int n = hash->numBuckets;
-   while (n--) {
-      if (*bucket != e)
-         return *bucket;
-      ++bucket;
+   struct cso_hash *hash = iter.hash;
+   unsigned i = iter.node - hash->nodes;
+
+   for (++i; i < hash->num_nodes; ++i) {
+      if (hash->nodes[i].state == NODE_USED)
+         return &hash->nodes[i];
    }
-   return e;
+   return NULL;
 }
 
-static struct cso_node **cso_hash_find_node(struct cso_hash *hash, unsigned akey)
+static struct cso_node *
+cso_hash_prev_node(struct cso_hash_iter iter)
 {
-   struct cso_node **node;
-
-   if (hash->data.d->numBuckets) {
-      node = (struct cso_node **)(&hash->data.d->buckets[akey % hash->data.d->numBuckets]);
-      assert(*node == hash->data.e || (*node)->next);
-      while (*node != hash->data.e && (*node)->key != akey)
-         node = &(*node)->next;
-   } else {
-      node = (struct cso_node **)((const struct cso_node * const *)(&hash->data.e));
+   struct cso_hash *hash = iter.hash;
+   unsigned i = iter.node - hash->nodes;
+
+   while (i--) {
+      if (hash->nodes[i].state == NODE_USED)
+         return &hash->nodes[i];
    }
-   return node;
+   return NULL;
 }
 
 struct cso_hash_iter cso_hash_insert(struct cso_hash *hash,
                                        unsigned key, void *data)
 {
-   cso_data_might_grow(hash->data.d);
-
-   {
-      struct cso_node **nextNode = cso_hash_find_node(hash, key);
-      struct cso_node *node = cso_hash_create_node(hash, key, data, nextNode);
-      if (!node) {
-         struct cso_hash_iter null_iter = {hash, 0};
-         return null_iter;
-      }
+   struct cso_hash_iter iter = {hash, NULL};
+   struct cso_node *node;
 
-      {
-         struct cso_hash_iter iter = {hash, node};
-         return iter;
-      }
-   }
+   if (!cso_hash_might_grow(hash))
+      return iter;
+
+   node = cso_hash_free_node(hash, key);
+   if (node->state == NODE_DELETED)
+      --hash->num_deleted;
+   node->key = key;
+   node->value = data;
+   node->state = NODE_USED;
+   ++hash->size;
+
+   iter.node = node;
+   return iter;
 }
 
 struct cso_hash * cso_hash_create(void)
 {
-   struct cso_hash *hash = MALLOC_STRUCT(cso_hash);
-   if (!hash)
-      return NULL;
-
-   hash->data.d = MALLOC_STRUCT(cso_hash_data);
-   if (!hash->data.d) {
-      FREE(hash);
-      return NULL;
-   }
-
-   hash->data.d->fakeNext = 0;
-   hash->data.d->buckets = 0;
-   hash->data.d->size = 0;
-   hash->data.d->nodeSize = sizeof(struct cso_node);
-   hash->data.d->userNumBits = (short)MinNumBits;
-   hash->data.d->numBits = 0;
-   hash->data.d->numBuckets = 0;
-
-   return hash;
+   return CALLOC_STRUCT(cso_hash);
 }
 
 void cso_hash_delete(struct cso_hash *hash)
 {
-   struct cso_node *e_for_x = (struct cso_node *)(hash->data.d);
-   struct cso_node **bucket = (struct cso_node **)(hash->data.d->buckets);
-   int n = hash->data.d->numBuckets;
-   while (n--) {
-      struct cso_node *cur = *bucket++;
-      while (cur != e_for_x) {
-         struct cso_node *next = cur->next;
-         cso_free_node(cur);
-         cur = next;
-      }
-   }
-   FREE(hash->data.d->buckets);
-   FREE(hash->data.d);
+   FREE(hash->nodes);
    FREE(hash);
 }
 
 struct cso_hash_iter cso_hash_find(struct cso_hash *hash,
                                      unsigned key)
 {
-   struct cso_node **nextNode = cso_hash_find_node(hash, key);
-   struct cso_hash_iter iter = {hash, *nextNode};
+   struct cso_hash_iter iter = {hash, cso_hash_find_node(hash, key)};
    return iter;
 }
 
-unsigned cso_hash_iter_key(struct cso_hash_iter iter)
+struct cso_hash_iter cso_hash_find_next(struct cso_hash_iter iter)
 {
-   if (!iter.node || iter.hash->data.e == iter.node)
-      return 0;
-   return iter.node->key;
-}
+   struct cso_hash *hash = iter.hash;
+   unsigned i;
 
-static struct cso_node *cso_hash_data_next(struct cso_node *node)
-{
-   union {
-      struct cso_node *next;
-      struct cso_node *e;
-      struct cso_hash_data *d;
-   } a;
-   int start;
-   struct cso_node **bucket;
-   int n;
-
-   a.next = node->next;
-   if (!a.next) {
-      debug_printf("iterating beyond the last element\n");
-      return 0;
-   }
-   if (a.next->next)
-      return a.next;
-
-   start = (node->key % a.d->numBuckets) + 1;
-   bucket = a.d->buckets + start;
-   n = a.d->numBuckets - start;
-   while (n--) {
-      if (*bucket != a.e)
-         return *bucket;
-      ++bucket;
+   if (!iter.node)
+      return iter;
+
+   /* the rest of the probe sequence, up to the next empty node */
+   i = iter.node - hash->nodes;
+   for (i = cso_hash_wrap(hash, i + 1); ; i = cso_hash_wrap(hash, i + 1)) {
+      struct cso_node *node = &hash->nodes[i];
+      if (node->state == NODE_EMPTY) {
+         iter.node = NULL;
+         return iter;
+      }
+      if (node->state == NODE_USED && node->key == iter.node->key) {
+         iter.node = node;
+         return iter;
+      }
    }
-   return a.e;
 }
 
-
-static struct cso_node *cso_hash_data_prev(struct cso_node *node)
+unsigned cso_hash_iter_key(struct cso_hash_iter iter)
 {
-   union {
-      struct cso_node *e;
-      struct cso_hash_data *d;
-   } a;
-   int start;
-   struct cso_node *sentinel;
-   struct cso_node **bucket;
-
-   a.e = node;
-   while (a.e->next)
-      a.e = a.e->next;
-
-   if (node == a.e)
-      start = a.d->numBuckets - 1;
-   else
-      start = node->key % a.d->numBuckets;
-
-   sentinel = node;
-   bucket = a.d->buckets + start;
-   while (start >= 0) {
-      if (*bucket != sentinel) {
-         struct cso_node *prev = *bucket;
-         while (prev->next != sentinel)
-            prev = prev->next;
-         return prev;
-      }
-
-      sentinel = a.e;
-      --bucket;
-      --start;
-   }
-   debug_printf("iterating backward beyond first element\n");
-   return a.e;
+   if (!iter.node)
+      return 0;
+   return iter.node->key;
 }
 
 struct cso_hash_iter cso_hash_iter_next(struct cso_hash_iter iter)
 {
-   struct cso_hash_iter next = {iter.hash, cso_hash_data_next(iter.node)};
+   struct cso_hash_iter next = iter;
+   if (!iter.node) {
+      debug_printf("iterating beyond the last element\n");
+      return iter;
+   }
+   next.node = cso_hash_next_node(iter);
    return next;
 }
 
 void * cso_hash_take(struct cso_hash *hash,
                       unsigned akey)
 {
-   struct cso_node **node = cso_hash_find_node(hash, akey);
-   if (*node != hash->data.e) {
-      void *t = (*node)->value;
-      struct cso_node *next = (*node)->next;
-      cso_free_node(*node);
-      *node = next;
-      --hash->data.d->size;
-      cso_data_has_shrunk(hash->data.d);
-      return t;
+   struct cso_node *node = cso_hash_find_node(hash, akey);
+   if (node) {
+      cso_hash_remove_node(hash, node);
+      return node->value;
    }
    return 0;
 }
 
 struct cso_hash_iter cso_hash_iter_prev(struct cso_hash_iter iter)
 {
-   struct cso_hash_iter prev = {iter.hash,
-                                 cso_hash_data_prev(iter.node)};
+   struct cso_hash_iter prev = iter;
+   if (!iter.node) {
+      debug_printf("iterating backward beyond first element\n");
+      return iter;
+   }
+   prev.node = cso_hash_prev_node(iter);
    return prev;
 }
 
 struct cso_hash_iter cso_hash_first_node(struct cso_hash *hash)
 {
-   struct cso_hash_iter iter = {hash, cso_data_first_node(hash->data.d)};
+   struct cso_hash_iter iter = {hash, NULL};
+   unsigned i;
+
+   for (i = 0; i < hash->num_nodes; ++i) {
+      if (hash->nodes[i].state == NODE_USED) {
+         iter.node = &hash->nodes[i];
+         break;
+      }
+   }
    return iter;
 }
 
 int cso_hash_size(struct cso_hash *hash)
 {
-   return hash->data.d->size;
+   return hash->size;
 }
 
 struct cso_hash_iter cso_hash_erase(struct cso_hash *hash, struct cso_hash_iter iter)
 {
    struct cso_hash_iter ret = iter;
-   struct cso_node *node = iter.node;
-   struct cso_node **node_ptr;
 
-   if (node == hash->data.e)
+   if (!iter.node)
       return iter;
 
-   ret = cso_hash_iter_next(ret);
-   node_ptr = (struct cso_node**)(&hash->data.d->buckets[node->key % hash->data.d->numBuckets]);
-   while (*node_ptr != node)
-      node_ptr = &(*node_ptr)->next;
-   *node_ptr = node->next;
-   cso_free_node(node);
-   --hash->data.d->size;
+   /* other nodes stay in place, so the iteration order is unaffected */
+   ret.node = cso_hash_next_node(iter);
+   cso_hash_remove_node(hash, iter.node);
    return ret;
 }
 
 boolean cso_hash_contains(struct cso_hash *hash, unsigned key)
 {
-   struct cso_node **node = cso_hash_find_node(hash, key);
-   return (*node != hash->data.e);
+   return cso_hash_find_node(hash, key) != NULL;
 }
@@ -28,16 +28,16 @@
 /**
  * @file
  * Hash table implementation.
- * 
+ *
  * This file provides a hash implementation that is capable of dealing
- * with collisions. It stores colliding entries in linked list. All
- * functions operating on the hash return an iterator. The iterator
- * itself points to the collision list. If there wasn't any collision
- * the list will have just one entry, otherwise client code should
- * iterate over the entries to find the exact entry among ones that
- * had the same key (e.g. memcmp could be used on the data to check
- * that)
- * 
+ * with collisions. Entries live in a flat, open addressing table which
+ * stores the key next to each value, and colliding entries are found by
+ * linear probing. Several entries may have the same key: the iterator
+ * returned by cso_hash_find() points to the first one, and
+ * cso_hash_find_next() walks the others, so client code should iterate
+ * over them to find the exact entry among ones that had the same key
+ * (e.g. memcmp could be used on the data to check that).
+ *
  * @author Zack Rusin <zackr@vmware.com>
  */
 
@@ -52,16 +52,17 @@ extern "C" {
 
 
 struct cso_node {
-   struct cso_node *next;
-   unsigned key;
    void *value;
+   unsigned key;
+   unsigned state;
 };
 
 struct cso_hash {
-   union {
-      struct cso_hash_data *d;
-      struct cso_node      *e;
-   } data;
+   struct cso_node *nodes;
+   unsigned num_bits;
+   unsigned num_nodes;     /* 1 << num_bits, or 0 before the first insert */
+   unsigned size;
+   unsigned num_deleted;
 };
 
 struct cso_hash_iter {
@@ -79,9 +80,9 @@ int              cso_hash_size(struct cso_hash *hash);
 
 /**
  * Adds a data with the given key to the hash. If entry with the given
- * key is already in the hash, this current entry is instered before it
- * in the collision list.
+ * key is already in the hash, the new entry is added alongside it.
  * Function returns iterator pointing to the inserted item in the hash.
+ * Inserting may move the entries, so it invalidates other iterators.
  */
 struct cso_hash_iter cso_hash_insert(struct cso_hash *hash, unsigned key,
                                      void *data);
@@ -98,13 +99,22 @@ void  *cso_hash_take(struct cso_hash *hash, unsigned key);
 
 
 
+/**
+ * Return an iterator over all the entries of the hash.
+ */
 struct cso_hash_iter cso_hash_first_node(struct cso_hash *hash);
 
 /**
- * Return an iterator pointing to the first entry in the collision list.
+ * Return an iterator pointing to the first entry with the given key.
  */
 struct cso_hash_iter cso_hash_find(struct cso_hash *hash, unsigned key);
 
+/**
+ * Return an iterator pointing to the next entry with the same key as the
+ * one iter points to, or a null iterator if there are no more.
+ */
+struct cso_hash_iter cso_hash_find_next(struct cso_hash_iter iter);
+
 /**
  * Returns true if a value with the given key exists in the hash
  */
@@ -131,15 +141,13 @@ void *cso_hash_find_data_from_template( struct cso_hash *hash,
 static inline int
 cso_hash_iter_is_null(struct cso_hash_iter iter)
 {
-   if (!iter.node || iter.node == iter.hash->data.e)
-      return 1;
-   return 0;
+   return !iter.node;
 }
 
 static inline void *
 cso_hash_iter_data(struct cso_hash_iter iter)
 {
-   if (!iter.node || iter.hash->data.e == iter.node)
+   if (!iter.node)
       return 0;
    return iter.node->value;
 }
@@ -25,9 +25,12 @@
  *
  **************************************************************************/
 
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_prim.h"
+#include "util/u_queue.h"
 #include "draw/draw_context.h"
 #include "draw/draw_gs.h"
 #include "draw/draw_vbuf.h"
@@ -40,6 +43,27 @@
 #include "gallivm/lp_bld_debug.h"
 
 
+/**
+ * Large fetches get their vertex shading split into chunks of at least
+ * this many vertices which are run concurrently.
+ */
+#define LLVM_VS_MIN_CHUNK    256
+#define LLVM_VS_MAX_THREADS  8
+
+struct llvm_middle_end;
+
+/** One chunk of vertices shaded on the vs worker pool */
+struct llvm_vs_job {
+   struct llvm_middle_end *fpme;
+   struct vertex_header *verts;
+   unsigned count;
+   unsigned start_or_maxelt;
+   unsigned vid_base;
+   const unsigned *elts;
+   boolean clipped;
+   struct util_queue_fence fence;
+};
+
 struct llvm_middle_end {
    struct draw_pt_middle_end base;
    struct draw_context *draw;
@@ -57,6 +81,11 @@ struct llvm_middle_end {
 
    struct draw_llvm *llvm;
    struct draw_llvm_variant *current_variant;
+
+   /** Worker pool for vertex shading, nr_vs_threads == 0 if none */
+   struct util_queue vs_queue;
+   unsigned nr_vs_threads;
+   struct llvm_vs_job vs_jobs[LLVM_VS_MAX_THREADS];
 };
 
 
@@ -347,6 +376,122 @@ emit(struct pt_emit *emit,
 }
 
 
+static boolean
+llvm_pipeline_run_vs(struct llvm_middle_end *fpme,
+                     struct vertex_header *verts,
+                     unsigned count,
+                     unsigned start_or_maxelt,
+                     unsigned vid_base,
+                     const unsigned *elts)
+{
+   struct draw_context *draw = fpme->draw;
+
+   return fpme->current_variant->jit_func(&fpme->llvm->jit_context,
+                                          verts,
+                                          draw->pt.user.vbuffer,
+                                          count,
+                                          start_or_maxelt,
+                                          fpme->vertex_size,
+                                          draw->pt.vertex_buffer,
+                                          draw->instance_id,
+                                          vid_base,
+                                          draw->start_instance,
+                                          elts);
+}
+
+
+static void
+llvm_vs_job_execute(void *data, int thread_index)
+{
+   struct llvm_vs_job *job = (struct llvm_vs_job *)data;
+   unsigned fpstate = util_fpstate_get();
+
+   /* Shade with the same FP state draw_vbo sets up for the calling
+    * thread, so every chunk flushes denorms the same way.
+    */
+   util_fpstate_set_denorms_to_zero(fpstate);
+
+   job->clipped = llvm_pipeline_run_vs(job->fpme, job->verts, job->count,
+                                       job->start_or_maxelt, job->vid_base,
+                                       job->elts);
+
+   util_fpstate_set(fpstate);
+}
+
+
+/**
+ * Run fetch and vertex shading for all fetched vertices, returning
+ * whether any of them need clipping.
+ *
+ * Big fetches are cut into chunks which the vs worker pool shades in
+ * parallel, the last chunk being done by the calling thread.  Each chunk
+ * writes its own slice of the vertex buffer, so the result is identical to
+ * shading everything in one go and everything downstream (gs, stream out,
+ * clipping and the vbuf backend) still sees the vertices in draw order.
+ */
+static boolean
+llvm_pipeline_shade(struct llvm_middle_end *fpme,
+                    struct vertex_header *verts,
+                    unsigned count,
+                    unsigned start_or_maxelt,
+                    unsigned vid_base,
+                    const unsigned *elts)
+{
+   const unsigned vector_length = lp_native_vector_width / 32;
+   unsigned nr_chunks, chunk, offset, i;
+   boolean clipped;
+
+   nr_chunks = MIN2(fpme->nr_vs_threads + 1, count / LLVM_VS_MIN_CHUNK);
+   if (nr_chunks < 2) {
+      return llvm_pipeline_run_vs(fpme, verts, count,
+                                  start_or_maxelt, vid_base, elts);
+   }
+
+   /*
+    * The jit function always writes out whole vectors of vertices, so chunk
+    * boundaries have to be vector aligned or the chunks would overwrite
+    * each other's first vertices.
+    */
+   chunk = align((count + nr_chunks - 1) / nr_chunks, vector_length);
+   nr_chunks = (count + chunk - 1) / chunk;
+
+   for (i = 0, offset = 0; i < nr_chunks - 1; i++, offset += chunk) {
+      struct llvm_vs_job *job = &fpme->vs_jobs[i];
+
+      job->fpme = fpme;
+      job->verts = (struct vertex_header *)
+         ((char *)verts + offset * fpme->vertex_size);
+      job->count = chunk;
+      job->vid_base = vid_base;
+      if (elts) {
+         job->start_or_maxelt = start_or_maxelt;
+         job->elts = elts + offset;
+      }
+      else {
+         job->start_or_maxelt = start_or_maxelt + offset;
+         job->elts = NULL;
+      }
+      util_queue_add_job(&fpme->vs_queue, job, &job->fence,
+                         llvm_vs_job_execute, NULL);
+   }
+
+   clipped = llvm_pipeline_run_vs(fpme,
+                                  (struct vertex_header *)
+                                     ((char *)verts + offset * fpme->vertex_size),
+                                  count - offset,
+                                  elts ? start_or_maxelt : start_or_maxelt + offset,
+                                  vid_base,
+                                  elts ? elts + offset : NULL);
+
+   for (i = 0; i < nr_chunks - 1; i++) {
+      util_queue_fence_wait(&fpme->vs_jobs[i].fence);
+      clipped |= fpme->vs_jobs[i].clipped;
+   }
+
+   return clipped;
+}
+
+
 static void
 llvm_pipeline_generic(struct draw_pt_middle_end *middle,
                       const struct draw_fetch_info *fetch_info,
@@ -397,17 +542,8 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
       vid_base = draw->pt.user.eltBias;
       elts = fetch_info->elts;
    }
-   clipped = fpme->current_variant->jit_func(&fpme->llvm->jit_context,
-                                             llvm_vert_info.verts,
-                                             draw->pt.user.vbuffer,
-                                             fetch_info->count,
-                                             start_or_maxelt,
-                                             fpme->vertex_size,
-                                             draw->pt.vertex_buffer,
-                                             draw->instance_id,
-                                             vid_base,
-                                             draw->start_instance,
-                                             elts);
+   clipped = llvm_pipeline_shade(fpme, llvm_vert_info.verts, fetch_info->count,
+                                 start_or_maxelt, vid_base, elts);
 
    /* Finished with fetch and vs:
     */
@@ -610,6 +746,14 @@ llvm_middle_end_destroy(struct draw_pt_middle_end *middle)
    if (fpme->post_vs)
       draw_pt_post_vs_destroy( fpme->post_vs );
 
+   if (fpme->nr_vs_threads) {
+      unsigned i;
+
+      util_queue_destroy(&fpme->vs_queue);
+      for (i = 0; i < LLVM_VS_MAX_THREADS; i++)
+         util_queue_fence_destroy(&fpme->vs_jobs[i].fence);
+   }
+
    FREE(middle);
 }
 
@@ -618,6 +762,7 @@ struct draw_pt_middle_end *
 draw_pt_fetch_pipeline_or_emit_llvm(struct draw_context *draw)
 {
    struct llvm_middle_end *fpme = 0;
+   long nr_vs_threads;
 
    if (!draw->llvm)
       return NULL;
@@ -658,6 +803,24 @@ draw_pt_fetch_pipeline_or_emit_llvm(struct draw_context *draw)
 
    fpme->current_variant = NULL;
 
+   /*
+    * The calling thread shades a chunk too, so n threads give n+1 way
+    * parallelism.  Keep the default modest, drivers like llvmpipe already
+    * have their own rasterizer threads competing for the cpus.
+    */
+   nr_vs_threads = debug_get_num_option("DRAW_VS_THREADS",
+                                        MIN2(util_cpu_caps.nr_cpus / 2, 4));
+   nr_vs_threads = MIN2(nr_vs_threads, LLVM_VS_MAX_THREADS);
+   if (nr_vs_threads > 0 &&
+       util_queue_init(&fpme->vs_queue, "drawvs", LLVM_VS_MAX_THREADS,
+                       nr_vs_threads, 0)) {
+      unsigned i;
+
+      for (i = 0; i < LLVM_VS_MAX_THREADS; i++)
+         util_queue_fence_init(&fpme->vs_jobs[i].fence);
+      fpme->nr_vs_threads = nr_vs_threads;
+   }
+
    return &fpme->base;
 
  fail:
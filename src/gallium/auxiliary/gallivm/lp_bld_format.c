@@ -26,6 +26,8 @@
  **************************************************************************/
 
 
+#include "util/u_format.h"
+
 #include "lp_bld_format.h"
 
 
@@ -42,15 +44,42 @@ lp_build_format_cache_type(struct gallivm_state *gallivm)
    elem_types[LP_BUILD_FORMAT_CACHE_MEMBER_TAGS] =
          LLVMArrayType(LLVMInt64TypeInContext(gallivm->context),
                        LP_BUILD_FORMAT_CACHE_SIZE);
-#if LP_BUILD_FORMAT_CACHE_DEBUG
    elem_types[LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_TOTAL] =
          LLVMInt64TypeInContext(gallivm->context);
    elem_types[LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_MISS] =
          LLVMInt64TypeInContext(gallivm->context);
-#endif
 
    s = LLVMStructTypeInContext(gallivm->context, elem_types,
                                LP_BUILD_FORMAT_CACHE_MEMBER_COUNT, 0);
 
    return s;
 }
+
+
+/**
+ * Whether texels of this format are fetched through the block cache,
+ * see lp_build_fetch_cached_texels().  These are the 4x4 block compressed
+ * formats whose blocks decode to 8 bit unorm texels (before any sRGB
+ * conversion) with a util_format fetch_rgba_8unorm function, which fills
+ * the cache: S3TC, and the unorm RGTC/LATC formats.
+ */
+boolean
+lp_build_format_is_cached(const struct util_format_description *format_desc)
+{
+   const struct util_format_description *linear_desc;
+
+   if (format_desc->block.width != 4 ||
+       format_desc->block.height != 4) {
+      return FALSE;
+   }
+
+   switch (format_desc->layout) {
+   case UTIL_FORMAT_LAYOUT_S3TC:
+   case UTIL_FORMAT_LAYOUT_RGTC:
+      linear_desc = util_format_description(util_format_linear(format_desc->format));
+      return linear_desc->fetch_rgba_8unorm &&
+             util_format_fits_8unorm(linear_desc);
+   default:
+      return FALSE;
+   }
+}
@@ -61,20 +61,17 @@ struct lp_build_format_cache
 {
    PIPE_ALIGN_VAR(16) uint32_t cache_data[LP_BUILD_FORMAT_CACHE_SIZE][4][4];
    uint64_t cache_tags[LP_BUILD_FORMAT_CACHE_SIZE];
-#if LP_BUILD_FORMAT_CACHE_DEBUG
+   /* Texels looked up, and those which needed their block decoded */
    uint64_t cache_access_total;
    uint64_t cache_access_miss;
-#endif
 };
 
 
 enum {
    LP_BUILD_FORMAT_CACHE_MEMBER_DATA = 0,
    LP_BUILD_FORMAT_CACHE_MEMBER_TAGS,
-#if LP_BUILD_FORMAT_CACHE_DEBUG
    LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_TOTAL,
    LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_MISS,
-#endif
    LP_BUILD_FORMAT_CACHE_MEMBER_COUNT
 };
 
@@ -82,6 +79,9 @@ enum {
 LLVMTypeRef
 lp_build_format_cache_type(struct gallivm_state *gallivm);
 
+boolean
+lp_build_format_is_cached(const struct util_format_description *format_desc);
+
 
 /*
  * AoS
@@ -46,12 +46,13 @@
  * texels must fit into 4x8 bits.
  * The cache is direct mapped so hitrates aren't all that great and cache
  * thrashing could happen.
+ * Lookups and misses are always counted in the cache, since the counters
+ * are cheap next to even a cache hit.
  *
  * @author Roland Scheidegger <sroland@vmware.com>
  */
 
 
-#if LP_BUILD_FORMAT_CACHE_DEBUG
 static void
 update_cache_access(struct gallivm_state *gallivm,
                     LLVMValueRef ptr,
@@ -71,7 +72,6 @@ update_cache_access(struct gallivm_state *gallivm,
                                                                    count, 0), "");
    LLVMBuildStore(builder, cache_access, member_ptr);
 }
-#endif
 
 
 static void
@@ -330,10 +330,8 @@ lp_build_fetch_cached_texels(struct gallivm_state *gallivm,
             ptr_addrx = LLVMBuildIntToPtr(builder, addrx,
                                           LLVMPointerType(i8t, 0), "");
             update_cached_block(gallivm, format_desc, ptr_addrx, hash_indexx, cache);
-#if LP_BUILD_FORMAT_CACHE_DEBUG
             update_cache_access(gallivm, cache, 1,
                                 LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_MISS);
-#endif
          }
          lp_build_endif(&if_ctx);
 
@@ -356,19 +354,15 @@ lp_build_fetch_cached_texels(struct gallivm_state *gallivm,
       {
          tmp = LLVMBuildIntToPtr(builder, addr, LLVMPointerType(i8t, 0), "");
          update_cached_block(gallivm, format_desc, tmp, hash_index, cache);
-#if LP_BUILD_FORMAT_CACHE_DEBUG
          update_cache_access(gallivm, cache, 1,
                              LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_MISS);
-#endif
       }
       lp_build_endif(&if_ctx);
 
       color = lookup_cached_pixel(gallivm, cache, block_index);
    }
-#if LP_BUILD_FORMAT_CACHE_DEBUG
    update_cache_access(gallivm, cache, n,
                        LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_TOTAL);
-#endif
    return LLVMBuildBitCast(builder, color, LLVMVectorType(i8t, n * 4), "");
 }
 
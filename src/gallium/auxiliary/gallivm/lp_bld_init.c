@@ -28,11 +28,15 @@
 
 #include "pipe/p_config.h"
 #include "pipe/p_compiler.h"
+#include "util/u_atomic.h"
 #include "util/u_cpu_detect.h"
 #include "util/u_debug.h"
 #include "util/u_memory.h"
+#include "util/u_string.h"
 #include "util/simple_list.h"
 #include "util/os_time.h"
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
 #include "lp_bld.h"
 #include "lp_bld_debug.h"
 #include "lp_bld_misc.h"
@@ -83,6 +87,18 @@ DEBUG_GET_ONCE_FLAGS_OPTION(gallivm_debug, "GALLIVM_DEBUG", lp_bld_debug_flags,
 
 static boolean gallivm_initialized = FALSE;
 
+/** Machine code cache shared by all gallivm users, NULL if disabled */
+static struct disk_cache *gallivm_disk_cache = NULL;
+static char *gallivm_cpu_id = NULL;
+
+static struct {
+   unsigned hits;
+   unsigned misses;
+   unsigned uncacheable;
+   int64_t hit_usecs;
+   int64_t miss_usecs;
+} gallivm_cache_stats;
+
 unsigned lp_native_vector_width;
 
 
@@ -219,27 +235,33 @@ gallivm_free_code(struct gallivm_state *gallivm)
 }
 
 
+static enum LLVM_CodeGenOpt_Level
+gallivm_get_optlevel(void)
+{
+   if (gallivm_debug & GALLIVM_DEBUG_NO_OPT) {
+      return None;
+   }
+   else {
+      return Default;
+   }
+}
+
+
 static boolean
 init_gallivm_engine(struct gallivm_state *gallivm)
 {
    if (1) {
-      enum LLVM_CodeGenOpt_Level optlevel;
+      enum LLVM_CodeGenOpt_Level optlevel = gallivm_get_optlevel();
       char *error = NULL;
       int ret;
 
-      if (gallivm_debug & GALLIVM_DEBUG_NO_OPT) {
-         optlevel = None;
-      }
-      else {
-         optlevel = Default;
-      }
-
       ret = lp_build_create_jit_compiler_for_module(&gallivm->engine,
                                                     &gallivm->code,
                                                     gallivm->module,
                                                     gallivm->memorymgr,
                                                     (unsigned) optlevel,
                                                     use_mcjit,
+                                                    &gallivm->cache,
                                                     &error);
       if (ret) {
          _debug_printf("%s\n", error);
@@ -380,6 +402,79 @@ fail:
 }
 
 
+/**
+ * Set up the on-disk cache of generated machine code.  Only MCJIT can load
+ * precompiled objects.
+ */
+static void
+gallivm_disk_cache_create(void)
+{
+#if HAVE_LLVM >= 0x0306
+   uint32_t mesa_timestamp, llvm_timestamp;
+   char timestamp[64];
+
+   if (!use_mcjit)
+      return;
+
+   if (!disk_cache_get_function_timestamp(gallivm_disk_cache_create,
+                                          &mesa_timestamp) ||
+       !disk_cache_get_function_timestamp(LLVMLinkInMCJIT,
+                                          &llvm_timestamp))
+      return;
+
+   util_snprintf(timestamp, sizeof timestamp, "%u_%u",
+                 mesa_timestamp, llvm_timestamp);
+   gallivm_disk_cache = disk_cache_create("gallivm", timestamp, 0);
+   if (gallivm_disk_cache)
+      gallivm_cpu_id = lp_build_host_cpu_id();
+#endif
+}
+
+
+/**
+ * Look the module's machine code up in the disk cache.  The key is made of
+ * the unoptimized IR, the target cpu and the codegen options; variant keys
+ * and anything else the code depends on is baked into the IR already.
+ */
+static void
+gallivm_cache_lookup(struct gallivm_state *gallivm)
+{
+#if HAVE_LLVM >= 0x0306
+   struct lp_cached_code *cache = &gallivm->cache;
+   enum LLVM_CodeGenOpt_Level optlevel = gallivm_get_optlevel();
+   LLVMMemoryBufferRef bitcode;
+   struct mesa_sha1 ctx;
+   unsigned char sha1[20];
+
+   if (!gallivm_disk_cache || !gallivm_cpu_id)
+      return;
+
+   /* Its key would never match again, so don't fill the cache with it */
+   if (cache->uncacheable) {
+      p_atomic_inc(&gallivm_cache_stats.uncacheable);
+      return;
+   }
+
+   bitcode = LLVMWriteBitcodeToMemoryBuffer(gallivm->module);
+   if (!bitcode)
+      return;
+
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, LLVMGetBufferStart(bitcode),
+                     LLVMGetBufferSize(bitcode));
+   _mesa_sha1_update(&ctx, gallivm_cpu_id, strlen(gallivm_cpu_id));
+   _mesa_sha1_update(&ctx, &optlevel, sizeof optlevel);
+   _mesa_sha1_final(&ctx, sha1);
+   LLVMDisposeMemoryBuffer(bitcode);
+
+   cache->disk_cache = gallivm_disk_cache;
+   disk_cache_compute_key(gallivm_disk_cache, sha1, sizeof sha1, cache->key);
+   cache->data = disk_cache_get(gallivm_disk_cache, cache->key,
+                                &cache->data_size);
+#endif
+}
+
+
 boolean
 lp_build_init(void)
 {
@@ -487,6 +582,8 @@ lp_build_init(void)
    }
 #endif
 
+   gallivm_disk_cache_create();
+
    gallivm_initialized = TRUE;
 
    return TRUE;
@@ -568,10 +665,11 @@ gallivm_compile_module(struct gallivm_state *gallivm)
       gallivm->builder = NULL;
    }
 
-   if (gallivm_debug & GALLIVM_DEBUG_PERF)
-      time_begin = os_time_get();
+   time_begin = os_time_get();
+
+   gallivm_cache_lookup(gallivm);
 
-   /* Run optimization passes */
+   /* Run optimization passes, unless the machine code was found in the cache */
    LLVMInitializeFunctionPassManager(gallivm->passmgr);
    func = LLVMGetFirstFunction(gallivm->module);
    while (func) {
@@ -588,7 +686,8 @@ gallivm_compile_module(struct gallivm_state *gallivm)
       LLVMAddTargetDependentFunctionAttr(func, "no-frame-pointer-elim-non-leaf", "true");
 #endif
 
-      LLVMRunFunctionPassManager(gallivm->passmgr, func);
+      if (!gallivm->cache.data)
+         LLVMRunFunctionPassManager(gallivm->passmgr, func);
       func = LLVMGetNextFunction(func);
    }
    LLVMFinalizeFunctionPassManager(gallivm->passmgr);
@@ -640,6 +739,31 @@ gallivm_compile_module(struct gallivm_state *gallivm)
    }
    assert(gallivm->engine);
 
+   if (gallivm->cache.disk_cache) {
+      int64_t time_usecs = os_time_get() - time_begin;
+
+      if (gallivm->cache.data) {
+         p_atomic_inc(&gallivm_cache_stats.hits);
+         p_atomic_add(&gallivm_cache_stats.hit_usecs, time_usecs);
+      }
+      else {
+         p_atomic_inc(&gallivm_cache_stats.misses);
+         p_atomic_add(&gallivm_cache_stats.miss_usecs, time_usecs);
+      }
+
+      if (gallivm_debug & GALLIVM_DEBUG_PERF) {
+         debug_printf("module %s %s disk cache, compiling took %d msec\n",
+                      gallivm->module_name,
+                      gallivm->cache.data ? "found in" : "not in",
+                      (int)(time_usecs / 1000));
+      }
+
+      /* The engine has its own copy of the code by now */
+      free(gallivm->cache.data);
+      gallivm->cache.data = NULL;
+      gallivm->cache.disk_cache = NULL;
+   }
+
    ++gallivm->compiled;
 
    if (gallivm_debug & GALLIVM_DEBUG_ASM) {
@@ -703,3 +827,33 @@ gallivm_jit_function(struct gallivm_state *gallivm,
 
    return jit_func;
 }
+
+
+/**
+ * Print how the machine code cache did so far.  The compile time saved is
+ * estimated from the average time spent on modules which missed.
+ */
+void
+gallivm_print_cache_stats(void)
+{
+   unsigned hits = gallivm_cache_stats.hits;
+   unsigned misses = gallivm_cache_stats.misses;
+   unsigned uncacheable = gallivm_cache_stats.uncacheable;
+   int64_t saved = 0;
+
+   if (hits + misses + uncacheable == 0)
+      return;
+
+   if (misses) {
+      saved = gallivm_cache_stats.miss_usecs * hits / misses -
+              gallivm_cache_stats.hit_usecs;
+   }
+
+   debug_printf("gallivm: cache hits:                    %9u\n", hits);
+   debug_printf("gallivm: cache misses:                  %9u\n", misses);
+   debug_printf("gallivm: uncacheable modules:           %9u\n", uncacheable);
+   debug_printf("gallivm: cache hit rate:                %9.1f%%\n",
+                hits + misses ? 100.0 * hits / (hits + misses) : 0.0);
+   debug_printf("gallivm: compile msec saved (approx):   %9d\n",
+                (int)(saved / 1000));
+}
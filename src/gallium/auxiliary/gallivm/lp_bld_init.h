@@ -39,6 +39,23 @@
 extern "C" {
 #endif
 
+struct disk_cache;
+
+/**
+ * Machine code of a module in the on-disk cache.  If data is set it's used
+ * in place of compiling the module, otherwise the generated code is stored
+ * under key.
+ */
+struct lp_cached_code
+{
+   struct disk_cache *disk_cache;
+   unsigned char key[20];
+   void *data;
+   size_t data_size;
+   boolean uncacheable;  /**< IR embeds host addresses, don't look it up */
+};
+
+
 struct gallivm_state
 {
    char *module_name;
@@ -50,6 +67,7 @@ struct gallivm_state
    LLVMBuilderRef builder;
    LLVMMCJITMemoryManagerRef memorymgr;
    struct lp_generated_code *code;
+   struct lp_cached_code cache;
    unsigned compiled;
 };
 
@@ -78,6 +96,9 @@ func_pointer
 gallivm_jit_function(struct gallivm_state *gallivm,
                      LLVMValueRef func);
 
+void
+gallivm_print_cache_stats(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -65,6 +65,8 @@
 #include <llvm/ExecutionEngine/JITMemoryManager.h>
 #else
 #include <llvm/ExecutionEngine/SectionMemoryManager.h>
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/Support/MemoryBuffer.h>
 #endif
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/Host.h>
@@ -94,9 +96,11 @@
 #include "pipe/p_config.h"
 #include "util/u_debug.h"
 #include "util/u_cpu_detect.h"
+#include "util/disk_cache.h"
 
 #include "lp_bld_misc.h"
 #include "lp_bld_debug.h"
+#include "lp_bld_init.h"
 
 namespace {
 
@@ -473,89 +477,11 @@ class ShaderMemoryManager : public DelegatingJITMemoryManager {
 };
 
 
-/**
- * Same as LLVMCreateJITCompilerForModule, but:
- * - allows using MCJIT and enabling AVX feature where available.
- * - set target options
- *
- * See also:
- * - llvm/lib/ExecutionEngine/ExecutionEngineBindings.cpp
- * - llvm/tools/lli/lli.cpp
- * - http://markmail.org/message/ttkuhvgj4cxxy2on#query:+page:1+mid:aju2dggerju3ivd3+state:results
- */
-extern "C"
-LLVMBool
-lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
-                                        lp_generated_code **OutCode,
-                                        LLVMModuleRef M,
-                                        LLVMMCJITMemoryManagerRef CMM,
-                                        unsigned OptLevel,
-                                        int useMCJIT,
-                                        char **OutError)
+static void
+get_host_mattrs(llvm::SmallVector<std::string, 16> &MAttrs)
 {
    using namespace llvm;
 
-   std::string Error;
-#if HAVE_LLVM >= 0x0306
-   EngineBuilder builder(std::unique_ptr<Module>(unwrap(M)));
-#else
-   EngineBuilder builder(unwrap(M));
-#endif
-
-   /**
-    * LLVM 3.1+ haven't more "extern unsigned llvm::StackAlignmentOverride" and
-    * friends for configuring code generation options, like stack alignment.
-    */
-   TargetOptions options;
-#if defined(PIPE_ARCH_X86)
-   options.StackAlignmentOverride = 4;
-#if HAVE_LLVM < 0x0304
-   options.RealignStack = true;
-#endif
-#endif
-
-#if defined(DEBUG) && HAVE_LLVM < 0x0307
-   options.JITEmitDebugInfo = true;
-#endif
-
-   /* XXX: Workaround http://llvm.org/PR21435 */
-#if defined(DEBUG) || defined(PROFILE) || \
-    (HAVE_LLVM >= 0x0303 && (defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64)))
-#if HAVE_LLVM < 0x0304
-   options.NoFramePointerElimNonLeaf = true;
-#endif
-#if HAVE_LLVM < 0x0307
-   options.NoFramePointerElim = true;
-#endif
-#endif
-
-   builder.setEngineKind(EngineKind::JIT)
-          .setErrorStr(&Error)
-          .setTargetOptions(options)
-          .setOptLevel((CodeGenOpt::Level)OptLevel);
-
-   if (useMCJIT) {
-#if HAVE_LLVM < 0x0306
-       builder.setUseMCJIT(true);
-#endif
-#ifdef _WIN32
-       /*
-        * MCJIT works on Windows, but currently only through ELF object format.
-        *
-        * XXX: We could use `LLVM_HOST_TRIPLE "-elf"` but LLVM_HOST_TRIPLE has
-        * different strings for MinGW/MSVC, so better play it safe and be
-        * explicit.
-        */
-#  ifdef _WIN64
-       LLVMSetTarget(M, "x86_64-pc-win32-elf");
-#  else
-       LLVMSetTarget(M, "i686-pc-win32-elf");
-#  endif
-#endif
-   }
-
-   llvm::SmallVector<std::string, 16> MAttrs;
-
 #if defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64)
 #if HAVE_LLVM >= 0x0400
    /* llvm-3.7+ implements sys::getHostCPUFeatures for x86,
@@ -674,20 +600,15 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
 #endif
 #endif
 #endif
+}
 
-   builder.setMAttrs(MAttrs);
-
-   if (gallivm_debug & (GALLIVM_DEBUG_IR | GALLIVM_DEBUG_ASM | GALLIVM_DEBUG_DUMP_BC)) {
-      int n = MAttrs.size();
-      if (n > 0) {
-         debug_printf("llc -mattr option(s): ");
-         for (int i = 0; i < n; i++)
-            debug_printf("%s%s", MAttrs[i].c_str(), (i < n - 1) ? "," : "");
-         debug_printf("\n");
-      }
-   }
 
 #if HAVE_LLVM >= 0x0305
+static llvm::StringRef
+get_host_mcpu()
+{
+   using namespace llvm;
+
    StringRef MCPU = llvm::sys::getHostCPUName();
    /*
     * The cpu bits are no longer set automatically, so need to set mcpu manually.
@@ -714,6 +635,164 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
    if (MCPU == "generic")
       MCPU = "pwr8";
 #endif
+   return MCPU;
+}
+#endif
+
+
+/**
+ * Return a malloc'ed string naming the cpu and features the generated code
+ * targets, for keying cached machine code.
+ */
+extern "C"
+char *
+lp_build_host_cpu_id(void)
+{
+   llvm::SmallVector<std::string, 16> MAttrs;
+   std::string id;
+
+#if HAVE_LLVM >= 0x0305
+   id = get_host_mcpu().str();
+#endif
+   get_host_mattrs(MAttrs);
+   for (unsigned i = 0; i < MAttrs.size(); i++)
+      id += "," + MAttrs[i];
+
+   return strdup(id.c_str());
+}
+
+
+#if HAVE_LLVM >= 0x0306
+/**
+ * Hands MCJIT the object found in the disk cache for a module instead of
+ * letting it run codegen, or stores the freshly generated object there.
+ */
+class ShaderObjectCache : public llvm::ObjectCache {
+   struct lp_cached_code *cache;
+
+public:
+   ShaderObjectCache(struct lp_cached_code *cache) : cache(cache) {}
+
+   void notifyObjectCompiled(const llvm::Module *M,
+                             llvm::MemoryBufferRef Obj) override
+   {
+      if (!cache->data) {
+         disk_cache_put(cache->disk_cache, cache->key,
+                        Obj.getBufferStart(), Obj.getBufferSize(), NULL);
+      }
+   }
+
+   std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *M) override
+   {
+      if (!cache->data)
+         return nullptr;
+      return llvm::MemoryBuffer::getMemBufferCopy(
+         llvm::StringRef((const char *)cache->data, cache->data_size));
+   }
+};
+#endif
+
+
+/**
+ * Same as LLVMCreateJITCompilerForModule, but:
+ * - allows using MCJIT and enabling AVX feature where available.
+ * - set target options
+ *
+ * See also:
+ * - llvm/lib/ExecutionEngine/ExecutionEngineBindings.cpp
+ * - llvm/tools/lli/lli.cpp
+ * - http://markmail.org/message/ttkuhvgj4cxxy2on#query:+page:1+mid:aju2dggerju3ivd3+state:results
+ */
+extern "C"
+LLVMBool
+lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
+                                        lp_generated_code **OutCode,
+                                        LLVMModuleRef M,
+                                        LLVMMCJITMemoryManagerRef CMM,
+                                        unsigned OptLevel,
+                                        int useMCJIT,
+                                        struct lp_cached_code *cache,
+                                        char **OutError)
+{
+   using namespace llvm;
+
+   std::string Error;
+#if HAVE_LLVM >= 0x0306
+   EngineBuilder builder(std::unique_ptr<Module>(unwrap(M)));
+#else
+   EngineBuilder builder(unwrap(M));
+#endif
+
+   /**
+    * LLVM 3.1+ haven't more "extern unsigned llvm::StackAlignmentOverride" and
+    * friends for configuring code generation options, like stack alignment.
+    */
+   TargetOptions options;
+#if defined(PIPE_ARCH_X86)
+   options.StackAlignmentOverride = 4;
+#if HAVE_LLVM < 0x0304
+   options.RealignStack = true;
+#endif
+#endif
+
+#if defined(DEBUG) && HAVE_LLVM < 0x0307
+   options.JITEmitDebugInfo = true;
+#endif
+
+   /* XXX: Workaround http://llvm.org/PR21435 */
+#if defined(DEBUG) || defined(PROFILE) || \
+    (HAVE_LLVM >= 0x0303 && (defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64)))
+#if HAVE_LLVM < 0x0304
+   options.NoFramePointerElimNonLeaf = true;
+#endif
+#if HAVE_LLVM < 0x0307
+   options.NoFramePointerElim = true;
+#endif
+#endif
+
+   builder.setEngineKind(EngineKind::JIT)
+          .setErrorStr(&Error)
+          .setTargetOptions(options)
+          .setOptLevel((CodeGenOpt::Level)OptLevel);
+
+   if (useMCJIT) {
+#if HAVE_LLVM < 0x0306
+       builder.setUseMCJIT(true);
+#endif
+#ifdef _WIN32
+       /*
+        * MCJIT works on Windows, but currently only through ELF object format.
+        *
+        * XXX: We could use `LLVM_HOST_TRIPLE "-elf"` but LLVM_HOST_TRIPLE has
+        * different strings for MinGW/MSVC, so better play it safe and be
+        * explicit.
+        */
+#  ifdef _WIN64
+       LLVMSetTarget(M, "x86_64-pc-win32-elf");
+#  else
+       LLVMSetTarget(M, "i686-pc-win32-elf");
+#  endif
+#endif
+   }
+
+   llvm::SmallVector<std::string, 16> MAttrs;
+
+   get_host_mattrs(MAttrs);
+
+   builder.setMAttrs(MAttrs);
+
+   if (gallivm_debug & (GALLIVM_DEBUG_IR | GALLIVM_DEBUG_ASM | GALLIVM_DEBUG_DUMP_BC)) {
+      int n = MAttrs.size();
+      if (n > 0) {
+         debug_printf("llc -mattr option(s): ");
+         for (int i = 0; i < n; i++)
+            debug_printf("%s%s", MAttrs[i].c_str(), (i < n - 1) ? "," : "");
+         debug_printf("\n");
+      }
+   }
+
+#if HAVE_LLVM >= 0x0305
+   StringRef MCPU = get_host_mcpu();
    builder.setMCPU(MCPU);
    if (gallivm_debug & (GALLIVM_DEBUG_IR | GALLIVM_DEBUG_ASM | GALLIVM_DEBUG_DUMP_BC)) {
       debug_printf("llc -mcpu option: %s\n", MCPU.str().c_str());
@@ -754,6 +833,18 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
    JIT->RegisterJITEventListener(JEL);
 #endif
    if (JIT) {
+#if HAVE_LLVM >= 0x0306
+      if (useMCJIT && cache && cache->disk_cache) {
+         /*
+          * MCJIT only consults the object cache when it generates code, so
+          * do that right away while the cache object is alive.
+          */
+         ShaderObjectCache objcache(cache);
+         JIT->setObjectCache(&objcache);
+         JIT->finalizeObject();
+         JIT->setObjectCache(NULL);
+      }
+#endif
       *OutJIT = wrap(JIT);
       return 0;
    }
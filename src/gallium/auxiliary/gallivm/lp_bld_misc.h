@@ -41,6 +41,7 @@ extern "C" {
 
 
 struct lp_generated_code;
+struct lp_cached_code;
 
 extern LLVMTargetLibraryInfoRef
 gallivm_create_target_library_info(const char *triple);
@@ -59,8 +60,12 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
                                         LLVMMCJITMemoryManagerRef MM,
                                         unsigned OptLevel,
                                         int useMCJIT,
+                                        struct lp_cached_code *cache,
                                         char **OutError);
 
+extern char *
+lp_build_host_cpu_id(void);
+
 extern void
 lp_free_generated_code(struct lp_generated_code *code);
 
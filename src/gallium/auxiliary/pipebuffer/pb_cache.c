@@ -27,10 +27,30 @@
  **************************************************************************/
 
 #include "pb_cache.h"
+#include "util/u_debug.h"
+#include "util/u_math.h"
 #include "util/u_memory.h"
+#include "util/u_thread.h"
 #include "util/os_time.h"
 
 
+/**
+ * Return the power-of-two size class of a buffer size, i.e. floor(log2).
+ */
+static inline unsigned
+pb_cache_size_class(pb_size size)
+{
+   return MAX2(util_last_bit64(size), 1) - 1;
+}
+
+static inline struct list_head *
+pb_cache_get_list(struct pb_cache *mgr, unsigned bucket_index,
+                  unsigned size_class)
+{
+   return &mgr->buckets[bucket_index * PB_CACHE_NUM_SIZE_CLASSES +
+                        size_class];
+}
+
 /**
  * Actually destroy the buffer.
  */
@@ -43,6 +63,7 @@ destroy_buffer_locked(struct pb_cache_entry *entry)
    assert(!pipe_is_referenced(&buf->reference));
    if (entry->head.next) {
       LIST_DEL(&entry->head);
+      LIST_DEL(&entry->lru);
       assert(mgr->num_buffers);
       --mgr->num_buffers;
       mgr->cache_size -= buf->size;
@@ -51,19 +72,18 @@ destroy_buffer_locked(struct pb_cache_entry *entry)
 }
 
 /**
- * Free as many cache buffers from the list head as possible.
+ * Free as many cache buffers from the LRU head as possible.
  */
 static void
-release_expired_buffers_locked(struct list_head *cache,
-                               int64_t current_time)
+release_expired_buffers_locked(struct pb_cache *mgr, int64_t current_time)
 {
    struct list_head *curr, *next;
    struct pb_cache_entry *entry;
 
-   curr = cache->next;
+   curr = mgr->lru.next;
    next = curr->next;
-   while (curr != cache) {
-      entry = LIST_ENTRY(struct pb_cache_entry, curr, head);
+   while (curr != &mgr->lru) {
+      entry = LIST_ENTRY(struct pb_cache_entry, curr, lru);
 
       if (!os_time_timeout(entry->start, entry->end, current_time))
          break;
@@ -83,28 +103,40 @@ void
 pb_cache_add_buffer(struct pb_cache_entry *entry)
 {
    struct pb_cache *mgr = entry->mgr;
-   struct list_head *cache = &mgr->buckets[entry->bucket_index];
    struct pb_buffer *buf = entry->buffer;
-   unsigned i;
+   struct list_head *cache =
+      pb_cache_get_list(mgr, entry->bucket_index,
+                        pb_cache_size_class(buf->size));
 
    mtx_lock(&mgr->mutex);
    assert(!pipe_is_referenced(&buf->reference));
 
    int64_t current_time = os_time_get();
 
-   for (i = 0; i < mgr->num_heaps; i++)
-      release_expired_buffers_locked(&mgr->buckets[i], current_time);
+   release_expired_buffers_locked(mgr, current_time);
 
    /* Directly release any buffer that exceeds the limit. */
-   if (mgr->cache_size + buf->size > mgr->max_cache_size) {
+   if (buf->size > mgr->max_cache_size) {
       mgr->destroy_buffer(buf);
       mtx_unlock(&mgr->mutex);
       return;
    }
 
-   entry->start = os_time_get();
+   /* Make room by releasing the least recently added buffers. */
+   while (mgr->cache_size + buf->size > mgr->max_cache_size) {
+      destroy_buffer_locked(LIST_ENTRY(struct pb_cache_entry,
+                                       mgr->lru.next, lru));
+      ++mgr->num_evictions;
+   }
+
+   /* The trim thread sleeps without a timeout while the cache is empty. */
+   if (mgr->has_trim_thread && LIST_IS_EMPTY(&mgr->lru))
+      cnd_signal(&mgr->trim_cond);
+
+   entry->start = current_time;
    entry->end = entry->start + mgr->usecs;
    LIST_ADDTAIL(&entry->head, cache);
+   LIST_ADDTAIL(&entry->lru, &mgr->lru);
    ++mgr->num_buffers;
    mgr->cache_size += buf->size;
    mtx_unlock(&mgr->mutex);
@@ -142,64 +174,42 @@ pb_cache_is_buffer_compat(struct pb_cache_entry *entry,
 /**
  * Find a compatible buffer in the cache, return it, and remove it
  * from the cache.
+ *
+ * Only the size classes between size and size_factor * size are searched,
+ * smallest first, and the oldest buffers of each first.
  */
 struct pb_buffer *
 pb_cache_reclaim_buffer(struct pb_cache *mgr, pb_size size,
                         unsigned alignment, unsigned usage,
                         unsigned bucket_index)
 {
-   struct pb_cache_entry *entry;
+   struct pb_cache_entry *entry = NULL;
    struct pb_cache_entry *cur_entry;
-   struct list_head *cur, *next;
-   int64_t now;
-   int ret = 0;
+   unsigned first_class, last_class, i;
 
    assert(bucket_index < mgr->num_heaps);
-   struct list_head *cache = &mgr->buckets[bucket_index];
-
-   mtx_lock(&mgr->mutex);
-
-   entry = NULL;
-   cur = cache->next;
-   next = cur->next;
 
-   /* search in the expired buffers, freeing them in the process */
-   now = os_time_get();
-   while (cur != cache) {
-      cur_entry = LIST_ENTRY(struct pb_cache_entry, cur, head);
+   first_class = pb_cache_size_class(size);
+   last_class = pb_cache_size_class((pb_size) (mgr->size_factor * size));
 
-      if (!entry && (ret = pb_cache_is_buffer_compat(cur_entry, size,
-                                                     alignment, usage)) > 0)
-         entry = cur_entry;
-      else if (os_time_timeout(cur_entry->start, cur_entry->end, now))
-         destroy_buffer_locked(cur_entry);
-      else
-         /* This buffer (and all hereafter) are still hot in cache */
-         break;
+   mtx_lock(&mgr->mutex);
 
-      /* the buffer is busy (and probably all remaining ones too) */
-      if (ret == -1)
-         break;
+   release_expired_buffers_locked(mgr, os_time_get());
 
-      cur = next;
-      next = cur->next;
-   }
+   for (i = first_class; i <= last_class && !entry; i++) {
+      struct list_head *cache = pb_cache_get_list(mgr, bucket_index, i);
 
-   /* keep searching in the hot buffers */
-   if (!entry && ret != -1) {
-      while (cur != cache) {
-         cur_entry = LIST_ENTRY(struct pb_cache_entry, cur, head);
-         ret = pb_cache_is_buffer_compat(cur_entry, size, alignment, usage);
+      LIST_FOR_EACH_ENTRY(cur_entry, cache, head) {
+         int ret = pb_cache_is_buffer_compat(cur_entry, size, alignment,
+                                             usage);
 
          if (ret > 0) {
             entry = cur_entry;
             break;
          }
+         /* the buffer is busy (and probably all remaining ones too) */
          if (ret == -1)
             break;
-         /* no need to check the timeout here */
-         cur = next;
-         next = cur->next;
       }
    }
 
@@ -209,13 +219,16 @@ pb_cache_reclaim_buffer(struct pb_cache *mgr, pb_size size,
 
       mgr->cache_size -= buf->size;
       LIST_DEL(&entry->head);
+      LIST_DEL(&entry->lru);
       --mgr->num_buffers;
+      ++mgr->num_hits;
       mtx_unlock(&mgr->mutex);
       /* Increase refcount */
       pipe_reference_init(&buf->reference, 1);
       return buf;
    }
 
+   ++mgr->num_misses;
    mtx_unlock(&mgr->mutex);
    return NULL;
 }
@@ -228,20 +241,15 @@ pb_cache_release_all_buffers(struct pb_cache *mgr)
 {
    struct list_head *curr, *next;
    struct pb_cache_entry *buf;
-   unsigned i;
 
    mtx_lock(&mgr->mutex);
-   for (i = 0; i < mgr->num_heaps; i++) {
-      struct list_head *cache = &mgr->buckets[i];
-
-      curr = cache->next;
+   curr = mgr->lru.next;
+   next = curr->next;
+   while (curr != &mgr->lru) {
+      buf = LIST_ENTRY(struct pb_cache_entry, curr, lru);
+      destroy_buffer_locked(buf);
+      curr = next;
       next = curr->next;
-      while (curr != cache) {
-         buf = LIST_ENTRY(struct pb_cache_entry, curr, head);
-         destroy_buffer_locked(buf);
-         curr = next;
-         next = curr->next;
-      }
    }
    mtx_unlock(&mgr->mutex);
 }
@@ -258,6 +266,52 @@ pb_cache_init_entry(struct pb_cache *mgr, struct pb_cache_entry *entry,
    entry->bucket_index = bucket_index;
 }
 
+/**
+ * Release buffers as they expire, instead of waiting for the next add or
+ * reclaim.
+ */
+static int
+pb_cache_trim_thread(void *data)
+{
+   struct pb_cache *mgr = (struct pb_cache *)data;
+
+   u_thread_setname("pb_cache_trim");
+
+   mtx_lock(&mgr->mutex);
+   while (!mgr->trim_thread_quit) {
+      struct pb_cache_entry *oldest;
+      struct timespec ts;
+      int64_t now, usecs;
+
+      if (LIST_IS_EMPTY(&mgr->lru)) {
+         cnd_wait(&mgr->trim_cond, &mgr->mutex);
+         continue;
+      }
+
+      now = os_time_get();
+      release_expired_buffers_locked(mgr, now);
+      if (LIST_IS_EMPTY(&mgr->lru))
+         continue;
+
+      /* Sleep until the oldest buffer expires. cnd_timedwait is relative to
+       * the TIME_UTC clock, unlike os_time_get.
+       */
+      oldest = LIST_ENTRY(struct pb_cache_entry, mgr->lru.next, lru);
+      usecs = MAX2(oldest->end - now, 1);
+
+      timespec_get(&ts, TIME_UTC);
+      ts.tv_sec += usecs / 1000000;
+      ts.tv_nsec += (usecs % 1000000) * 1000;
+      if (ts.tv_nsec >= 1000000000) {
+         ts.tv_sec++;
+         ts.tv_nsec -= 1000000000;
+      }
+      cnd_timedwait(&mgr->trim_cond, &mgr->mutex, &ts);
+   }
+   mtx_unlock(&mgr->mutex);
+   return 0;
+}
+
 /**
  * Initialize a caching buffer manager.
  *
@@ -272,7 +326,8 @@ pb_cache_init_entry(struct pb_cache *mgr, struct pb_cache_entry *entry,
  * @param bypass_usage  Bitmask. If (requested usage & bypass_usage) != 0,
  *                      buffer allocation requests are rejected.
  * @param maximum_cache_size  Maximum size of all unused buffers the cache can
- *                            hold.
+ *                            hold. The least recently added buffers are
+ *                            released to stay within it.
  * @param destroy_buffer  Function that destroys a buffer for good.
  * @param can_reclaim     Whether a buffer can be reclaimed (e.g. is not busy)
  */
@@ -285,12 +340,14 @@ pb_cache_init(struct pb_cache *mgr, uint num_heaps,
 {
    unsigned i;
 
-   mgr->buckets = CALLOC(num_heaps, sizeof(struct list_head));
+   mgr->buckets = CALLOC(num_heaps * PB_CACHE_NUM_SIZE_CLASSES,
+                         sizeof(struct list_head));
    if (!mgr->buckets)
       return;
 
-   for (i = 0; i < num_heaps; i++)
+   for (i = 0; i < num_heaps * PB_CACHE_NUM_SIZE_CLASSES; i++)
       LIST_INITHEAD(&mgr->buckets[i]);
+   LIST_INITHEAD(&mgr->lru);
 
    (void) mtx_init(&mgr->mutex, mtx_plain);
    mgr->cache_size = 0;
@@ -300,8 +357,22 @@ pb_cache_init(struct pb_cache *mgr, uint num_heaps,
    mgr->num_buffers = 0;
    mgr->bypass_usage = bypass_usage;
    mgr->size_factor = size_factor;
+   mgr->num_hits = 0;
+   mgr->num_misses = 0;
+   mgr->num_evictions = 0;
    mgr->destroy_buffer = destroy_buffer;
    mgr->can_reclaim = can_reclaim;
+
+   mgr->has_trim_thread = false;
+   mgr->trim_thread_quit = false;
+   if (debug_get_bool_option("GALLIUM_PB_CACHE_TRIM", false)) {
+      cnd_init(&mgr->trim_cond);
+      mgr->trim_thread = u_thread_create(pb_cache_trim_thread, mgr);
+      if (mgr->trim_thread)
+         mgr->has_trim_thread = true;
+      else
+         cnd_destroy(&mgr->trim_cond);
+   }
 }
 
 /**
@@ -310,6 +381,16 @@ pb_cache_init(struct pb_cache *mgr, uint num_heaps,
 void
 pb_cache_deinit(struct pb_cache *mgr)
 {
+   if (mgr->has_trim_thread) {
+      mtx_lock(&mgr->mutex);
+      mgr->trim_thread_quit = true;
+      cnd_signal(&mgr->trim_cond);
+      mtx_unlock(&mgr->mutex);
+      thrd_join(mgr->trim_thread, NULL);
+      cnd_destroy(&mgr->trim_cond);
+      mgr->has_trim_thread = false;
+   }
+
    pb_cache_release_all_buffers(mgr);
    mtx_destroy(&mgr->mutex);
    FREE(mgr->buckets);
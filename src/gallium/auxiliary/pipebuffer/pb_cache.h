@@ -33,12 +33,20 @@
 #include "util/list.h"
 #include "os/os_thread.h"
 
+/**
+ * Buffers of each heap are further divided by size into power-of-two
+ * classes, so that a lookup only visits the lists of the sizes that can
+ * match.
+ */
+#define PB_CACHE_NUM_SIZE_CLASSES 64
+
 /**
  * Statically inserted into the driver-specific buffer structure.
  */
 struct pb_cache_entry
 {
-   struct list_head head;
+   struct list_head head; /**< In the list of its heap and size class */
+   struct list_head lru;  /**< In the list of all cached buffers */
    struct pb_buffer *buffer; /**< Pointer to the structure this is part of. */
    struct pb_cache *mgr;
    int64_t start, end; /**< Caching time interval */
@@ -49,9 +57,15 @@ struct pb_cache
 {
    /* The cache is divided into buckets for minimizing cache misses.
     * The driver controls which buffer goes into which bucket.
+    * Each bucket has PB_CACHE_NUM_SIZE_CLASSES lists.
     */
    struct list_head *buckets;
 
+   /* All cached buffers, least recently added first. As all buffers are
+    * cached for the same time, this is also the order in which they expire.
+    */
+   struct list_head lru;
+
    mtx_t mutex;
    uint64_t cache_size;
    uint64_t max_cache_size;
@@ -61,6 +75,19 @@ struct pb_cache
    unsigned bypass_usage;
    float size_factor;
 
+   /* Statistics. */
+   uint64_t num_hits;
+   uint64_t num_misses;
+   uint64_t num_evictions; /**< buffers released to stay within the budget */
+
+   /* Optional thread releasing expired buffers (GALLIUM_PB_CACHE_TRIM),
+    * so that memory isn't kept after bursts until the next allocation.
+    */
+   bool has_trim_thread;
+   bool trim_thread_quit;
+   thrd_t trim_thread;
+   cnd_t trim_cond;
+
    void (*destroy_buffer)(struct pb_buffer *buf);
    bool (*can_reclaim)(struct pb_buffer *buf);
 };
@@ -58,10 +58,12 @@
 #include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_util.h"
 #include "tgsi_exec.h"
+#include "util/u_debug.h"
 #include "util/u_half.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
 #include "util/rounding.h"
+#include "util/u_sse.h"
 
 
 #define DEBUG_EXECUTION 0
@@ -1085,6 +1087,748 @@ tgsi_check_soa_dependencies(const struct tgsi_full_instruction *inst)
 }
 
 
+/*
+ * Pre-decoded instructions.
+ *
+ * When a shader is bound, the instructions which are plain float
+ * arithmetic (MOV, ADD, MUL, MAD, DP3, DP4) on directly addressed registers
+ * are decoded once more, into a tgsi_exec_op: the function which executes
+ * the instruction, and pointers to the register channels it reads and
+ * writes.  Runs of such instructions are then executed by calling those
+ * functions one after the other, without going through exec_instruction(),
+ * fetch_source() and store_dest() for every instruction and channel.
+ *
+ * A few common sequences are fused into one op:
+ *
+ *  - MUL/MAD/ADD chains each reading the previous result from a
+ *    temporary, as generated for matrix * vector products and texture
+ *    coordinate transforms, keep that result in registers and skip the
+ *    stores which the next instruction overwrites;
+ *  - consecutive DP3s or DP4s of the same vector, as generated for matrix
+ *    transforms, fetch that vector once.
+ *
+ * Everything is computed exactly as exec_instruction() would, with the
+ * same float operations in the same order, so the results are identical.
+ * Ops[pc] is valid for every pc which starts a run, so jumping into the
+ * middle of a run works too.
+ */
+
+#if defined(PIPE_ARCH_SSE)
+
+typedef __m128 fast_chan;
+
+static inline fast_chan
+fast_load(const union tgsi_exec_channel *chan)
+{
+   return _mm_loadu_ps(chan->f);
+}
+
+static inline void
+fast_store(union tgsi_exec_channel *chan, fast_chan v)
+{
+   _mm_storeu_ps(chan->f, v);
+}
+
+static inline fast_chan
+fast_splat(uint u)
+{
+   /* through the integer unit, not to touch NaNs */
+   return _mm_castsi128_ps(_mm_set1_epi32(u));
+}
+
+static inline fast_chan
+fast_add(fast_chan a, fast_chan b)
+{
+   return _mm_add_ps(a, b);
+}
+
+static inline fast_chan
+fast_mul(fast_chan a, fast_chan b)
+{
+   return _mm_mul_ps(a, b);
+}
+
+static inline fast_chan
+fast_abs(fast_chan a)
+{
+   return _mm_and_ps(a, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+}
+
+static inline fast_chan
+fast_neg(fast_chan a)
+{
+   return _mm_xor_ps(a, _mm_castsi128_ps(_mm_set1_epi32(0x80000000)));
+}
+
+/** Like store_dest(): NaNs are left alone */
+static inline fast_chan
+fast_saturate(fast_chan a)
+{
+   const __m128 one = _mm_set1_ps(1.0f);
+   const __m128 lt = _mm_cmplt_ps(a, _mm_setzero_ps());
+   const __m128 gt = _mm_cmpgt_ps(a, one);
+
+   a = _mm_andnot_ps(lt, a);
+   return _mm_or_ps(_mm_andnot_ps(gt, a), _mm_and_ps(gt, one));
+}
+
+#else /* !PIPE_ARCH_SSE */
+
+typedef union tgsi_exec_channel fast_chan;
+
+static inline fast_chan
+fast_load(const union tgsi_exec_channel *chan)
+{
+   return *chan;
+}
+
+static inline void
+fast_store(union tgsi_exec_channel *chan, fast_chan v)
+{
+   *chan = v;
+}
+
+static inline fast_chan
+fast_splat(uint u)
+{
+   fast_chan r;
+   r.u[0] = r.u[1] = r.u[2] = r.u[3] = u;
+   return r;
+}
+
+static inline fast_chan
+fast_add(fast_chan a, fast_chan b)
+{
+   fast_chan r;
+   uint i;
+
+   for (i = 0; i < TGSI_QUAD_SIZE; i++)
+      r.f[i] = a.f[i] + b.f[i];
+   return r;
+}
+
+static inline fast_chan
+fast_mul(fast_chan a, fast_chan b)
+{
+   fast_chan r;
+   uint i;
+
+   for (i = 0; i < TGSI_QUAD_SIZE; i++)
+      r.f[i] = a.f[i] * b.f[i];
+   return r;
+}
+
+static inline fast_chan
+fast_abs(fast_chan a)
+{
+   uint i;
+
+   for (i = 0; i < TGSI_QUAD_SIZE; i++)
+      a.f[i] = fabsf(a.f[i]);
+   return a;
+}
+
+static inline fast_chan
+fast_neg(fast_chan a)
+{
+   uint i;
+
+   for (i = 0; i < TGSI_QUAD_SIZE; i++)
+      a.f[i] = -a.f[i];
+   return a;
+}
+
+static inline fast_chan
+fast_saturate(fast_chan a)
+{
+   uint i;
+
+   for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+      if (a.f[i] < 0.0f)
+         a.f[i] = 0.0f;
+      else if (a.f[i] > 1.0f)
+         a.f[i] = 1.0f;
+   }
+   return a;
+}
+
+#endif /* !PIPE_ARCH_SSE */
+
+
+enum fast_src_kind {
+   FAST_SRC_CHANNEL,    /**< a channel of Temps, Inputs, Outputs etc. */
+   FAST_SRC_SCALAR,     /**< an immediate, replicated */
+   FAST_SRC_CONST       /**< a constant, replicated and bounds checked */
+};
+
+/** A pre-decoded source operand, all four channels of it swizzled */
+struct tgsi_exec_fast_src
+{
+   enum fast_src_kind kind;
+   boolean absolute;
+   boolean negate;
+   unsigned buf;
+   union {
+      const union tgsi_exec_channel *chan[TGSI_NUM_CHANNELS];
+      const uint *scalar[TGSI_NUM_CHANNELS];
+      int pos[TGSI_NUM_CHANNELS];
+   } u;
+};
+
+/** A pre-decoded destination operand: a temporary or an output */
+struct tgsi_exec_fast_dst
+{
+   unsigned file;
+   unsigned index;
+   unsigned writemask;
+   boolean saturate;
+};
+
+struct tgsi_exec_op;
+
+typedef void (* tgsi_exec_op_func)(struct tgsi_exec_machine *mach,
+                                   const struct tgsi_exec_op *op);
+
+struct tgsi_exec_op
+{
+   /** Executes the op, NULL if the instruction isn't pre-decoded */
+   tgsi_exec_op_func run;
+   /** Number of instructions run executes */
+   unsigned length;
+   /** Number of pre-decoded instructions from this one on */
+   unsigned block;
+
+   unsigned opcode;
+   struct tgsi_exec_fast_dst dst;
+   struct tgsi_exec_fast_src src[3];
+
+   /**
+    * In a MUL/MAD/ADD chain: the source which reads the previous
+    * instruction's result, and whether the result is overwritten by the
+    * next instruction before anything reads it.
+    */
+   int acc_src;
+   boolean dead_store;
+};
+
+
+static inline fast_chan
+fetch_fast_src(const struct tgsi_exec_machine *mach,
+               const struct tgsi_exec_fast_src *src,
+               uint chan)
+{
+   fast_chan r;
+
+   switch (src->kind) {
+   case FAST_SRC_CHANNEL:
+      r = fast_load(src->u.chan[chan]);
+      break;
+   case FAST_SRC_SCALAR:
+      r = fast_splat(*src->u.scalar[chan]);
+      break;
+   default: {
+      /* same bounds check as fetch_src_file_channel() */
+      const int pos = src->u.pos[chan];
+
+      if (pos < 0 || pos >= (int) mach->ConstsSize[src->buf])
+         r = fast_splat(0);
+      else
+         r = fast_splat(((const uint *) mach->Consts[src->buf])[pos]);
+      break;
+   }
+   }
+
+   if (src->absolute)
+      r = fast_abs(r);
+   if (src->negate)
+      r = fast_neg(r);
+
+   return r;
+}
+
+static inline void
+store_fast_dst(struct tgsi_exec_machine *mach,
+               const struct tgsi_exec_fast_dst *dst,
+               const fast_chan *r)
+{
+   const uint execmask = mach->ExecMask;
+   struct tgsi_exec_vector *reg;
+   uint chan, i;
+
+   if (dst->file == TGSI_FILE_TEMPORARY)
+      reg = &mach->Temps[dst->index];
+   else
+      reg = &mach->Outputs[mach->Temps[TEMP_OUTPUT_I].xyzw[TEMP_OUTPUT_C].u[0]
+                           + dst->index];
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (dst->writemask & (1 << chan)) {
+         const fast_chan v = dst->saturate ? fast_saturate(r[chan]) : r[chan];
+
+         if (execmask == 0xf) {
+            fast_store(&reg->xyzw[chan], v);
+         }
+         else {
+            union tgsi_exec_channel tmp;
+
+            fast_store(&tmp, v);
+            for (i = 0; i < TGSI_QUAD_SIZE; i++)
+               if (execmask & (1 << i))
+                  reg->xyzw[chan].u[i] = tmp.u[i];
+         }
+      }
+   }
+}
+
+/**
+ * One channel of a MOV, ADD, MUL or MAD.  If acc is not NULL, it replaces
+ * source op->acc_src.
+ */
+static inline fast_chan
+exec_fast_alu_channel(const struct tgsi_exec_machine *mach,
+                      const struct tgsi_exec_op *op,
+                      unsigned opcode,
+                      uint chan,
+                      const fast_chan *acc)
+{
+   fast_chan a, b, c;
+
+   a = acc && op->acc_src == 0 ? *acc : fetch_fast_src(mach, &op->src[0], chan);
+   if (opcode == TGSI_OPCODE_MOV)
+      return a;
+
+   b = acc && op->acc_src == 1 ? *acc : fetch_fast_src(mach, &op->src[1], chan);
+   if (opcode == TGSI_OPCODE_ADD)
+      return fast_add(a, b);
+   if (opcode == TGSI_OPCODE_MUL)
+      return fast_mul(a, b);
+
+   c = acc && op->acc_src == 2 ? *acc : fetch_fast_src(mach, &op->src[2], chan);
+   return fast_add(fast_mul(a, b), c);
+}
+
+#define FAST_ALU(NAME, OPCODE)                                          \
+static void                                                             \
+NAME(struct tgsi_exec_machine *mach, const struct tgsi_exec_op *op)     \
+{                                                                       \
+   fast_chan r[TGSI_NUM_CHANNELS];                                      \
+   uint chan;                                                           \
+                                                                        \
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {                   \
+      if (op->dst.writemask & (1 << chan))                              \
+         r[chan] = exec_fast_alu_channel(mach, op, OPCODE, chan, NULL); \
+   }                                                                    \
+   store_fast_dst(mach, &op->dst, r);                                   \
+}
+
+FAST_ALU(exec_fast_mov, TGSI_OPCODE_MOV)
+FAST_ALU(exec_fast_add, TGSI_OPCODE_ADD)
+FAST_ALU(exec_fast_mul, TGSI_OPCODE_MUL)
+FAST_ALU(exec_fast_mad, TGSI_OPCODE_MAD)
+
+/**
+ * A chain of op->length MOV/ADD/MUL/MADs, each reading the previous one's
+ * result.
+ */
+static void
+exec_fast_alu_chain(struct tgsi_exec_machine *mach,
+                    const struct tgsi_exec_op *op)
+{
+   const struct tgsi_exec_op *end = op + op->length;
+   fast_chan acc[TGSI_NUM_CHANNELS];
+   uint chan;
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (op->dst.writemask & (1 << chan))
+         acc[chan] = exec_fast_alu_channel(mach, op, op->opcode, chan, NULL);
+   }
+
+   for (;;) {
+      if (!op->dead_store || op + 1 == end)
+         store_fast_dst(mach, &op->dst, acc);
+      if (++op == end)
+         break;
+
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+         if (op->dst.writemask & (1 << chan))
+            acc[chan] = exec_fast_alu_channel(mach, op, op->opcode, chan,
+                                              &acc[chan]);
+      }
+   }
+}
+
+/** Like exec_dp3()/exec_dp4(), src0 being already fetched */
+static inline fast_chan
+exec_fast_dp_channel(const struct tgsi_exec_machine *mach,
+                     const struct tgsi_exec_op *op,
+                     const fast_chan *src0,
+                     uint num_chan)
+{
+   fast_chan r;
+   uint chan;
+
+   r = fast_mul(src0[0], fetch_fast_src(mach, &op->src[1], 0));
+   for (chan = 1; chan < num_chan; chan++) {
+      const fast_chan src1 = fetch_fast_src(mach, &op->src[1], chan);
+
+      r = fast_add(fast_mul(src0[chan], src1), r);
+   }
+   return r;
+}
+
+/** op->length DP3s or DP4s of the same src0 */
+static void
+exec_fast_dp(struct tgsi_exec_machine *mach, const struct tgsi_exec_op *op)
+{
+   const struct tgsi_exec_op *end = op + op->length;
+   const uint num_chan = op->opcode == TGSI_OPCODE_DP4 ? 4 : 3;
+   fast_chan src0[TGSI_NUM_CHANNELS];
+   uint chan;
+
+   for (chan = 0; chan < num_chan; chan++)
+      src0[chan] = fetch_fast_src(mach, &op->src[0], chan);
+
+   for (; op < end; op++) {
+      fast_chan r[TGSI_NUM_CHANNELS];
+
+      r[0] = exec_fast_dp_channel(mach, op, src0, num_chan);
+      r[1] = r[2] = r[3] = r[0];
+      store_fast_dst(mach, &op->dst, r);
+   }
+}
+
+
+static boolean
+decode_fast_src(const struct tgsi_exec_machine *mach,
+                const struct tgsi_full_src_register *reg,
+                struct tgsi_exec_fast_src *src)
+{
+   const int index = reg->Register.Index;
+   const int index2D = reg->Register.Dimension ? reg->Dimension.Index : 0;
+   uint chan;
+
+   if (reg->Register.Indirect ||
+       (reg->Register.Dimension && reg->Dimension.Indirect) ||
+       index < 0 || index2D < 0)
+      return FALSE;
+
+   memset(src, 0, sizeof *src);
+   src->absolute = reg->Register.Absolute;
+   src->negate = reg->Register.Negate;
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      const uint swizzle = tgsi_util_get_full_src_register_swizzle(reg, chan);
+
+      switch (reg->Register.File) {
+      case TGSI_FILE_TEMPORARY:
+         if (index2D || index >= TGSI_EXEC_NUM_TEMPS)
+            return FALSE;
+         src->kind = FAST_SRC_CHANNEL;
+         src->u.chan[chan] = &mach->Temps[index].xyzw[swizzle];
+         break;
+      case TGSI_FILE_INPUT: {
+         const int pos = index2D * TGSI_EXEC_MAX_INPUT_ATTRIBS + index;
+
+         if (!mach->Inputs)
+            return FALSE;
+         src->kind = FAST_SRC_CHANNEL;
+         src->u.chan[chan] = &mach->Inputs[pos].xyzw[swizzle];
+         break;
+      }
+      case TGSI_FILE_SYSTEM_VALUE:
+         if (index >= TGSI_MAX_MISC_INPUTS)
+            return FALSE;
+         src->kind = FAST_SRC_CHANNEL;
+         src->u.chan[chan] = &mach->SystemValue[index].xyzw[swizzle];
+         break;
+      case TGSI_FILE_OUTPUT:
+         if (index2D || !mach->Outputs)
+            return FALSE;
+         src->kind = FAST_SRC_CHANNEL;
+         src->u.chan[chan] = &mach->Outputs[index].xyzw[swizzle];
+         break;
+      case TGSI_FILE_IMMEDIATE:
+         if (index2D || index >= (int) mach->ImmLimit)
+            return FALSE;
+         src->kind = FAST_SRC_SCALAR;
+         src->u.scalar[chan] = (const uint *) &mach->Imms[index][swizzle];
+         break;
+      case TGSI_FILE_CONSTANT:
+         if (index2D >= PIPE_MAX_CONSTANT_BUFFERS)
+            return FALSE;
+         src->kind = FAST_SRC_CONST;
+         src->buf = index2D;
+         src->u.pos[chan] = index * 4 + swizzle;
+         break;
+      default:
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+static boolean
+fast_src_equal(const struct tgsi_exec_fast_src *a,
+               const struct tgsi_exec_fast_src *b)
+{
+   /* decode_fast_src() cleared the padding */
+   return memcmp(a, b, sizeof *a) == 0;
+}
+
+static boolean
+decode_fast_dst(const struct tgsi_exec_machine *mach,
+                const struct tgsi_full_instruction *inst,
+                struct tgsi_exec_fast_dst *dst)
+{
+   const struct tgsi_full_dst_register *reg = &inst->Dst[0];
+
+   if (inst->Instruction.NumDstRegs != 1 ||
+       reg->Register.Indirect || reg->Register.Dimension)
+      return FALSE;
+
+   switch (reg->Register.File) {
+   case TGSI_FILE_TEMPORARY:
+      if (reg->Register.Index >= TGSI_EXEC_NUM_TEMPS)
+         return FALSE;
+      break;
+   case TGSI_FILE_OUTPUT:
+      if (!mach->Outputs)
+         return FALSE;
+      break;
+   default:
+      return FALSE;
+   }
+
+   dst->file = reg->Register.File;
+   dst->index = reg->Register.Index;
+   dst->writemask = reg->Register.WriteMask;
+   dst->saturate = inst->Instruction.Saturate;
+   return TRUE;
+}
+
+static boolean
+decode_fast_op(const struct tgsi_exec_machine *mach,
+               const struct tgsi_full_instruction *inst,
+               struct tgsi_exec_op *op)
+{
+   uint i;
+
+   switch (inst->Instruction.Opcode) {
+   case TGSI_OPCODE_MOV:
+      op->run = exec_fast_mov;
+      break;
+   case TGSI_OPCODE_ADD:
+      op->run = exec_fast_add;
+      break;
+   case TGSI_OPCODE_MUL:
+      op->run = exec_fast_mul;
+      break;
+   case TGSI_OPCODE_MAD:
+      op->run = exec_fast_mad;
+      break;
+   case TGSI_OPCODE_DP3:
+   case TGSI_OPCODE_DP4:
+      op->run = exec_fast_dp;
+      break;
+   default:
+      return FALSE;
+   }
+
+   if (inst->Instruction.NumSrcRegs > ARRAY_SIZE(op->src) ||
+       !decode_fast_dst(mach, inst, &op->dst))
+      return FALSE;
+   for (i = 0; i < inst->Instruction.NumSrcRegs; i++) {
+      if (!decode_fast_src(mach, &inst->Src[i], &op->src[i]))
+         return FALSE;
+   }
+
+   op->opcode = inst->Instruction.Opcode;
+   op->length = 1;
+   op->acc_src = -1;
+   return TRUE;
+}
+
+static boolean
+src_reads_dst(const struct tgsi_full_src_register *src,
+              const struct tgsi_full_dst_register *dst)
+{
+   return src->Register.File == dst->Register.File &&
+          src->Register.Index == dst->Register.Index;
+}
+
+static boolean
+src_is_plain_dst(const struct tgsi_full_src_register *src,
+                 const struct tgsi_full_dst_register *dst)
+{
+   return src_reads_dst(src, dst) &&
+          !src->Register.Absolute && !src->Register.Negate &&
+          src->Register.SwizzleX == TGSI_SWIZZLE_X &&
+          src->Register.SwizzleY == TGSI_SWIZZLE_Y &&
+          src->Register.SwizzleZ == TGSI_SWIZZLE_Z &&
+          src->Register.SwizzleW == TGSI_SWIZZLE_W;
+}
+
+/**
+ * Can instruction b of an ALU chain take instruction a's result from
+ * registers?  Returns the source which reads it, or -1.
+ */
+static int
+chain_src(const struct tgsi_full_instruction *a,
+          const struct tgsi_full_instruction *b)
+{
+   const struct tgsi_full_dst_register *dst = &a->Dst[0];
+   int acc_src = -1;
+   uint i;
+
+   /* Outputs are written at the current vertex's offset but read without
+    * it, which differs from the stored result after a geometry shader's
+    * first EMIT.
+    */
+   if (a->Instruction.Saturate || dst->Register.File != TGSI_FILE_TEMPORARY)
+      return -1;
+
+   switch (b->Instruction.Opcode) {
+   case TGSI_OPCODE_ADD:
+      acc_src = src_is_plain_dst(&b->Src[0], dst) ? 0 : 1;
+      break;
+   case TGSI_OPCODE_MAD:
+      acc_src = 2;
+      break;
+   default:
+      return -1;
+   }
+
+   if (!src_is_plain_dst(&b->Src[acc_src], dst))
+      return -1;
+   for (i = 0; i < b->Instruction.NumSrcRegs; i++) {
+      if (i != acc_src && src_reads_dst(&b->Src[i], dst))
+         return -1;
+   }
+
+   return acc_src;
+}
+
+/**
+ * Can a DP3/DP4 be run together with the previous ones, ops first..last-1,
+ * fetching src0 once?
+ */
+static boolean
+dp_can_group(const struct tgsi_full_instruction *first,
+             const struct tgsi_exec_op *ops, uint last)
+{
+   const struct tgsi_full_instruction *inst = first + last;
+   uint i;
+
+   if (inst->Instruction.Opcode != first->Instruction.Opcode ||
+       !ops[last].run ||
+       !fast_src_equal(&ops[last].src[0], &ops[0].src[0]))
+      return FALSE;
+
+   /* no instruction may write what any of them reads */
+   for (i = 0; i <= last; i++) {
+      if (src_reads_dst(&first[i].Src[0], &inst->Dst[0]) ||
+          src_reads_dst(&first[i].Src[1], &inst->Dst[0]) ||
+          src_reads_dst(&inst->Src[0], &first[i].Dst[0]) ||
+          src_reads_dst(&inst->Src[1], &first[i].Dst[0]))
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+/**
+ * Build mach->Ops from mach->Instructions.
+ */
+static void
+decode_instructions(struct tgsi_exec_machine *mach)
+{
+   const struct tgsi_full_instruction *insts = mach->Instructions;
+   const uint num = mach->NumInstructions;
+   struct tgsi_exec_op *ops;
+   uint i, j;
+
+   FREE(mach->Ops);
+   mach->Ops = NULL;
+
+   if (!mach->Predecode || DEBUG_EXECUTION || !num)
+      return;
+
+   ops = CALLOC(num, sizeof *ops);
+   if (!ops)
+      return;
+
+   for (i = 0; i < num; i++) {
+      if (!decode_fast_op(mach, &insts[i], &ops[i]))
+         memset(&ops[i], 0, sizeof ops[i]);
+   }
+
+   /* ALU chains */
+   for (i = 1; i < num; i++) {
+      /* the previous result must be there for every channel written */
+      if (ops[i - 1].run && ops[i].run &&
+          ops[i - 1].opcode != TGSI_OPCODE_DP3 &&
+          ops[i - 1].opcode != TGSI_OPCODE_DP4 &&
+          !(ops[i].dst.writemask & ~ops[i - 1].dst.writemask)) {
+         ops[i].acc_src = chain_src(&insts[i - 1], &insts[i]);
+         ops[i - 1].dead_store =
+            ops[i].acc_src >= 0 &&
+            ops[i].dst.file == ops[i - 1].dst.file &&
+            ops[i].dst.index == ops[i - 1].dst.index &&
+            ops[i].dst.writemask == ops[i - 1].dst.writemask;
+      }
+   }
+   for (i = 0; i < num; i++) {
+      if (ops[i].run && ops[i].opcode != TGSI_OPCODE_DP3 &&
+          ops[i].opcode != TGSI_OPCODE_DP4) {
+         for (j = i + 1; j < num && ops[j].run && ops[j].acc_src >= 0; j++)
+            ;
+         if (j - i > 1) {
+            ops[i].run = exec_fast_alu_chain;
+            ops[i].length = j - i;
+         }
+      }
+   }
+
+   /* DP3/DP4 groups */
+   for (i = 0; i < num; i++) {
+      if (ops[i].opcode == TGSI_OPCODE_DP3 ||
+          ops[i].opcode == TGSI_OPCODE_DP4) {
+         for (j = 1; i + j < num && j < 4; j++) {
+            if (!dp_can_group(&insts[i], &ops[i], j))
+               break;
+         }
+         ops[i].length = j;
+      }
+   }
+
+   for (i = num; i-- > 0; ) {
+      if (ops[i].run)
+         ops[i].block = i + 1 < num ? ops[i + 1].block + 1 : 1;
+   }
+
+   mach->Ops = ops;
+}
+
+/**
+ * Execute the run of pre-decoded instructions starting at pc.
+ * \return the pc of the first instruction after it
+ */
+static int
+exec_fast_block(struct tgsi_exec_machine *mach, int pc)
+{
+   const struct tgsi_exec_op *op = &mach->Ops[pc];
+   const struct tgsi_exec_op *end = op + op->block;
+
+   do {
+      op->run(mach, op);
+      op += op->length;
+   } while (op < end);
+
+   return pc + mach->Ops[pc].block;
+}
+
+
 /**
  * Initialize machine state by expanding tokens to full instructions,
  * allocating temporary storage, setting up constants, etc.
@@ -1127,6 +1871,9 @@ tgsi_exec_machine_bind_shader(
       mach->Instructions = NULL;
       mach->NumInstructions = 0;
 
+      FREE(mach->Ops);
+      mach->Ops = NULL;
+
       return;
    }
 
@@ -1273,6 +2020,8 @@ tgsi_exec_machine_bind_shader(
    FREE(mach->Instructions);
    mach->Instructions = instructions;
    mach->NumInstructions = numInstructions;
+
+   decode_instructions(mach);
 }
 
 
@@ -1291,6 +2040,7 @@ tgsi_exec_machine_create(enum pipe_shader_type shader_type)
    mach->ShaderType = shader_type;
    mach->Addrs = &mach->Temps[TGSI_EXEC_TEMP_ADDR];
    mach->MaxGeometryShaderOutputs = TGSI_MAX_TOTAL_VERTICES;
+   mach->Predecode = debug_get_bool_option("TGSI_EXEC_PREDECODE", TRUE);
 
    if (shader_type != PIPE_SHADER_COMPUTE) {
       mach->Inputs = align_malloc(sizeof(struct tgsi_exec_vector) * PIPE_MAX_SHADER_INPUTS, 16);
@@ -1337,6 +2087,7 @@ tgsi_exec_machine_destroy(struct tgsi_exec_machine *mach)
    if (mach) {
       FREE(mach->Instructions);
       FREE(mach->Declarations);
+      FREE(mach->Ops);
 
       align_free(mach->Inputs);
       align_free(mach->Outputs);
@@ -6141,6 +6892,11 @@ tgsi_exec_machine_run( struct tgsi_exec_machine *mach, int start_pc )
 #endif
 
          assert(mach->pc < (int) mach->NumInstructions);
+         if (mach->Ops && mach->Ops[mach->pc].block) {
+            mach->pc = exec_fast_block(mach, mach->pc);
+            continue;
+         }
+
          barrier_hit = exec_instruction(mach, mach->Instructions + mach->pc, &mach->pc);
 
          /* for compute shaders if we hit a barrier return now for later rescheduling */
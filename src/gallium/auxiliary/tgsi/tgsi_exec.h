@@ -342,6 +342,8 @@ enum tgsi_break_type {
 #define TGSI_EXEC_MAX_BREAK_STACK (TGSI_EXEC_MAX_LOOP_NESTING + TGSI_EXEC_MAX_SWITCH_NESTING)
 
 
+struct tgsi_exec_op;
+
 /**
  * Run-time virtual machine state for executing TGSI shader.
  */
@@ -442,6 +444,11 @@ struct tgsi_exec_machine
    struct tgsi_full_instruction *Instructions;
    uint NumInstructions;
 
+   /** Instructions pre-decoded for faster execution, or NULL */
+   struct tgsi_exec_op *Ops;
+   /** Whether to pre-decode them (TGSI_EXEC_PREDECODE, default true) */
+   boolean Predecode;
+
    struct tgsi_full_declaration *Declarations;
    uint NumDeclarations;
 
@@ -64,7 +64,9 @@ struct translate_buffer_variant
 
 #define ELEMENT_BUFFER_INSTANCE_ID  1001
 
-#define NUM_CONSTS 7
+#define NUM_FLOAT_CONSTS 14
+#define NUM_INT_CONSTS 1
+#define NUM_CONSTS (NUM_FLOAT_CONSTS + NUM_INT_CONSTS)
 
 enum
 {
@@ -74,22 +76,42 @@ enum
    CONST_INV_32767,
    CONST_INV_65535,
    CONST_INV_2147483647,
-   CONST_255
+   CONST_255,
+   CONST_2POW112,
+   CONST_65536,
+   CONST_1010102_SCALE,
+   CONST_1010102_INV_UNORM,
+   CONST_1010102_INV_SNORM,
+   CONST_1010102_SIGN,
+   CONST_1010102_WRAP,
+   /* integer bit patterns, stored after the float constants */
+   CONST_1010102_MASK = NUM_FLOAT_CONSTS
 };
 
 #define C(v) {(float)(v), (float)(v), (float)(v), (float)(v)}
-static float consts[NUM_CONSTS][4] = {
+static float consts[NUM_FLOAT_CONSTS][4] = {
    {0, 0, 0, 1},
    C(1.0 / 127.0),
    C(1.0 / 255.0),
    C(1.0 / 32767.0),
    C(1.0 / 65535.0),
    C(1.0 / 2147483647.0),
-   C(255.0)
+   C(255.0),
+   C(5192296858534827628530496329220096.0), /* 2^112 */
+   C(65536.0),
+   {1.0, 1.0 / (1 << 10), 1.0 / (1 << 18), 1.0 / (1 << 28)},
+   {1.0 / 1023.0, 1.0 / 1023.0, 1.0 / 1023.0, 1.0 / 3.0},
+   {1.0 / 511.0, 1.0 / 511.0, 1.0 / 511.0, 1.0},
+   {512.0, 512.0, 512.0, 2.0},
+   {1024.0, 1024.0, 1024.0, 4.0}
 };
 
 #undef C
 
+static uint32_t int_consts[NUM_INT_CONSTS][4] = {
+   {0x3ff, 0x3ff << 10, 0x3ff << 18, 0x3 << 28}
+};
+
 struct translate_sse
 {
    struct translate translate;
@@ -329,6 +351,117 @@ emit_load_float64to32(struct translate_sse *p, struct x86_reg data,
 }
 
 
+/* this function behaves like emit_load_float32, but loads
+ * 16-bit half floats.  The conversion is exact, except that NaNs keep
+ * their mantissa.
+ */
+static boolean
+emit_load_float16to32(struct translate_sse *p, struct x86_reg data,
+                      struct x86_reg arg0, unsigned out_chans, unsigned chans)
+{
+   struct x86_reg tmpXMM = x86_make_reg(file_XMM, 1);
+
+   if (!emit_load_sse2(p, data, arg0, chans * 2))
+      return FALSE;
+   sse2_punpcklwd(p->func, data, get_const(p, CONST_IDENTITY));
+
+   /* magnitude bits in place for a float with the half exponent bias, then
+    * rebias by multiplying with 2^112, which also normalizes denormals
+    */
+   sse_movaps(p->func, tmpXMM, data);
+   sse2_pslld_imm(p->func, tmpXMM, 17);
+   sse2_psrld_imm(p->func, tmpXMM, 4);
+   sse2_psrld_imm(p->func, data, 15);
+   sse2_pslld_imm(p->func, data, 31);
+   sse_mulps(p->func, tmpXMM, get_const(p, CONST_2POW112));
+   sse_orps(p->func, data, tmpXMM);
+
+   /* half infinities and NaNs end up >= 65536, give them the max exponent */
+   sse_cmpps(p->func, tmpXMM, get_const(p, CONST_65536), cc_NotLessThan);
+   sse2_psrld_imm(p->func, tmpXMM, 24);
+   sse2_pslld_imm(p->func, tmpXMM, 23);
+   sse_orps(p->func, data, tmpXMM);
+
+   if (out_chans == CHANNELS_0001)
+      sse_orps(p->func, data, get_const(p, CONST_IDENTITY));
+   return TRUE;
+}
+
+
+/* whether two channels have the same representation, wherever they are */
+static boolean
+channels_equal(const struct util_format_channel_description *a,
+               const struct util_format_channel_description *b)
+{
+   return a->type == b->type
+      && a->normalized == b->normalized
+      && a->pure_integer == b->pure_integer
+      && a->size == b->size;
+}
+
+
+/* whether the format is a 10_10_10_2 format emit_load_1010102 can load */
+static boolean
+is_1010102_format(const struct util_format_description *desc)
+{
+   static const unsigned sizes[4] = { 10, 10, 10, 2 };
+   unsigned i;
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN
+       || desc->block.bits != 32 || desc->nr_channels != 4)
+      return FALSE;
+
+   for (i = 0; i < 4; ++i) {
+      const struct util_format_channel_description *channel =
+         &desc->channel[i];
+      if (channel->size != sizes[i] || channel->shift != i * 10
+          || channel->type != desc->channel[0].type
+          || channel->normalized != desc->channel[0].normalized
+          || channel->pure_integer)
+         return FALSE;
+   }
+
+   return desc->channel[0].type == UTIL_FORMAT_TYPE_UNSIGNED
+      || desc->channel[0].type == UTIL_FORMAT_TYPE_SIGNED;
+}
+
+
+/* load a 10_10_10_2 value as four floats, in channel order */
+static void
+emit_load_1010102(struct translate_sse *p, struct x86_reg data,
+                  struct x86_reg arg0,
+                  const struct util_format_description *desc)
+{
+   struct x86_reg tmpXMM = x86_make_reg(file_XMM, 1);
+
+   /* v v v>>2 v>>2, so that the 2-bit channel stays positive for cvtdq2ps */
+   sse2_movd(p->func, data, arg0);
+   sse_movaps(p->func, tmpXMM, data);
+   sse2_psrld_imm(p->func, tmpXMM, 2);
+   sse_shufps(p->func, data, tmpXMM, SHUF(X, X, X, X));
+
+   /* mask out each channel and scale it down to its integer value */
+   sse_andps(p->func, data, get_const(p, CONST_1010102_MASK));
+   sse2_cvtdq2ps(p->func, data, data);
+   sse_mulps(p->func, data, get_const(p, CONST_1010102_SCALE));
+
+   if (desc->channel[0].type == UTIL_FORMAT_TYPE_SIGNED) {
+      /* two's complement: subtract 2^size where the top bit is set */
+      sse_movaps(p->func, tmpXMM, data);
+      sse_cmpps(p->func, tmpXMM, get_const(p, CONST_1010102_SIGN),
+                cc_NotLessThan);
+      sse_andps(p->func, tmpXMM, get_const(p, CONST_1010102_WRAP));
+      sse_subps(p->func, data, tmpXMM);
+
+      if (desc->channel[0].normalized)
+         sse_mulps(p->func, data, get_const(p, CONST_1010102_INV_SNORM));
+   }
+   else if (desc->channel[0].normalized) {
+      sse_mulps(p->func, data, get_const(p, CONST_1010102_INV_UNORM));
+   }
+}
+
+
 static void
 emit_mov64(struct translate_sse *p, struct x86_reg dst_gpr,
            struct x86_reg dst_xmm, struct x86_reg src_gpr,
@@ -471,28 +604,29 @@ translate_attr_convert(struct translate_sse *p,
         PIPE_SWIZZLE_NONE, PIPE_SWIZZLE_NONE };
    unsigned needed_chans = 0;
    unsigned imms[2] = { 0, 0x3f800000 };
+   boolean input_1010102;
 
    if (a->output_format == PIPE_FORMAT_NONE
        || a->input_format == PIPE_FORMAT_NONE)
       return FALSE;
 
-   if (input_desc->channel[0].size & 7)
+   /* 10_10_10_2 inputs are only handled by the float output path below */
+   input_1010102 = is_1010102_format(input_desc);
+
+   if ((input_desc->channel[0].size & 7) && !input_1010102)
       return FALSE;
 
    if (input_desc->colorspace != output_desc->colorspace)
       return FALSE;
 
-   for (i = 1; i < input_desc->nr_channels; ++i) {
-      if (memcmp
-          (&input_desc->channel[i], &input_desc->channel[0],
-           sizeof(input_desc->channel[0])))
+   for (i = 1; i < input_desc->nr_channels && !input_1010102; ++i) {
+      if (!channels_equal(&input_desc->channel[i], &input_desc->channel[0]))
          return FALSE;
    }
 
    for (i = 1; i < output_desc->nr_channels; ++i) {
-      if (memcmp
-          (&output_desc->channel[i], &output_desc->channel[0],
-           sizeof(output_desc->channel[0]))) {
+      if (!channels_equal(&output_desc->channel[i],
+                          &output_desc->channel[0])) {
          return FALSE;
       }
    }
@@ -522,7 +656,17 @@ translate_attr_convert(struct translate_sse *p,
             id_swizzle = FALSE;
       }
 
-      if (needed_chans > 0) {
+      if (needed_chans > 0 && input_1010102) {
+         if (!(x86_target_caps(p->func) & X86_SSE2))
+            return FALSE;
+         emit_load_1010102(p, dataXMM, src, input_desc);
+
+         if (!id_swizzle) {
+            sse_shufps(p->func, dataXMM, dataXMM,
+                       SHUF(swizzle[0], swizzle[1], swizzle[2], swizzle[3]));
+         }
+      }
+      else if (needed_chans > 0) {
          switch (input_desc->channel[0].type) {
          case UTIL_FORMAT_TYPE_UNSIGNED:
             if (!(x86_target_caps(p->func) & X86_SSE2))
@@ -626,7 +770,8 @@ translate_attr_convert(struct translate_sse *p,
 
             break;
          case UTIL_FORMAT_TYPE_FLOAT:
-            if (input_desc->channel[0].size != 32
+            if (input_desc->channel[0].size != 16
+                && input_desc->channel[0].size != 32
                 && input_desc->channel[0].size != 64) {
                return FALSE;
             }
@@ -646,6 +791,13 @@ translate_attr_convert(struct translate_sse *p,
                emit_load_float64to32(p, dataXMM, src, needed_chans,
                                      input_desc->nr_channels);
                break;
+            case 16:
+               if (!(x86_target_caps(p->func) & X86_SSE2))
+                  return FALSE;
+               if (!emit_load_float16to32(p, dataXMM, src, needed_chans,
+                                          input_desc->nr_channels))
+                  return FALSE;
+               break;
             default:
                return FALSE;
             }
@@ -883,8 +1035,10 @@ translate_attr_convert(struct translate_sse *p,
       }
       return TRUE;
    }
-   else if (!memcmp(&output_desc->channel[0], &input_desc->channel[0],
-                    sizeof(output_desc->channel[0]))) {
+   else if (input_1010102) {
+      return FALSE;
+   }
+   else if (channels_equal(&output_desc->channel[0], &input_desc->channel[0])) {
       struct x86_reg tmp = p->tmp_EAX;
       unsigned i;
 
@@ -1491,6 +1645,7 @@ translate_sse2_create(const struct translate_key *key)
 
    memset(p, 0, sizeof(*p));
    memcpy(p->consts, consts, sizeof(consts));
+   memcpy(p->consts[NUM_FLOAT_CONSTS], int_consts, sizeof(int_consts));
 
    p->translate.key = *key;
    p->translate.release = translate_sse_release;
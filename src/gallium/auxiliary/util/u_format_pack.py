@@ -610,6 +610,283 @@ def generate_pack_kernel(format, src_channel, src_native_type):
         print_channels(format, pack_into_union)
 
 
+def simd_format_type(format):
+    '''Classify the formats that also get SSE2 row kernels: linear four
+    channel formats where every channel has the same size.'''
+
+    if not is_format_supported(format) or format.colorspace != RGB:
+        return None
+
+    channel = format.array_element()
+    if channel is None or channel.pure:
+        return None
+    if format.block_size() != 4 * channel.size:
+        return None
+
+    if channel.type == UNSIGNED and channel.norm and channel.size in (8, 16):
+        return 'unorm%u' % channel.size
+    if channel.type == FLOAT and channel.size == 32:
+        return 'float32'
+    return None
+
+
+def has_simd_kernel(format, channel, pack):
+    '''Whether to generate a SSE2 kernel for unpacking to or packing from
+    the given channel type.'''
+
+    type = simd_format_type(format)
+    if type is None:
+        return False
+
+    if type == 'float32' and channel.type == FLOAT:
+        # A plain copy, which the compiler already does well
+        if pack:
+            mapping, ones = simd_pack_mapping(format)
+        else:
+            mapping, ones = simd_unpack_mapping(format)
+        if mapping == range(4) and True not in ones:
+            return False
+
+    return True
+
+
+def simd_unpack_mapping(format):
+    '''Source element of each rgba component, or None for constants, and
+    whether each component is one.'''
+
+    mapping = [None]*4
+    ones = [False]*4
+    for i in range(4):
+        swizzle = format.le_swizzles[i]
+        if swizzle < 4:
+            mapping[i] = swizzle
+        elif swizzle == SWIZZLE_1:
+            ones[i] = True
+    return mapping, ones
+
+
+def simd_pack_mapping(format):
+    '''Source rgba component of each element, or None for zero.'''
+
+    inv_swizzle = inv_swizzles(format.le_swizzles)
+    mapping = [None]*4
+    for i in range(4):
+        if format.le_channels[i].type != VOID:
+            mapping[i] = inv_swizzle[i]
+    return mapping, [False]*4
+
+
+simd_indent = ' '*12
+
+
+def sse2_byte_swizzle(dst, src, mapping, ones):
+    '''Rearrange the bytes in each 32bit element.'''
+
+    # Group the bytes moving by the same distance, so that each group takes
+    # a single shift and mask
+    groups = {}
+    for i in range(4):
+        if mapping[i] is not None:
+            delta = i - mapping[i]
+            groups[delta] = groups.get(delta, 0) | (0xff << (8*i))
+
+    terms = []
+    for delta in sorted(groups):
+        mask = groups[delta]
+        if delta > 0:
+            value = '_mm_slli_epi32(%s, %u)' % (src, 8*delta)
+            unmasked = (0xffffffff << (8*delta)) & 0xffffffff
+        elif delta < 0:
+            value = '_mm_srli_epi32(%s, %u)' % (src, -8*delta)
+            unmasked = 0xffffffff >> (-8*delta)
+        else:
+            value = src
+            unmasked = 0xffffffff
+        if mask != unmasked:
+            value = '_mm_and_si128(%s, _mm_set1_epi32(0x%08x))' % (value, mask)
+        terms.append(value)
+
+    one_mask = 0
+    for i in range(4):
+        if ones[i]:
+            one_mask |= 0xff << (8*i)
+    if one_mask:
+        terms.append('_mm_set1_epi32(0x%08x)' % one_mask)
+
+    if not terms:
+        terms.append('_mm_setzero_si128()')
+
+    print '%s__m128i %s = %s;' % (simd_indent, dst, terms[0])
+    for term in terms[1:]:
+        print '%s%s = _mm_or_si128(%s, %s);' % (simd_indent, dst, dst, term)
+
+
+def sse2_shuffle_imm(mapping):
+    identity = True
+    terms = []
+    for i in range(4):
+        if mapping[i] is None:
+            terms.append(i)
+        else:
+            terms.append(mapping[i])
+            if mapping[i] != i:
+                identity = False
+    terms.reverse()
+    return identity, '_MM_SHUFFLE(%u, %u, %u, %u)' % tuple(terms)
+
+
+def sse2_word_swizzle(var, mapping, ones):
+    '''Rearrange the 16bit words of the two pixels in var.'''
+
+    identity, imm = sse2_shuffle_imm(mapping)
+    if not identity:
+        print '%s%s = _mm_shufflehi_epi16(_mm_shufflelo_epi16(%s, %s), %s);' % (simd_indent, var, var, imm, imm)
+
+    if None in mapping:
+        keep = ['0' if mapping[i] is None else '-1' for i in range(4)]*2
+        print '%s%s = _mm_and_si128(%s, _mm_setr_epi16(%s));' % (simd_indent, var, var, ', '.join(keep))
+    if True in ones:
+        one = ['-1' if ones[i] else '0' for i in range(4)]*2
+        print '%s%s = _mm_or_si128(%s, _mm_setr_epi16(%s));' % (simd_indent, var, var, ', '.join(one))
+
+
+def sse2_float_swizzle(var, mapping, ones):
+    '''Rearrange the floats of the pixel in var.'''
+
+    identity, imm = sse2_shuffle_imm(mapping)
+    if not identity:
+        print '%s%s = _mm_shuffle_ps(%s, %s, %s);' % (simd_indent, var, var, var, imm)
+
+    if None in mapping:
+        keep = ['0' if mapping[i] is None else '-1' for i in range(4)]
+        print '%s%s = _mm_and_ps(%s, _mm_castsi128_ps(_mm_setr_epi32(%s)));' % (simd_indent, var, var, ', '.join(keep))
+    if True in ones:
+        one = ['1.0f' if ones[i] else '0.0f' for i in range(4)]
+        print '%s%s = _mm_or_ps(%s, _mm_setr_ps(%s));' % (simd_indent, var, var, ', '.join(one))
+
+
+def sse2_expand_ubytes(src):
+    '''Convert the 16 unorm8 values in src to floats in p0..p3, matching
+    ubyte_to_float().'''
+
+    print '%s__m128i lo = _mm_unpacklo_epi8(%s, _mm_setzero_si128());' % (simd_indent, src)
+    print '%s__m128i hi = _mm_unpackhi_epi8(%s, _mm_setzero_si128());' % (simd_indent, src)
+    print '%s__m128 scale = _mm_set1_ps(1.0f / 255.0f);' % simd_indent
+    for i in range(4):
+        half = ('lo', 'hi')[i / 2]
+        unpack = ('_mm_unpacklo_epi16', '_mm_unpackhi_epi16')[i % 2]
+        print '%s__m128 p%u = _mm_mul_ps(_mm_cvtepi32_ps(%s(%s, _mm_setzero_si128())), scale);' % (simd_indent, i, unpack, half)
+
+
+def sse2_pack_ubytes(dst, srcs):
+    '''Pack four vectors of ubytes in 32bit elements into dst.'''
+
+    print '%s__m128i %s = _mm_packus_epi16(_mm_packs_epi32(%s, %s), _mm_packs_epi32(%s, %s));' % ((simd_indent, dst) + tuple(srcs))
+
+
+def generate_simd_unpack_kernel(format, dst_channel):
+    '''Generate the body of a loop unpacking 4 pixels at a time.'''
+
+    type = simd_format_type(format)
+    mapping, ones = simd_unpack_mapping(format)
+    to_float = dst_channel.type == FLOAT
+
+    if type == 'unorm8':
+        print '%s__m128i pixels = _mm_loadu_si128((const __m128i *)src);' % simd_indent
+        sse2_byte_swizzle('rgba', 'pixels', mapping, ones)
+        if to_float:
+            sse2_expand_ubytes('rgba')
+            for i in range(4):
+                print '%s_mm_storeu_ps(dst + %u, p%u);' % (simd_indent, 4*i, i)
+        else:
+            print '%s_mm_storeu_si128((__m128i *)dst, rgba);' % simd_indent
+    elif type == 'unorm16':
+        print '%s__m128i p01 = _mm_loadu_si128((const __m128i *)src);' % simd_indent
+        print '%s__m128i p23 = _mm_loadu_si128((const __m128i *)src + 1);' % simd_indent
+        sse2_word_swizzle('p01', mapping, ones)
+        sse2_word_swizzle('p23', mapping, ones)
+        if to_float:
+            print '%s__m128 scale = _mm_set1_ps(1.0f / 0xffff);' % simd_indent
+            for i in range(4):
+                half = ('p01', 'p23')[i / 2]
+                unpack = ('_mm_unpacklo_epi16', '_mm_unpackhi_epi16')[i % 2]
+                print '%s_mm_storeu_ps(dst + %u, _mm_mul_ps(_mm_cvtepi32_ps(%s(%s, _mm_setzero_si128())), scale));' % (simd_indent, 4*i, unpack, half)
+        else:
+            print '%s_mm_storeu_si128((__m128i *)dst, _mm_packus_epi16(_mm_srli_epi16(p01, 8), _mm_srli_epi16(p23, 8)));' % simd_indent
+    elif type == 'float32':
+        for i in range(4):
+            print '%s__m128 p%u = _mm_loadu_ps((const float *)src + %u);' % (simd_indent, i, 4*i)
+            sse2_float_swizzle('p%u' % i, mapping, ones)
+        if to_float:
+            for i in range(4):
+                print '%s_mm_storeu_ps(dst + %u, p%u);' % (simd_indent, 4*i, i)
+        else:
+            sse2_pack_ubytes('rgba', ['mm_float_to_ubyte_epi32(p%u)' % i for i in range(4)])
+            print '%s_mm_storeu_si128((__m128i *)dst, rgba);' % simd_indent
+    else:
+        assert False
+
+
+def generate_simd_pack_kernel(format, src_channel):
+    '''Generate the body of a loop packing 4 pixels at a time.'''
+
+    type = simd_format_type(format)
+    mapping, ones = simd_pack_mapping(format)
+    from_float = src_channel.type == FLOAT
+
+    if type == 'unorm8':
+        if from_float:
+            sse2_pack_ubytes('rgba', ['mm_float_to_ubyte_epi32(_mm_loadu_ps(src + %u))' % (4*i) for i in range(4)])
+        else:
+            print '%s__m128i rgba = _mm_loadu_si128((const __m128i *)src);' % simd_indent
+        sse2_byte_swizzle('pixels', 'rgba', mapping, ones)
+        print '%s_mm_storeu_si128((__m128i *)dst, pixels);' % simd_indent
+    elif type == 'unorm16':
+        if from_float:
+            # Same as util_iround(CLAMP(x, 0.0f, 1.0f) * 0xffff), biased
+            # to fit the signed saturation of _mm_packs_epi32
+            print '%s__m128i bias = _mm_set1_epi32(0x8000);' % simd_indent
+            for i in range(4):
+                print '%s__m128i c%u = _mm_sub_epi32(mm_iround_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + %u), _mm_setzero_ps()), _mm_set1_ps(1.0f)), _mm_set1_ps(65535.0f))), bias);' % (simd_indent, i, 4*i)
+            print '%s__m128i p01 = _mm_add_epi16(_mm_packs_epi32(c0, c1), _mm_set1_epi16(-0x8000));' % simd_indent
+            print '%s__m128i p23 = _mm_add_epi16(_mm_packs_epi32(c2, c3), _mm_set1_epi16(-0x8000));' % simd_indent
+        else:
+            print '%s__m128i rgba = _mm_loadu_si128((const __m128i *)src);' % simd_indent
+            print '%s__m128i p01 = _mm_unpacklo_epi8(rgba, rgba);' % simd_indent
+            print '%s__m128i p23 = _mm_unpackhi_epi8(rgba, rgba);' % simd_indent
+        sse2_word_swizzle('p01', mapping, ones)
+        sse2_word_swizzle('p23', mapping, ones)
+        print '%s_mm_storeu_si128((__m128i *)dst, p01);' % simd_indent
+        print '%s_mm_storeu_si128((__m128i *)dst + 1, p23);' % simd_indent
+    elif type == 'float32':
+        if from_float:
+            for i in range(4):
+                print '%s__m128 p%u = _mm_loadu_ps(src + %u);' % (simd_indent, i, 4*i)
+        else:
+            print '%s__m128i rgba = _mm_loadu_si128((const __m128i *)src);' % simd_indent
+            sse2_expand_ubytes('rgba')
+        for i in range(4):
+            sse2_float_swizzle('p%u' % i, mapping, ones)
+            print '%s_mm_storeu_ps((float *)dst + %u, p%u);' % (simd_indent, 4*i, i)
+    else:
+        assert False
+
+
+def generate_simd_loop(format, kernel, channel, src_step, dst_step):
+    '''Generate a loop handling runs of 4 pixels with SSE2, leaving the rest
+    of the row to the scalar code.'''
+
+    print '#if defined(PIPE_ARCH_SSE)'
+    print '      if (util_cpu_caps.has_sse2) {'
+    print '         for(; x + 4 <= width; x += 4) {'
+    kernel(format, channel)
+    print '            src += %u;' % (4*src_step)
+    print '            dst += %u;' % (4*dst_step)
+    print '         }'
+    print '      }'
+    print '#endif'
+
+
 def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
     '''Generate the function to unpack pixels from a particular format'''
 
@@ -624,7 +901,12 @@ def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
         print '   for(y = 0; y < height; y += %u) {' % (format.block_height,)
         print '      %s *dst = dst_row;' % (dst_native_type)
         print '      const uint8_t *src = src_row;'
-        print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
+        if has_simd_kernel(format, dst_channel, False):
+            print '      x = 0;'
+            generate_simd_loop(format, generate_simd_unpack_kernel, dst_channel, format.block_size() / 8, 4)
+            print '      for(; x < width; x += %u) {' % (format.block_width,)
+        else:
+            print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
         
         generate_unpack_kernel(format, dst_channel, dst_native_type)
     
@@ -653,7 +935,12 @@ def generate_format_pack(format, src_channel, src_native_type, src_suffix):
         print '   for(y = 0; y < height; y += %u) {' % (format.block_height,)
         print '      const %s *src = src_row;' % (src_native_type)
         print '      uint8_t *dst = dst_row;'
-        print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
+        if has_simd_kernel(format, src_channel, True):
+            print '      x = 0;'
+            generate_simd_loop(format, generate_simd_pack_kernel, src_channel, 4, format.block_size() / 8)
+            print '      for(; x < width; x += %u) {' % (format.block_width,)
+        else:
+            print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
     
         generate_pack_kernel(format, src_channel, src_native_type)
             
@@ -698,6 +985,8 @@ def generate(formats):
     print '#include "util/format_srgb.h"'
     print '#include "u_format_yuv.h"'
     print '#include "u_format_zs.h"'
+    print '#include "u_cpu_detect.h"'
+    print '#include "u_sse.h"'
     print
 
     for format in formats:
@@ -36,8 +36,12 @@
 
 
 #include "util/u_gen_mipmap.h"
+#include "util/u_box.h"
 #include "util/u_format.h"
 #include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_queue.h"
+#include "util/u_sse.h"
 
 
 /**
@@ -126,3 +130,390 @@ util_gen_mipmap(struct pipe_context *pipe, struct pipe_resource *pt,
    }
    return TRUE;
 }
+
+
+/*
+ * CPU mipmap generation, for software drivers.
+ *
+ * Each texel of a level is the average of a 2x2 block of the previous
+ * level, computed the way softpipe samples the middle of the block with
+ * linear filtering, so that the result is the same as blitting.  Only
+ * reductions of power-of-two levels are done here: for other sizes the
+ * blit's texture coordinates aren't exact and it samples with other
+ * weights, so the levels from the first such size on are blitted.
+ */
+
+/** Max number of jobs a level is split into */
+#define GEN_MIPMAP_MAX_JOBS 16
+
+/** Min number of texels per job, to not hand out tiny levels */
+#define GEN_MIPMAP_MIN_JOB_TEXELS (64 * 64)
+
+
+typedef void (*gen_mipmap_row_func)(uint8_t *dst, const uint8_t *src0,
+                                    const uint8_t *src1, unsigned dst_width,
+                                    unsigned src_width, unsigned nr_channels);
+
+struct gen_mipmap_level
+{
+   const uint8_t *src;
+   unsigned src_stride, src_layer_stride;
+   unsigned src_width, src_height;
+   uint8_t *dst;
+   unsigned dst_stride, dst_layer_stride;
+   unsigned dst_width, dst_height;
+   unsigned nr_channels;
+   gen_mipmap_row_func filter_row;
+};
+
+struct gen_mipmap_job
+{
+   const struct gen_mipmap_level *level;
+   unsigned first_row, last_row; /**< rows of all layers */
+   struct util_queue_fence fence;
+};
+
+
+static inline float
+lerp_half(float v0, float v1)
+{
+   return v0 + 0.5f * (v1 - v0);
+}
+
+/**
+ * Bilinear sample in the middle of four texels, as softpipe's lerp_2d().
+ */
+static inline float
+box_filter(float v00, float v10, float v01, float v11)
+{
+   return lerp_half(lerp_half(v00, v10), lerp_half(v01, v11));
+}
+
+
+#if defined(PIPE_ARCH_SSE)
+
+static inline __m128
+lerp_half4(__m128 v0, __m128 v1)
+{
+   return _mm_add_ps(v0, _mm_mul_ps(_mm_set1_ps(0.5f),
+                                    _mm_sub_ps(v1, v0)));
+}
+
+/**
+ * Unpack four RGBA8 texels to floats, as ubyte_to_float().
+ */
+static inline void
+unpack_unorm8_4(__m128i texels, __m128 rgba[4])
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+   __m128i lo = _mm_unpacklo_epi8(texels, zero);
+   __m128i hi = _mm_unpackhi_epi8(texels, zero);
+
+   rgba[0] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale);
+   rgba[1] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale);
+   rgba[2] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale);
+   rgba[3] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale);
+}
+
+/**
+ * Convert floats in [0,1] to unorm8 in the low byte of each lane, as
+ * float_to_ubyte().
+ */
+static inline __m128i
+float4_to_unorm8(__m128 f)
+{
+   f = _mm_max_ps(_mm_min_ps(f, _mm_set1_ps(1.0f)), _mm_setzero_ps());
+   f = _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(255.0f / 256.0f)),
+                  _mm_set1_ps(32768.0f));
+   return _mm_and_si128(_mm_castps_si128(f), _mm_set1_epi32(0xff));
+}
+
+/**
+ * Filter four RGBA8 texels from two rows of eight.
+ */
+static inline void
+filter_unorm8_4x4(uint8_t *dst, const uint8_t *src0, const uint8_t *src1)
+{
+   __m128 row0[8], row1[8];
+   __m128i out[4];
+   unsigned i;
+
+   unpack_unorm8_4(_mm_loadu_si128((const __m128i *)src0), row0);
+   unpack_unorm8_4(_mm_loadu_si128((const __m128i *)(src0 + 16)), row0 + 4);
+   unpack_unorm8_4(_mm_loadu_si128((const __m128i *)src1), row1);
+   unpack_unorm8_4(_mm_loadu_si128((const __m128i *)(src1 + 16)), row1 + 4);
+
+   for (i = 0; i < 4; i++) {
+      out[i] = float4_to_unorm8(
+         lerp_half4(lerp_half4(row0[2 * i], row0[2 * i + 1]),
+                    lerp_half4(row1[2 * i], row1[2 * i + 1])));
+   }
+
+   _mm_storeu_si128((__m128i *)dst,
+                    _mm_packus_epi16(_mm_packs_epi32(out[0], out[1]),
+                                     _mm_packs_epi32(out[2], out[3])));
+}
+
+#endif /* PIPE_ARCH_SSE */
+
+
+static void
+filter_row_unorm8(uint8_t *dst, const uint8_t *src0, const uint8_t *src1,
+                  unsigned dst_width, unsigned src_width,
+                  unsigned nr_channels)
+{
+   /* Offset of the second texel of a pair, none for 1-texel wide levels */
+   const unsigned next = src_width > 1 ? nr_channels : 0;
+   unsigned x = 0, c;
+
+#if defined(PIPE_ARCH_SSE)
+   if (nr_channels == 4 && next) {
+      for (; x + 4 <= dst_width; x += 4)
+         filter_unorm8_4x4(dst + x * 4, src0 + x * 8, src1 + x * 8);
+   }
+#endif
+
+   for (; x < dst_width; x++) {
+      const uint8_t *s0 = src0 + x * 2 * nr_channels;
+      const uint8_t *s1 = src1 + x * 2 * nr_channels;
+
+      for (c = 0; c < nr_channels; c++) {
+         dst[x * nr_channels + c] =
+            float_to_ubyte(box_filter(ubyte_to_float(s0[c]),
+                                      ubyte_to_float(s0[next + c]),
+                                      ubyte_to_float(s1[c]),
+                                      ubyte_to_float(s1[next + c])));
+      }
+   }
+}
+
+
+static void
+filter_row_float32(uint8_t *dst, const uint8_t *src0, const uint8_t *src1,
+                   unsigned dst_width, unsigned src_width,
+                   unsigned nr_channels)
+{
+   const float *s0 = (const float *)src0;
+   const float *s1 = (const float *)src1;
+   float *d = (float *)dst;
+   const unsigned next = src_width > 1 ? nr_channels : 0;
+   unsigned x = 0, c;
+
+#if defined(PIPE_ARCH_SSE)
+   if (nr_channels == 4 && next) {
+      for (; x < dst_width; x++) {
+         const float *t0 = s0 + x * 8;
+         const float *t1 = s1 + x * 8;
+
+         _mm_storeu_ps(d + x * 4,
+                       lerp_half4(lerp_half4(_mm_loadu_ps(t0),
+                                             _mm_loadu_ps(t0 + 4)),
+                                  lerp_half4(_mm_loadu_ps(t1),
+                                             _mm_loadu_ps(t1 + 4))));
+      }
+   }
+#endif
+
+   for (; x < dst_width; x++) {
+      const float *t0 = s0 + x * 2 * nr_channels;
+      const float *t1 = s1 + x * 2 * nr_channels;
+
+      for (c = 0; c < nr_channels; c++) {
+         d[x * nr_channels + c] = box_filter(t0[c], t0[next + c],
+                                             t1[c], t1[next + c]);
+      }
+   }
+}
+
+
+/**
+ * Return the row filter for a format, or NULL if there is none: formats
+ * of 8-bit unorm or 32-bit float channels only, all of which are read.
+ */
+static gen_mipmap_row_func
+get_filter_row(const struct util_format_description *desc)
+{
+   const struct util_format_channel_description *chan = &desc->channel[0];
+   unsigned i, j;
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB ||
+       desc->block.width != 1 || desc->block.height != 1 ||
+       desc->block.bits != desc->nr_channels * chan->size)
+      return NULL;
+
+   for (i = 0; i < desc->nr_channels; i++) {
+      if (desc->channel[i].type != chan->type ||
+          desc->channel[i].normalized != chan->normalized ||
+          desc->channel[i].size != chan->size)
+         return NULL;
+
+      for (j = 0; j < 4; j++) {
+         if (desc->swizzle[j] == i)
+            break;
+      }
+      if (j == 4)
+         return NULL;
+   }
+
+   if (chan->type == UTIL_FORMAT_TYPE_UNSIGNED && chan->normalized &&
+       chan->size == 8)
+      return filter_row_unorm8;
+   if (chan->type == UTIL_FORMAT_TYPE_FLOAT && chan->size == 32)
+      return filter_row_float32;
+   return NULL;
+}
+
+
+static void
+gen_mipmap_job_execute(void *data, int thread_index)
+{
+   struct gen_mipmap_job *job = (struct gen_mipmap_job *)data;
+   const struct gen_mipmap_level *level = job->level;
+   unsigned row;
+
+   for (row = job->first_row; row < job->last_row; row++) {
+      unsigned layer = row / level->dst_height;
+      unsigned y = row % level->dst_height;
+      const uint8_t *src0 = level->src + layer * level->src_layer_stride;
+      const uint8_t *src1;
+
+      if (level->src_height > 1) {
+         src0 += 2 * y * level->src_stride;
+         src1 = src0 + level->src_stride;
+      } else {
+         src1 = src0;
+      }
+
+      level->filter_row(level->dst + layer * level->dst_layer_stride +
+                        y * level->dst_stride,
+                        src0, src1, level->dst_width, level->src_width,
+                        level->nr_channels);
+   }
+}
+
+
+/**
+ * Generate mipmap images on the CPU, with the same results as
+ * util_gen_mipmap() on softpipe.  Only some formats and targets are
+ * supported; FALSE is returned for the others, which must then go through
+ * util_gen_mipmap(), as must textures whose base level isn't a power of
+ * two.  Levels below a non-power-of-two one are generated with
+ * util_gen_mipmap().
+ *
+ * \param queue  if not NULL, each level is split among its threads and the
+ *               calling thread
+ *
+ * The other parameters are as for util_gen_mipmap().
+ */
+boolean
+util_gen_mipmap_cpu(struct pipe_context *pipe, struct pipe_resource *pt,
+                    enum pipe_format format, uint base_level, uint last_level,
+                    uint first_layer, uint last_layer, uint filter,
+                    struct util_queue *queue)
+{
+   const struct util_format_description *desc =
+      util_format_description(format);
+   struct gen_mipmap_job jobs[GEN_MIPMAP_MAX_JOBS];
+   gen_mipmap_row_func filter_row;
+   unsigned max_jobs = 1;
+   unsigned nr_layers = last_layer + 1 - first_layer;
+   boolean success = TRUE;
+   unsigned cpu_last_level, level, i;
+
+   if (filter != PIPE_TEX_FILTER_LINEAR ||
+       (pt->target != PIPE_TEXTURE_2D &&
+        pt->target != PIPE_TEXTURE_2D_ARRAY) ||
+       pt->nr_samples > 1 ||
+       util_format_get_blocksize(pt->format) != desc->block.bits / 8)
+      return FALSE;
+
+   filter_row = get_filter_row(desc);
+   if (!filter_row)
+      return FALSE;
+
+   for (cpu_last_level = base_level; cpu_last_level < last_level;
+        cpu_last_level++) {
+      unsigned width = u_minify(pt->width0, cpu_last_level);
+      unsigned height = u_minify(pt->height0, cpu_last_level);
+
+      if (!util_is_power_of_two_nonzero(width) ||
+          !util_is_power_of_two_nonzero(height))
+         break;
+   }
+   if (cpu_last_level == base_level)
+      return FALSE;
+
+   if (queue)
+      max_jobs = MIN2(queue->num_threads + 1, GEN_MIPMAP_MAX_JOBS);
+   for (i = 1; i < max_jobs; i++)
+      util_queue_fence_init(&jobs[i].fence);
+
+   for (level = base_level + 1; level <= cpu_last_level; level++) {
+      struct pipe_transfer *src_transfer, *dst_transfer;
+      struct gen_mipmap_level l;
+      struct pipe_box box;
+      unsigned nr_rows, nr_jobs;
+
+      l.src_width = u_minify(pt->width0, level - 1);
+      l.src_height = u_minify(pt->height0, level - 1);
+      l.dst_width = u_minify(pt->width0, level);
+      l.dst_height = u_minify(pt->height0, level);
+      l.nr_channels = desc->nr_channels;
+      l.filter_row = filter_row;
+
+      u_box_3d(0, 0, first_layer, l.src_width, l.src_height, nr_layers, &box);
+      l.src = pipe->transfer_map(pipe, pt, level - 1, PIPE_TRANSFER_READ,
+                                 &box, &src_transfer);
+      if (!l.src) {
+         success = FALSE;
+         break;
+      }
+
+      u_box_3d(0, 0, first_layer, l.dst_width, l.dst_height, nr_layers, &box);
+      l.dst = pipe->transfer_map(pipe, pt, level, PIPE_TRANSFER_WRITE,
+                                 &box, &dst_transfer);
+      if (!l.dst) {
+         pipe->transfer_unmap(pipe, src_transfer);
+         success = FALSE;
+         break;
+      }
+
+      l.src_stride = src_transfer->stride;
+      l.src_layer_stride = src_transfer->layer_stride;
+      l.dst_stride = dst_transfer->stride;
+      l.dst_layer_stride = dst_transfer->layer_stride;
+
+      nr_rows = nr_layers * l.dst_height;
+      nr_jobs = DIV_ROUND_UP(nr_rows * l.dst_width,
+                             GEN_MIPMAP_MIN_JOB_TEXELS);
+      nr_jobs = CLAMP(nr_jobs, 1, max_jobs);
+
+      for (i = 0; i < nr_jobs; i++) {
+         jobs[i].level = &l;
+         jobs[i].first_row = nr_rows * i / nr_jobs;
+         jobs[i].last_row = nr_rows * (i + 1) / nr_jobs;
+      }
+
+      for (i = 1; i < nr_jobs; i++) {
+         util_queue_add_job(queue, &jobs[i], &jobs[i].fence,
+                            gen_mipmap_job_execute, NULL);
+      }
+      gen_mipmap_job_execute(&jobs[0], 0);
+      for (i = 1; i < nr_jobs; i++)
+         util_queue_fence_wait(&jobs[i].fence);
+
+      pipe->transfer_unmap(pipe, src_transfer);
+      pipe->transfer_unmap(pipe, dst_transfer);
+   }
+
+   for (i = 1; i < max_jobs; i++)
+      util_queue_fence_destroy(&jobs[i].fence);
+
+   if (success && cpu_last_level < last_level) {
+      success = util_gen_mipmap(pipe, pt, format, cpu_last_level, last_level,
+                                first_layer, last_layer, filter);
+   }
+   return success;
+}
@@ -296,6 +296,45 @@ transpose2_64_2_32(const __m128i * restrict a01,
 #define SCALAR_EPI32(m, i) _mm_shuffle_epi32((m), _MM_SHUFFLE(i,i,i,i))
 
 
+/*
+ * Same as float_to_ubyte() for each element, with the result in the low
+ * byte of each dword.
+ */
+static inline __m128i
+mm_float_to_ubyte_epi32(const __m128 f)
+{
+   __m128i bits = _mm_castps_si128(f);
+   __m128i zero = _mm_cmplt_epi32(bits, _mm_setzero_si128());
+   __m128i one  = _mm_cmpgt_epi32(bits, _mm_set1_epi32(0x3f7fffff));
+   __m128 tmp   = _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(255.0f/256.0f)),
+                             _mm_set1_ps(32768.0f));
+   __m128i mask = _mm_set1_epi32(0xff);
+   __m128i result = _mm_and_si128(_mm_castps_si128(tmp), mask);
+
+   result = _mm_andnot_si128(_mm_or_si128(zero, one), result);
+   return _mm_or_si128(result, _mm_and_si128(one, mask));
+}
+
+
+/*
+ * Same as util_iround() for each element.
+ */
+static inline __m128i
+mm_iround_epi32(const __m128 f)
+{
+#if defined(PIPE_ARCH_X86)
+   /* util_iround() uses fistp, which rounds to nearest even like this */
+   return _mm_cvtps_epi32(f);
+#else
+   /* add +/-0.5 and truncate; note util_iround() treats -0.0 as positive,
+    * which makes no difference here */
+   __m128 sign = _mm_and_ps(f, _mm_castsi128_ps(_mm_set1_epi32(0x80000000)));
+   __m128 half = _mm_or_ps(sign, _mm_set1_ps(0.5f));
+   return _mm_cvttps_epi32(_mm_add_ps(f, half));
+#endif
+}
+
+
 #endif /* PIPE_ARCH_SSE */
 
 #endif /* U_SSE_H_ */
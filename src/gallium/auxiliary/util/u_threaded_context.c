@@ -30,6 +30,7 @@
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "util/u_upload_mgr.h"
+#include "util/os_time.h"
 
 /* 0 = disabled, 1 = assertions, 2 = printfs */
 #define TC_DEBUG 0
@@ -119,6 +120,65 @@ tc_batch_flush(struct threaded_context *tc)
                       NULL);
    tc->last = tc->next;
    tc->next = (tc->next + 1) % TC_MAX_BATCHES;
+
+   /* Don't let more than max_queued batches be in flight. The driver thread
+    * executes batches in order, so if the oldest allowed one is done, all
+    * older ones are too, including the next one to record into.
+    */
+   struct tc_batch *oldest =
+      &tc->batch_slots[(tc->last + TC_MAX_BATCHES - tc->max_queued) %
+                       TC_MAX_BATCHES];
+
+   if (!util_queue_fence_is_signalled(&oldest->fence)) {
+      int64_t start = os_time_get_nano();
+
+      util_queue_fence_wait(&oldest->fence);
+      p_atomic_add(&tc->queue_stall_ns, os_time_get_nano() - start);
+      tc->frame_stalled = true;
+   }
+}
+
+/* Flush a partially filled batch if the driver thread is idle, so that the
+ * draw calls recorded so far start executing instead of waiting for the
+ * batch to fill up. This is only a fence read, no locking.
+ */
+static void
+tc_early_kick(struct threaded_context *tc)
+{
+   struct tc_batch *next = &tc->batch_slots[tc->next];
+
+   if (next->num_total_call_slots >= tc->batch_size / 4 &&
+       util_queue_fence_is_signalled(&tc->batch_slots[tc->last].fence)) {
+      p_atomic_inc(&tc->num_early_kicks);
+      tc_batch_flush(tc);
+   }
+}
+
+/* Adapt the batch size and the number of batches in flight to the last
+ * frames. Called at every frame boundary, i.e. non-deferred flush.
+ */
+static void
+tc_adapt_batching(struct threaded_context *tc)
+{
+   unsigned total = tc->num_offloaded_slots + tc->num_direct_slots +
+                    tc->batch_slots[tc->next].num_total_call_slots;
+   unsigned slots = total - tc->frame_start;
+
+   tc->frame_start = total;
+   tc->frame_slots = (tc->frame_slots * 3 + slots) / 4;
+   tc->batch_size = CLAMP(DIV_ROUND_UP(tc->frame_slots, TC_BATCHES_PER_FRAME),
+                          TC_MIN_CALLS_PER_BATCH, TC_CALLS_PER_BATCH);
+
+   /* If the application thread had to wait for a free batch, the driver
+    * thread is the bottleneck and a deeper queue absorbs the bursts.
+    * Otherwise, shrink the queue for low CPU cache usage and latency.
+    */
+   if (tc->frame_stalled)
+      tc->max_queued = MIN2(tc->max_queued + 2, TC_MAX_BATCHES - 2);
+   else if (tc->max_queued > TC_MIN_QUEUED)
+      tc->max_queued--;
+
+   tc->frame_stalled = false;
 }
 
 /* This is the function that adds variable-sized calls into the current
@@ -135,7 +195,8 @@ tc_add_sized_call(struct threaded_context *tc, enum tc_call_id id,
 
    tc_debug_check(tc);
 
-   if (unlikely(next->num_total_call_slots + num_call_slots > TC_CALLS_PER_BATCH)) {
+   if (unlikely(next->num_total_call_slots + num_call_slots > TC_CALLS_PER_BATCH ||
+                next->num_total_call_slots >= tc->batch_size)) {
       tc_batch_flush(tc);
       next = &tc->batch_slots[tc->next];
       tc_assert(next->num_total_call_slots == 0);
@@ -190,7 +251,10 @@ _tc_sync(struct threaded_context *tc, MAYBE_UNUSED const char *info, MAYBE_UNUSE
 
    /* Only wait for queued calls... */
    if (!util_queue_fence_is_signalled(&last->fence)) {
+      int64_t start = os_time_get_nano();
+
       util_queue_fence_wait(&last->fence);
+      p_atomic_add(&tc->sync_stall_ns, os_time_get_nano() - start);
       synced = true;
    }
 
@@ -1947,6 +2011,9 @@ tc_flush(struct pipe_context *_pipe, struct pipe_fence_handle **fence,
    struct pipe_screen *screen = pipe->screen;
    bool async = flags & PIPE_FLUSH_DEFERRED;
 
+   if (!(flags & PIPE_FLUSH_DEFERRED))
+      tc_adapt_batching(tc);
+
    if (flags & PIPE_FLUSH_ASYNC) {
       struct tc_batch *last = &tc->batch_slots[tc->last];
 
@@ -2080,6 +2147,8 @@ tc_draw_vbo(struct pipe_context *_pipe, const struct pipe_draw_info *info)
          p->draw.indirect = &p->indirect;
       }
    }
+
+   tc_early_kick(tc);
 }
 
 static void
@@ -2575,6 +2644,10 @@ threaded_context_create(struct pipe_context *pipe,
       util_queue_fence_init(&tc->batch_slots[i].fence);
    }
 
+   tc->batch_size = TC_CALLS_PER_BATCH;
+   tc->max_queued = TC_DEFAULT_QUEUED;
+   tc->frame_slots = TC_CALLS_PER_BATCH * TC_BATCHES_PER_FRAME;
+
    LIST_INITHEAD(&tc->unflushed_queries);
 
    slab_create_child(&tc->pool_transfers, parent_transfer_pool);
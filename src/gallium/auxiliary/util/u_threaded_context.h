@@ -208,19 +208,35 @@ struct tc_unflushed_batch_token;
  * - 1 batch is being executed
  * so the queue size is TC_MAX_BATCHES - 2 = number of waiting batches.
  *
- * Use a size as small as possible for low CPU L2 cache usage but large enough
- * so that the queue isn't stalled too often for not having enough idle batch
- * slots.
+ * How many of them may actually be in flight at once is adapted at run time
+ * (threaded_context::max_queued), so this only bounds the memory and the
+ * deepest queue that a heavy workload can use.
  */
-#define TC_MAX_BATCHES        10
+#define TC_MAX_BATCHES        32
+
+/* The initial and smallest number of batches that may be in flight. */
+#define TC_DEFAULT_QUEUED     8
+#define TC_MIN_QUEUED         2
 
 /* The size of one batch. Non-trivial calls (i.e. not setting a CSO pointer)
  * can occupy multiple call slots.
  *
  * The idea is to have batches as small as possible but large enough so that
  * the queuing and mutex overhead is negligible.
+ *
+ * This is the storage size. Batches are flushed as soon as they hold
+ * threaded_context::batch_size slots, which adapts between
+ * TC_MIN_CALLS_PER_BATCH and this to the number of slots recorded per frame,
+ * so that small frames get to the driver thread early and large frames pay
+ * the queuing overhead rarely.
  */
 #define TC_CALLS_PER_BATCH    192
+#define TC_MIN_CALLS_PER_BATCH  32
+
+/* The number of batches that a frame is split into, if the frame is small
+ * enough.
+ */
+#define TC_BATCHES_PER_FRAME  8
 
 /* Threshold for when to use the queue or sync. */
 #define TC_MAX_STRING_MARKER_BYTES  512
@@ -360,6 +376,16 @@ struct threaded_context {
    unsigned num_offloaded_slots;
    unsigned num_direct_slots;
    unsigned num_syncs;
+   unsigned num_early_kicks;
+   uint64_t sync_stall_ns;  /* time waiting for the driver thread in syncs */
+   uint64_t queue_stall_ns; /* time waiting for a free batch */
+
+   /* Adaptive batching, see TC_CALLS_PER_BATCH and TC_MAX_BATCHES. */
+   unsigned batch_size;
+   unsigned max_queued;
+   unsigned frame_slots;    /* running average of slots recorded per frame */
+   unsigned frame_start;    /* offloaded + direct slots at the last frame */
+   bool frame_stalled;
 
    struct util_queue queue;
    struct util_queue_fence *fence;
@@ -390,6 +416,22 @@ threaded_context(struct pipe_context *pipe)
    return (struct threaded_context*)pipe;
 }
 
+/**
+ * Return the number of batches queued or being executed by the driver
+ * thread, for the HUD.
+ */
+static inline unsigned
+threaded_context_queue_depth(struct threaded_context *tc)
+{
+   unsigned depth = 0;
+
+   for (unsigned i = 0; i < TC_MAX_BATCHES; i++) {
+      if (!util_queue_fence_is_signalled(&tc->batch_slots[i].fence))
+         depth++;
+   }
+   return depth;
+}
+
 static inline struct threaded_resource *
 threaded_resource(struct pipe_resource *res)
 {
@@ -32,6 +32,7 @@
 #include "pipe/p_defines.h"
 #include "util/u_inlines.h"
 #include "pipe/p_context.h"
+#include "pipe/p_screen.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
 
@@ -53,6 +54,21 @@ struct u_upload_mgr {
    uint8_t *map;    /* Pointer to the mapped upload buffer. */
    unsigned offset; /* Aligned offset to the upload buffer, pointing
                      * at the first unused byte. */
+
+   /* Ring mode, see u_upload_enable_ring().  The current buffer is in the
+    * fields above while it is in use, the others are parked here.
+    */
+   unsigned num_ring_buffers; /* 0 if not in ring mode. */
+   unsigned ring_index;       /* Index of the current buffer. */
+   struct {
+      struct pipe_resource *buffer;
+      struct pipe_transfer *transfer; /* Only kept with persistent maps. */
+      uint8_t *map;
+      struct pipe_fence_handle *fence; /* Last fence which used it. */
+      boolean pending; /* Written since the last u_upload_fence(). */
+   } ring[U_UPLOAD_MAX_RING_BUFFERS];
+
+   struct u_upload_stats stats;
 };
 
 
@@ -102,8 +118,13 @@ u_upload_create_default(struct pipe_context *pipe)
 struct u_upload_mgr *
 u_upload_clone(struct pipe_context *pipe, struct u_upload_mgr *upload)
 {
-   return u_upload_create(pipe, upload->default_size, upload->bind,
-                          upload->usage, upload->flags);
+   struct u_upload_mgr *result =
+      u_upload_create(pipe, upload->default_size, upload->bind,
+                      upload->usage, upload->flags);
+
+   if (result && upload->num_ring_buffers)
+      u_upload_enable_ring(result, upload->num_ring_buffers);
+   return result;
 }
 
 static void
@@ -143,14 +164,72 @@ u_upload_release_buffer(struct u_upload_mgr *upload)
 }
 
 
+static void
+u_upload_release_ring_buffer(struct u_upload_mgr *upload, unsigned index)
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+
+   if (upload->ring[index].transfer)
+      pipe_transfer_unmap(upload->pipe, upload->ring[index].transfer);
+   upload->ring[index].transfer = NULL;
+   upload->ring[index].map = NULL;
+   pipe_resource_reference(&upload->ring[index].buffer, NULL);
+
+   if (upload->ring[index].fence)
+      screen->fence_reference(screen, &upload->ring[index].fence, NULL);
+   upload->ring[index].pending = FALSE;
+}
+
+
 void
 u_upload_destroy(struct u_upload_mgr *upload)
 {
+   unsigned i;
+
    u_upload_release_buffer(upload);
+   for (i = 0; i < upload->num_ring_buffers; i++)
+      u_upload_release_ring_buffer(upload, i);
    FREE(upload);
 }
 
 
+void
+u_upload_enable_ring(struct u_upload_mgr *upload, unsigned num_buffers)
+{
+   assert(!upload->buffer);
+   assert(num_buffers >= 2);
+
+   upload->num_ring_buffers = MIN2(num_buffers, U_UPLOAD_MAX_RING_BUFFERS);
+   upload->ring_index = 0;
+}
+
+
+void
+u_upload_fence(struct u_upload_mgr *upload, struct pipe_fence_handle *fence)
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+   unsigned i;
+
+   /* Without a fence the buffers stay pending, so they won't be reused. */
+   if (!fence)
+      return;
+
+   for (i = 0; i < upload->num_ring_buffers; i++) {
+      if (upload->ring[i].pending) {
+         screen->fence_reference(screen, &upload->ring[i].fence, fence);
+         upload->ring[i].pending = FALSE;
+      }
+   }
+}
+
+
+void
+u_upload_get_stats(struct u_upload_mgr *upload, struct u_upload_stats *stats)
+{
+   *stats = upload->stats;
+}
+
+
 static void
 u_upload_alloc_buffer(struct u_upload_mgr *upload, unsigned min_size)
 {
@@ -185,6 +264,7 @@ u_upload_alloc_buffer(struct u_upload_mgr *upload, unsigned min_size)
    upload->buffer = screen->resource_create(screen, &buffer);
    if (upload->buffer == NULL)
       return;
+   upload->stats.num_buffers++;
 
    /* Map the new buffer. */
    upload->map = pipe_buffer_map_range(upload->pipe, upload->buffer,
@@ -199,6 +279,67 @@ u_upload_alloc_buffer(struct u_upload_mgr *upload, unsigned min_size)
    upload->offset = 0;
 }
 
+/**
+ * Move on to the next ring buffer, waiting for the GPU to be done with it,
+ * or allocate a new one if it can't be reused.
+ */
+static void
+u_upload_next_ring_buffer(struct u_upload_mgr *upload, unsigned min_size)
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+   unsigned index = upload->ring_index;
+
+   /* Park the current buffer. */
+   if (!upload->map_persistent)
+      upload_unmap_internal(upload, TRUE);
+   upload->ring[index].buffer = upload->buffer;
+   upload->ring[index].transfer = upload->transfer;
+   upload->ring[index].map = upload->map;
+   upload->buffer = NULL;
+   upload->transfer = NULL;
+   upload->map = NULL;
+
+   index = (index + 1) % upload->num_ring_buffers;
+   upload->ring_index = index;
+
+   if (!upload->ring[index].buffer) {
+      u_upload_alloc_buffer(upload, min_size);
+      return;
+   }
+
+   /* Unflushed commands may still use it, or it is too small. */
+   if (upload->ring[index].pending ||
+       upload->ring[index].buffer->width0 < min_size) {
+      u_upload_release_ring_buffer(upload, index);
+      u_upload_alloc_buffer(upload, min_size);
+      return;
+   }
+
+   if (upload->ring[index].fence) {
+      if (!screen->fence_finish(screen, upload->pipe,
+                                upload->ring[index].fence, 0)) {
+         upload->stats.num_stalls++;
+         if (!screen->fence_finish(screen, upload->pipe,
+                                   upload->ring[index].fence,
+                                   PIPE_TIMEOUT_INFINITE)) {
+            u_upload_release_ring_buffer(upload, index);
+            u_upload_alloc_buffer(upload, min_size);
+            return;
+         }
+      }
+      screen->fence_reference(screen, &upload->ring[index].fence, NULL);
+   }
+
+   upload->buffer = upload->ring[index].buffer;
+   upload->transfer = upload->ring[index].transfer;
+   upload->map = upload->ring[index].map;
+   upload->ring[index].buffer = NULL;
+   upload->ring[index].transfer = NULL;
+   upload->ring[index].map = NULL;
+   upload->offset = 0;
+   upload->stats.num_wraps++;
+}
+
 void
 u_upload_alloc(struct u_upload_mgr *upload,
                unsigned min_out_offset,
@@ -220,7 +361,10 @@ u_upload_alloc(struct u_upload_mgr *upload,
     * for the sub-allocation.
     */
    if (unlikely(!upload->buffer || offset + size > buffer_size)) {
-      u_upload_alloc_buffer(upload, min_out_offset + size);
+      if (upload->num_ring_buffers && upload->buffer)
+         u_upload_next_ring_buffer(upload, min_out_offset + size);
+      else
+         u_upload_alloc_buffer(upload, min_out_offset + size);
 
       if (unlikely(!upload->buffer)) {
          *out_offset = ~0;
@@ -260,6 +404,9 @@ u_upload_alloc(struct u_upload_mgr *upload,
    *out_offset = offset;
 
    upload->offset = offset + size;
+   upload->stats.bytes_uploaded += size;
+   if (upload->num_ring_buffers)
+      upload->ring[upload->ring_index].pending = TRUE;
 }
 
 void
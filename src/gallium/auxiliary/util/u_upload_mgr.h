@@ -36,12 +36,23 @@
 #include "pipe/p_defines.h"
 
 struct pipe_context;
+struct pipe_fence_handle;
 struct pipe_resource;
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* Most upload buffers u_upload_enable_ring() can cycle through. */
+#define U_UPLOAD_MAX_RING_BUFFERS 8
+
+struct u_upload_stats {
+   uint64_t bytes_uploaded; /* Sum of the sizes of all the sub-allocations. */
+   unsigned num_buffers;    /* Upload buffers created. */
+   unsigned num_wraps;      /* Ring buffers reused. */
+   unsigned num_stalls;     /* Reuses which had to wait for the GPU. */
+};
+
 /**
  * Create the upload manager.
  *
@@ -74,6 +85,38 @@ u_upload_clone(struct pipe_context *pipe, struct u_upload_mgr *upload);
  */
 void u_upload_destroy( struct u_upload_mgr *upload );
 
+/**
+ * Switch the upload manager to ring mode.
+ *
+ * \param upload           Upload manager
+ * \param num_buffers      Number of upload buffers to cycle through.
+ *
+ * Instead of allocating a new upload buffer whenever the current one is
+ * full, the upload manager moves on to the next of \p num_buffers
+ * buffers, which stay mapped when persistent mappings are supported.
+ * A buffer is only reused once the fence passed to u_upload_fence()
+ * after it was written has signalled, so drivers opting in must call
+ * u_upload_fence() on every flush.  Buffers which were written but not
+ * fenced yet are replaced by new ones.
+ *
+ * This must be called before the first allocation.
+ */
+void u_upload_enable_ring(struct u_upload_mgr *upload, unsigned num_buffers);
+
+/**
+ * Tell the upload manager that everything uploaded since the previous
+ * call is used by the commands \p fence signals the completion of.
+ * This does nothing when the upload manager isn't in ring mode.
+ */
+void u_upload_fence(struct u_upload_mgr *upload,
+                    struct pipe_fence_handle *fence);
+
+/**
+ * Return the counters of the upload manager.
+ */
+void u_upload_get_stats(struct u_upload_mgr *upload,
+                        struct u_upload_stats *stats);
+
 /**
  * Unmap upload buffer
  *
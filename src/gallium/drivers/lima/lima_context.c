@@ -191,6 +191,8 @@ lima_context_create(struct pipe_screen *pscreen, void *priv, unsigned flags)
    ctx->uploader = u_upload_create_default(&ctx->base);
    if (!ctx->uploader)
       goto err_out;
+   /* reuse the upload buffers once _lima_flush() fences show they are idle */
+   u_upload_enable_ring(ctx->uploader, 4);
    ctx->base.stream_uploader = ctx->uploader;
    ctx->base.const_uploader = ctx->uploader;
    ctx->base.texture_subdata = u_default_texture_subdata;
@@ -30,6 +30,7 @@
 #include "util/u_helpers.h"
 #include "util/u_inlines.h"
 #include "util/u_pack_color.h"
+#include "util/u_upload_mgr.h"
 #include "util/hash_table.h"
 
 #include "lima_context.h"
@@ -1167,6 +1168,13 @@ _lima_flush(struct lima_context *ctx)
          fprintf(stderr, "pp submit error\n");
    }
 
+   /* the pp job is the last one to use the uploads of this frame */
+   struct pipe_fence_handle *fence = lima_fence_create(ctx, -1);
+   if (fence) {
+      u_upload_fence(ctx->uploader, fence);
+      screen->base.fence_reference(&screen->base, &fence, NULL);
+   }
+
    ctx->num_draws = 0;
    ctx->plb_index = (ctx->plb_index + 1) % lima_ctx_num_plb;
 }
@@ -0,0 +1,752 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Headless rasterization benchmark.
+ *
+ * Renders synthetic scenes through llvmpipe's setup and rasterizer, with
+ * a null winsys, once per LP_NUM_THREADS value, and reports:
+ *  - submit: API thread time spent in the draws, i.e. vertex processing
+ *    and binning (and rasterization too when there are no threads)
+ *  - wait: time from the final flush until the rasterizer is done
+ *  - triangle and pixel rates over the whole frame
+ *
+ * Usage: lp_bench_raster [-n frames] [-t threads,...] [scenario...]
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "tgsi/tgsi_text.h"
+#include "util/os_time.h"
+#include "util/u_box.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_draw.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_sampler.h"
+#include "util/u_simple_shaders.h"
+#include "util/u_string.h"
+#include "sw/null/null_sw_winsys.h"
+
+#include "lp_limits.h"
+#include "lp_public.h"
+
+
+#define WIDTH  1024
+#define HEIGHT 1024
+
+/** position and one generic attribute */
+#define FLOATS_PER_VERT 8
+
+
+struct bench
+{
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+
+   struct pipe_resource *target;
+   struct pipe_framebuffer_state fb;
+
+   void *vs;
+   void *fs_color;
+   void *fs_tex;
+   void *blend[2];      /**< opaque, alpha blended */
+   void *rast[2];       /**< smooth, flat shaded */
+   void *dsa;
+   void *velems;
+   void *sampler;
+
+   struct pipe_resource *tex;
+   struct pipe_sampler_view *view;
+
+   struct pipe_resource *vbuf;
+   unsigned num_verts;
+};
+
+
+/** Vertex data being generated for a scenario */
+struct geometry
+{
+   float *verts;
+   unsigned num_verts;
+   double area;         /**< covered pixels, counting overdraw */
+};
+
+
+struct scenario
+{
+   const char *name;
+   const char *desc;
+   unsigned max_verts;
+   void (*build)(struct geometry *geom);
+   void (*draw)(struct bench *b);
+};
+
+
+static void
+emit_vert(struct geometry *geom, float x, float y, float s, float t)
+{
+   float *v = geom->verts + geom->num_verts++ * FLOATS_PER_VERT;
+
+   /* window coordinates to clip space */
+   v[0] = 2.0f * x / WIDTH - 1.0f;
+   v[1] = 2.0f * y / HEIGHT - 1.0f;
+   v[2] = 0.0f;
+   v[3] = 1.0f;
+   v[4] = s;
+   v[5] = t;
+   v[6] = 0.0f;
+   v[7] = 1.0f;
+}
+
+
+static void
+emit_tri(struct geometry *geom, float x, float y, float size)
+{
+   emit_vert(geom, x, y, 0.0f, 0.0f);
+   emit_vert(geom, x + size, y, 1.0f, 0.0f);
+   emit_vert(geom, x, y + size, 0.0f, 1.0f);
+   geom->area += 0.5 * size * size;
+}
+
+
+static void
+emit_quad(struct geometry *geom, float x0, float y0, float x1, float y1)
+{
+   /* texture coordinates repeat every 256 pixels */
+   float s0 = x0 / 256.0f, t0 = y0 / 256.0f;
+   float s1 = x1 / 256.0f, t1 = y1 / 256.0f;
+
+   emit_vert(geom, x0, y0, s0, t0);
+   emit_vert(geom, x1, y0, s1, t0);
+   emit_vert(geom, x0, y1, s0, t1);
+   emit_vert(geom, x0, y1, s0, t1);
+   emit_vert(geom, x1, y0, s1, t0);
+   emit_vert(geom, x1, y1, s1, t1);
+   geom->area += (x1 - x0) * (y1 - y0);
+}
+
+
+/*
+ * Scenarios
+ */
+
+#define TINY_CELL 4
+#define OVERDRAW_LAYERS 32
+#define STATE_QUAD 16
+#define SPARSE_SCENES 16
+#define TEXTURE_LAYERS 8
+
+
+static void
+build_tiny(struct geometry *geom)
+{
+   unsigned x, y;
+
+   for (y = 0; y < HEIGHT; y += TINY_CELL)
+      for (x = 0; x < WIDTH; x += TINY_CELL)
+         emit_tri(geom, x, y, TINY_CELL - 1);
+}
+
+
+static void
+build_sparse(struct geometry *geom)
+{
+   unsigned x, y;
+
+   /* one small triangle in every 64x64 tile */
+   for (y = 0; y < HEIGHT; y += 64)
+      for (x = 0; x < WIDTH; x += 64)
+         emit_tri(geom, x + 8, y + 8, 4);
+}
+
+
+static void
+build_overdraw(struct geometry *geom)
+{
+   unsigned i;
+
+   for (i = 0; i < OVERDRAW_LAYERS; i++)
+      emit_quad(geom, 0, 0, WIDTH, HEIGHT);
+}
+
+
+static void
+build_state(struct geometry *geom)
+{
+   unsigned x, y;
+
+   for (y = 0; y < HEIGHT; y += STATE_QUAD)
+      for (x = 0; x < WIDTH; x += STATE_QUAD)
+         emit_quad(geom, x, y, x + STATE_QUAD, y + STATE_QUAD);
+}
+
+
+static void
+build_texture(struct geometry *geom)
+{
+   unsigned i;
+
+   for (i = 0; i < TEXTURE_LAYERS; i++)
+      emit_quad(geom, 0, 0, WIDTH, HEIGHT);
+}
+
+
+static void
+draw_simple(struct bench *b, unsigned blend)
+{
+   struct pipe_context *pipe = b->pipe;
+
+   pipe->bind_blend_state(pipe, b->blend[blend]);
+   pipe->bind_rasterizer_state(pipe, b->rast[0]);
+   pipe->bind_fs_state(pipe, b->fs_color);
+   util_draw_arrays(pipe, PIPE_PRIM_TRIANGLES, 0, b->num_verts);
+}
+
+
+static void
+draw_tiny(struct bench *b)
+{
+   draw_simple(b, 0);
+}
+
+
+static void
+draw_sparse(struct bench *b)
+{
+   unsigned i;
+
+   /* many nearly empty scenes, to show the per scene and per bin cost */
+   for (i = 0; i < SPARSE_SCENES; i++) {
+      draw_simple(b, 0);
+      b->pipe->flush(b->pipe, NULL, 0);
+   }
+}
+
+
+static void
+draw_overdraw(struct bench *b)
+{
+   draw_simple(b, 1);
+}
+
+
+static void
+draw_state(struct bench *b)
+{
+   struct pipe_context *pipe = b->pipe;
+   unsigned i;
+
+   pipe->bind_fs_state(pipe, b->fs_color);
+
+   for (i = 0; i < b->num_verts / 6; i++) {
+      pipe->bind_blend_state(pipe, b->blend[i & 1]);
+      pipe->bind_rasterizer_state(pipe, b->rast[(i >> 1) & 1]);
+      util_draw_arrays(pipe, PIPE_PRIM_TRIANGLES, i * 6, 6);
+   }
+}
+
+
+static void
+draw_texture(struct bench *b)
+{
+   struct pipe_context *pipe = b->pipe;
+
+   pipe->bind_blend_state(pipe, b->blend[0]);
+   pipe->bind_rasterizer_state(pipe, b->rast[0]);
+   pipe->bind_fs_state(pipe, b->fs_tex);
+   pipe->set_sampler_views(pipe, PIPE_SHADER_FRAGMENT, 0, 1, &b->view);
+   pipe->bind_sampler_states(pipe, PIPE_SHADER_FRAGMENT, 0, 1, &b->sampler);
+   util_draw_arrays(pipe, PIPE_PRIM_TRIANGLES, 0, b->num_verts);
+}
+
+
+static const struct scenario scenarios[] = {
+   { "tiny", "4.5 pixel triangles covering the framebuffer",
+     3 * (WIDTH / TINY_CELL) * (HEIGHT / TINY_CELL),
+     build_tiny, draw_tiny },
+   { "sparse", "one small triangle per tile, 16 scenes per frame",
+     3 * (WIDTH / 64) * (HEIGHT / 64),
+     build_sparse, draw_sparse },
+   { "overdraw", "32 blended full screen quads",
+     6 * OVERDRAW_LAYERS,
+     build_overdraw, draw_overdraw },
+   { "state", "16x16 quads with blend and rasterizer changes between draws",
+     6 * (WIDTH / STATE_QUAD) * (HEIGHT / STATE_QUAD),
+     build_state, draw_state },
+   { "texture", "8 full screen quads with four bilinear samples per pixel",
+     6 * TEXTURE_LAYERS,
+     build_texture, draw_texture },
+};
+
+
+/*
+ * Setup
+ */
+
+static const char fs_tex_text[] =
+   "FRAG\n"
+   "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+   "DCL OUT[0], COLOR\n"
+   "DCL SAMP[0]\n"
+   "DCL SVIEW[0], 2D, FLOAT\n"
+   "DCL TEMP[0..1]\n"
+   "IMM[0] FLT32 { 0.0039, 0.0078, 0.25, 0.0 }\n"
+   "  0: TEX TEMP[0], IN[0], SAMP[0], 2D\n"
+   "  1: ADD TEMP[1], IN[0], IMM[0].xyww\n"
+   "  2: TEX TEMP[1], TEMP[1], SAMP[0], 2D\n"
+   "  3: ADD TEMP[0], TEMP[0], TEMP[1]\n"
+   "  4: ADD TEMP[1], IN[0], IMM[0].yxww\n"
+   "  5: TEX TEMP[1], TEMP[1], SAMP[0], 2D\n"
+   "  6: ADD TEMP[0], TEMP[0], TEMP[1]\n"
+   "  7: ADD TEMP[1], IN[0], IMM[0].yyww\n"
+   "  8: TEX TEMP[1], TEMP[1], SAMP[0], 2D\n"
+   "  9: ADD TEMP[0], TEMP[0], TEMP[1]\n"
+   " 10: MUL OUT[0], TEMP[0], IMM[0].zzzz\n"
+   " 11: END\n";
+
+
+static boolean
+create_states(struct bench *b)
+{
+   struct pipe_context *pipe = b->pipe;
+   struct pipe_blend_state blend;
+   struct pipe_rasterizer_state rast;
+   struct pipe_depth_stencil_alpha_state dsa;
+   struct pipe_vertex_element velems[2];
+   struct pipe_sampler_state sampler;
+   struct pipe_shader_state fs;
+   struct tgsi_token tokens[1024];
+   const enum tgsi_semantic semantic_names[] =
+      { TGSI_SEMANTIC_POSITION, TGSI_SEMANTIC_GENERIC };
+   const uint semantic_indexes[] = { 0, 0 };
+   unsigned i;
+
+   memset(&blend, 0, sizeof blend);
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   b->blend[0] = pipe->create_blend_state(pipe, &blend);
+   blend.rt[0].blend_enable = 1;
+   blend.rt[0].rgb_func = PIPE_BLEND_ADD;
+   blend.rt[0].rgb_src_factor = PIPE_BLENDFACTOR_SRC_ALPHA;
+   blend.rt[0].rgb_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+   blend.rt[0].alpha_func = PIPE_BLEND_ADD;
+   blend.rt[0].alpha_src_factor = PIPE_BLENDFACTOR_ONE;
+   blend.rt[0].alpha_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+   b->blend[1] = pipe->create_blend_state(pipe, &blend);
+
+   memset(&rast, 0, sizeof rast);
+   rast.cull_face = PIPE_FACE_NONE;
+   rast.half_pixel_center = 1;
+   rast.bottom_edge_rule = 1;
+   rast.depth_clip = 1;
+   b->rast[0] = pipe->create_rasterizer_state(pipe, &rast);
+   rast.flatshade = 1;
+   b->rast[1] = pipe->create_rasterizer_state(pipe, &rast);
+
+   memset(&dsa, 0, sizeof dsa);
+   b->dsa = pipe->create_depth_stencil_alpha_state(pipe, &dsa);
+   pipe->bind_depth_stencil_alpha_state(pipe, b->dsa);
+
+   memset(velems, 0, sizeof velems);
+   for (i = 0; i < 2; i++) {
+      velems[i].src_offset = i * 4 * sizeof(float);
+      velems[i].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   }
+   b->velems = pipe->create_vertex_elements_state(pipe, 2, velems);
+   pipe->bind_vertex_elements_state(pipe, b->velems);
+
+   memset(&sampler, 0, sizeof sampler);
+   sampler.wrap_s = PIPE_TEX_WRAP_REPEAT;
+   sampler.wrap_t = PIPE_TEX_WRAP_REPEAT;
+   sampler.wrap_r = PIPE_TEX_WRAP_REPEAT;
+   sampler.min_img_filter = PIPE_TEX_FILTER_LINEAR;
+   sampler.mag_img_filter = PIPE_TEX_FILTER_LINEAR;
+   sampler.min_mip_filter = PIPE_TEX_MIPFILTER_NONE;
+   sampler.normalized_coords = 1;
+   b->sampler = pipe->create_sampler_state(pipe, &sampler);
+
+   b->vs = util_make_vertex_passthrough_shader(pipe, 2, semantic_names,
+                                               semantic_indexes, FALSE);
+   pipe->bind_vs_state(pipe, b->vs);
+
+   b->fs_color = util_make_fragment_passthrough_shader(pipe,
+                                                       TGSI_SEMANTIC_GENERIC,
+                                                       TGSI_INTERPOLATE_PERSPECTIVE,
+                                                       TRUE);
+
+   if (!tgsi_text_translate(fs_tex_text, tokens, ARRAY_SIZE(tokens))) {
+      fprintf(stderr, "failed to translate texture shader\n");
+      return FALSE;
+   }
+   pipe_shader_state_from_tgsi(&fs, tokens);
+   b->fs_tex = pipe->create_fs_state(pipe, &fs);
+
+   return b->vs && b->fs_color && b->fs_tex;
+}
+
+
+static boolean
+create_resources(struct bench *b)
+{
+   struct pipe_screen *screen = b->screen;
+   struct pipe_context *pipe = b->pipe;
+   struct pipe_resource templ;
+   struct pipe_surface surf_templ;
+   struct pipe_sampler_view view_templ;
+   struct pipe_viewport_state viewport;
+   struct pipe_box box;
+   uint32_t *texels;
+   unsigned x, y;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+   templ.width0 = WIDTH;
+   templ.height0 = HEIGHT;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = PIPE_BIND_RENDER_TARGET;
+   b->target = screen->resource_create(screen, &templ);
+   if (!b->target)
+      return FALSE;
+
+   memset(&surf_templ, 0, sizeof surf_templ);
+   surf_templ.format = templ.format;
+   memset(&b->fb, 0, sizeof b->fb);
+   b->fb.width = WIDTH;
+   b->fb.height = HEIGHT;
+   b->fb.nr_cbufs = 1;
+   b->fb.cbufs[0] = pipe->create_surface(pipe, b->target, &surf_templ);
+   pipe->set_framebuffer_state(pipe, &b->fb);
+
+   memset(&viewport, 0, sizeof viewport);
+   viewport.scale[0] = WIDTH / 2.0f;
+   viewport.scale[1] = HEIGHT / 2.0f;
+   viewport.scale[2] = 0.5f;
+   viewport.translate[0] = WIDTH / 2.0f;
+   viewport.translate[1] = HEIGHT / 2.0f;
+   viewport.translate[2] = 0.5f;
+   pipe->set_viewport_states(pipe, 0, 1, &viewport);
+
+   /* a 256x256 xor pattern to sample from */
+   templ.width0 = 256;
+   templ.height0 = 256;
+   templ.bind = PIPE_BIND_SAMPLER_VIEW;
+   b->tex = screen->resource_create(screen, &templ);
+   if (!b->tex)
+      return FALSE;
+
+   texels = MALLOC(256 * 256 * sizeof *texels);
+   if (!texels)
+      return FALSE;
+   for (y = 0; y < 256; y++)
+      for (x = 0; x < 256; x++)
+         texels[y * 256 + x] = 0xff000000 | ((x ^ y) * 0x010101);
+   u_box_origin_2d(256, 256, &box);
+   pipe->texture_subdata(pipe, b->tex, 0, PIPE_TRANSFER_WRITE, &box,
+                         texels, 256 * sizeof *texels, 0);
+   FREE(texels);
+
+   u_sampler_view_default_template(&view_templ, b->tex, b->tex->format);
+   b->view = pipe->create_sampler_view(pipe, b->tex, &view_templ);
+
+   return b->view != NULL;
+}
+
+
+static boolean
+bench_init(struct bench *b, unsigned num_threads)
+{
+   char value[16];
+
+   memset(b, 0, sizeof *b);
+
+   /* read by llvmpipe when creating the screen */
+   util_snprintf(value, sizeof value, "%u", num_threads);
+#ifdef _WIN32
+   _putenv_s("LP_NUM_THREADS", value);
+#else
+   setenv("LP_NUM_THREADS", value, 1);
+#endif
+
+   b->screen = llvmpipe_create_screen(null_sw_create());
+   if (!b->screen)
+      return FALSE;
+
+   b->pipe = b->screen->context_create(b->screen, NULL, 0);
+   if (!b->pipe)
+      return FALSE;
+
+   return create_states(b) && create_resources(b);
+}
+
+
+static void
+bench_fini(struct bench *b)
+{
+   struct pipe_context *pipe = b->pipe;
+   unsigned i;
+
+   if (pipe) {
+      pipe->set_sampler_views(pipe, PIPE_SHADER_FRAGMENT, 0, 1, NULL);
+      pipe_sampler_view_reference(&b->view, NULL);
+      pipe_surface_reference(&b->fb.cbufs[0], NULL);
+      pipe_resource_reference(&b->tex, NULL);
+      pipe_resource_reference(&b->target, NULL);
+      pipe_resource_reference(&b->vbuf, NULL);
+
+      for (i = 0; i < 2; i++) {
+         if (b->blend[i])
+            pipe->delete_blend_state(pipe, b->blend[i]);
+         if (b->rast[i])
+            pipe->delete_rasterizer_state(pipe, b->rast[i]);
+      }
+      if (b->dsa)
+         pipe->delete_depth_stencil_alpha_state(pipe, b->dsa);
+      if (b->velems)
+         pipe->delete_vertex_elements_state(pipe, b->velems);
+      if (b->sampler)
+         pipe->delete_sampler_state(pipe, b->sampler);
+      if (b->vs)
+         pipe->delete_vs_state(pipe, b->vs);
+      if (b->fs_color)
+         pipe->delete_fs_state(pipe, b->fs_color);
+      if (b->fs_tex)
+         pipe->delete_fs_state(pipe, b->fs_tex);
+
+      pipe->destroy(pipe);
+   }
+
+   if (b->screen)
+      b->screen->destroy(b->screen);
+}
+
+
+/*
+ * Running
+ */
+
+static boolean
+load_geometry(struct bench *b, const struct scenario *s, double *area)
+{
+   struct pipe_vertex_buffer vb;
+   struct geometry geom;
+   unsigned size = s->max_verts * FLOATS_PER_VERT * sizeof(float);
+
+   geom.verts = MALLOC(size);
+   if (!geom.verts)
+      return FALSE;
+   geom.num_verts = 0;
+   geom.area = 0.0;
+
+   s->build(&geom);
+   assert(geom.num_verts <= s->max_verts);
+
+   pipe_resource_reference(&b->vbuf, NULL);
+   b->vbuf = pipe_buffer_create(b->screen, PIPE_BIND_VERTEX_BUFFER,
+                                PIPE_USAGE_IMMUTABLE, size);
+   if (!b->vbuf) {
+      FREE(geom.verts);
+      return FALSE;
+   }
+   pipe_buffer_write(b->pipe, b->vbuf, 0, size, geom.verts);
+   FREE(geom.verts);
+
+   memset(&vb, 0, sizeof vb);
+   vb.stride = FLOATS_PER_VERT * sizeof(float);
+   vb.buffer.resource = b->vbuf;
+   b->pipe->set_vertex_buffers(b->pipe, 0, 1, &vb);
+
+   b->num_verts = geom.num_verts;
+   *area = geom.area;
+   return TRUE;
+}
+
+
+static void
+run_frame(struct bench *b, const struct scenario *s,
+          int64_t *submit_ns, int64_t *wait_ns)
+{
+   static const union pipe_color_union clear_color = { { 0.0f } };
+   struct pipe_fence_handle *fence = NULL;
+   int64_t t0, t1, t2;
+
+   t0 = os_time_get_nano();
+   b->pipe->clear(b->pipe, PIPE_CLEAR_COLOR, &clear_color, 0.0, 0);
+   s->draw(b);
+   t1 = os_time_get_nano();
+
+   b->pipe->flush(b->pipe, &fence, 0);
+   b->screen->fence_finish(b->screen, NULL, fence, PIPE_TIMEOUT_INFINITE);
+   b->screen->fence_reference(b->screen, &fence, NULL);
+   t2 = os_time_get_nano();
+
+   *submit_ns += t1 - t0;
+   *wait_ns += t2 - t1;
+}
+
+
+static void
+run_scenario(struct bench *b, const struct scenario *s,
+             unsigned num_threads, unsigned num_frames)
+{
+   int64_t submit_ns = 0, wait_ns = 0, total_ns;
+   double area, tris, frame_ms;
+   unsigned i;
+
+   if (!load_geometry(b, s, &area)) {
+      fprintf(stderr, "%s: out of memory\n", s->name);
+      return;
+   }
+
+   /* compile the shader variants outside of the timed frames */
+   for (i = 0; i < 2; i++) {
+      int64_t dummy = 0;
+      run_frame(b, s, &dummy, &dummy);
+   }
+
+   for (i = 0; i < num_frames; i++)
+      run_frame(b, s, &submit_ns, &wait_ns);
+
+   total_ns = MAX2(submit_ns + wait_ns, 1);
+   tris = b->num_verts / 3.0;
+   if (s->draw == draw_sparse) {
+      tris *= SPARSE_SCENES;
+      area *= SPARSE_SCENES;
+   }
+   frame_ms = total_ns / 1e6 / num_frames;
+
+   printf("%-10s %7u %6u %10.3f %10.3f %10.3f %9.2f %9.1f\n",
+          s->name, num_threads, num_frames,
+          submit_ns / 1e6 / num_frames,
+          wait_ns / 1e6 / num_frames,
+          frame_ms,
+          tris * num_frames / (total_ns / 1e9) / 1e6,
+          area * num_frames / (total_ns / 1e9) / 1e6);
+   fflush(stdout);
+}
+
+
+static void
+usage(void)
+{
+   unsigned i;
+
+   printf("Usage: lp_bench_raster [-n frames] [-t threads,...] [scenario...]\n"
+          "\n"
+          "Scenarios:\n");
+   for (i = 0; i < ARRAY_SIZE(scenarios); i++)
+      printf("  %-10s %s\n", scenarios[i].name, scenarios[i].desc);
+}
+
+
+int main(int argc, char **argv)
+{
+   unsigned threads[LP_MAX_THREADS + 1];
+   unsigned num_threads = 0;
+   unsigned num_frames = 20;
+   boolean selected[ARRAY_SIZE(scenarios)];
+   boolean any_selected = FALSE;
+   unsigned i, j;
+   int ret = 0;
+
+   memset(selected, 0, sizeof selected);
+
+   for (i = 1; i < (unsigned) argc; i++) {
+      if (strcmp(argv[i], "-n") == 0 && i + 1 < (unsigned) argc) {
+         num_frames = MAX2(1, atoi(argv[++i]));
+      }
+      else if (strcmp(argv[i], "-t") == 0 && i + 1 < (unsigned) argc) {
+         const char *p = argv[++i];
+         while (*p && num_threads < ARRAY_SIZE(threads)) {
+            threads[num_threads++] = MIN2(strtoul(p, NULL, 10), LP_MAX_THREADS);
+            p = strchr(p, ',');
+            if (!p)
+               break;
+            p++;
+         }
+      }
+      else {
+         for (j = 0; j < ARRAY_SIZE(scenarios); j++) {
+            if (strcmp(argv[i], scenarios[j].name) == 0)
+               break;
+         }
+         if (j == ARRAY_SIZE(scenarios)) {
+            usage();
+            return 1;
+         }
+         selected[j] = TRUE;
+         any_selected = TRUE;
+      }
+   }
+
+   if (!num_threads) {
+      /* no threads, then powers of two up to the number of cpus */
+      unsigned max_threads;
+
+      util_cpu_detect();
+      max_threads = MIN2(util_cpu_caps.nr_cpus, LP_MAX_THREADS);
+
+      threads[num_threads++] = 0;
+      for (j = 1; j <= max_threads; j *= 2)
+         threads[num_threads++] = j;
+      if (threads[num_threads - 1] != max_threads)
+         threads[num_threads++] = max_threads;
+   }
+
+   printf("%-10s %7s %6s %10s %10s %10s %9s %9s\n",
+          "scenario", "threads", "frames", "submit ms", "wait ms",
+          "frame ms", "Mtri/s", "Mpix/s");
+
+   for (i = 0; i < num_threads; i++) {
+      struct bench b;
+
+      if (!bench_init(&b, threads[i])) {
+         fprintf(stderr, "failed to create llvmpipe context\n");
+         bench_fini(&b);
+         ret = 1;
+         break;
+      }
+
+      for (j = 0; j < ARRAY_SIZE(scenarios); j++) {
+         if (!any_selected || selected[j])
+            run_scenario(&b, &scenarios[j], threads[i], num_frames);
+      }
+
+      bench_fini(&b);
+   }
+
+   return ret;
+}
@@ -101,6 +101,10 @@ static void llvmpipe_destroy( struct pipe_context *pipe )
 
    lp_delete_setup_variants(llvmpipe);
 
+   /* after the blitter and draw freed their shaders' variants */
+   lp_fs_variant_keys_dump(llvmpipe);
+   FREE(llvmpipe->fs_hot_keys);
+
 #ifndef USE_GLOBAL_LLVM_CONTEXT
    LLVMContextDispose(llvmpipe->context);
 #endif
@@ -204,6 +208,9 @@ llvmpipe_create_context(struct pipe_screen *screen, void *priv,
       goto fail;
    llvmpipe->pipe.const_uploader = llvmpipe->pipe.stream_uploader;
 
+   /* before any shaders get created, so they can be pre-warmed */
+   lp_fs_variant_keys_load(llvmpipe);
+
    llvmpipe->blitter = util_blitter_create(&llvmpipe->pipe);
    if (!llvmpipe->blitter) {
       goto fail;
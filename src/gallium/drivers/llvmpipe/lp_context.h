@@ -143,6 +143,19 @@ struct llvmpipe_context {
    unsigned nr_fs_variants;
    unsigned nr_fs_instrs;
 
+   /** Fragment shader variant cache counters, see LP_QUERY_FS_* */
+   struct {
+      uint64_t hits;
+      uint64_t misses;
+      uint64_t evictions;
+      uint64_t compile_usecs;
+   } fs_variant_stats;
+
+   /** Hot variant keys to pre-compile and save, see LP_FS_VARIANT_KEYS */
+   const char *fs_keys_file;
+   struct lp_fs_hot_key *fs_hot_keys;
+   unsigned nr_fs_hot_keys;
+
    struct lp_setup_variant_list_item setup_variants_list;
    unsigned nr_setup_variants;
 
@@ -64,6 +64,12 @@
 #define LP_MAX_THREADS 16
 
 
+/**
+ * Max NUMA nodes the rasterizer threads are spread over.
+ */
+#define LP_MAX_NUMA_NODES 8
+
+
 /**
  * Max bytes per scene.  This may be replaced by a runtime parameter.
  */
@@ -48,6 +48,36 @@ static struct llvmpipe_query *llvmpipe_query( struct pipe_query *p )
    return (struct llvmpipe_query *)p;
 }
 
+static uint64_t
+lp_driver_query_value(struct llvmpipe_context *llvmpipe, unsigned type)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(llvmpipe->pipe.screen);
+   uint64_t accesses, misses;
+
+   switch (type) {
+   case LP_QUERY_FS_VARIANT_HITS:
+      return llvmpipe->fs_variant_stats.hits;
+   case LP_QUERY_FS_VARIANT_MISSES:
+      return llvmpipe->fs_variant_stats.misses;
+   case LP_QUERY_FS_VARIANT_EVICTIONS:
+      return llvmpipe->fs_variant_stats.evictions;
+   case LP_QUERY_FS_COMPILE_TIME:
+      return llvmpipe->fs_variant_stats.compile_usecs;
+   case LP_QUERY_FS_VARIANTS:
+      return llvmpipe->nr_fs_variants;
+   case LP_QUERY_TEX_CACHE_ACCESSES:
+      lp_rast_get_texture_cache_stats(screen->rast, &accesses, &misses);
+      return accesses;
+   case LP_QUERY_TEX_CACHE_MISSES:
+      lp_rast_get_texture_cache_stats(screen->rast, &accesses, &misses);
+      return misses;
+   default:
+      assert(0);
+      return 0;
+   }
+}
+
+
 static struct pipe_query *
 llvmpipe_create_query(struct pipe_context *pipe, 
                       unsigned type,
@@ -55,7 +85,7 @@ llvmpipe_create_query(struct pipe_context *pipe,
 {
    struct llvmpipe_query *pq;
 
-   assert(type < PIPE_QUERY_TYPES);
+   assert(type < PIPE_QUERY_TYPES || type >= PIPE_QUERY_DRIVER_SPECIFIC);
 
    pq = CALLOC_STRUCT( llvmpipe_query );
 
@@ -166,6 +196,15 @@ llvmpipe_get_query_result(struct pipe_context *pipe,
       stats->primitives_storage_needed = pq->num_primitives_generated;
    }
       break;
+   case LP_QUERY_FS_VARIANT_HITS:
+   case LP_QUERY_FS_VARIANT_MISSES:
+   case LP_QUERY_FS_VARIANT_EVICTIONS:
+   case LP_QUERY_FS_COMPILE_TIME:
+   case LP_QUERY_FS_VARIANTS:
+   case LP_QUERY_TEX_CACHE_ACCESSES:
+   case LP_QUERY_TEX_CACHE_MISSES:
+      *result = pq->driver_value;
+      break;
    case PIPE_QUERY_PIPELINE_STATISTICS: {
       struct pipe_query_data_pipeline_statistics *stats =
          (struct pipe_query_data_pipeline_statistics *)vresult;
@@ -201,6 +240,15 @@ llvmpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
    }
 
 
+   /* The driver specific queries sample counters directly, without going
+    * through the scene.  The texture cache ones lag behind by whatever
+    * the rasterizer threads haven't got to yet.
+    */
+   if (pq->type >= PIPE_QUERY_DRIVER_SPECIFIC) {
+      pq->driver_value = lp_driver_query_value(llvmpipe, pq->type);
+      return true;
+   }
+
    memset(pq->start, 0, sizeof(pq->start));
    memset(pq->end, 0, sizeof(pq->end));
    lp_setup_begin_query(llvmpipe->setup, pq);
@@ -249,6 +297,17 @@ llvmpipe_end_query(struct pipe_context *pipe, struct pipe_query *q)
    struct llvmpipe_context *llvmpipe = llvmpipe_context( pipe );
    struct llvmpipe_query *pq = llvmpipe_query(q);
 
+   if (pq->type >= PIPE_QUERY_DRIVER_SPECIFIC) {
+      uint64_t value = lp_driver_query_value(llvmpipe, pq->type);
+
+      /* the number of variants is a running total, the rest count events */
+      if (pq->type == LP_QUERY_FS_VARIANTS)
+         pq->driver_value = value;
+      else
+         pq->driver_value = value - pq->driver_value;
+      return true;
+   }
+
    lp_setup_end_query(llvmpipe->setup, pq);
 
    switch (pq->type) {
@@ -35,12 +35,23 @@
 
 #include <limits.h>
 #include "os/os_thread.h"
+#include "pipe/p_defines.h"
 #include "lp_limits.h"
 
 
 struct llvmpipe_context;
 
 
+/** Driver specific queries, see llvmpipe_get_driver_query_info() */
+#define LP_QUERY_FS_VARIANT_HITS      (PIPE_QUERY_DRIVER_SPECIFIC + 0)
+#define LP_QUERY_FS_VARIANT_MISSES    (PIPE_QUERY_DRIVER_SPECIFIC + 1)
+#define LP_QUERY_FS_VARIANT_EVICTIONS (PIPE_QUERY_DRIVER_SPECIFIC + 2)
+#define LP_QUERY_FS_COMPILE_TIME      (PIPE_QUERY_DRIVER_SPECIFIC + 3)
+#define LP_QUERY_FS_VARIANTS          (PIPE_QUERY_DRIVER_SPECIFIC + 4)
+#define LP_QUERY_TEX_CACHE_ACCESSES   (PIPE_QUERY_DRIVER_SPECIFIC + 5)
+#define LP_QUERY_TEX_CACHE_MISSES     (PIPE_QUERY_DRIVER_SPECIFIC + 6)
+
+
 struct llvmpipe_query {
    uint64_t start[LP_MAX_THREADS];  /* start count value for each thread */
    uint64_t end[LP_MAX_THREADS];    /* end count value for each thread */
@@ -48,6 +59,7 @@ struct llvmpipe_query {
    unsigned type;                   /* PIPE_QUERY_* */
    unsigned num_primitives_generated;
    unsigned num_primitives_written;
+   uint64_t driver_value;           /* LP_QUERY_* */
 
    struct pipe_query_data_pipeline_statistics stats;
 };
@@ -26,6 +26,9 @@
  **************************************************************************/
 
 #include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "util/u_atomic.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
 #include "util/u_rect.h"
@@ -58,28 +61,129 @@ const struct lp_rasterizer_task *jit_task = NULL;
 
 
 /**
- * Begin rasterizing a scene.
- * Called once per scene by one thread.
+ * Does the scene sample any render target of the scenes still queued
+ * ahead of it, or render to any texture they sample?  Bin tickets only
+ * order the bins of a tile, while a scene may sample any part of a
+ * texture from any of its bins.
+ *
+ * Called by the setup thread, which is also the only one to rebin and
+ * reset scenes, so the resource lists of the earlier scenes are stable.
+ */
+static boolean
+scene_depends_on_earlier(const struct lp_rasterizer *rast,
+                         const struct lp_scene *scene)
+{
+   const struct pipe_resource *targets[PIPE_MAX_COLOR_BUFS + 1];
+   unsigned num_targets = 0;
+   unsigned seq, i;
+
+   if (scene->fb.zsbuf)
+      targets[num_targets++] = scene->fb.zsbuf->texture;
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      if (scene->fb.cbufs[i])
+         targets[num_targets++] = scene->fb.cbufs[i]->texture;
+   }
+
+   /* The scene queue doesn't reuse a slot before the scene in it has
+    * finished, so all scenes from scenes_done on are still in their slots.
+    */
+   for (seq = p_atomic_read(&rast->scenes_done); seq != scene->seq; seq++) {
+      const struct lp_scene *earlier =
+         lp_scene_queue_get(rast->full_scenes, seq);
+      const struct pipe_resource * const *earlier_targets =
+         rast->scene_targets[seq % MAX_SCENE_QUEUE];
+
+      /* read after write */
+      if (scene->resources) {
+         for (i = 0; i < PIPE_MAX_COLOR_BUFS + 1; i++) {
+            if (earlier_targets[i] &&
+                lp_scene_is_resource_referenced(scene, earlier_targets[i]))
+               return TRUE;
+         }
+      }
+
+      /* write after read */
+      if (earlier->resources) {
+         for (i = 0; i < num_targets; i++) {
+            if (lp_scene_is_resource_referenced(earlier, targets[i]))
+               return TRUE;
+         }
+      }
+   }
+
+   return FALSE;
+}
+
+
+/**
+ * Begin rasterizing a scene: map the framebuffer surfaces and set up the
+ * bin iterator.  Called by the setup thread when the scene is queued, so
+ * this never sits on a rasterizer thread's path.
  */
 static void
 lp_rast_begin( struct lp_rasterizer *rast,
                struct lp_scene *scene )
 {
-   rast->curr_scene = scene;
+   unsigned i;
 
    LP_DBG(DEBUG_RAST, "%s\n", __FUNCTION__);
 
    lp_scene_begin_rasterization( scene );
-   lp_scene_bin_iter_begin( scene );
+   lp_scene_bin_iter_begin( scene, rast->num_nodes, rast->bin_group_order );
+
+   scene->threads_left = MAX2(1, rast->num_threads);
+   scene->wait_for_earlier = FALSE;
+
+   if (rast->no_rast || scene->discard)
+      return;
+
+   /* Order this scene's bins after those of earlier queued scenes for the
+    * same tiles.
+    */
+   for (i = 0; i < scene->num_ordered_bins; i++) {
+      unsigned x, y;
+
+      lp_scene_bin_unmorton(scene->bin_order[i], &x, &y);
+      scene->bin_ticket[i] = rast->tile_queued[x][y]++;
+   }
+
+   /* That doesn't cover sampling what another scene renders to, which
+    * may be done by any bin of it.
+    */
+   if (rast->num_threads) {
+      const struct pipe_resource **targets =
+         rast->scene_targets[scene->seq % MAX_SCENE_QUEUE];
+
+      scene->wait_for_earlier = scene_depends_on_earlier(rast, scene);
+
+      for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+         targets[i] = i < scene->fb.nr_cbufs && scene->fb.cbufs[i] ?
+                      scene->fb.cbufs[i]->texture : NULL;
+      }
+      targets[PIPE_MAX_COLOR_BUFS] = scene->fb.zsbuf ?
+                                     scene->fb.zsbuf->texture : NULL;
+   }
 }
 
 
+/**
+ * Finish rasterizing a scene.  Called by whichever thread is the last to
+ * run out of bins in it.
+ */
 static void
-lp_rast_end( struct lp_rasterizer *rast )
+lp_rast_end( struct lp_rasterizer *rast,
+             struct lp_scene *scene )
 {
-   lp_scene_end_rasterization( rast->curr_scene );
+   lp_scene_end_rasterization( scene );
 
-   rast->curr_scene = NULL;
+   p_atomic_inc(&rast->scenes_done);
+
+   /* Signal only once the rasterizer is completely done with the scene:
+    * setup may reclaim and rebin it as soon as the fence is signalled.
+    */
+   if (scene->fence) {
+      lp_fence_signal(scene->fence);
+   }
 }
 
 
@@ -644,18 +748,46 @@ rasterize_bin(struct lp_rasterizer_task *task,
 }
 
 
-/* An empty bin is one that just loads the contents of the tile and
- * stores them again unchanged.  This typically happens when bins have
- * been flushed for some reason in the middle of a frame, or when
- * incremental updates are being made to a render target.
- * 
- * Try to avoid doing pointless work in this case.
+#if LP_USE_TEXTURE_CACHE
+/**
+ * Drop the cached blocks of textures written since this thread last
+ * looked.  Blocks are tagged with their address, so cached blocks of other
+ * textures stay valid from one scene to the next.
  */
-static boolean
-is_empty_bin( const struct cmd_bin *bin )
+static void
+update_texture_cache(struct lp_rasterizer_task *task)
 {
-   return bin->head == NULL;
+   struct lp_rasterizer *rast = task->rast;
+   struct lp_build_format_cache *cache = task->thread_data.cache;
+   unsigned seq;
+
+   if (p_atomic_read(&rast->tex_cache_inval.seq) == task->tex_cache_seq)
+      return;
+
+   mtx_lock(&rast->tex_cache_inval.mutex);
+
+   seq = rast->tex_cache_inval.seq;
+   if (seq - task->tex_cache_seq > LP_RAST_TEX_CACHE_INVAL_RING) {
+      memset(cache->cache_tags, 0, sizeof(cache->cache_tags));
+   }
+   else {
+      for (; task->tex_cache_seq != seq; task->tex_cache_seq++) {
+         unsigned slot = task->tex_cache_seq % LP_RAST_TEX_CACHE_INVAL_RING;
+         uintptr_t start = rast->tex_cache_inval.range[slot].start;
+         uintptr_t end = rast->tex_cache_inval.range[slot].end;
+         unsigned i;
+
+         for (i = 0; i < LP_BUILD_FORMAT_CACHE_SIZE; i++) {
+            if (cache->cache_tags[i] >= start && cache->cache_tags[i] < end)
+               cache->cache_tags[i] = 0;
+         }
+      }
+   }
+   task->tex_cache_seq = seq;
+
+   mtx_unlock(&rast->tex_cache_inval.mutex);
 }
+#endif
 
 
 /**
@@ -668,27 +800,40 @@ rasterize_scene(struct lp_rasterizer_task *task,
 {
    task->scene = scene;
 
-   /* Clear the cache tags. This should not always be necessary but
-      simpler for now. */
+   /* Scenes complete in queue order, since every thread goes through
+    * every scene in order.
+    */
+   if (scene->wait_for_earlier) {
+      while (p_atomic_read(&task->rast->scenes_done) != scene->seq)
+         thrd_yield();
+   }
+
 #if LP_USE_TEXTURE_CACHE
-   memset(task->thread_data.cache->cache_tags, 0,
-          sizeof(task->thread_data.cache->cache_tags));
-#if LP_BUILD_FORMAT_CACHE_DEBUG
-   task->thread_data.cache->cache_access_total = 0;
-   task->thread_data.cache->cache_access_miss = 0;
-#endif
+   update_texture_cache(task);
 #endif
 
    if (!task->rast->no_rast && !scene->discard) {
-      /* loop over scene bins, rasterize each */
+      /* loop over the non-empty scene bins, rasterize each */
       {
+         struct lp_rasterizer *rast = task->rast;
          struct cmd_bin *bin;
+         unsigned ticket;
          int i, j;
 
          assert(scene);
-         while ((bin = lp_scene_bin_iter_next(scene, &i, &j))) {
-            if (!is_empty_bin( bin ))
-               rasterize_bin(task, bin, i, j);
+         task->bin_iter.pos = task->bin_iter.end = 0;
+         while ((bin = lp_scene_bin_iter_next(scene, &task->bin_iter,
+                                              &i, &j, &ticket))) {
+            /* Another thread may still be on this tile in an earlier
+             * scene; that bin is already claimed and running, so the
+             * wait is short.
+             */
+            while (p_atomic_read(&rast->tile_done[i][j]) != ticket)
+               thrd_yield();
+
+            rasterize_bin(task, bin, i, j);
+
+            p_atomic_inc(&rast->tile_done[i][j]);
          }
       }
    }
@@ -708,10 +853,6 @@ rasterize_scene(struct lp_rasterizer_task *task,
    }
 #endif
 
-   if (scene->fence) {
-      lp_fence_signal(scene->fence);
-   }
-
    task->scene = NULL;
 }
 
@@ -738,17 +879,16 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
 
       rasterize_scene( &rast->tasks[0], scene );
 
-      lp_rast_end( rast );
+      lp_rast_end( rast, scene );
 
       util_fpstate_set(fpstate);
-
-      rast->curr_scene = NULL;
    }
    else {
       /* threaded rendering! */
       unsigned i;
 
-      lp_scene_enqueue( rast->full_scenes, scene );
+      scene->seq = lp_scene_enqueue( rast->full_scenes, scene );
+      lp_rast_begin( rast, scene );
 
       /* signal the threads that there's work to do */
       for (i = 0; i < rast->num_threads; i++) {
@@ -760,29 +900,12 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
 }
 
 
-void
-lp_rast_finish( struct lp_rasterizer *rast )
-{
-   if (rast->num_threads == 0) {
-      /* nothing to do */
-   }
-   else {
-      int i;
-
-      /* wait for work to complete */
-      for (i = 0; i < rast->num_threads; i++) {
-         pipe_semaphore_wait(&rast->tasks[i].work_done);
-      }
-   }
-}
-
-
 /**
  * This is the thread's main entrypoint.
  * It's a simple loop:
  *   1. wait for work
  *   2. do work
- *   3. signal that we're done
+ * Completion is reported through the scene's fence by lp_rast_end().
  */
 static int
 thread_function(void *init_data)
@@ -796,6 +919,14 @@ thread_function(void *init_data)
    util_snprintf(thread_name, sizeof thread_name, "llvmpipe-%u", task->thread_index);
    u_thread_setname(thread_name);
 
+   /* Keep the thread on its node, so that the framebuffer pages of the
+    * rows it rasterizes (first touched here) stay local to it.
+    */
+   if (rast->num_nodes > 1) {
+      u_thread_setaffinity(rast->node_cpus[task->bin_iter.node],
+                           LP_RAST_CPU_MASK_WORDS);
+   }
+
    /* Make sure that denorms are treated like zeros. This is 
     * the behavior required by D3D10. OpenGL doesn't care.
     */
@@ -803,6 +934,8 @@ thread_function(void *init_data)
    util_fpstate_set_denorms_to_zero(fpstate);
 
    while (1) {
+      struct lp_scene *scene;
+
       /* wait for work */
       if (debug)
          debug_printf("thread %d waiting for work\n", task->thread_index);
@@ -811,41 +944,25 @@ thread_function(void *init_data)
       if (rast->exit_flag)
          break;
 
-      if (task->thread_index == 0) {
-         /* thread[0]:
-          *  - get next scene to rasterize
-          *  - map the framebuffer surfaces
-          */
-         lp_rast_begin( rast, 
-                        lp_scene_dequeue( rast->full_scenes, TRUE ) );
-      }
-
-      /* Wait for all threads to get here so that threads[1+] don't
-       * get a null rast->curr_scene pointer.
+      /* Each thread visits every queued scene, in order, with its own
+       * cursor.  There is no barrier between scenes: a thread which runs
+       * out of bins moves straight on to the next scene, and the last
+       * thread to leave a scene finishes it.
        */
-      util_barrier_wait( &rast->barrier );
+      scene = lp_scene_queue_get(rast->full_scenes, task->scene_seq++);
 
       /* do work */
       if (debug)
          debug_printf("thread %d doing work\n", task->thread_index);
 
-      rasterize_scene(task,
-                      rast->curr_scene);
-      
-      /* wait for all threads to finish with this scene */
-      util_barrier_wait( &rast->barrier );
+      rasterize_scene(task, scene);
 
-      /* XXX: shouldn't be necessary:
-       */
-      if (task->thread_index == 0) {
-         lp_rast_end( rast );
+      if (p_atomic_dec_zero(&scene->threads_left)) {
+         lp_rast_end( rast, scene );
       }
 
-      /* signal done with work */
       if (debug)
          debug_printf("thread %d done working\n", task->thread_index);
-
-      pipe_semaphore_signal(&task->work_done);
    }
 
 #ifdef _WIN32
@@ -856,6 +973,102 @@ thread_function(void *init_data)
 }
 
 
+#if defined(PIPE_OS_LINUX)
+
+/**
+ * Parse a sysfs cpu/node list such as "0-7,16-23" into a bitmask.
+ */
+static void
+parse_sysfs_list(const char *list, uint32_t *mask, unsigned num_words)
+{
+   const char *p = list;
+
+   memset(mask, 0, num_words * sizeof *mask);
+
+   while (*p >= '0' && *p <= '9') {
+      char *end;
+      unsigned first, last, i;
+
+      first = last = strtoul(p, &end, 10);
+      if (*end == '-')
+         last = strtoul(end + 1, &end, 10);
+
+      for (i = first; i <= last && i < num_words * 32; i++)
+         mask[i / 32] |= 1u << (i % 32);
+
+      p = *end == ',' ? end + 1 : end;
+   }
+}
+
+
+static boolean
+read_sysfs_list(const char *path, uint32_t *mask, unsigned num_words)
+{
+   char buf[4096];
+   FILE *f = fopen(path, "r");
+   boolean ret = FALSE;
+
+   if (f) {
+      if (fgets(buf, sizeof buf, f)) {
+         parse_sysfs_list(buf, mask, num_words);
+         ret = TRUE;
+      }
+      fclose(f);
+   }
+   return ret;
+}
+
+#endif /* PIPE_OS_LINUX */
+
+
+/**
+ * Find the NUMA nodes which have cpus, and record each one's cpu mask.
+ * Returns the number of nodes found, or 1 when it can't be determined.
+ */
+static unsigned
+lp_rast_detect_numa_nodes(struct lp_rasterizer *rast)
+{
+   unsigned num_nodes = 0;
+#if defined(PIPE_OS_LINUX)
+   uint32_t online[8];
+   unsigned node;
+
+   if (!read_sysfs_list("/sys/devices/system/node/online",
+                        online, ARRAY_SIZE(online)))
+      return 1;
+
+   for (node = 0; node < ARRAY_SIZE(online) * 32; node++) {
+      uint32_t *cpus = rast->node_cpus[num_nodes];
+      char path[64];
+      unsigned i;
+      boolean empty = TRUE;
+
+      if (!(online[node / 32] & (1u << (node % 32))))
+         continue;
+
+      util_snprintf(path, sizeof path,
+                    "/sys/devices/system/node/node%u/cpulist", node);
+      if (!read_sysfs_list(path, cpus, LP_RAST_CPU_MASK_WORDS))
+         continue;
+
+      /* Memory-only nodes have no cpus to run threads on */
+      for (i = 0; i < LP_RAST_CPU_MASK_WORDS; i++) {
+         if (cpus[i])
+            empty = FALSE;
+      }
+      if (empty)
+         continue;
+
+      if (++num_nodes == LP_MAX_NUMA_NODES)
+         break;
+   }
+#else
+   (void) rast;
+#endif
+   return MAX2(1, num_nodes);
+}
+
+
 /**
  * Initialize semaphores and spawn the threads.
  */
@@ -884,6 +1097,7 @@ struct lp_rasterizer *
 lp_rast_create( unsigned num_threads )
 {
    struct lp_rasterizer *rast;
+   unsigned bin_size;
    unsigned i;
 
    rast = CALLOC_STRUCT(lp_rasterizer);
@@ -905,19 +1119,37 @@ lp_rast_create( unsigned num_threads )
       if (!task->thread_data.cache) {
          goto no_thread_data_cache;
       }
+      memset(task->thread_data.cache, 0, sizeof(struct lp_build_format_cache));
    }
 
    rast->num_threads = num_threads;
 
    rast->no_rast = debug_get_bool_option("LP_NO_RAST", FALSE);
 
-   create_rast_threads(rast);
+   (void) mtx_init(&rast->tex_cache_inval.mutex, mtx_plain);
 
-   /* for synchronizing rasterization threads */
-   if (rast->num_threads > 0) {
-      util_barrier_init( &rast->barrier, rast->num_threads );
+   /* Bins are handed out in Morton-aligned groups of LP_BIN_SIZE pixels
+    * square.  Raster tiles stay TILE_SIZE: the 64/16/4 block hierarchy of
+    * the triangle rasterizer is built around it.
+    */
+   bin_size = debug_get_num_option("LP_BIN_SIZE", TILE_SIZE);
+   while ((TILE_SIZE << (rast->bin_group_order + 1)) <= bin_size &&
+          rast->bin_group_order < 4)
+      rast->bin_group_order++;
+
+   /* With several nodes, give each a band of tile rows and an equal share
+    * of the threads; threads only leave their band to steal work.
+    */
+   rast->num_nodes = 1;
+   if (num_threads > 1 && debug_get_bool_option("LP_NUMA", TRUE)) {
+      rast->num_nodes = MIN2(lp_rast_detect_numa_nodes(rast), num_threads);
+   }
+   for (i = 0; i < MAX2(1, num_threads); i++) {
+      rast->tasks[i].bin_iter.node = i * rast->num_nodes / MAX2(1, num_threads);
    }
 
+   create_rast_threads(rast);
+
    memset(lp_dummy_tile, 0, sizeof lp_dummy_tile);
 
    return rast;
@@ -937,6 +1169,118 @@ no_rast:
 }
 
 
+/**
+ * Number of NUMA nodes the rasterizer threads are spread over.
+ */
+unsigned
+lp_rast_num_numa_nodes( const struct lp_rasterizer *rast )
+{
+   return rast->num_nodes;
+}
+
+
+struct first_touch_job {
+   const struct lp_rasterizer *rast;
+   unsigned node;
+   void (*func)(void *data, unsigned node);
+   void *data;
+};
+
+
+static int
+first_touch_thread(void *init_data)
+{
+   struct first_touch_job *job = (struct first_touch_job *) init_data;
+
+   u_thread_setaffinity(job->rast->node_cpus[job->node],
+                        LP_RAST_CPU_MASK_WORDS);
+   job->func(job->data, job->node);
+   return 0;
+}
+
+
+/**
+ * Call func(data, node) for each NUMA node, from a thread running on that
+ * node, so that the pages it touches first are allocated there.  The
+ * calls run concurrently; returns once all of them are done.
+ */
+void
+lp_rast_first_touch( const struct lp_rasterizer *rast,
+                     void (*func)(void *data, unsigned node),
+                     void *data )
+{
+   struct first_touch_job jobs[LP_MAX_NUMA_NODES];
+   thrd_t threads[LP_MAX_NUMA_NODES];
+   unsigned node;
+
+   for (node = 0; node < rast->num_nodes; node++) {
+      jobs[node].rast = rast;
+      jobs[node].node = node;
+      jobs[node].func = func;
+      jobs[node].data = data;
+      threads[node] = rast->num_nodes > 1 ?
+                      u_thread_create(first_touch_thread, &jobs[node]) : 0;
+
+      /* no extra thread needed, or couldn't create one */
+      if (!threads[node])
+         func(data, node);
+   }
+
+   for (node = 0; node < rast->num_nodes; node++) {
+      if (threads[node])
+         thrd_join(threads[node], NULL);
+   }
+}
+
+
+/**
+ * Record that a texture's storage was written or freed, so that no thread
+ * keeps using blocks of it decoded before.  Called by the API thread,
+ * before any scene reading the new contents is queued.
+ */
+void
+lp_rast_invalidate_texture_cache( struct lp_rasterizer *rast,
+                                  const void *data, size_t size )
+{
+#if LP_USE_TEXTURE_CACHE
+   unsigned slot;
+
+   mtx_lock(&rast->tex_cache_inval.mutex);
+   slot = rast->tex_cache_inval.seq % LP_RAST_TEX_CACHE_INVAL_RING;
+   rast->tex_cache_inval.range[slot].start = (uintptr_t) data;
+   rast->tex_cache_inval.range[slot].end = (uintptr_t) data + size;
+   p_atomic_inc(&rast->tex_cache_inval.seq);
+   mtx_unlock(&rast->tex_cache_inval.mutex);
+#else
+   (void) rast;
+   (void) data;
+   (void) size;
+#endif
+}
+
+
+/**
+ * Texel lookups through the threads' texture caches, and how many of them
+ * missed, since the rasterizer was created.  The counters are updated by
+ * the threads without synchronization, so this is only approximate while
+ * rendering.
+ */
+void
+lp_rast_get_texture_cache_stats( const struct lp_rasterizer *rast,
+                                 uint64_t *accesses, uint64_t *misses )
+{
+   unsigned i;
+
+   *accesses = 0;
+   *misses = 0;
+   for (i = 0; i < MAX2(1, rast->num_threads); i++) {
+      const struct lp_build_format_cache *cache = rast->tasks[i].thread_data.cache;
+      *accesses += cache->cache_access_total;
+      *misses += cache->cache_access_miss;
+   }
+}
+
+
 /* Shutdown:
  */
 void lp_rast_destroy( struct lp_rasterizer *rast )
@@ -972,13 +1316,10 @@ void lp_rast_destroy( struct lp_rasterizer *rast )
       align_free(rast->tasks[i].thread_data.cache);
    }
 
-   /* for synchronizing rasterization threads */
-   if (rast->num_threads > 0) {
-      util_barrier_destroy( &rast->barrier );
-   }
-
    lp_scene_queue_destroy(rast->full_scenes);
 
+   mtx_destroy(&rast->tex_cache_inval.mutex);
+
    FREE(rast);
 }
 
@@ -162,13 +162,25 @@ lp_rast_create( unsigned num_threads );
 void
 lp_rast_destroy( struct lp_rasterizer * );
 
-void 
-lp_rast_queue_scene( struct lp_rasterizer *rast,
-                     struct lp_scene *scene );
+unsigned
+lp_rast_num_numa_nodes( const struct lp_rasterizer *rast );
+
+void
+lp_rast_first_touch( const struct lp_rasterizer *rast,
+                     void (*func)(void *data, unsigned node),
+                     void *data );
 
 void
-lp_rast_finish( struct lp_rasterizer *rast );
+lp_rast_invalidate_texture_cache( struct lp_rasterizer *rast,
+                                  const void *data, size_t size );
 
+void
+lp_rast_get_texture_cache_stats( const struct lp_rasterizer *rast,
+                                 uint64_t *accesses, uint64_t *misses );
+
+void 
+lp_rast_queue_scene( struct lp_rasterizer *rast,
+                     struct lp_scene *scene );
 
 union lp_rast_cmd_arg {
    const struct lp_rast_shader_inputs *shade_tile;
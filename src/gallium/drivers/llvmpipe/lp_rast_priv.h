@@ -34,6 +34,7 @@
 #include "lp_memory.h"
 #include "lp_rast.h"
 #include "lp_scene.h"
+#include "lp_scene_queue.h"
 #include "lp_state.h"
 #include "lp_texture.h"
 #include "lp_limits.h"
@@ -76,6 +77,15 @@ extern const struct lp_rasterizer_task *jit_task;
 struct lp_rasterizer;
 struct cmd_bin;
 
+
+/** Size of the per-node cpu masks, in 32-bit words */
+#define LP_RAST_CPU_MASK_WORDS 32
+
+/** Texture writes remembered for invalidating the per-thread texture
+ * caches.  Threads further behind than this drop their whole cache.
+ */
+#define LP_RAST_TEX_CACHE_INVAL_RING 16
+
 /**
  * Per-thread rasterization state
  */
@@ -102,6 +112,15 @@ struct lp_rasterizer_task
    uint64_t ps_invocations;
    uint8_t ps_inv_multiplier;
 
+   /** Sequence number of the next queued scene this thread will work on */
+   unsigned scene_seq;
+
+   /** Bins claimed by this thread in the current scene */
+   struct lp_scene_bin_iter bin_iter;
+
+   /** Texture writes already applied to thread_data.cache */
+   unsigned tex_cache_seq;
+
    pipe_semaphore work_ready;
    pipe_semaphore work_done;
 };
@@ -120,8 +139,20 @@ struct lp_rasterizer
    /** The incoming queue of scenes ready to rasterize */
    struct lp_scene_queue *full_scenes;
 
-   /** The scene currently being rasterized by the threads */
-   struct lp_scene *curr_scene;
+   /** Per tile, the number of queued bins and of finished bins.  Threads
+    * may be working on different scenes at once; these keep the bins for
+    * any one tile executing in scene order.
+    */
+   unsigned tile_queued[TILES_X][TILES_Y];
+   unsigned tile_done[TILES_X][TILES_Y];
+
+   /** Render targets of the most recently queued scenes, by queue
+    * position.  Only ever compared against, never dereferenced.
+    */
+   const struct pipe_resource *scene_targets[MAX_SCENE_QUEUE][PIPE_MAX_COLOR_BUFS + 1];
+
+   /** Number of scenes completely rasterized, atomic */
+   unsigned scenes_done;
 
    /** A task object for each rasterization thread */
    struct lp_rasterizer_task tasks[LP_MAX_THREADS];
@@ -129,8 +160,21 @@ struct lp_rasterizer
    unsigned num_threads;
    thrd_t threads[LP_MAX_THREADS];
 
-   /** For synchronizing the rasterization threads */
-   util_barrier barrier;
+   /** log2 of the edge of the bin groups threads claim, in tiles */
+   unsigned bin_group_order;
+
+   /** NUMA nodes the threads are spread over, and each node's cpus */
+   unsigned num_nodes;
+   uint32_t node_cpus[LP_MAX_NUMA_NODES][LP_RAST_CPU_MASK_WORDS];
+
+   /** Address ranges of recently written cached-format textures */
+   struct {
+      mtx_t mutex;
+      unsigned seq;  /**< number of ranges recorded so far, atomic */
+      struct {
+         uintptr_t start, end;
+      } range[LP_RAST_TEX_CACHE_INVAL_RING];
+   } tex_cache_inval;
 };
 
 
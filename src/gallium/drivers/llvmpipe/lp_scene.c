@@ -25,6 +25,7 @@
  *
  **************************************************************************/
 
+#include "util/u_atomic.h"
 #include "util/u_framebuffer.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
@@ -62,8 +63,6 @@ lp_scene_create( struct pipe_context *pipe )
    scene->data.head =
       CALLOC_STRUCT(data_block);
 
-   (void) mtx_init(&scene->mutex, mtx_plain);
-
 #ifdef DEBUG
    /* Do some scene limit sanity checks here */
    {
@@ -90,7 +89,6 @@ void
 lp_scene_destroy(struct lp_scene *scene)
 {
    lp_fence_reference(&scene->fence, NULL);
-   mtx_destroy(&scene->mutex);
    assert(scene->data.head->next == NULL);
    FREE(scene->data.head);
    FREE(scene);
@@ -204,12 +202,14 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
 
 
 /**
- * Free all the temporary data in a scene.
+ * Unmap the framebuffer surfaces mapped by lp_scene_begin_rasterization().
+ * Called by the rasterizer once all bins have been processed.  The scene's
+ * commands, data and resource references stay live until lp_scene_reset().
  */
 void
 lp_scene_end_rasterization(struct lp_scene *scene )
 {
-   int i, j;
+   int i;
 
    /* Unmap color buffers */
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
@@ -232,6 +232,18 @@ lp_scene_end_rasterization(struct lp_scene *scene )
                               zsbuf->u.tex.first_layer);
       scene->zsbuf.map = NULL;
    }
+}
+
+
+/**
+ * Free all the temporary data in a scene.
+ * Called by setup when reclaiming a scene, after its fence has signalled
+ * (or when the scene was never queued for rasterization).
+ */
+void
+lp_scene_reset(struct lp_scene *scene)
+{
+   int i, j;
 
    /* Reset all command lists:
     */
@@ -243,6 +255,9 @@ lp_scene_end_rasterization(struct lp_scene *scene )
          bin->last_state = NULL;
       }
    }
+   memset(scene->active_bins, 0, sizeof scene->active_bins);
+   scene->num_ordered_bins = 0;
+   scene->num_queues = 0;
 
    /* If there are any bins which weren't cleared by the loop above,
     * they will be caught (on debug builds at least) by this assert:
@@ -449,61 +464,114 @@ lp_scene_is_resource_referenced(const struct lp_scene *scene,
 
 
 
-/** advance curr_x,y to the next bin */
-static boolean
-next_bin(struct lp_scene *scene)
+/**
+ * Prepare to hand out the scene's non-empty bins.
+ * Called once per scene, before any rasterizer thread starts iterating.
+ * The bins are compacted out of the occupancy mask in Morton order so
+ * that consecutively dispatched bins are spatial neighbours, which helps
+ * the texture cache.
+ *
+ * \param num_nodes  split the tile rows into this many horizontal bands,
+ *                   each with its own queue, so that a NUMA node's threads
+ *                   keep touching the same part of the framebuffer
+ * \param group_order  threads claim Morton-aligned blocks of
+ *                     (1 << group_order)^2 bins at a time
+ */
+void
+lp_scene_bin_iter_begin( struct lp_scene *scene, unsigned num_nodes,
+                         unsigned group_order )
 {
-   scene->curr_x++;
-   if (scene->curr_x >= scene->tiles_x) {
-      scene->curr_x = 0;
-      scene->curr_y++;
-   }
-   if (scene->curr_y >= scene->tiles_y) {
-      /* no more bins */
-      return FALSE;
-   }
-   return TRUE;
-}
+   unsigned n = 0, g = 0;
+   unsigned node, i;
 
+   num_nodes = MAX2(1, MIN3(num_nodes, LP_MAX_NUMA_NODES, scene->tiles_y));
 
-void
-lp_scene_bin_iter_begin( struct lp_scene *scene )
-{
-   scene->curr_x = scene->curr_y = -1;
+   for (node = 0; node < num_nodes; node++) {
+      struct lp_scene_bin_queue *queue = &scene->queue[node];
+      unsigned prev_group = ~0u;
+
+      queue->curr_group = g;
+
+      for (i = 0; i < LP_SCENE_BIN_MASK_WORDS; i++) {
+         uint64_t mask = scene->active_bins[i];
+         while (mask) {
+            unsigned code = i * 64 + u_bit_scan64(&mask);
+
+            if (num_nodes > 1) {
+               unsigned x, y;
+
+               lp_scene_bin_unmorton(code, &x, &y);
+               if (y * num_nodes / scene->tiles_y != node)
+                  continue;
+            }
+
+            if ((code >> (2 * group_order)) != prev_group) {
+               prev_group = code >> (2 * group_order);
+               scene->group_start[g++] = n;
+            }
+            scene->bin_order[n++] = code;
+         }
+      }
+
+      queue->end_group = g;
+   }
+
+   assert(n <= lp_scene_get_num_bins(scene));
+   scene->group_start[g] = n;
+   scene->num_ordered_bins = n;
+   scene->num_queues = num_nodes;
 }
 
 
 /**
- * Return pointer to next bin to be rendered.
- * The lp_scene::curr_x and ::curr_y fields will be advanced.
+ * Return pointer to next bin to be rendered, and its ordering ticket.
  * Multiple rendering threads will call this function to get a chunk
- * of work (a bin) to work on.
+ * of work (a bin) to work on.  Only bins which received commands during
+ * binning are returned.  Bins come out of the group the thread last
+ * claimed; claiming the next group is a single atomic increment on the
+ * thread's own node queue, or on another node's when that one is empty.
  */
 struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene , int *x, int *y)
+lp_scene_bin_iter_next( struct lp_scene *scene,
+                        struct lp_scene_bin_iter *iter,
+                        int *x, int *y, unsigned *ticket )
 {
-   struct cmd_bin *bin = NULL;
+   unsigned idx, bx, by;
 
-   mtx_lock(&scene->mutex);
+   if (iter->pos == iter->end) {
+      unsigned i;
 
-   if (scene->curr_x < 0) {
-      /* first bin */
-      scene->curr_x = 0;
-      scene->curr_y = 0;
-   }
-   else if (!next_bin(scene)) {
-      /* no more bins left */
-      goto end;
+      for (i = 0; i < scene->num_queues; i++) {
+         struct lp_scene_bin_queue *queue =
+            &scene->queue[(iter->node + i) % scene->num_queues];
+         unsigned group;
+
+         /* Skip drained queues without bumping their counter */
+         if ((unsigned)p_atomic_read(&queue->curr_group) >= queue->end_group)
+            continue;
+
+         group = p_atomic_inc_return(&queue->curr_group) - 1;
+         if (group < queue->end_group) {
+            iter->pos = scene->group_start[group];
+            iter->end = scene->group_start[group + 1];
+            break;
+         }
+      }
+
+      if (iter->pos == iter->end)
+         return NULL;
    }
 
-   bin = lp_scene_get_bin(scene, scene->curr_x, scene->curr_y);
-   *x = scene->curr_x;
-   *y = scene->curr_y;
+   idx = iter->pos++;
+
+   lp_scene_bin_unmorton(scene->bin_order[idx], &bx, &by);
+   assert(bx < scene->tiles_x);
+   assert(by < scene->tiles_y);
 
-end:
-   /*printf("return bin %p at %d, %d\n", (void *) bin, *bin_x, *bin_y);*/
-   mtx_unlock(&scene->mutex);
-   return bin;
+   *x = bx;
+   *y = by;
+   *ticket = scene->bin_ticket[idx];
+   return lp_scene_get_bin(scene, bx, by);
 }
 
 
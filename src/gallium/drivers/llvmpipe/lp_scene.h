@@ -36,6 +36,7 @@
 #define LP_SCENE_H
 
 #include "os/os_thread.h"
+#include "util/u_math.h"
 #include "lp_rast.h"
 #include "lp_debug.h"
 
@@ -48,6 +49,13 @@ struct lp_rast_state;
 #define TILES_X (LP_MAX_WIDTH / TILE_SIZE)
 #define TILES_Y (LP_MAX_HEIGHT / TILE_SIZE)
 
+/* Bins are tracked in Morton (Z-curve) order, which needs a square,
+ * power-of-two index space covering both dimensions.
+ */
+#define LP_SCENE_MORTON_DIM MAX2(TILES_X, TILES_Y)
+#define LP_SCENE_BIN_MASK_WORDS \
+   ((LP_SCENE_MORTON_DIM * LP_SCENE_MORTON_DIM + 63) / 64)
+
 
 /* Commands per command block (ideally so sizeof(cmd_block) is a power of
  * two in size.)
@@ -117,6 +125,27 @@ struct data_block_list {
 
 struct resource_ref;
 
+
+/**
+ * The bin groups of one NUMA node's band of tile rows.  Threads take
+ * groups from their own node's queue first and steal from the others
+ * once it runs dry.
+ */
+struct lp_scene_bin_queue {
+   int curr_group;        /**< next group_start[] entry to hand out, atomic */
+   unsigned end_group;
+};
+
+
+/**
+ * A rasterizer thread's position within the bin group it last claimed.
+ */
+struct lp_scene_bin_iter {
+   unsigned pos, end;     /**< bin_order[] entries left in the group */
+   unsigned node;         /**< queue tried first */
+};
+
+
 /**
  * All bins and bin data are contained here.
  * Per-bin data goes into the 'tile' bins.
@@ -173,8 +202,39 @@ struct lp_scene {
     */
    unsigned tiles_x, tiles_y;
 
-   int curr_x, curr_y;  /**< for iterating over bins */
-   mtx_t mutex;
+   /** Bit per non-empty bin, indexed by the bin's Morton code.
+    * Set as bins receive their first command during binning.
+    */
+   uint64_t active_bins[LP_SCENE_BIN_MASK_WORDS];
+
+   /** Morton codes of the non-empty bins, compacted at iter_begin time.
+    * Grouped by NUMA node band, then into Morton-aligned bin groups.
+    */
+   uint16_t bin_order[TILES_X * TILES_Y];
+   unsigned num_ordered_bins;
+
+   /** bin_order[] index of each bin group's first bin, plus a terminator */
+   uint16_t group_start[TILES_X * TILES_Y + 1];
+
+   /** One queue of bin groups per NUMA node */
+   struct lp_scene_bin_queue queue[LP_MAX_NUMA_NODES];
+   unsigned num_queues;
+
+   /** Per bin_order[] entry, the number of earlier queued scenes which
+    * also have a bin for that tile.  Assigned by the rasterizer when the
+    * scene is queued; the bin may only run once those are finished.
+    */
+   unsigned bin_ticket[TILES_X * TILES_Y];
+
+   int threads_left;  /**< rasterizer threads still working on the scene */
+
+   unsigned seq;      /**< position in the rasterizer's scene queue */
+
+   /** The scene samples a texture which an earlier queued scene renders
+    * to, or renders to one it samples, so it may only start once all
+    * earlier scenes are done.
+    */
+   boolean wait_for_earlier;
 
    struct cmd_bin tile[TILES_X][TILES_Y];
    struct data_block_list data;
@@ -294,6 +354,44 @@ void
 lp_scene_bin_reset(struct lp_scene *scene, unsigned x, unsigned y);
 
 
+/** Interleave the bits of x and y, x in the even positions. */
+static inline unsigned
+lp_scene_bin_morton(unsigned x, unsigned y)
+{
+   unsigned code = 0;
+   unsigned bit;
+
+   for (bit = 0; (LP_SCENE_MORTON_DIM >> bit) > 1; bit++) {
+      code |= ((x >> bit) & 1) << (2 * bit);
+      code |= ((y >> bit) & 1) << (2 * bit + 1);
+   }
+   return code;
+}
+
+
+/** Inverse of lp_scene_bin_morton(). */
+static inline void
+lp_scene_bin_unmorton(unsigned code, unsigned *x, unsigned *y)
+{
+   unsigned bit;
+
+   *x = *y = 0;
+   for (bit = 0; (LP_SCENE_MORTON_DIM >> bit) > 1; bit++) {
+      *x |= ((code >> (2 * bit)) & 1) << bit;
+      *y |= ((code >> (2 * bit + 1)) & 1) << bit;
+   }
+}
+
+
+/** Record that bin[x][y] holds commands and must be rasterized. */
+static inline void
+lp_scene_bin_set_active(struct lp_scene *scene, unsigned x, unsigned y)
+{
+   unsigned code = lp_scene_bin_morton(x, y);
+   scene->active_bins[code / 64] |= (uint64_t)1 << (code % 64);
+}
+
+
 /* Add a command to bin[x][y].
  */
 static inline boolean
@@ -310,11 +408,14 @@ lp_scene_bin_command( struct lp_scene *scene,
    assert(cmd < LP_RAST_OP_MAX);
 
    if (tail == NULL || tail->count == CMD_BLOCK_MAX) {
+      boolean first = tail == NULL;
       tail = lp_scene_new_cmd_block( scene, bin );
       if (!tail) {
          return FALSE;
       }
       assert(tail->count == 0);
+      if (first)
+         lp_scene_bin_set_active(scene, x, y);
    }
 
    {
@@ -379,10 +480,13 @@ lp_scene_get_num_bins( const struct lp_scene *scene )
 
 
 void
-lp_scene_bin_iter_begin( struct lp_scene *scene );
+lp_scene_bin_iter_begin( struct lp_scene *scene, unsigned num_nodes,
+                         unsigned group_order );
 
 struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene, int *x, int *y );
+lp_scene_bin_iter_next( struct lp_scene *scene,
+                        struct lp_scene_bin_iter *iter,
+                        int *x, int *y, unsigned *ticket );
 
 
 
@@ -405,6 +509,9 @@ lp_scene_begin_rasterization(struct lp_scene *scene);
 void
 lp_scene_end_rasterization(struct lp_scene *scene );
 
+void
+lp_scene_reset(struct lp_scene *scene);
+
 
 
 
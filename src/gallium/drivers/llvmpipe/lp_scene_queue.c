@@ -27,30 +27,31 @@
 
 
 /**
- * Scene queue.  We'll use two queues.  One contains "full" scenes which
- * are produced by the "setup" code.  The other contains "empty" scenes
- * which are produced by the "rast" code when it finishes rendering a scene.
+ * Scene queue.  Scenes produced by the "setup" code are placed in a small
+ * ring of slots.  Every rasterizer thread walks the ring with its own
+ * cursor, so each queued scene is seen by all threads without any of them
+ * having to dequeue it on behalf of the others.
  */
 
-#include "util/u_ringbuffer.h"
 #include "util/u_memory.h"
+#include "lp_fence.h"
+#include "lp_scene.h"
 #include "lp_scene_queue.h"
 
 
 
-#define MAX_SCENE_QUEUE 4
-
-struct scene_packet {
-   struct util_packet header;
-   struct lp_scene *scene;
-};
-
 /**
  * A queue of scenes
  */
 struct lp_scene_queue
 {
-   struct util_ringbuffer *ring;
+   struct lp_scene *scenes[MAX_SCENE_QUEUE];
+
+   /** Fence of the scene last put in each slot, to know when it's free */
+   struct lp_fence *fences[MAX_SCENE_QUEUE];
+
+   /** Number of scenes enqueued so far */
+   unsigned count;
 };
 
 
@@ -60,19 +61,7 @@ struct lp_scene_queue *
 lp_scene_queue_create(void)
 {
    struct lp_scene_queue *queue = CALLOC_STRUCT(lp_scene_queue);
-   if (!queue)
-      return NULL;
-
-   queue->ring = util_ringbuffer_create( MAX_SCENE_QUEUE * 
-                                         sizeof( struct scene_packet ) / 4);
-   if (queue->ring == NULL)
-      goto fail;
-
    return queue;
-
-fail:
-   FREE(queue);
-   return NULL;
 }
 
 
@@ -80,45 +69,43 @@ fail:
 void
 lp_scene_queue_destroy(struct lp_scene_queue *queue)
 {
-   util_ringbuffer_destroy(queue->ring);
+   unsigned i;
+
+   for (i = 0; i < MAX_SCENE_QUEUE; i++) {
+      lp_fence_reference(&queue->fences[i], NULL);
+   }
    FREE(queue);
 }
 
 
-/** Remove first lp_scene from head of queue */
+/**
+ * Return the scene with the given sequence number.  The caller must know
+ * that it has been enqueued and that it hasn't finished rasterizing yet.
+ */
 struct lp_scene *
-lp_scene_dequeue(struct lp_scene_queue *queue, boolean wait)
+lp_scene_queue_get(struct lp_scene_queue *queue, unsigned seq)
 {
-   struct scene_packet packet;
-   enum pipe_error ret;
-
-   packet.scene = NULL;
-
-   ret = util_ringbuffer_dequeue(queue->ring,
-                                 &packet.header,
-                                 sizeof packet / 4,
-                                 wait );
-   if (ret != PIPE_OK)
-      return NULL;
-
-   return packet.scene;
+   return queue->scenes[seq % MAX_SCENE_QUEUE];
 }
 
 
-/** Add an lp_scene to tail of queue */
-void
+/**
+ * Add an lp_scene to tail of queue and return its sequence number.
+ * If the slot is still occupied, wait for the scene in it to be fully
+ * rasterized.  The scene must have an issued fence.
+ */
+unsigned
 lp_scene_enqueue(struct lp_scene_queue *queue, struct lp_scene *scene)
 {
-   struct scene_packet packet;
-
-   packet.header.dwords = sizeof packet / 4;
-   packet.header.data24 = 0;
-   packet.scene = scene;
-
-   util_ringbuffer_enqueue(queue->ring, &packet.header);
-}
-
-
+   unsigned seq = queue->count;
+   unsigned slot = seq % MAX_SCENE_QUEUE;
 
+   if (queue->fences[slot])
+      lp_fence_wait(queue->fences[slot]);
 
+   lp_fence_reference(&queue->fences[slot], scene->fence);
+   queue->scenes[slot] = scene;
+   queue->count++;
 
+   return seq;
+}
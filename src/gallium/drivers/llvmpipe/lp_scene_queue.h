@@ -35,6 +35,10 @@ struct lp_scene_queue;
 struct lp_scene;
 
 
+/** Most scenes which can be queued or rasterizing at once */
+#define MAX_SCENE_QUEUE 8
+
+
 struct lp_scene_queue *
 lp_scene_queue_create(void);
 
@@ -42,9 +46,9 @@ void
 lp_scene_queue_destroy(struct lp_scene_queue *queue);
 
 struct lp_scene *
-lp_scene_dequeue(struct lp_scene_queue *queue, boolean wait);
+lp_scene_queue_get(struct lp_scene_queue *queue, unsigned seq);
 
-void
+unsigned
 lp_scene_enqueue(struct lp_scene_queue *queue, struct lp_scene *scene);
 
 
@@ -47,6 +47,7 @@
 #include "lp_debug.h"
 #include "lp_public.h"
 #include "lp_limits.h"
+#include "lp_query.h"
 #include "lp_rast.h"
 
 #include "state_tracker/sw_winsys.h"
@@ -617,6 +618,49 @@ llvmpipe_get_timestamp(struct pipe_screen *_screen)
    return os_time_get_nano();
 }
 
+static int
+llvmpipe_get_driver_query_info(struct pipe_screen *screen,
+                               unsigned index,
+                               struct pipe_driver_query_info *info)
+{
+#define QUERY(NAME, ENUM, UNITS, RESULT) \
+   {NAME, ENUM, {0}, UNITS, RESULT, 0, 0x0}
+
+   static const struct pipe_driver_query_info queries[] = {
+      QUERY("fs-variant-hits", LP_QUERY_FS_VARIANT_HITS,
+            PIPE_DRIVER_QUERY_TYPE_UINT64,
+            PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE),
+      QUERY("fs-variant-misses", LP_QUERY_FS_VARIANT_MISSES,
+            PIPE_DRIVER_QUERY_TYPE_UINT64,
+            PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE),
+      QUERY("fs-variant-evictions", LP_QUERY_FS_VARIANT_EVICTIONS,
+            PIPE_DRIVER_QUERY_TYPE_UINT64,
+            PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE),
+      QUERY("fs-compile-time", LP_QUERY_FS_COMPILE_TIME,
+            PIPE_DRIVER_QUERY_TYPE_MICROSECONDS,
+            PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE),
+      QUERY("fs-variants", LP_QUERY_FS_VARIANTS,
+            PIPE_DRIVER_QUERY_TYPE_UINT64,
+            PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE),
+      QUERY("tex-cache-accesses", LP_QUERY_TEX_CACHE_ACCESSES,
+            PIPE_DRIVER_QUERY_TYPE_UINT64,
+            PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE),
+      QUERY("tex-cache-misses", LP_QUERY_TEX_CACHE_MISSES,
+            PIPE_DRIVER_QUERY_TYPE_UINT64,
+            PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE),
+   };
+#undef QUERY
+
+   if (!info)
+      return ARRAY_SIZE(queries);
+
+   if (index >= ARRAY_SIZE(queries))
+      return 0;
+
+   *info = queries[index];
+   return 1;
+}
+
 /**
  * Create a new pipe_screen object
  * Note: we're not presently subclassing pipe_screen (no llvmpipe_screen).
@@ -661,6 +705,7 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->base.fence_finish = llvmpipe_fence_finish;
 
    screen->base.get_timestamp = llvmpipe_get_timestamp;
+   screen->base.get_driver_query_info = llvmpipe_get_driver_query_info;
 
    llvmpipe_init_screen_resource_funcs(&screen->base);
 
@@ -74,12 +74,16 @@ lp_setup_get_empty_scene(struct lp_setup_context *setup)
 
    setup->scene = setup->scenes[setup->scene_idx];
 
+   /* Scenes are rasterized in submission order, so the next one in the
+    * ring is the oldest still possibly in flight.
+    */
    if (setup->scene->fence) {
       if (LP_DEBUG & DEBUG_SETUP)
          debug_printf("%s: wait for scene %d\n",
                       __FUNCTION__, setup->scene->fence->id);
 
       lp_fence_wait(setup->scene->fence);
+      lp_scene_reset(setup->scene);
    }
 
    lp_scene_begin_binning(setup->scene, &setup->fb, setup->rasterizer_discard);
@@ -147,6 +151,28 @@ void lp_setup_reset( struct lp_setup_context *setup )
 }
 
 
+/**
+ * Reset the scenes which the rasterizer has finished with.
+ */
+static void
+lp_setup_retire_scenes(struct lp_setup_context *setup)
+{
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(setup->scenes); i++) {
+      struct lp_scene *scene = setup->scenes[i];
+
+      if (scene->fence && lp_fence_signalled(scene->fence)) {
+         /* Returns immediately, but orders the rasterizer's last accesses
+          * to the scene before ours.
+          */
+         lp_fence_wait(scene->fence);
+         lp_scene_reset(scene);
+      }
+   }
+}
+
+
 /** Rasterize all scene's bins */
 static void
 lp_setup_rasterize_scene( struct lp_setup_context *setup )
@@ -166,22 +192,15 @@ lp_setup_rasterize_scene( struct lp_setup_context *setup )
       setup->last_fence->issued = TRUE;
 
    mtx_lock(&screen->rast_mutex);
-
-   /* FIXME: We enqueue the scene then wait on the rasterizer to finish.
-    * This means we never actually run any vertex stuff in parallel to
-    * rasterization (not in the same context at least) which is what the
-    * multiple scenes per setup is about - when we get a new empty scene
-    * any old one is already empty again because we waited here for
-    * raster tasks to be finished. Ideally, we shouldn't need to wait here
-    * and rely on fences elsewhere when waiting is necessary.
-    * Certainly, lp_scene_end_rasterization() would need to be deferred too
-    * and there's probably other bits why this doesn't actually work.
-    */
    lp_rast_queue_scene(screen->rast, scene);
-   lp_rast_finish(screen->rast);
    mtx_unlock(&screen->rast_mutex);
 
-   lp_scene_end_rasterization(setup->scene);
+   /* Don't wait for the rasterizer: binning of the next scene overlaps
+    * with rasterization of this one.  Release whatever earlier scenes
+    * have finished so their resource references don't linger.
+    */
+   lp_setup_retire_scenes(setup);
+
    lp_setup_reset( setup );
 
    LP_DBG(DEBUG_SETUP, "%s done \n", __FUNCTION__);
@@ -199,9 +218,10 @@ begin_binning( struct lp_setup_context *setup )
    assert(scene);
    assert(scene->fence == NULL);
 
-   /* Always create a fence:
+   /* Always create a fence.  It is signalled once, by lp_rast_end(),
+    * after every rasterizer thread is done with the scene.
     */
-   scene->fence = lp_fence_create(MAX2(1, setup->num_threads));
+   scene->fence = lp_fence_create(1);
    if (!scene->fence)
       return FALSE;
 
@@ -209,6 +229,11 @@ begin_binning( struct lp_setup_context *setup )
    if (!ok)
       return FALSE;
 
+   /* Depth contents are unknown unless they're cleared below. */
+   lp_setup_hiz_reset(setup,
+                      (setup->clear.flags & PIPE_CLEAR_DEPTH) != 0,
+                      setup->clear.depth);
+
    if (setup->fb.zsbuf &&
        ((setup->clear.flags & PIPE_CLEAR_DEPTHSTENCIL) != PIPE_CLEAR_DEPTHSTENCIL) &&
         util_format_is_depth_and_stencil(setup->fb.zsbuf->format))
@@ -342,7 +367,7 @@ set_scene_state( struct lp_setup_context *setup,
 
 fail:
    if (setup->scene) {
-      lp_scene_end_rasterization(setup->scene);
+      lp_scene_reset(setup->scene);
       setup->scene = NULL;
    }
 
@@ -514,6 +539,9 @@ lp_setup_try_clear_zs(struct lp_setup_context *setup,
                                    LP_RAST_OP_CLEAR_ZSTENCIL,
                                    lp_rast_arg_clearzs(zsvalue, zsmask)))
          return FALSE;
+
+      if (flags & PIPE_CLEAR_DEPTH)
+         lp_setup_hiz_reset(setup, TRUE, depth);
    }
    else {
       /* Put ourselves into the 'pre-clear' state, specifically to try
@@ -528,6 +556,8 @@ lp_setup_try_clear_zs(struct lp_setup_context *setup,
       setup->clear.zsmask |= zsmask;
       setup->clear.zsvalue =
          (setup->clear.zsvalue & ~zsmask) | (zsvalue & zsmask);
+      if (flags & PIPE_CLEAR_DEPTH)
+         setup->clear.depth = depth;
    }
 
    return TRUE;
@@ -981,9 +1011,23 @@ lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
       return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
    }
 
-   /* check textures referenced by the scene */
+   /* check scenes still being built or rasterized */
    for (i = 0; i < ARRAY_SIZE(setup->scenes); i++) {
-      if (lp_scene_is_resource_referenced(setup->scenes[i], texture)) {
+      const struct lp_scene *scene = setup->scenes[i];
+      unsigned j;
+
+      if (!scene->fence || lp_fence_signalled(scene->fence))
+         continue;
+
+      /* queued scenes may still write to their own render targets */
+      for (j = 0; j < scene->fb.nr_cbufs; j++) {
+         if (scene->fb.cbufs[j] && scene->fb.cbufs[j]->texture == texture)
+            return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+      }
+      if (scene->fb.zsbuf && scene->fb.zsbuf->texture == texture)
+         return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+
+      if (lp_scene_is_resource_referenced(scene, texture)) {
          return LP_REFERENCED_FOR_READ;
       }
    }
@@ -1287,8 +1331,11 @@ lp_setup_destroy( struct lp_setup_context *setup )
    for (i = 0; i < ARRAY_SIZE(setup->scenes); i++) {
       struct lp_scene *scene = setup->scenes[i];
 
-      if (scene->fence)
-         lp_fence_wait(scene->fence);
+      if (scene->fence) {
+         if (scene != setup->scene)
+            lp_fence_wait(scene->fence);
+         lp_scene_reset(scene);
+      }
 
       lp_scene_destroy(scene);
    }
@@ -54,9 +54,10 @@
 struct lp_setup_variant;
 
 
-/** Max number of scenes */
-/* XXX: make multiple scenes per context work, see lp_setup_rasterize_scene */
-#define MAX_SCENES 1
+/** Max number of scenes per context.  While the rasterizer works through
+ * queued scenes, setup keeps binning into the next free one.
+ */
+#define MAX_SCENES 4
 
 
 
@@ -121,8 +122,18 @@ struct lp_setup_context
       union util_color color_val[PIPE_MAX_COLOR_BUFS];
       uint64_t zsmask;
       uint64_t zsvalue;               /**< lp_rast_clear_zstencil() cmd */
+      float depth;                    /**< unpacked depth clear value */
    } clear;
 
+   /** Conservative bounds of the depth values in each tile of the scene
+    * being binned, assuming the bins so far have been rasterized.  Lets
+    * binning drop triangles which fail the depth test across a tile.
+    */
+   struct {
+      float zmin[TILES_X][TILES_Y];
+      float zmax[TILES_X][TILES_Y];
+   } hiz;
+
    enum setup_state {
       SETUP_FLUSHED,    /**< scene is null */
       SETUP_CLEARED,    /**< scene exists but has only clears */
@@ -214,12 +225,17 @@ lp_setup_alloc_triangle(struct lp_scene *scene,
                         unsigned nr_planes,
                         unsigned *tri_size);
 
+void
+lp_setup_hiz_reset(struct lp_setup_context *setup,
+                   boolean known, float depth);
+
 boolean
 lp_setup_bin_triangle(struct lp_setup_context *setup,
                       struct lp_rast_triangle *tri,
                       const struct u_rect *bboxorig,
                       const struct u_rect *bbox,
                       int nr_planes,
-                      unsigned scissor_index);
+                      unsigned scissor_index,
+                      float zmin, float zmax);
 
 #endif
@@ -29,6 +29,7 @@
  * Binning code for lines
  */
 
+#include <float.h>
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "lp_perf.h"
@@ -755,7 +756,9 @@ try_setup_line( struct lp_setup_context *setup,
       assert(plane_s == &plane[nr_planes]);
    }
 
-   return lp_setup_bin_triangle(setup, line, &bbox, &bboxpos, nr_planes, viewport_index);
+   return lp_setup_bin_triangle(setup, line, &bbox, &bboxpos, nr_planes, viewport_index,
+                                /* extents may be extrapolated, no cull */
+                                -FLT_MAX, FLT_MAX);
 }
 
 
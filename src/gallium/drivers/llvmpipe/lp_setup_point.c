@@ -29,6 +29,7 @@
  * Binning code for points
  */
 
+#include <float.h>
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "lp_setup_context.h"
@@ -513,7 +514,9 @@ try_setup_point( struct lp_setup_context *setup,
       plane[3].eo = 0;
    }
 
-   return lp_setup_bin_triangle(setup, point, &bbox, &bbox, nr_planes, viewport_index);
+   return lp_setup_bin_triangle(setup, point, &bbox, &bbox, nr_planes, viewport_index,
+                                /* extents may be extrapolated, no cull */
+                                -FLT_MAX, FLT_MAX);
 }
 
 
@@ -40,6 +40,7 @@
 #include "lp_state_setup.h"
 #include "lp_context.h"
 
+#include <float.h>
 #include <inttypes.h>
 
 #define NUM_CHANNELS 4
@@ -206,6 +207,153 @@ lp_rast_32_tri_tab[MAX_PLANES+1] = {
 
 
 
+/*
+ * Coarse depth ("hiz") tracking.
+ *
+ * While binning, setup->hiz keeps per-tile bounds on the depth values the
+ * tile will hold once the bins binned so far have executed.  Triangles
+ * whose depth range lies entirely behind a tile's bound are not binned
+ * into it.  The bounds are in window z and compared with a margin which
+ * covers rounding to any depth format, so the test never culls a fragment
+ * which the real depth test would have passed.
+ */
+#define LP_HIZ_EPSILON (1.0f / 32768.0f)
+
+
+/**
+ * Reset the coarse depth bounds of the scene's tiles: to 'depth' if the
+ * whole depth buffer is known to hold that value, else to "anything".
+ * Binning never goes past the framebuffer, so the bounds of the other
+ * tiles are left as they are.
+ */
+void
+lp_setup_hiz_reset(struct lp_setup_context *setup,
+                   boolean known, float depth)
+{
+   const struct lp_scene *scene = setup->scene;
+   unsigned x, y;
+
+   for (x = 0; x < scene->tiles_x; x++) {
+      for (y = 0; y < scene->tiles_y; y++) {
+         setup->hiz.zmin[x][y] = known ? depth : -FLT_MAX;
+         setup->hiz.zmax[x][y] = known ? depth : FLT_MAX;
+      }
+   }
+}
+
+
+/** How one primitive interacts with the coarse depth bounds. */
+struct hiz_prim {
+   unsigned func;
+   boolean cull;        /**< may be dropped from tiles it can't pass in */
+   boolean write;       /**< may change the depth values of tiles */
+   boolean full_write;  /**< writes z wherever it passes, if no cull */
+   float zmin, zmax;    /**< depth range of the primitive's fragments */
+};
+
+
+static void
+hiz_prim_init(const struct lp_setup_context *setup,
+              float zmin, float zmax,
+              struct hiz_prim *prim)
+{
+   const struct lp_fragment_shader_variant *variant =
+      setup->fs.current.variant;
+   const struct lp_setup_variant_key *key = &setup->setup.variant->key;
+   const struct lp_scene *scene = setup->scene;
+   boolean exact = variant->hiz_exact_z &&
+                   key->pgon_offset_units == 0.0f &&
+                   key->pgon_offset_scale == 0.0f;
+
+   prim->func = variant->key.depth.func;
+   prim->write = variant->key.depth.enabled && variant->key.depth.writemask;
+   prim->full_write = variant->hiz_full_write && exact;
+
+   /* With layered rendering tiles don't map to a single depth surface.
+    * Like the opaque tile optimization, stay away from scenes with
+    * queries, whose statistics would notice skipped shader invocations.
+    */
+   prim->cull = variant->hiz_cull && exact &&
+                scene->fb_max_layer == 0 &&
+                !scene->had_queries;
+
+   prim->zmin = exact ? zmin : -FLT_MAX;
+   prim->zmax = exact ? zmax : FLT_MAX;
+}
+
+
+/** Would the primitive fail the depth test everywhere in tile x, y? */
+static inline boolean
+hiz_cull_tile(const struct lp_setup_context *setup,
+              const struct hiz_prim *prim,
+              int x, int y)
+{
+   if (!prim->cull)
+      return FALSE;
+
+   switch (prim->func) {
+   case PIPE_FUNC_LESS:
+   case PIPE_FUNC_LEQUAL:
+      return prim->zmin > setup->hiz.zmax[x][y] + LP_HIZ_EPSILON;
+   case PIPE_FUNC_GREATER:
+   case PIPE_FUNC_GEQUAL:
+      return prim->zmax < setup->hiz.zmin[x][y] - LP_HIZ_EPSILON;
+   default:
+      return FALSE;
+   }
+}
+
+
+/**
+ * Account for the primitive's depth writes to tile x, y.
+ * \param full  the primitive covers the whole tile
+ */
+static inline void
+hiz_update_tile(struct lp_setup_context *setup,
+                const struct hiz_prim *prim,
+                int x, int y, boolean full)
+{
+   float *zmin = &setup->hiz.zmin[x][y];
+   float *zmax = &setup->hiz.zmax[x][y];
+
+   if (!prim->write)
+      return;
+
+   full = full && prim->full_write;
+
+   switch (prim->func) {
+   case PIPE_FUNC_NEVER:
+   case PIPE_FUNC_EQUAL:
+      break;
+   case PIPE_FUNC_LESS:
+   case PIPE_FUNC_LEQUAL:
+      /* depth values can only decrease */
+      *zmin = MIN2(*zmin, prim->zmin);
+      if (full)
+         *zmax = MIN2(*zmax, prim->zmax);
+      break;
+   case PIPE_FUNC_GREATER:
+   case PIPE_FUNC_GEQUAL:
+      /* depth values can only increase */
+      *zmax = MAX2(*zmax, prim->zmax);
+      if (full)
+         *zmin = MAX2(*zmin, prim->zmin);
+      break;
+   case PIPE_FUNC_ALWAYS:
+      if (full) {
+         *zmin = prim->zmin;
+         *zmax = prim->zmax;
+         break;
+      }
+      /* fallthrough */
+   default:
+      *zmin = MIN2(*zmin, prim->zmin);
+      *zmax = MAX2(*zmax, prim->zmax);
+      break;
+   }
+}
+
+
 /**
  * The primitive covers the whole tile- shade whole tile.
  *
@@ -717,7 +865,9 @@ do_triangle_ccw(struct lp_setup_context *setup,
       assert(plane_s == &plane[nr_planes]);
    }
 
-   return lp_setup_bin_triangle(setup, tri, &bbox, &bboxpos, nr_planes, viewport_index);
+   return lp_setup_bin_triangle(setup, tri, &bbox, &bboxpos, nr_planes, viewport_index,
+                                MIN3(v0[0][2], v1[0][2], v2[0][2]),
+                                MAX3(v0[0][2], v1[0][2], v2[0][2]));
 }
 
 /*
@@ -753,10 +903,12 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
                       const struct u_rect *bboxorig,
                       const struct u_rect *bbox,
                       int nr_planes,
-                      unsigned viewport_index)
+                      unsigned viewport_index,
+                      float zmin, float zmax)
 {
    struct lp_scene *scene = setup->scene;
    struct u_rect trimmed_box = *bbox;   
+   struct hiz_prim hiz;
    int i;
    /* What is the largest power-of-two boundary this triangle crosses:
     */
@@ -788,6 +940,8 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
    u_rect_find_intersection(&setup->draw_regions[viewport_index],
                             &trimmed_box);
 
+   hiz_prim_init(setup, zmin, zmax, &hiz);
+
    /* Determine which tile(s) intersect the triangle's bounding box
     */
    if (dx < TILE_SIZE)
@@ -800,6 +954,13 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
       assert(iy0 == bbox->y1 / TILE_SIZE &&
 	     ix0 == bbox->x1 / TILE_SIZE);
 
+      if (hiz_cull_tile(setup, &hiz, ix0, iy0)) {
+         LP_COUNT(nr_hiz_culled_64);
+         LP_COUNT(nr_hiz_culled_tris);
+         return TRUE;
+      }
+      hiz_update_tile(setup, &hiz, ix0, iy0, FALSE);
+
       if (nr_planes == 3) {
          if (sz < 4)
          {
@@ -878,6 +1039,7 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
       int iy0 = trimmed_box.y0 / TILE_SIZE;
       int ix1 = trimmed_box.x1 / TILE_SIZE;
       int iy1 = trimmed_box.y1 / TILE_SIZE;
+      boolean binned = FALSE, hidden = FALSE;
       
       for (i = 0; i < nr_planes; i++) {
          c[i] = (plane[i].c + 
@@ -926,6 +1088,12 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
                   break;  /* exiting triangle, all done with this row */
                LP_COUNT(nr_empty_64);
             }
+            else if (hiz_cull_tile(setup, &hiz, x, y)) {
+               /* hidden behind what the tile already holds */
+               in = TRUE;
+               hidden = TRUE;
+               LP_COUNT(nr_hiz_culled_64);
+            }
             else if (partial) {
                /* Not trivially accepted by at least one plane -
                 * rasterize/shade partial tile
@@ -941,6 +1109,8 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
                                                  lp_rast_arg_triangle(tri, partial) ))
                   goto fail;
 
+               hiz_update_tile(setup, &hiz, x, y, FALSE);
+               binned = TRUE;
                LP_COUNT(nr_partially_covered_64);
             }
             else {
@@ -949,6 +1119,9 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
                in = TRUE;
                if (!lp_setup_whole_tile(setup, &tri->inputs, x, y))
                   goto fail;
+
+               hiz_update_tile(setup, &hiz, x, y, TRUE);
+               binned = TRUE;
             }
 
             /* Iterate cx values across the region: */
@@ -960,6 +1133,9 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
          for (i = 0; i < nr_planes; i++)
             c[i] += ystep[i];
       }
+
+      if (hidden && !binned)
+         LP_COUNT(nr_hiz_culled_tris);
    }
 
    return TRUE;
@@ -58,6 +58,7 @@
  */
 
 #include <limits.h>
+#include <stdio.h>
 #include "pipe/p_defines.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
@@ -68,6 +69,8 @@
 #include "util/simple_list.h"
 #include "util/u_dual_blend.h"
 #include "util/os_time.h"
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
 #include "pipe/p_shader_tokens.h"
 #include "draw/draw_context.h"
 #include "tgsi/tgsi_dump.h"
@@ -2843,6 +2846,27 @@ generate_variant(struct llvmpipe_context *lp,
          !shader->info.base.writes_samplemask
       ? TRUE : FALSE;
 
+   variant->hiz_exact_z =
+         !shader->info.base.writes_z &&
+         !key->depth_clamp;
+
+   variant->hiz_cull =
+         key->depth.enabled &&
+         !key->stencil[0].enabled &&
+         (key->depth.func == PIPE_FUNC_LESS ||
+          key->depth.func == PIPE_FUNC_LEQUAL ||
+          key->depth.func == PIPE_FUNC_GREATER ||
+          key->depth.func == PIPE_FUNC_GEQUAL);
+
+   variant->hiz_full_write =
+         key->depth.enabled &&
+         key->depth.writemask &&
+         !key->stencil[0].enabled &&
+         !key->alpha.enabled &&
+         !key->blend.alpha_to_coverage &&
+         !shader->info.base.uses_kill &&
+         !shader->info.base.writes_samplemask;
+
    if ((shader->info.base.num_tokens <= 1) &&
        !key->depth.enabled && !key->stencil[0].enabled) {
       variant->ps_inv_multiplier = 0;
@@ -2894,6 +2918,289 @@ generate_variant(struct llvmpipe_context *lp,
 }
 
 
+/**
+ * Number of least recently used variants considered for eviction.
+ */
+#define LP_FS_EVICT_WINDOW 8
+
+#define LP_MAX_FS_HOT_KEYS 1024
+
+#define LP_FS_KEYS_MAGIC   0x4b53464c /* "LFSK" */
+#define LP_FS_KEYS_VERSION 1
+
+struct lp_fs_keys_header
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t timestamp;   /* of the driver binary, keys are build specific */
+   uint32_t key_struct_size;
+   uint32_t count;
+};
+
+
+/**
+ * Remember a variant key as hot, merging its hits with an existing record.
+ * When the table is full the coldest record makes room.  Returns the
+ * record, or NULL if the key was too cold to keep.
+ */
+static struct lp_fs_hot_key *
+lp_fs_hot_key_record(struct llvmpipe_context *lp,
+                     const unsigned char shader_sha1[20],
+                     unsigned key_size,
+                     const struct lp_fragment_shader_variant_key *key,
+                     unsigned hits)
+{
+   struct lp_fs_hot_key *hot = NULL;
+   unsigned i;
+
+   if (!lp->fs_hot_keys) {
+      lp->fs_hot_keys = CALLOC(LP_MAX_FS_HOT_KEYS, sizeof *lp->fs_hot_keys);
+      if (!lp->fs_hot_keys)
+         return NULL;
+   }
+
+   for (i = 0; i < lp->nr_fs_hot_keys; i++) {
+      struct lp_fs_hot_key *rec = &lp->fs_hot_keys[i];
+      if (rec->key_size == key_size &&
+          memcmp(rec->shader_sha1, shader_sha1, 20) == 0 &&
+          memcmp(&rec->key, key, key_size) == 0) {
+         rec->hits += hits;
+         return rec;
+      }
+   }
+
+   if (lp->nr_fs_hot_keys < LP_MAX_FS_HOT_KEYS) {
+      hot = &lp->fs_hot_keys[lp->nr_fs_hot_keys++];
+   }
+   else {
+      for (i = 0; i < lp->nr_fs_hot_keys; i++) {
+         if (!hot || lp->fs_hot_keys[i].hits < hot->hits)
+            hot = &lp->fs_hot_keys[i];
+      }
+      if (hot->hits >= hits)
+         return NULL;
+   }
+
+   memset(hot, 0, sizeof *hot);
+   memcpy(hot->shader_sha1, shader_sha1, 20);
+   hot->key_size = key_size;
+   hot->hits = hits;
+   memcpy(&hot->key, key, key_size);
+   return hot;
+}
+
+
+static uint32_t
+lp_fs_keys_timestamp(void)
+{
+   uint32_t timestamp = 0;
+
+   disk_cache_get_function_timestamp(lp_fs_keys_timestamp, &timestamp);
+   return timestamp;
+}
+
+
+/**
+ * Merge the records of the LP_FS_VARIANT_KEYS file into the hot keys.
+ * When loading, remember their hits as already saved.
+ */
+static void
+lp_fs_variant_keys_read(struct llvmpipe_context *lp, boolean loading)
+{
+   struct lp_fs_keys_header header;
+   FILE *f;
+   unsigned i;
+
+   f = fopen(lp->fs_keys_file, "rb");
+   if (!f)
+      return;
+
+   if (fread(&header, sizeof header, 1, f) != 1 ||
+       header.magic != LP_FS_KEYS_MAGIC ||
+       header.version != LP_FS_KEYS_VERSION ||
+       header.timestamp != lp_fs_keys_timestamp() ||
+       header.key_struct_size != sizeof(struct lp_fragment_shader_variant_key)) {
+      fclose(f);
+      return;
+   }
+
+   for (i = 0; i < header.count; i++) {
+      struct lp_fs_hot_key rec, *hot;
+      uint32_t key_size, hits;
+
+      memset(&rec, 0, sizeof rec);
+      if (fread(rec.shader_sha1, 20, 1, f) != 1 ||
+          fread(&key_size, sizeof key_size, 1, f) != 1 ||
+          fread(&hits, sizeof hits, 1, f) != 1 ||
+          key_size > sizeof rec.key ||
+          fread(&rec.key, key_size, 1, f) != 1)
+         break;
+
+      hot = lp_fs_hot_key_record(lp, rec.shader_sha1, key_size, &rec.key,
+                                 hits);
+      if (hot && loading)
+         hot->loaded_hits = hot->hits;
+   }
+
+   fclose(f);
+}
+
+
+/**
+ * Read back the hot variant keys saved by an earlier run, if
+ * LP_FS_VARIANT_KEYS names a file.  Shaders matching them get those
+ * variants compiled as soon as they are created.
+ */
+void
+lp_fs_variant_keys_load(struct llvmpipe_context *lp)
+{
+   lp->fs_keys_file = debug_get_option("LP_FS_VARIANT_KEYS", NULL);
+   if (!lp->fs_keys_file)
+      return;
+
+   lp_fs_variant_keys_read(lp, TRUE);
+
+   if (LP_DEBUG & DEBUG_FS) {
+      debug_printf("llvmpipe: loaded %u hot fs variant keys from %s\n",
+                   lp->nr_fs_hot_keys, lp->fs_keys_file);
+   }
+}
+
+
+/**
+ * Save the hot variant keys, both of the variants still cached and of those
+ * freed earlier on, for LP_FS_VARIANT_KEYS.  Other contexts may have saved
+ * theirs since this one loaded the file, so only the hits of this context
+ * are added to what the file holds now.  The file is replaced by renaming,
+ * never left half written.
+ */
+void
+lp_fs_variant_keys_dump(struct llvmpipe_context *lp)
+{
+   struct lp_fs_variant_list_item *li;
+   struct lp_fs_keys_header header;
+   char *tmp_file;
+   FILE *f;
+   unsigned i;
+
+   if (!lp->fs_keys_file)
+      return;
+
+   li = first_elem(&lp->fs_variants_list);
+   while (!at_end(&lp->fs_variants_list, li)) {
+      struct lp_fragment_shader_variant *variant = li->base;
+      if (variant->hits) {
+         lp_fs_hot_key_record(lp, variant->shader->sha1,
+                              variant->shader->variant_key_size,
+                              &variant->key, variant->hits);
+         variant->hits = 0;
+      }
+      li = next_elem(li);
+   }
+
+   for (i = 0; i < lp->nr_fs_hot_keys; i++) {
+      lp->fs_hot_keys[i].hits -= lp->fs_hot_keys[i].loaded_hits;
+      lp->fs_hot_keys[i].loaded_hits = 0;
+   }
+   lp_fs_variant_keys_read(lp, FALSE);
+
+   if (!lp->nr_fs_hot_keys)
+      return;
+
+   tmp_file = MALLOC(strlen(lp->fs_keys_file) + 32);
+   if (!tmp_file)
+      return;
+   sprintf(tmp_file, "%s.%p.tmp", lp->fs_keys_file, (void *) lp);
+   f = fopen(tmp_file, "wb");
+   if (!f) {
+      FREE(tmp_file);
+      return;
+   }
+
+   header.magic = LP_FS_KEYS_MAGIC;
+   header.version = LP_FS_KEYS_VERSION;
+   header.timestamp = lp_fs_keys_timestamp();
+   header.key_struct_size = sizeof(struct lp_fragment_shader_variant_key);
+   header.count = lp->nr_fs_hot_keys;
+   fwrite(&header, sizeof header, 1, f);
+
+   for (i = 0; i < lp->nr_fs_hot_keys; i++) {
+      const struct lp_fs_hot_key *rec = &lp->fs_hot_keys[i];
+      uint32_t key_size = rec->key_size;
+      uint32_t hits = rec->hits;
+
+      fwrite(rec->shader_sha1, 20, 1, f);
+      fwrite(&key_size, sizeof key_size, 1, f);
+      fwrite(&hits, sizeof hits, 1, f);
+      fwrite(&rec->key, key_size, 1, f);
+   }
+
+   if (fclose(f) != 0 || rename(tmp_file, lp->fs_keys_file) != 0)
+      remove(tmp_file);
+   FREE(tmp_file);
+}
+
+
+/**
+ * Build a variant and put it into the shader's and the context's lists.
+ */
+static struct lp_fragment_shader_variant *
+lp_fs_variant_create(struct llvmpipe_context *lp,
+                     struct lp_fragment_shader *shader,
+                     const struct lp_fragment_shader_variant_key *key)
+{
+   struct lp_fragment_shader_variant *variant;
+   int64_t t0, t1, dt;
+
+   t0 = os_time_get();
+   variant = generate_variant(lp, shader, key);
+   t1 = os_time_get();
+   dt = t1 - t0;
+   LP_COUNT_ADD(llvm_compile_time, dt);
+   LP_COUNT_ADD(nr_llvm_compiles, 2);  /* emit vs. omit in/out test */
+   lp->fs_variant_stats.compile_usecs += dt;
+
+   /* Put the new variant into the list */
+   if (variant) {
+      variant->compile_usecs = dt;
+      insert_at_head(&shader->variants, &variant->list_item_local);
+      insert_at_head(&lp->fs_variants_list, &variant->list_item_global);
+      lp->nr_fs_variants++;
+      lp->nr_fs_instrs += variant->nr_instrs;
+      shader->variants_cached++;
+   }
+
+   return variant;
+}
+
+
+/**
+ * Compile the variants a previous run found hot for this shader.
+ */
+static void
+lp_fs_prewarm_variants(struct llvmpipe_context *lp,
+                       struct lp_fragment_shader *shader)
+{
+   unsigned i;
+
+   for (i = 0; i < lp->nr_fs_hot_keys; i++) {
+      const struct lp_fs_hot_key *rec = &lp->fs_hot_keys[i];
+
+      /* Prewarming never evicts, so leave half of both budgets to the
+       * variants draws actually ask for.
+       */
+      if (lp->nr_fs_variants >= LP_MAX_SHADER_VARIANTS / 2 ||
+          lp->nr_fs_instrs >= LP_MAX_SHADER_INSTRUCTIONS / 2)
+         break;
+
+      if (rec->key_size == shader->variant_key_size &&
+          memcmp(rec->shader_sha1, shader->sha1, 20) == 0) {
+         lp_fs_variant_create(lp, shader, &rec->key);
+      }
+   }
+}
+
+
 static void *
 llvmpipe_create_fs_state(struct pipe_context *pipe,
                          const struct pipe_shader_state *templ)
@@ -2968,6 +3275,14 @@ llvmpipe_create_fs_state(struct pipe_context *pipe,
       shader->inputs[i].src_index = i+1;
    }
 
+   if (llvmpipe->fs_keys_file) {
+      _mesa_sha1_compute(shader->base.tokens,
+                         tgsi_num_tokens(shader->base.tokens) *
+                         sizeof(struct tgsi_token),
+                         shader->sha1);
+      lp_fs_prewarm_variants(llvmpipe, shader);
+   }
+
    if (LP_DEBUG & DEBUG_TGSI) {
       unsigned attrib;
       debug_printf("llvmpipe: Create fragment shader #%u %p:\n",
@@ -3024,6 +3339,12 @@ llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                    lp->nr_fs_variants, variant->nr_instrs, lp->nr_fs_instrs);
    }
 
+   if (lp->fs_keys_file && variant->hits) {
+      lp_fs_hot_key_record(lp, variant->shader->sha1,
+                           variant->shader->variant_key_size,
+                           &variant->key, variant->hits);
+   }
+
    gallivm_destroy(variant->gallivm);
 
    /* remove from shader's list */
@@ -3347,6 +3668,46 @@ make_variant_key(struct llvmpipe_context *lp,
 
 
 
+/**
+ * Evict one variant.  Out of the LP_FS_EVICT_WINDOW least recently used
+ * ones pick the cheapest to bring back, that is the one with the lowest
+ * compile time weighted by its hits.  The survivors get their hits halved
+ * so that variants which were hot once but aren't used anymore go too.
+ */
+static void
+lp_fs_variant_evict_one(struct llvmpipe_context *lp)
+{
+   struct lp_fs_variant_list_item *item, *victim = NULL;
+   uint64_t victim_cost = UINT64_MAX;
+   unsigned i;
+
+   item = last_elem(&lp->fs_variants_list);
+   for (i = 0; i < LP_FS_EVICT_WINDOW && !at_end(&lp->fs_variants_list, item); i++) {
+      const struct lp_fragment_shader_variant *variant = item->base;
+      uint64_t cost = (uint64_t)MAX2(variant->compile_usecs, 1) *
+                      (variant->hits + 1);
+
+      if (cost < victim_cost) {
+         victim = item;
+         victim_cost = cost;
+      }
+      item = prev_elem(item);
+   }
+
+   assert(victim);
+
+   item = last_elem(&lp->fs_variants_list);
+   for (i = 0; i < LP_FS_EVICT_WINDOW && !at_end(&lp->fs_variants_list, item); i++) {
+      if (item != victim)
+         item->base->hits /= 2;
+      item = prev_elem(item);
+   }
+
+   llvmpipe_remove_shader_variant(lp, victim->base);
+   lp->fs_variant_stats.evictions++;
+}
+
+
 /**
  * Update fragment shader state.  This is called just prior to drawing
  * something when some fragment-related state has changed.
@@ -3376,13 +3737,16 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
        * deletion of shader's when we have too many.
        */
       move_to_head(&lp->fs_variants_list, &variant->list_item_global);
+      variant->hits++;
+      lp->fs_variant_stats.hits++;
    }
    else {
       /* variant not found, create it now */
-      int64_t t0, t1, dt;
       unsigned i;
       unsigned variants_to_cull;
 
+      lp->fs_variant_stats.misses++;
+
       if (LP_DEBUG & DEBUG_FS) {
          debug_printf("%u variants,\t%u instrs,\t%u instrs/variant\n",
                       lp->nr_fs_variants,
@@ -3421,35 +3785,17 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
           */
 
          for (i = 0; i < variants_to_cull || lp->nr_fs_instrs >= LP_MAX_SHADER_INSTRUCTIONS; i++) {
-            struct lp_fs_variant_list_item *item;
             if (is_empty_list(&lp->fs_variants_list)) {
                break;
             }
-            item = last_elem(&lp->fs_variants_list);
-            assert(item);
-            assert(item->base);
-            llvmpipe_remove_shader_variant(lp, item->base);
+            lp_fs_variant_evict_one(lp);
          }
       }
 
       /*
        * Generate the new variant.
        */
-      t0 = os_time_get();
-      variant = generate_variant(lp, shader, &key);
-      t1 = os_time_get();
-      dt = t1 - t0;
-      LP_COUNT_ADD(llvm_compile_time, dt);
-      LP_COUNT_ADD(nr_llvm_compiles, 2);  /* emit vs. omit in/out test */
-
-      /* Put the new variant into the list */
-      if (variant) {
-         insert_at_head(&shader->variants, &variant->list_item_local);
-         insert_at_head(&lp->fs_variants_list, &variant->list_item_global);
-         lp->nr_fs_variants++;
-         lp->nr_fs_instrs += variant->nr_instrs;
-         shader->variants_cached++;
-      }
+      variant = lp_fs_variant_create(lp, shader, &key);
    }
 
    /* Bind this variant */
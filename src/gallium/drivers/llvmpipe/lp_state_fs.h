@@ -85,6 +85,20 @@ struct lp_fragment_shader_variant_key
 };
 
 
+/**
+ * A variant key seen often enough to be worth compiling up front in later
+ * runs, see LP_FS_VARIANT_KEYS.
+ */
+struct lp_fs_hot_key
+{
+   unsigned char shader_sha1[20];
+   unsigned key_size;
+   unsigned hits;
+   unsigned loaded_hits;   /* part of hits read back from the file */
+   struct lp_fragment_shader_variant_key key;
+};
+
+
 /** doubly-linked list item */
 struct lp_fs_variant_list_item
 {
@@ -100,6 +114,11 @@ struct lp_fragment_shader_variant
    boolean opaque;
    uint8_t ps_inv_multiplier;
 
+   /* Coarse per-tile depth tracking at binning time, see lp_setup_tri.c */
+   boolean hiz_exact_z;     /**< fragment z is the interpolated vertex z */
+   boolean hiz_cull;        /**< depth test alone decides visibility */
+   boolean hiz_full_write;  /**< every fragment passing the depth test writes z */
+
    struct gallivm_state *gallivm;
 
    LLVMTypeRef jit_context_ptr_type;
@@ -113,6 +132,10 @@ struct lp_fragment_shader_variant
    /* Total number of LLVM instructions generated */
    unsigned nr_instrs;
 
+   /* Times this variant was looked up and found, and what it cost to build */
+   unsigned hits;
+   int64_t compile_usecs;
+
    struct lp_fs_variant_list_item list_item_global, list_item_local;
    struct lp_fragment_shader *shader;
 
@@ -138,6 +161,9 @@ struct lp_fragment_shader
    unsigned variants_created;
    unsigned variants_cached;
 
+   /* Identifies the shader across runs, only set with LP_FS_VARIANT_KEYS */
+   unsigned char sha1[20];
+
    /** Fragment shader input interpolation info */
    struct lp_shader_input inputs[PIPE_MAX_SHADER_INPUTS];
 };
@@ -153,5 +179,11 @@ llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
 boolean
 llvmpipe_rasterization_disabled(struct llvmpipe_context *lp);
 
+void
+lp_fs_variant_keys_load(struct llvmpipe_context *lp);
+
+void
+lp_fs_variant_keys_dump(struct llvmpipe_context *lp);
+
 
 #endif /* LP_STATE_FS_H_ */
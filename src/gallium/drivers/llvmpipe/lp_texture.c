@@ -42,6 +42,7 @@
 #include "util/u_memory.h"
 #include "util/simple_list.h"
 #include "util/u_transfer.h"
+#include "gallivm/lp_bld_format.h"
 
 #include "lp_context.h"
 #include "lp_flush.h"
@@ -60,6 +61,60 @@ static struct llvmpipe_resource resource_list;
 static unsigned id_counter = 0;
 
 
+struct zero_bands_data {
+   struct llvmpipe_resource *lpr;
+   unsigned num_nodes;
+};
+
+
+/**
+ * Zero the rows of every image of a render target which the given node's
+ * rasterizer threads render, by the same split into bands of tile rows as
+ * lp_scene_bin_iter_begin() makes.
+ */
+static void
+zero_bands(void *data, unsigned node)
+{
+   const struct zero_bands_data *zero = (const struct zero_bands_data *) data;
+   struct llvmpipe_resource *lpr = zero->lpr;
+   unsigned level, slice;
+
+   for (level = 0; level <= lpr->base.last_level; level++) {
+      const unsigned height = u_minify(lpr->base.height0, level);
+      const unsigned nblocksy = util_format_get_nblocksy(lpr->base.format,
+                                                         height);
+      const unsigned tiles_y = DIV_ROUND_UP(height, TILE_SIZE);
+      const unsigned num_nodes = MIN2(zero->num_nodes, tiles_y);
+      const unsigned y0 = MIN2(DIV_ROUND_UP(node * tiles_y, num_nodes) *
+                               TILE_SIZE, nblocksy);
+      const unsigned y1 = MIN2(DIV_ROUND_UP((node + 1) * tiles_y, num_nodes) *
+                               TILE_SIZE, nblocksy);
+      unsigned num_slices;
+
+      if (lpr->base.target == PIPE_TEXTURE_3D)
+         num_slices = u_minify(lpr->base.depth0, level);
+      else if (lpr->base.target == PIPE_TEXTURE_1D_ARRAY ||
+               lpr->base.target == PIPE_TEXTURE_2D_ARRAY ||
+               lpr->base.target == PIPE_TEXTURE_CUBE ||
+               lpr->base.target == PIPE_TEXTURE_CUBE_ARRAY)
+         num_slices = lpr->base.array_size;
+      else
+         num_slices = 1;
+
+      if (y0 >= y1)
+         continue;
+
+      for (slice = 0; slice < num_slices; slice++) {
+         uint8_t *map = (uint8_t *) lpr->tex_data + lpr->mip_offsets[level] +
+                        slice * lpr->img_stride[level] +
+                        y0 * lpr->row_stride[level];
+
+         memset(map, 0, (y1 - y0) * lpr->row_stride[level]);
+      }
+   }
+}
+
+
 /**
  * Conventional allocation path for non-display textures:
  * Compute strides and allocate data (unless asked not to).
@@ -171,6 +226,18 @@ llvmpipe_texture_layout(struct llvmpipe_screen *screen,
       if (!lpr->tex_data) {
          return FALSE;
       }
+      else if ((lpr->base.bind & (PIPE_BIND_RENDER_TARGET |
+                                  PIPE_BIND_DEPTH_STENCIL)) &&
+               lp_rast_num_numa_nodes(screen->rast) > 1) {
+         /* Zero each band of rows of a render target from the NUMA node
+          * whose rasterizer threads render it, so its pages end up there.
+          */
+         struct zero_bands_data zero;
+
+         zero.lpr = lpr;
+         zero.num_nodes = lp_rast_num_numa_nodes(screen->rast);
+         lp_rast_first_touch(screen->rast, zero_bands, &zero);
+      }
       else {
          memset(lpr->tex_data, 0, total_size);
       }
@@ -313,6 +380,23 @@ llvmpipe_resource_create(struct pipe_screen *_screen,
 }
 
 
+/**
+ * Tell the rasterizer threads that a texture's storage is about to change
+ * under any blocks of it they have decoded.  Only formats fetched through
+ * the texture cache need this.
+ */
+static void
+llvmpipe_invalidate_texture_cache(struct llvmpipe_screen *screen,
+                                  struct llvmpipe_resource *lpr)
+{
+   if (lpr->tex_data && !lpr->dt &&
+       lp_build_format_is_cached(util_format_description(lpr->base.format))) {
+      lp_rast_invalidate_texture_cache(screen->rast, lpr->tex_data,
+                                       lpr->total_alloc_size);
+   }
+}
+
+
 static void
 llvmpipe_resource_destroy(struct pipe_screen *pscreen,
                           struct pipe_resource *pt)
@@ -328,6 +412,8 @@ llvmpipe_resource_destroy(struct pipe_screen *pscreen,
    else if (llvmpipe_resource_is_texture(pt)) {
       /* free linear image data */
       if (lpr->tex_data) {
+         /* the memory may come back as another texture */
+         llvmpipe_invalidate_texture_cache(screen, lpr);
          align_free(lpr->tex_data);
          lpr->tex_data = NULL;
       }
@@ -634,6 +720,10 @@ llvmpipe_transfer_unmap(struct pipe_context *pipe,
     * where it would happen.  For llvmpipe, nothing to do.
     */
    assert (transfer->resource);
+   if (transfer->usage & PIPE_TRANSFER_WRITE) {
+      llvmpipe_invalidate_texture_cache(llvmpipe_screen(pipe->screen),
+                                        llvmpipe_resource(transfer->resource));
+   }
    pipe_resource_reference(&transfer->resource, NULL);
    FREE(transfer);
 }
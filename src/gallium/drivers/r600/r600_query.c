@@ -85,6 +85,10 @@ static enum radeon_value_id winsys_id_from_type(unsigned type)
 	case R600_QUERY_CURRENT_GPU_SCLK: return RADEON_CURRENT_SCLK;
 	case R600_QUERY_CURRENT_GPU_MCLK: return RADEON_CURRENT_MCLK;
 	case R600_QUERY_CS_THREAD_BUSY: return RADEON_CS_THREAD_TIME;
+	case R600_QUERY_BO_CACHE_HITS: return RADEON_BO_CACHE_HITS;
+	case R600_QUERY_BO_CACHE_MISSES: return RADEON_BO_CACHE_MISSES;
+	case R600_QUERY_BO_CACHE_EVICTIONS: return RADEON_BO_CACHE_EVICTIONS;
+	case R600_QUERY_BO_CACHE_SIZE: return RADEON_BO_CACHE_SIZE;
 	default: unreachable("query type does not correspond to winsys id");
 	}
 }
@@ -153,6 +157,15 @@ static bool r600_query_sw_begin(struct r600_common_context *rctx,
 	case R600_QUERY_TC_NUM_SYNCS:
 		query->begin_result = rctx->tc ? rctx->tc->num_syncs : 0;
 		break;
+	case R600_QUERY_TC_NUM_EARLY_KICKS:
+		query->begin_result = rctx->tc ? rctx->tc->num_early_kicks : 0;
+		break;
+	case R600_QUERY_TC_SYNC_STALL_TIME:
+		query->begin_result = rctx->tc ? rctx->tc->sync_stall_ns : 0;
+		break;
+	case R600_QUERY_TC_QUEUE_STALL_TIME:
+		query->begin_result = rctx->tc ? rctx->tc->queue_stall_ns : 0;
+		break;
 	case R600_QUERY_REQUESTED_VRAM:
 	case R600_QUERY_REQUESTED_GTT:
 	case R600_QUERY_MAPPED_VRAM:
@@ -164,6 +177,9 @@ static bool r600_query_sw_begin(struct r600_common_context *rctx,
 	case R600_QUERY_CURRENT_GPU_SCLK:
 	case R600_QUERY_CURRENT_GPU_MCLK:
 	case R600_QUERY_NUM_MAPPED_BUFFERS:
+	case R600_QUERY_TC_QUEUE_DEPTH:
+	case R600_QUERY_TC_BATCH_SIZE:
+	case R600_QUERY_BO_CACHE_SIZE:
 		query->begin_result = 0;
 		break;
 	case R600_QUERY_BUFFER_WAIT_TIME:
@@ -171,7 +187,10 @@ static bool r600_query_sw_begin(struct r600_common_context *rctx,
 	case R600_QUERY_NUM_SDMA_IBS:
 	case R600_QUERY_NUM_BYTES_MOVED:
 	case R600_QUERY_NUM_EVICTIONS:
-	case R600_QUERY_NUM_VRAM_CPU_PAGE_FAULTS: {
+	case R600_QUERY_NUM_VRAM_CPU_PAGE_FAULTS:
+	case R600_QUERY_BO_CACHE_HITS:
+	case R600_QUERY_BO_CACHE_MISSES:
+	case R600_QUERY_BO_CACHE_EVICTIONS: {
 		enum radeon_value_id ws_id = winsys_id_from_type(query->b.type);
 		query->begin_result = rctx->ws->query_value(rctx->ws, ws_id);
 		break;
@@ -305,6 +324,22 @@ static bool r600_query_sw_end(struct r600_common_context *rctx,
 	case R600_QUERY_TC_NUM_SYNCS:
 		query->end_result = rctx->tc ? rctx->tc->num_syncs : 0;
 		break;
+	case R600_QUERY_TC_NUM_EARLY_KICKS:
+		query->end_result = rctx->tc ? rctx->tc->num_early_kicks : 0;
+		break;
+	case R600_QUERY_TC_SYNC_STALL_TIME:
+		query->end_result = rctx->tc ? rctx->tc->sync_stall_ns : 0;
+		break;
+	case R600_QUERY_TC_QUEUE_STALL_TIME:
+		query->end_result = rctx->tc ? rctx->tc->queue_stall_ns : 0;
+		break;
+	case R600_QUERY_TC_QUEUE_DEPTH:
+		query->end_result =
+			rctx->tc ? threaded_context_queue_depth(rctx->tc) : 0;
+		break;
+	case R600_QUERY_TC_BATCH_SIZE:
+		query->end_result = rctx->tc ? rctx->tc->batch_size : 0;
+		break;
 	case R600_QUERY_REQUESTED_VRAM:
 	case R600_QUERY_REQUESTED_GTT:
 	case R600_QUERY_MAPPED_VRAM:
@@ -321,7 +356,11 @@ static bool r600_query_sw_end(struct r600_common_context *rctx,
 	case R600_QUERY_NUM_SDMA_IBS:
 	case R600_QUERY_NUM_BYTES_MOVED:
 	case R600_QUERY_NUM_EVICTIONS:
-	case R600_QUERY_NUM_VRAM_CPU_PAGE_FAULTS: {
+	case R600_QUERY_NUM_VRAM_CPU_PAGE_FAULTS:
+	case R600_QUERY_BO_CACHE_HITS:
+	case R600_QUERY_BO_CACHE_MISSES:
+	case R600_QUERY_BO_CACHE_EVICTIONS:
+	case R600_QUERY_BO_CACHE_SIZE: {
 		enum radeon_value_id ws_id = winsys_id_from_type(query->b.type);
 		query->end_result = rctx->ws->query_value(rctx->ws, ws_id);
 		break;
@@ -444,6 +483,8 @@ static bool r600_query_sw_get_result(struct r600_common_context *rctx,
 
 	switch (query->b.type) {
 	case R600_QUERY_BUFFER_WAIT_TIME:
+	case R600_QUERY_TC_SYNC_STALL_TIME:
+	case R600_QUERY_TC_QUEUE_STALL_TIME:
 	case R600_QUERY_GPU_TEMPERATURE:
 		result->u64 /= 1000;
 		break;
@@ -1967,6 +2008,15 @@ static struct pipe_driver_query_info r600_driver_query_list[] = {
 	X("tc-offloaded-slots",		TC_OFFLOADED_SLOTS,     UINT64, AVERAGE),
 	X("tc-direct-slots",		TC_DIRECT_SLOTS,	UINT64, AVERAGE),
 	X("tc-num-syncs",		TC_NUM_SYNCS,		UINT64, AVERAGE),
+	X("tc-num-early-kicks",		TC_NUM_EARLY_KICKS,	UINT64, AVERAGE),
+	X("tc-sync-stall-time",		TC_SYNC_STALL_TIME,	MICROSECONDS, CUMULATIVE),
+	X("tc-queue-stall-time",	TC_QUEUE_STALL_TIME,	MICROSECONDS, CUMULATIVE),
+	X("tc-queue-depth",		TC_QUEUE_DEPTH,		UINT64, AVERAGE),
+	X("tc-batch-size",		TC_BATCH_SIZE,		UINT64, AVERAGE),
+	X("BO-cache-hits",		BO_CACHE_HITS,		UINT64, AVERAGE),
+	X("BO-cache-misses",		BO_CACHE_MISSES,	UINT64, AVERAGE),
+	X("BO-cache-evictions",	BO_CACHE_EVICTIONS,	UINT64, AVERAGE),
+	X("BO-cache-size",		BO_CACHE_SIZE,		BYTES, AVERAGE),
 	X("CS-thread-busy",		CS_THREAD_BUSY,		UINT64, AVERAGE),
 	X("gallium-thread-busy",	GALLIUM_THREAD_BUSY,	UINT64, AVERAGE),
 	X("requested-VRAM",		REQUESTED_VRAM,		BYTES, AVERAGE),
@@ -59,6 +59,15 @@ enum {
 	R600_QUERY_TC_OFFLOADED_SLOTS,
 	R600_QUERY_TC_DIRECT_SLOTS,
 	R600_QUERY_TC_NUM_SYNCS,
+	R600_QUERY_TC_NUM_EARLY_KICKS,
+	R600_QUERY_TC_SYNC_STALL_TIME,
+	R600_QUERY_TC_QUEUE_STALL_TIME,
+	R600_QUERY_TC_QUEUE_DEPTH,
+	R600_QUERY_TC_BATCH_SIZE,
+	R600_QUERY_BO_CACHE_HITS,
+	R600_QUERY_BO_CACHE_MISSES,
+	R600_QUERY_BO_CACHE_EVICTIONS,
+	R600_QUERY_BO_CACHE_SIZE,
 	R600_QUERY_CS_THREAD_BUSY,
 	R600_QUERY_GALLIUM_THREAD_BUSY,
 	R600_QUERY_REQUESTED_VRAM,
@@ -113,6 +113,10 @@ enum radeon_value_id {
     RADEON_CURRENT_MCLK,
     RADEON_GPU_RESET_COUNTER, /* DRM 2.43.0 */
     RADEON_CS_THREAD_TIME,
+    RADEON_BO_CACHE_HITS,
+    RADEON_BO_CACHE_MISSES,
+    RADEON_BO_CACHE_EVICTIONS,
+    RADEON_BO_CACHE_SIZE,
 };
 
 /* Each group of four has the same priority. */
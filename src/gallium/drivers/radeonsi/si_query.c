@@ -88,6 +88,10 @@ static enum radeon_value_id winsys_id_from_type(unsigned type)
 	case SI_QUERY_CURRENT_GPU_SCLK: return RADEON_CURRENT_SCLK;
 	case SI_QUERY_CURRENT_GPU_MCLK: return RADEON_CURRENT_MCLK;
 	case SI_QUERY_CS_THREAD_BUSY: return RADEON_CS_THREAD_TIME;
+	case SI_QUERY_BO_CACHE_HITS: return RADEON_BO_CACHE_HITS;
+	case SI_QUERY_BO_CACHE_MISSES: return RADEON_BO_CACHE_MISSES;
+	case SI_QUERY_BO_CACHE_EVICTIONS: return RADEON_BO_CACHE_EVICTIONS;
+	case SI_QUERY_BO_CACHE_SIZE: return RADEON_BO_CACHE_SIZE;
 	default: unreachable("query type does not correspond to winsys id");
 	}
 }
@@ -162,6 +166,15 @@ static bool si_query_sw_begin(struct si_context *sctx,
 	case SI_QUERY_TC_NUM_SYNCS:
 		query->begin_result = sctx->tc ? sctx->tc->num_syncs : 0;
 		break;
+	case SI_QUERY_TC_NUM_EARLY_KICKS:
+		query->begin_result = sctx->tc ? sctx->tc->num_early_kicks : 0;
+		break;
+	case SI_QUERY_TC_SYNC_STALL_TIME:
+		query->begin_result = sctx->tc ? sctx->tc->sync_stall_ns : 0;
+		break;
+	case SI_QUERY_TC_QUEUE_STALL_TIME:
+		query->begin_result = sctx->tc ? sctx->tc->queue_stall_ns : 0;
+		break;
 	case SI_QUERY_REQUESTED_VRAM:
 	case SI_QUERY_REQUESTED_GTT:
 	case SI_QUERY_MAPPED_VRAM:
@@ -174,6 +187,9 @@ static bool si_query_sw_begin(struct si_context *sctx,
 	case SI_QUERY_CURRENT_GPU_MCLK:
 	case SI_QUERY_BACK_BUFFER_PS_DRAW_RATIO:
 	case SI_QUERY_NUM_MAPPED_BUFFERS:
+	case SI_QUERY_TC_QUEUE_DEPTH:
+	case SI_QUERY_TC_BATCH_SIZE:
+	case SI_QUERY_BO_CACHE_SIZE:
 		query->begin_result = 0;
 		break;
 	case SI_QUERY_BUFFER_WAIT_TIME:
@@ -182,7 +198,10 @@ static bool si_query_sw_begin(struct si_context *sctx,
 	case SI_QUERY_NUM_SDMA_IBS:
 	case SI_QUERY_NUM_BYTES_MOVED:
 	case SI_QUERY_NUM_EVICTIONS:
-	case SI_QUERY_NUM_VRAM_CPU_PAGE_FAULTS: {
+	case SI_QUERY_NUM_VRAM_CPU_PAGE_FAULTS:
+	case SI_QUERY_BO_CACHE_HITS:
+	case SI_QUERY_BO_CACHE_MISSES:
+	case SI_QUERY_BO_CACHE_EVICTIONS: {
 		enum radeon_value_id ws_id = winsys_id_from_type(query->b.type);
 		query->begin_result = sctx->ws->query_value(sctx->ws, ws_id);
 		break;
@@ -322,6 +341,22 @@ static bool si_query_sw_end(struct si_context *sctx,
 	case SI_QUERY_TC_NUM_SYNCS:
 		query->end_result = sctx->tc ? sctx->tc->num_syncs : 0;
 		break;
+	case SI_QUERY_TC_NUM_EARLY_KICKS:
+		query->end_result = sctx->tc ? sctx->tc->num_early_kicks : 0;
+		break;
+	case SI_QUERY_TC_SYNC_STALL_TIME:
+		query->end_result = sctx->tc ? sctx->tc->sync_stall_ns : 0;
+		break;
+	case SI_QUERY_TC_QUEUE_STALL_TIME:
+		query->end_result = sctx->tc ? sctx->tc->queue_stall_ns : 0;
+		break;
+	case SI_QUERY_TC_QUEUE_DEPTH:
+		query->end_result =
+			sctx->tc ? threaded_context_queue_depth(sctx->tc) : 0;
+		break;
+	case SI_QUERY_TC_BATCH_SIZE:
+		query->end_result = sctx->tc ? sctx->tc->batch_size : 0;
+		break;
 	case SI_QUERY_REQUESTED_VRAM:
 	case SI_QUERY_REQUESTED_GTT:
 	case SI_QUERY_MAPPED_VRAM:
@@ -339,7 +374,11 @@ static bool si_query_sw_end(struct si_context *sctx,
 	case SI_QUERY_NUM_SDMA_IBS:
 	case SI_QUERY_NUM_BYTES_MOVED:
 	case SI_QUERY_NUM_EVICTIONS:
-	case SI_QUERY_NUM_VRAM_CPU_PAGE_FAULTS: {
+	case SI_QUERY_NUM_VRAM_CPU_PAGE_FAULTS:
+	case SI_QUERY_BO_CACHE_HITS:
+	case SI_QUERY_BO_CACHE_MISSES:
+	case SI_QUERY_BO_CACHE_EVICTIONS:
+	case SI_QUERY_BO_CACHE_SIZE: {
 		enum radeon_value_id ws_id = winsys_id_from_type(query->b.type);
 		query->end_result = sctx->ws->query_value(sctx->ws, ws_id);
 		break;
@@ -465,6 +504,8 @@ static bool si_query_sw_get_result(struct si_context *sctx,
 
 	switch (query->b.type) {
 	case SI_QUERY_BUFFER_WAIT_TIME:
+	case SI_QUERY_TC_SYNC_STALL_TIME:
+	case SI_QUERY_TC_QUEUE_STALL_TIME:
 	case SI_QUERY_GPU_TEMPERATURE:
 		result->u64 /= 1000;
 		break;
@@ -1891,6 +1932,15 @@ static struct pipe_driver_query_info si_driver_query_list[] = {
 	X("tc-offloaded-slots",		TC_OFFLOADED_SLOTS,     UINT64, AVERAGE),
 	X("tc-direct-slots",		TC_DIRECT_SLOTS,	UINT64, AVERAGE),
 	X("tc-num-syncs",		TC_NUM_SYNCS,		UINT64, AVERAGE),
+	X("tc-num-early-kicks",		TC_NUM_EARLY_KICKS,	UINT64, AVERAGE),
+	X("tc-sync-stall-time",		TC_SYNC_STALL_TIME,	MICROSECONDS, CUMULATIVE),
+	X("tc-queue-stall-time",	TC_QUEUE_STALL_TIME,	MICROSECONDS, CUMULATIVE),
+	X("tc-queue-depth",		TC_QUEUE_DEPTH,		UINT64, AVERAGE),
+	X("tc-batch-size",		TC_BATCH_SIZE,		UINT64, AVERAGE),
+	X("BO-cache-hits",		BO_CACHE_HITS,		UINT64, AVERAGE),
+	X("BO-cache-misses",		BO_CACHE_MISSES,	UINT64, AVERAGE),
+	X("BO-cache-evictions",	BO_CACHE_EVICTIONS,	UINT64, AVERAGE),
+	X("BO-cache-size",		BO_CACHE_SIZE,		BYTES, AVERAGE),
 	X("CS-thread-busy",		CS_THREAD_BUSY,		UINT64, AVERAGE),
 	X("gallium-thread-busy",	GALLIUM_THREAD_BUSY,	UINT64, AVERAGE),
 	X("requested-VRAM",		REQUESTED_VRAM,		BYTES, AVERAGE),
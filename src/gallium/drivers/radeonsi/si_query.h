@@ -58,6 +58,15 @@ enum {
 	SI_QUERY_TC_OFFLOADED_SLOTS,
 	SI_QUERY_TC_DIRECT_SLOTS,
 	SI_QUERY_TC_NUM_SYNCS,
+	SI_QUERY_TC_NUM_EARLY_KICKS,
+	SI_QUERY_TC_SYNC_STALL_TIME,
+	SI_QUERY_TC_QUEUE_STALL_TIME,
+	SI_QUERY_TC_QUEUE_DEPTH,
+	SI_QUERY_TC_BATCH_SIZE,
+	SI_QUERY_BO_CACHE_HITS,
+	SI_QUERY_BO_CACHE_MISSES,
+	SI_QUERY_BO_CACHE_EVICTIONS,
+	SI_QUERY_BO_CACHE_SIZE,
 	SI_QUERY_CS_THREAD_BUSY,
 	SI_QUERY_GALLIUM_THREAD_BUSY,
 	SI_QUERY_REQUESTED_VRAM,
@@ -0,0 +1,577 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Binning of primitives and their rasterization by bands, see sp_band.h.
+ *
+ * The primitives of a draw are recorded together with copies of their
+ * vertices, since the vbuf code reuses its vertex buffer.  Each primitive
+ * gets a mask of the bands its rows may fall into, so bands can skip the
+ * setup of primitives which can't touch them.  The bins are rasterized
+ * at the end of the draw, or earlier when full, with the state of the
+ * draw: softpipe flushes the draw module, and so the bins, before any
+ * state change.
+ */
+
+#include "pipe/p_shader_tokens.h"
+#include "tgsi/tgsi_exec.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+#include "sp_band.h"
+#include "sp_context.h"
+#include "sp_quad.h"
+#include "sp_setup.h"
+#include "sp_state.h"
+#include "sp_tex_sample.h"
+#include "sp_tex_tile_cache.h"
+#include "sp_texture.h"
+#include "sp_tile_cache.h"
+
+
+/** Max number of primitives binned before they are rasterized */
+#define SP_BIN_MAX_PRIMS 4096
+
+
+/**
+ * A binned primitive.
+ */
+struct sp_bin_prim
+{
+   unsigned type:2;               /**< QUAD_PRIM_POINT, LINE, TRI */
+   unsigned owner:6;              /**< band counting it in the statistics */
+   unsigned bands:SP_MAX_BANDS;   /**< mask of the bands it may touch */
+   unsigned vertex;               /**< offset of its vertices in verts */
+};
+
+
+struct sp_bands
+{
+   struct softpipe_context *softpipe;
+
+   struct util_queue queue;
+
+   unsigned nr_bands;
+   struct sp_band band[SP_MAX_BANDS];
+
+   /** Number of fragment shader sampler views the bands have copies of */
+   unsigned nr_views;
+
+   struct sp_bin_prim prims[SP_BIN_MAX_PRIMS];
+   unsigned nr_prims;
+
+   float *verts;
+   unsigned vertex_size;          /**< in floats */
+   unsigned verts_used;           /**< in floats */
+   unsigned verts_size;           /**< in floats */
+};
+
+
+/**
+ * Record a primitive of nr_verts vertices covering rows ymin to ymax,
+ * give or take margin, and return where to copy its vertices.
+ */
+static float *
+bin_prim(struct sp_bands *bands, unsigned type, unsigned nr_verts,
+         float ymin, float ymax, float margin)
+{
+   struct softpipe_context *softpipe = bands->softpipe;
+   const unsigned vertex_size = softpipe->vertex_info.size;
+   const float max_row = (float) (softpipe->framebuffer.height - 1);
+   struct sp_bin_prim *prim;
+   float top = ymin - margin, bottom = ymax + margin;
+   int first_tile, last_tile, tile;
+   unsigned size;
+
+   if (bands->nr_prims == SP_BIN_MAX_PRIMS)
+      sp_bands_flush(bands);
+
+   size = bands->verts_used + nr_verts * vertex_size;
+   if (size > bands->verts_size) {
+      unsigned new_size = MAX2(size, bands->verts_size * 2);
+      float *verts = REALLOC(bands->verts,
+                             bands->verts_size * sizeof(float),
+                             new_size * sizeof(float));
+      if (!verts)
+         return NULL;
+      bands->verts = verts;
+      bands->verts_size = new_size;
+   }
+
+   /* rows of tiles the primitive may touch, NaNs take all of them */
+   if (!(top > 0.0f))
+      top = 0.0f;
+   if (!(bottom < max_row))
+      bottom = max_row;
+   top = MIN2(top, max_row);
+   bottom = MAX2(bottom, 0.0f);
+   first_tile = (int) top >> TILE_SIZE_LOG2;
+   last_tile = (int) bottom >> TILE_SIZE_LOG2;
+
+   prim = &bands->prims[bands->nr_prims++];
+   prim->type = type;
+   prim->owner = first_tile % bands->nr_bands;
+   prim->bands = 1 << prim->owner;
+   if (last_tile - first_tile + 1 >= (int) bands->nr_bands) {
+      prim->bands = (1 << bands->nr_bands) - 1;
+   }
+   else {
+      for (tile = first_tile + 1; tile <= last_tile; tile++)
+         prim->bands |= 1 << (tile % bands->nr_bands);
+   }
+   prim->vertex = bands->verts_used;
+
+   bands->vertex_size = vertex_size;
+   bands->verts_used = size;
+
+   return bands->verts + prim->vertex;
+}
+
+
+void
+sp_bin_tri(struct sp_bands *bands,
+           const float (*v0)[4],
+           const float (*v1)[4],
+           const float (*v2)[4])
+{
+   const float ymin = MIN3(v0[0][1], v1[0][1], v2[0][1]);
+   const float ymax = MAX3(v0[0][1], v1[0][1], v2[0][1]);
+   const unsigned size = bands->softpipe->vertex_info.size * sizeof(float);
+   float *verts = bin_prim(bands, QUAD_PRIM_TRI, 3, ymin, ymax, 1.0f);
+
+   if (verts) {
+      memcpy(verts, v0, size);
+      memcpy((char *) verts + size, v1, size);
+      memcpy((char *) verts + 2 * size, v2, size);
+   }
+}
+
+
+void
+sp_bin_line(struct sp_bands *bands,
+            const float (*v0)[4],
+            const float (*v1)[4])
+{
+   const float ymin = MIN2(v0[0][1], v1[0][1]);
+   const float ymax = MAX2(v0[0][1], v1[0][1]);
+   const unsigned size = bands->softpipe->vertex_info.size * sizeof(float);
+   float *verts = bin_prim(bands, QUAD_PRIM_LINE, 2, ymin, ymax, 1.0f);
+
+   if (verts) {
+      memcpy(verts, v0, size);
+      memcpy((char *) verts + size, v1, size);
+   }
+}
+
+
+void
+sp_bin_point(struct sp_bands *bands,
+             const float (*v0)[4])
+{
+   const struct softpipe_context *softpipe = bands->softpipe;
+   const int size_attr = softpipe->psize_slot;
+   const float point_size = size_attr > 0 ? v0[size_attr][0]
+                                          : softpipe->rasterizer->point_size;
+   const unsigned size = softpipe->vertex_info.size * sizeof(float);
+   float *verts = bin_prim(bands, QUAD_PRIM_POINT, 1, v0[0][1], v0[0][1],
+                           0.5f * point_size + 1.0f);
+
+   if (verts)
+      memcpy(verts, v0, size);
+}
+
+
+/**
+ * Whether the primitives of the current draw can be binned.
+ */
+boolean
+sp_bands_can_bin(struct sp_bands *bands)
+{
+   struct softpipe_context *softpipe = bands->softpipe;
+   const struct tgsi_shader_info *info = &softpipe->fs_variant->info;
+   unsigned i, b;
+
+   /* nothing to share out */
+   if (softpipe->framebuffer.height <= TILE_SIZE)
+      return FALSE;
+
+   /* stores would race, and be reordered between the bands */
+   if (info->file_count[TGSI_FILE_IMAGE] ||
+       info->file_count[TGSI_FILE_BUFFER])
+      return FALSE;
+
+   for (i = 0; i < softpipe->num_sampler_views[PIPE_SHADER_FRAGMENT]; i++) {
+      struct pipe_sampler_view *view =
+         softpipe->sampler_views[PIPE_SHADER_FRAGMENT][i];
+
+      if (!view)
+         continue;
+
+      /* the bands map textures themselves, don't go near the winsys */
+      if (softpipe_resource(view->texture)->dt)
+         return FALSE;
+
+      for (b = 0; b < bands->nr_bands; b++) {
+         struct sp_band *band = &bands->band[b];
+         if (!band->tex_cache[i]) {
+            band->tex_cache[i] = sp_create_tex_tile_cache(&softpipe->pipe);
+            if (!band->tex_cache[i])
+               return FALSE;
+         }
+      }
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Bind the context's fragment shader to the bands' machines.
+ */
+void
+sp_bands_bind_fs(struct sp_bands *bands)
+{
+   struct softpipe_context *softpipe = bands->softpipe;
+   unsigned i;
+
+   for (i = 0; i < bands->nr_bands; i++) {
+      struct sp_band *band = &bands->band[i];
+
+      softpipe->fs_variant->prepare(softpipe->fs_variant,
+                                    band->fs_machine,
+                                    (struct tgsi_sampler *) band->fs_sampler,
+                                    (struct tgsi_image *)softpipe->tgsi.image[PIPE_SHADER_FRAGMENT],
+                                    (struct tgsi_buffer *)softpipe->tgsi.buffer[PIPE_SHADER_FRAGMENT]);
+   }
+}
+
+
+/**
+ * Unbind a fragment shader variant that is being deleted from the bands'
+ * machines, as its delete function does for the context's.
+ */
+void
+sp_bands_unbind_fs_variant(struct sp_bands *bands,
+                           const struct sp_fragment_shader_variant *var)
+{
+   unsigned i;
+
+   for (i = 0; i < bands->nr_bands; i++) {
+      struct tgsi_exec_machine *machine = bands->band[i].fs_machine;
+
+      if (machine->Tokens == var->tokens)
+         tgsi_exec_machine_bind_shader(machine, NULL, NULL, NULL, NULL);
+   }
+}
+
+
+/**
+ * Bring a band up to date with the context's state before rasterizing.
+ */
+static void
+prepare_band(struct sp_band *band, unsigned nr_views)
+{
+   struct softpipe_context *softpipe = band->softpipe;
+   const struct sp_tgsi_sampler *sampler =
+      softpipe->tgsi.sampler[PIPE_SHADER_FRAGMENT];
+   unsigned i;
+
+   /* the caches are empty, release_band() let go of the last surfaces */
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      pipe_surface_reference(&band->cbufs[i], softpipe->framebuffer.cbufs[i]);
+      sp_tile_cache_set_surface(band->cbuf_cache[i], band->cbufs[i]);
+   }
+   pipe_surface_reference(&band->zsbuf, softpipe->framebuffer.zsbuf);
+   sp_tile_cache_set_surface(band->zsbuf_cache, band->zsbuf);
+
+   /*
+    * The views of the sampler are the context's but for their caches.
+    * Texture contents may have changed since last time, from rendering
+    * for instance, so start with empty caches.
+    */
+   memcpy(band->fs_sampler->sp_sampler, sampler->sp_sampler,
+          sizeof(sampler->sp_sampler));
+   for (i = 0; i < nr_views; i++) {
+      struct pipe_sampler_view *view =
+         i < softpipe->num_sampler_views[PIPE_SHADER_FRAGMENT] ?
+         softpipe->sampler_views[PIPE_SHADER_FRAGMENT][i] : NULL;
+      struct sp_sampler_view *sp_sview = &band->fs_sampler->sp_sview[i];
+
+      *sp_sview = sampler->sp_sview[i];
+      if (view) {
+         sp_tex_tile_cache_set_sampler_view(band->tex_cache[i], view);
+         sp_flush_tex_tile_cache(band->tex_cache[i]);
+         sp_sview->cache = band->tex_cache[i];
+      }
+   }
+
+   sp_build_quad_pipeline(softpipe, &band->quad);
+   sp_setup_prepare(band->setup);
+
+   band->occlusion_count = 0;
+   band->ps_invocations = 0;
+   band->c_primitives = 0;
+}
+
+
+/**
+ * Rasterize the bins into a band.
+ * Called via util_queue, or directly for the first band.
+ */
+static void
+rasterize_band(void *job, int thread_index)
+{
+   struct sp_band *band = (struct sp_band *) job;
+   const struct sp_bands *bands = band->bands;
+   const unsigned vertex_size = bands->vertex_size;
+   const unsigned bit = 1 << band->index;
+   unsigned i;
+
+   for (i = 0; i < bands->nr_prims; i++) {
+      const struct sp_bin_prim *prim = &bands->prims[i];
+      const float *v = bands->verts + prim->vertex;
+
+      if (!(prim->bands & bit))
+         continue;
+
+      band->count_prim = prim->owner == band->index;
+
+      switch (prim->type) {
+      case QUAD_PRIM_TRI:
+         sp_setup_tri(band->setup,
+                      (const float (*)[4]) v,
+                      (const float (*)[4]) (v + vertex_size),
+                      (const float (*)[4]) (v + 2 * vertex_size));
+         break;
+      case QUAD_PRIM_LINE:
+         sp_setup_line(band->setup,
+                       (const float (*)[4]) v,
+                       (const float (*)[4]) (v + vertex_size));
+         break;
+      case QUAD_PRIM_POINT:
+         sp_setup_point(band->setup, (const float (*)[4]) v);
+         break;
+      default:
+         assert(0);
+      }
+   }
+
+   /* the bands write disjoint tiles */
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
+      sp_flush_tile_cache(band->cbuf_cache[i]);
+   sp_flush_tile_cache(band->zsbuf_cache);
+}
+
+
+/**
+ * Drop the band's references to the surfaces and textures, so that they
+ * aren't kept alive after the draw.
+ */
+static void
+release_band(struct sp_band *band)
+{
+   unsigned i;
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      sp_tile_cache_set_surface(band->cbuf_cache[i], NULL);
+      pipe_surface_reference(&band->cbufs[i], NULL);
+   }
+   sp_tile_cache_set_surface(band->zsbuf_cache, NULL);
+   pipe_surface_reference(&band->zsbuf, NULL);
+
+   for (i = 0; i < ARRAY_SIZE(band->tex_cache); i++) {
+      if (band->tex_cache[i])
+         sp_tex_tile_cache_set_sampler_view(band->tex_cache[i], NULL);
+   }
+}
+
+
+/**
+ * Rasterize the binned primitives, and wait for them to be done.
+ */
+void
+sp_bands_flush(struct sp_bands *bands)
+{
+   struct softpipe_context *softpipe = bands->softpipe;
+   unsigned nr_views = MAX2(bands->nr_views,
+                            softpipe->num_sampler_views[PIPE_SHADER_FRAGMENT]);
+   unsigned i;
+
+   if (!bands->nr_prims)
+      return;
+
+   /* the bands get the surfaces' contents from memory */
+   for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++)
+      sp_flush_tile_cache(softpipe->cbuf_cache[i]);
+   sp_flush_tile_cache(softpipe->zsbuf_cache);
+
+   for (i = 0; i < bands->nr_bands; i++)
+      prepare_band(&bands->band[i], nr_views);
+   bands->nr_views = softpipe->num_sampler_views[PIPE_SHADER_FRAGMENT];
+
+   for (i = 1; i < bands->nr_bands; i++) {
+      util_queue_add_job(&bands->queue, &bands->band[i],
+                         &bands->band[i].fence, rasterize_band, NULL);
+   }
+   rasterize_band(&bands->band[0], 0);
+
+   for (i = 0; i < bands->nr_bands; i++) {
+      struct sp_band *band = &bands->band[i];
+
+      util_queue_fence_wait(&band->fence);
+      release_band(band);
+
+      softpipe->occlusion_count += band->occlusion_count;
+      softpipe->pipeline_statistics.ps_invocations += band->ps_invocations;
+      softpipe->pipeline_statistics.c_primitives += band->c_primitives;
+   }
+
+   bands->nr_prims = 0;
+   bands->verts_used = 0;
+}
+
+
+/**
+ * The bands' thread pool, for other work split among threads, or NULL.
+ * Not to be used while rasterizing.
+ */
+struct util_queue *
+sp_bands_queue(struct sp_bands *bands)
+{
+   return util_queue_is_initialized(&bands->queue) ? &bands->queue : NULL;
+}
+
+
+struct sp_bands *
+sp_create_bands(struct softpipe_context *softpipe, unsigned nr_threads)
+{
+   struct sp_bands *bands = CALLOC_STRUCT(sp_bands);
+   unsigned i;
+
+   if (!bands)
+      return NULL;
+
+   bands->softpipe = softpipe;
+   bands->nr_bands = MIN2(nr_threads + 1, SP_MAX_BANDS);
+
+   for (i = 0; i < bands->nr_bands; i++) {
+      struct sp_band *band = &bands->band[i];
+      unsigned j;
+
+      band->softpipe = softpipe;
+      band->bands = bands;
+      band->index = i;
+      band->nr_bands = bands->nr_bands;
+      util_queue_fence_init(&band->fence);
+
+      band->setup = sp_setup_create_context(softpipe);
+      if (!band->setup)
+         goto fail;
+      sp_setup_set_band(band->setup, band);
+
+      band->quad.shade = sp_quad_shade_stage(softpipe);
+      band->quad.depth_test = sp_quad_depth_test_stage(softpipe);
+      band->quad.blend = sp_quad_blend_stage(softpipe);
+      band->quad.pstipple = sp_quad_polygon_stipple_stage(softpipe);
+      if (!band->quad.shade || !band->quad.depth_test ||
+          !band->quad.blend || !band->quad.pstipple)
+         goto fail;
+      band->quad.shade->band = band;
+      band->quad.depth_test->band = band;
+      band->quad.blend->band = band;
+      band->quad.pstipple->band = band;
+
+      band->fs_machine = tgsi_exec_machine_create(PIPE_SHADER_FRAGMENT);
+      band->fs_sampler = sp_create_tgsi_sampler();
+      if (!band->fs_machine || !band->fs_sampler)
+         goto fail;
+
+      for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++) {
+         band->cbuf_cache[j] = sp_create_tile_cache(&softpipe->pipe);
+         if (!band->cbuf_cache[j])
+            goto fail;
+      }
+      band->zsbuf_cache = sp_create_tile_cache(&softpipe->pipe);
+      if (!band->zsbuf_cache)
+         goto fail;
+   }
+
+   /* the calling thread rasterizes the first band */
+   if (bands->nr_bands > 1 &&
+       !util_queue_init(&bands->queue, "spband", bands->nr_bands - 1,
+                        bands->nr_bands - 1, 0))
+      goto fail;
+
+   return bands;
+
+fail:
+   sp_destroy_bands(bands);
+   return NULL;
+}
+
+
+void
+sp_destroy_bands(struct sp_bands *bands)
+{
+   unsigned i, j;
+
+   if (util_queue_is_initialized(&bands->queue))
+      util_queue_destroy(&bands->queue);
+
+   for (i = 0; i < bands->nr_bands; i++) {
+      struct sp_band *band = &bands->band[i];
+
+      if (band->setup)
+         sp_setup_destroy_context(band->setup);
+
+      if (band->quad.shade)
+         band->quad.shade->destroy(band->quad.shade);
+      if (band->quad.depth_test)
+         band->quad.depth_test->destroy(band->quad.depth_test);
+      if (band->quad.blend)
+         band->quad.blend->destroy(band->quad.blend);
+      if (band->quad.pstipple)
+         band->quad.pstipple->destroy(band->quad.pstipple);
+
+      if (band->fs_machine)
+         tgsi_exec_machine_destroy(band->fs_machine);
+      FREE(band->fs_sampler);
+
+      for (j = 0; j < ARRAY_SIZE(band->tex_cache); j++)
+         sp_destroy_tex_tile_cache(band->tex_cache[j]);
+
+      for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++) {
+         sp_destroy_tile_cache(band->cbuf_cache[j]);
+         pipe_surface_reference(&band->cbufs[j], NULL);
+      }
+      sp_destroy_tile_cache(band->zsbuf_cache);
+      pipe_surface_reference(&band->zsbuf, NULL);
+
+      util_queue_fence_destroy(&band->fence);
+   }
+
+   FREE(bands->verts);
+   FREE(bands);
+}
@@ -0,0 +1,196 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Multi-threaded rasterization.
+ *
+ * The framebuffer is split into horizontal bands of TILE_SIZE rows, which
+ * are dealt out round-robin to nr_bands threads.  The primitives of a
+ * draw are binned and then each thread sets up and rasterizes all of them,
+ * in order, but only emits the quads of its own bands.  Every thread has
+ * its own setup context, quad pipeline, tile caches, fragment shader
+ * machine and texture caches, so no two threads ever touch the same
+ * cached tile and the results are exactly those of single-threaded
+ * rendering.
+ */
+
+#ifndef SP_BAND_H
+#define SP_BAND_H
+
+#include "pipe/p_compiler.h"
+#include "pipe/p_state.h"
+#include "util/u_queue.h"
+
+#include "sp_context.h"
+#include "sp_quad_pipe.h"
+#include "sp_tile_cache.h"
+
+
+/** Max number of threads rasterizing, including the calling thread */
+#define SP_MAX_BANDS 16
+
+
+struct setup_context;
+struct sp_bands;
+struct sp_fragment_shader_variant;
+struct sp_tgsi_sampler;
+struct softpipe_tex_tile_cache;
+struct tgsi_exec_machine;
+
+
+/**
+ * State of one rasterizing thread.
+ */
+struct sp_band
+{
+   struct softpipe_context *softpipe;
+   struct sp_bands *bands;
+   unsigned index;
+   unsigned nr_bands;
+
+   struct setup_context *setup;
+   struct sp_quad_pipeline quad;
+
+   struct tgsi_exec_machine *fs_machine;
+   struct sp_tgsi_sampler *fs_sampler;
+   struct softpipe_tex_tile_cache *tex_cache[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+
+   struct softpipe_tile_cache *cbuf_cache[PIPE_MAX_COLOR_BUFS];
+   struct softpipe_tile_cache *zsbuf_cache;
+   /** The surfaces of the above caches, referenced */
+   struct pipe_surface *cbufs[PIPE_MAX_COLOR_BUFS];
+   struct pipe_surface *zsbuf;
+
+   /** Whether the primitive being rasterized is counted by this band */
+   boolean count_prim;
+
+   /** Statistics, added to the context's when the band is done */
+   uint64_t occlusion_count;
+   uint64_t ps_invocations;
+   uint64_t c_primitives;
+
+   struct util_queue_fence fence;
+};
+
+
+/**
+ * Does the band rasterize row y of the framebuffer?
+ */
+static inline boolean
+sp_band_owns_row(const struct sp_band *band, int y)
+{
+   return (unsigned) (y >> TILE_SIZE_LOG2) % band->nr_bands == band->index;
+}
+
+
+/*
+ * The objects a quad stage renders with: its band's if it has one, else
+ * the context's.
+ */
+
+static inline struct softpipe_tile_cache *
+sp_quad_cbuf_cache(const struct quad_stage *qs, unsigned cbuf)
+{
+   return qs->band ? qs->band->cbuf_cache[cbuf] : qs->softpipe->cbuf_cache[cbuf];
+}
+
+static inline struct softpipe_tile_cache *
+sp_quad_zsbuf_cache(const struct quad_stage *qs)
+{
+   return qs->band ? qs->band->zsbuf_cache : qs->softpipe->zsbuf_cache;
+}
+
+static inline struct tgsi_exec_machine *
+sp_quad_fs_machine(const struct quad_stage *qs)
+{
+   return qs->band ? qs->band->fs_machine : qs->softpipe->fs_machine;
+}
+
+static inline uint64_t *
+sp_quad_occlusion_count(const struct quad_stage *qs)
+{
+   return qs->band ? &qs->band->occlusion_count :
+                     &qs->softpipe->occlusion_count;
+}
+
+static inline uint64_t *
+sp_quad_ps_invocations(const struct quad_stage *qs)
+{
+   return qs->band ? &qs->band->ps_invocations :
+                     &qs->softpipe->pipeline_statistics.ps_invocations;
+}
+
+
+struct sp_bands *
+sp_create_bands(struct softpipe_context *softpipe, unsigned nr_threads);
+
+void
+sp_destroy_bands(struct sp_bands *bands);
+
+boolean
+sp_bands_can_bin(struct sp_bands *bands);
+
+void
+sp_bands_bind_fs(struct sp_bands *bands);
+
+void
+sp_bands_unbind_fs_variant(struct sp_bands *bands,
+                           const struct sp_fragment_shader_variant *var);
+
+void
+sp_bin_tri(struct sp_bands *bands,
+           const float (*v0)[4],
+           const float (*v1)[4],
+           const float (*v2)[4]);
+
+void
+sp_bin_line(struct sp_bands *bands,
+            const float (*v0)[4],
+            const float (*v1)[4]);
+
+void
+sp_bin_point(struct sp_bands *bands,
+             const float (*v0)[4]);
+
+void
+sp_bands_flush(struct sp_bands *bands);
+
+struct util_queue *
+sp_bands_queue(struct sp_bands *bands);
+
+
+/**
+ * Rasterize the binned primitives, before the state they were binned with
+ * changes.  draw_flush() doesn't cover this: the draw module's pipeline
+ * stages rebind state in the middle of a draw, with flushing suspended.
+ */
+static inline void
+sp_flush_bins(struct softpipe_context *softpipe)
+{
+   if (softpipe->bands)
+      sp_bands_flush(softpipe->bands);
+}
+
+
+#endif /* SP_BAND_H */
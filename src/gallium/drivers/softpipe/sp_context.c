@@ -39,6 +39,7 @@
 #include "util/u_inlines.h"
 #include "util/u_upload_mgr.h"
 #include "tgsi/tgsi_exec.h"
+#include "sp_band.h"
 #include "sp_buffer.h"
 #include "sp_clear.h"
 #include "sp_context.h"
@@ -75,6 +76,9 @@ softpipe_destroy( struct pipe_context *pipe )
    if (softpipe->draw)
       draw_destroy( softpipe->draw );
 
+   if (softpipe->bands)
+      sp_destroy_bands(softpipe->bands);
+
    if (softpipe->quad.shade)
       softpipe->quad.shade->destroy( softpipe->quad.shade );
 
@@ -198,6 +202,7 @@ softpipe_create_context(struct pipe_screen *screen,
 {
    struct softpipe_screen *sp_screen = softpipe_screen(screen);
    struct softpipe_context *softpipe = CALLOC_STRUCT(softpipe_context);
+   unsigned nr_threads;
    uint i, sh;
 
    util_init_math();
@@ -319,6 +324,16 @@ softpipe_create_context(struct pipe_screen *screen,
    if (debug_get_bool_option( "SOFTPIPE_NO_RAST", FALSE ))
       softpipe->no_rast = TRUE;
 
+   /* Rasterize with this many extra threads, each taking bands of the
+    * framebuffer.
+    */
+   nr_threads = debug_get_num_option("SOFTPIPE_NUM_THREADS", 0);
+   if (nr_threads > 0) {
+      softpipe->bands = sp_create_bands(softpipe, nr_threads);
+      if (!softpipe->bands)
+         goto fail;
+   }
+
    softpipe->vbuf_backend = sp_create_vbuf_backend(softpipe);
    if (!softpipe->vbuf_backend)
       goto fail;
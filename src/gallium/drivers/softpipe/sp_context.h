@@ -48,6 +48,7 @@
 
 
 struct softpipe_vbuf_render;
+struct sp_bands;
 struct draw_context;
 struct draw_stage;
 struct softpipe_tile_cache;
@@ -161,13 +162,7 @@ struct softpipe_context {
    } pstipple;
 
    /** Software quad rendering pipeline */
-   struct {
-      struct quad_stage *shade;
-      struct quad_stage *depth_test;
-      struct quad_stage *blend;
-      struct quad_stage *pstipple;
-      struct quad_stage *first; /**< points to one of the above stages */
-   } quad;
+   struct sp_quad_pipeline quad;
 
    /** TGSI exec things */
    struct {
@@ -205,6 +200,9 @@ struct softpipe_context {
     */
    struct softpipe_tex_tile_cache *tex_cache[PIPE_SHADER_TYPES][PIPE_MAX_SHADER_SAMPLER_VIEWS];
 
+   /** Threads rasterizing bands of the framebuffer, NULL if disabled */
+   struct sp_bands *bands;
+
    unsigned dump_fs : 1;
    unsigned dump_gs : 1;
    unsigned dump_cs : 1;
@@ -37,6 +37,7 @@
 #include "util/u_draw.h"
 #include "util/u_prim.h"
 
+#include "sp_band.h"
 #include "sp_context.h"
 #include "sp_query.h"
 #include "sp_state.h"
@@ -165,6 +166,9 @@ softpipe_draw_vbo(struct pipe_context *pipe,
     */
    draw_flush(draw);
 
+   /* the bins don't outlive the draw, clears, transfers etc. don't see them */
+   sp_flush_bins(sp);
+
    /* Note: leave drawing surfaces mapped */
    sp->dirty_render_cache = TRUE;
 }
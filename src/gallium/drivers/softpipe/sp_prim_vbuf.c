@@ -36,6 +36,7 @@
  */
 
 
+#include "sp_band.h"
 #include "sp_context.h"
 #include "sp_setup.h"
 #include "sp_state.h"
@@ -137,6 +138,11 @@ sp_vbuf_set_primitive(struct vbuf_render *vbr, enum pipe_prim_type prim)
 {
    struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
    struct setup_context *setup_ctx = cvbr->setup;
+
+   /* the binned primitives must be set up as the current primitive type */
+   if (cvbr->softpipe->bands &&
+       u_reduced_prim(prim) != cvbr->softpipe->reduced_prim)
+      sp_bands_flush(cvbr->softpipe->bands);
    
    sp_setup_prepare( setup_ctx );
 
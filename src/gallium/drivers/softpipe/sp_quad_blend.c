@@ -34,11 +34,13 @@
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_format.h"
+#include "util/u_sse.h"
 #include "util/u_dual_blend.h"
 #include "sp_context.h"
 #include "sp_state.h"
 #include "sp_quad.h"
 #include "sp_tile_cache.h"
+#include "sp_band.h"
 #include "sp_quad_pipe.h"
 
 
@@ -59,6 +61,10 @@ struct blend_quad_stage
    boolean clamp[PIPE_MAX_COLOR_BUFS];  /**< clamp colors to [0,1]? */
    enum format base_format[PIPE_MAX_COLOR_BUFS];
    enum util_format_type format_type[PIPE_MAX_COLOR_BUFS];
+   /** format to round the colors to, NULL if floats hold them exactly */
+   const struct util_format_description *quantize[PIPE_MAX_COLOR_BUFS];
+   /** the format has four 8-bit unorm channels, which round the same */
+   boolean quantize_unorm8[PIPE_MAX_COLOR_BUFS];
 };
 
 
@@ -868,6 +874,76 @@ clamp_colors(float (*quadColor)[4])
 }
 
 
+/**
+ * Round colors to what the color buffer can hold.  The tile cache keeps
+ * colors as floats, so without this the result of blending depends on
+ * whether the tile stayed in the cache since it was last written, or was
+ * written out and read back.  Only done when rasterizing in bands, where
+ * each band's tile cache evicts differently than a single one would.
+ */
+static void
+quantize_colors(const struct blend_quad_stage *bqs, unsigned cbuf,
+                float (*quadColor)[4])
+{
+   const struct util_format_description *desc = bqs->quantize[cbuf];
+   float rgba[TGSI_QUAD_SIZE][4];
+   uint8_t packed[TGSI_QUAD_SIZE * 16];
+   uint i, j;
+
+   if (bqs->quantize_unorm8[cbuf]) {
+      /* as the format's pack and unpack functions, without the swizzles */
+      for (i = 0; i < 4; i++) {
+#if defined(PIPE_ARCH_SSE)
+         const __m128i ub = mm_float_to_ubyte_epi32(_mm_loadu_ps(quadColor[i]));
+         _mm_storeu_ps(quadColor[i], _mm_mul_ps(_mm_cvtepi32_ps(ub),
+                                                _mm_set1_ps(1.0f / 255.0f)));
+#else
+         for (j = 0; j < TGSI_QUAD_SIZE; j++)
+            quadColor[i][j] = ubyte_to_float(float_to_ubyte(quadColor[i][j]));
+#endif
+      }
+      return;
+   }
+
+   for (j = 0; j < TGSI_QUAD_SIZE; j++)
+      for (i = 0; i < 4; i++)
+         rgba[j][i] = quadColor[i][j];
+
+   desc->pack_rgba_float(packed, 0, &rgba[0][0], 0, TGSI_QUAD_SIZE, 1);
+   desc->unpack_rgba_float(&rgba[0][0], 0, packed, 0, TGSI_QUAD_SIZE, 1);
+
+   for (j = 0; j < TGSI_QUAD_SIZE; j++)
+      for (i = 0; i < 4; i++)
+         quadColor[i][j] = rgba[j][i];
+}
+
+
+/**
+ * Whether the format is RGBA8, BGRA8 or another arrangement of four
+ * 8-bit unorm channels, so that rounding colors through it is the same
+ * for every channel.
+ */
+static boolean
+is_unorm8(const struct util_format_description *desc)
+{
+   unsigned i;
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB ||
+       desc->nr_channels != 4)
+      return FALSE;
+
+   for (i = 0; i < 4; i++) {
+      if (desc->channel[i].type != UTIL_FORMAT_TYPE_UNSIGNED ||
+          !desc->channel[i].normalized ||
+          desc->channel[i].size != 8 ||
+          desc->swizzle[i] > PIPE_SWIZZLE_W)
+         return FALSE;
+   }
+   return TRUE;
+}
+
+
 /**
  * If we're drawing to a luminance, luminance/alpha or intensity surface
  * we have to adjust (rebase) the fragment/quad colors before writing them
@@ -932,7 +1008,7 @@ blend_fallback(struct quad_stage *qs,
          const uint blend_buf = blend->independent_blend_enable ? cbuf : 0;
          float dest[4][TGSI_QUAD_SIZE];
          struct softpipe_cached_tile *tile
-            = sp_get_cached_tile(softpipe->cbuf_cache[cbuf],
+            = sp_get_cached_tile(sp_quad_cbuf_cache(qs, cbuf),
                                  quads[0]->input.x0, 
                                  quads[0]->input.y0, quads[0]->input.layer);
          const boolean clamp = bqs->clamp[cbuf];
@@ -1005,6 +1081,9 @@ blend_fallback(struct quad_stage *qs,
             if (blend->rt[blend_buf].colormask != 0xf)
                colormask_quad( blend->rt[cbuf].colormask, quadColor, dest);
 
+            if (bqs->quantize[cbuf])
+               quantize_colors(bqs, cbuf, quadColor);
+
             /* Output color values
              */
             for (j = 0; j < TGSI_QUAD_SIZE; j++) {
@@ -1035,7 +1114,7 @@ blend_single_add_src_alpha_inv_src_alpha(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
+      = sp_get_cached_tile(sp_quad_cbuf_cache(qs, 0),
                            quads[0]->input.x0, 
                            quads[0]->input.y0, quads[0]->input.layer);
 
@@ -1087,6 +1166,9 @@ blend_single_add_src_alpha_inv_src_alpha(struct quad_stage *qs,
 
       rebase_colors(bqs->base_format[0], quadColor);
 
+      if (bqs->quantize[0])
+         quantize_colors(bqs, 0, quadColor);
+
       for (j = 0; j < TGSI_QUAD_SIZE; j++) {
          if (quad->inout.mask & (1 << j)) {
             int x = itx + (j & 1);
@@ -1109,7 +1191,7 @@ blend_single_add_one_one(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
+      = sp_get_cached_tile(sp_quad_cbuf_cache(qs, 0),
                            quads[0]->input.x0, 
                            quads[0]->input.y0, quads[0]->input.layer);
 
@@ -1149,6 +1231,9 @@ blend_single_add_one_one(struct quad_stage *qs,
 
       rebase_colors(bqs->base_format[0], quadColor);
 
+      if (bqs->quantize[0])
+         quantize_colors(bqs, 0, quadColor);
+
       for (j = 0; j < TGSI_QUAD_SIZE; j++) {
          if (quad->inout.mask & (1 << j)) {
             int x = itx + (j & 1);
@@ -1177,7 +1262,7 @@ single_output_color(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
+      = sp_get_cached_tile(sp_quad_cbuf_cache(qs, 0),
                            quads[0]->input.x0, 
                            quads[0]->input.y0, quads[0]->input.layer);
 
@@ -1192,6 +1277,9 @@ single_output_color(struct quad_stage *qs,
 
       rebase_colors(bqs->base_format[0], quadColor);
 
+      if (bqs->quantize[0])
+         quantize_colors(bqs, 0, quadColor);
+
       for (j = 0; j < TGSI_QUAD_SIZE; j++) {
          if (quad->inout.mask & (1 << j)) {
             int x = itx + (j & 1);
@@ -1255,7 +1343,7 @@ choose_blend_quad(struct quad_stage *qs,
    }
 
    /* For each color buffer, determine if the buffer has destination alpha and
-    * whether color clamping is needed.
+    * whether color clamping and rounding are needed.
     */
    for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++) {
       if (softpipe->framebuffer.cbufs[i]) {
@@ -1265,6 +1353,11 @@ choose_blend_quad(struct quad_stage *qs,
          /* assuming all or no color channels are normalized: */
          bqs->clamp[i] = desc->channel[0].normalized;
          bqs->format_type[i] = desc->channel[0].type;
+         bqs->quantize[i] =
+            !softpipe->bands ||
+            format == PIPE_FORMAT_R32G32B32A32_FLOAT ||
+            util_format_is_pure_integer(format) ? NULL : desc;
+         bqs->quantize_unorm8[i] = is_unorm8(desc);
 
          if (util_format_is_intensity(format))
             bqs->base_format[i] = INTENSITY;
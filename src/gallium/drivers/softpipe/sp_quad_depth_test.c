@@ -39,6 +39,7 @@
 #include "sp_quad.h"
 #include "sp_quad_pipe.h"
 #include "sp_tile_cache.h"
+#include "sp_band.h"
 #include "sp_state.h"           /* for sp_fragment_shader */
 
 
@@ -800,7 +801,7 @@ depth_test_quads_fallback(struct quad_stage *qs,
 
       data.ps = qs->softpipe->framebuffer.zsbuf;
       data.format = data.ps->format;
-      data.tile = sp_get_cached_tile(qs->softpipe->zsbuf_cache, 
+      data.tile = sp_get_cached_tile(sp_quad_zsbuf_cache(qs),
                                      quads[0]->input.x0, 
                                      quads[0]->input.y0, quads[0]->input.layer);
       data.clamp = !qs->softpipe->rasterizer->depth_clip;
@@ -842,8 +843,9 @@ depth_test_quads_fallback(struct quad_stage *qs,
    }
 
    if (qs->softpipe->active_query_count) {
+      uint64_t *occlusion_count = sp_quad_occlusion_count(qs);
       for (i = 0; i < nr; i++) 
-         qs->softpipe->occlusion_count += mask_count[quads[i]->inout.mask];
+         *occlusion_count += mask_count[quads[i]->inout.mask];
    }
 
    if (nr)
@@ -32,15 +32,16 @@
 
 
 static void
-insert_stage_at_head(struct softpipe_context *sp, struct quad_stage *quad)
+insert_stage_at_head(struct sp_quad_pipeline *quad, struct quad_stage *stage)
 {
-   quad->next = sp->quad.first;
-   sp->quad.first = quad;
+   stage->next = quad->first;
+   quad->first = stage;
 }
 
 
 void
-sp_build_quad_pipeline(struct softpipe_context *sp)
+sp_build_quad_pipeline(struct softpipe_context *sp,
+                       struct sp_quad_pipeline *quad)
 {
    boolean early_depth_test =
       (sp->depth_stencil->depth.enabled &&
@@ -51,21 +52,20 @@ sp_build_quad_pipeline(struct softpipe_context *sp)
        !sp->fs_variant->info.writes_stencil) ||
       sp->fs_variant->info.properties[TGSI_PROPERTY_FS_EARLY_DEPTH_STENCIL];
 
-   sp->quad.first = sp->quad.blend;
+   quad->first = quad->blend;
 
    sp->early_depth = early_depth_test;
    if (early_depth_test) {
-      insert_stage_at_head( sp, sp->quad.shade );
-      insert_stage_at_head( sp, sp->quad.depth_test );
+      insert_stage_at_head( quad, quad->shade );
+      insert_stage_at_head( quad, quad->depth_test );
    }
    else {
-      insert_stage_at_head( sp, sp->quad.depth_test );
-      insert_stage_at_head( sp, sp->quad.shade );
+      insert_stage_at_head( quad, quad->depth_test );
+      insert_stage_at_head( quad, quad->shade );
    }
 
 #if !DO_PSTIPPLE_IN_DRAW_MODULE && !DO_PSTIPPLE_IN_HELPER_MODULE
    if (sp->rasterizer->poly_stipple_enable)
-      insert_stage_at_head( sp, sp->quad.pstipple );
+      insert_stage_at_head( quad, quad->pstipple );
 #endif
 }
-
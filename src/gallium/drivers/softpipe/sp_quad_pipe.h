@@ -34,6 +34,7 @@
 
 struct softpipe_context;
 struct quad_header;
+struct sp_band;
 
 
 /**
@@ -44,6 +45,9 @@ struct quad_header;
 struct quad_stage {
    struct softpipe_context *softpipe;
 
+   /** The band this stage renders for, NULL in the context's own pipeline */
+   struct sp_band *band;
+
    struct quad_stage *next;
 
    void (*begin)(struct quad_stage *qs);
@@ -67,6 +71,20 @@ struct quad_stage *sp_quad_blend_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_colormask_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_output_stage( struct softpipe_context *softpipe );
 
-void sp_build_quad_pipeline(struct softpipe_context *sp);
+
+/**
+ * The quad stages of one pipeline.  The context has one, and so does
+ * each band when rasterizing with threads (see sp_band.c).
+ */
+struct sp_quad_pipeline {
+   struct quad_stage *shade;
+   struct quad_stage *depth_test;
+   struct quad_stage *blend;
+   struct quad_stage *pstipple;
+   struct quad_stage *first; /**< points to one of the above stages */
+};
+
+void sp_build_quad_pipeline(struct softpipe_context *sp,
+                            struct sp_quad_pipeline *quad);
 
 #endif /* SP_QUAD_PIPE_H */
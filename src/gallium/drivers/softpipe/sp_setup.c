@@ -32,6 +32,7 @@
  * \author  Brian Paul
  */
 
+#include "sp_band.h"
 #include "sp_context.h"
 #include "sp_quad.h"
 #include "sp_quad_pipe.h"
@@ -74,6 +75,12 @@ struct edge {
 struct setup_context {
    struct softpipe_context *softpipe;
 
+   /** The band rasterized into, NULL for the whole framebuffer */
+   struct sp_band *band;
+
+   /** Bin the primitives for the bands instead of rasterizing them */
+   boolean binning;
+
    /* Vertices are just an array of floats making up each attribute in
     * turn.  Currently fixed at 4 floats, but should change in time.
     * Codegen will help cope with this.
@@ -121,6 +128,16 @@ struct setup_context {
 
 
 
+/**
+ * The first stage of the quad pipeline the setup feeds.
+ */
+static inline struct quad_stage *
+first_stage(const struct setup_context *setup)
+{
+   return setup->band ? setup->band->quad.first : setup->softpipe->quad.first;
+}
+
+
 /**
  * Clip setup->quad against the scissor/surface bounds.
  */
@@ -142,6 +159,11 @@ quad_clip(struct setup_context *setup, struct quad_header *quad)
       quad->inout.mask = 0x0;
       return;
    }
+   if (setup->band && !sp_band_owns_row(setup->band, quad->input.y0)) {
+      /* another band's quad, quads never straddle two bands */
+      quad->inout.mask = 0x0;
+      return;
+   }
    if (quad->input.x0 < minx)
       quad->inout.mask &= (MASK_BOTTOM_RIGHT | MASK_TOP_RIGHT);
    if (quad->input.y0 < miny)
@@ -162,13 +184,13 @@ clip_emit_quad(struct setup_context *setup, struct quad_header *quad)
    quad_clip(setup, quad);
 
    if (quad->inout.mask) {
-      struct softpipe_context *sp = setup->softpipe;
+      struct quad_stage *first = first_stage(setup);
 
 #if DEBUG_FRAGS
       setup->numFragsEmitted += util_bitcount(quad->inout.mask);
 #endif
 
-      sp->quad.first->run( sp->quad.first, &quad, 1 );
+      first->run( first, &quad, 1 );
    }
 }
 
@@ -203,7 +225,7 @@ flush_spans(struct setup_context *setup)
    const int xleft1 = setup->span.left[1];
    const int xright0 = setup->span.right[0];
    const int xright1 = setup->span.right[1];
-   struct quad_stage *pipe = setup->softpipe->quad.first;
+   struct quad_stage *pipe = first_stage(setup);
 
    const int minleft = block_x(MIN2(xleft0, xleft1));
    const int maxright = MAX2(xright0, xright1);
@@ -741,6 +763,14 @@ subtriangle(struct setup_context *setup,
    */
 
    for (y = start_y; y < finish_y; y++) {
+      const int _y = sy + y;
+      int left, right;
+
+      if (setup->band && !sp_band_owns_row(setup->band, _y)) {
+         /* skip to the next row of tiles */
+         y = (_y | (TILE_SIZE - 1)) - sy;
+         continue;
+      }
 
       /* avoid accumulating adds as floats don't have the precision to
        * accurately iterate large triangle edges that way.  luckily we
@@ -748,8 +778,8 @@ subtriangle(struct setup_context *setup,
        *
        * this is all drowned out by the attribute interpolation anyway.
        */
-      int left = (int)(eleft->sx + y * eleft->dxdy);
-      int right = (int)(eright->sx + y * eright->dxdy);
+      left = (int)(eleft->sx + y * eleft->dxdy);
+      right = (int)(eright->sx + y * eright->dxdy);
 
       /* clip left/right */
       if (left < minx)
@@ -758,7 +788,6 @@ subtriangle(struct setup_context *setup,
          right = maxx;
 
       if (left < right) {
-         int _y = sy + y;
          if (block(_y) != setup->span.y) {
             flush_spans(setup);
             setup->span.y = block(_y);
@@ -821,6 +850,11 @@ sp_setup_tri(struct setup_context *setup,
 
    if (setup->softpipe->no_rast || setup->softpipe->rasterizer->rasterizer_discard)
       return;
+
+   if (setup->binning) {
+      sp_bin_tri(setup->softpipe->bands, v0, v1, v2);
+      return;
+   }
    
    det = calc_det(v0, v1, v2);
    /*
@@ -874,7 +908,11 @@ sp_setup_tri(struct setup_context *setup,
    flush_spans( setup );
 
    if (setup->softpipe->active_statistics_queries) {
-      setup->softpipe->pipeline_statistics.c_primitives++;
+      /* every band sets the triangle up, but only one counts it */
+      if (!setup->band)
+         setup->softpipe->pipeline_statistics.c_primitives++;
+      else if (setup->band->count_prim)
+         setup->band->c_primitives++;
    }
 
 #if DEBUG_FRAGS
@@ -1107,6 +1145,11 @@ sp_setup_line(struct setup_context *setup,
    if (setup->softpipe->no_rast || setup->softpipe->rasterizer->rasterizer_discard)
       return;
 
+   if (setup->binning) {
+      sp_bin_line(setup->softpipe->bands, v0, v1);
+      return;
+   }
+
    if (dx == 0 && dy == 0)
       return;
 
@@ -1254,6 +1297,11 @@ sp_setup_point(struct setup_context *setup,
    if (setup->softpipe->no_rast || setup->softpipe->rasterizer->rasterizer_discard)
       return;
 
+   if (setup->binning) {
+      sp_bin_point(setup->softpipe->bands, v0);
+      return;
+   }
+
    assert(setup->softpipe->reduced_prim == PIPE_PRIM_POINTS);
 
    if (setup->softpipe->layer_slot > 0) {
@@ -1478,7 +1526,9 @@ sp_setup_prepare(struct setup_context *setup)
 
    setup->max_layer = max_layer;
 
-   sp->quad.first->begin( sp->quad.first );
+   first_stage(setup)->begin( first_stage(setup) );
+
+   setup->binning = !setup->band && sp->bands && sp_bands_can_bin(sp->bands);
 
    if (sp->reduced_api_prim == PIPE_PRIM_TRIANGLES &&
        sp->rasterizer->fill_front == PIPE_POLYGON_MODE_FILL &&
@@ -1493,6 +1543,16 @@ sp_setup_prepare(struct setup_context *setup)
 }
 
 
+/**
+ * Make the setup rasterize only the rows of a band, with its quad pipeline.
+ */
+void
+sp_setup_set_band(struct setup_context *setup, struct sp_band *band)
+{
+   setup->band = band;
+}
+
+
 void
 sp_setup_destroy_context(struct setup_context *setup)
 {
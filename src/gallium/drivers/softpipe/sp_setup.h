@@ -29,6 +29,7 @@
 
 struct setup_context;
 struct softpipe_context;
+struct sp_band;
 
 /**
  * Attribute interpolation mode
@@ -72,6 +73,7 @@ sp_clamp_viewport_idx(int idx)
 
 struct setup_context *sp_setup_create_context( struct softpipe_context *softpipe );
 void sp_setup_prepare( struct setup_context *setup );
+void sp_setup_set_band( struct setup_context *setup, struct sp_band *band );
 void sp_setup_destroy_context( struct setup_context *setup );
 
 #endif
@@ -32,6 +32,7 @@
 #include "pipe/p_shader_tokens.h"
 #include "draw/draw_context.h"
 #include "draw/draw_vertex.h"
+#include "sp_band.h"
 #include "sp_context.h"
 #include "sp_screen.h"
 #include "sp_state.h"
@@ -352,6 +353,9 @@ update_fragment_shader(struct softpipe_context *softpipe, unsigned prim)
                                     tgsi.sampler[PIPE_SHADER_FRAGMENT],
                                     (struct tgsi_image *)softpipe->tgsi.image[PIPE_SHADER_FRAGMENT],
                                     (struct tgsi_buffer *)softpipe->tgsi.buffer[PIPE_SHADER_FRAGMENT]);
+
+      if (softpipe->bands)
+         sp_bands_bind_fs(softpipe->bands);
    }
    else {
       softpipe->fs_variant = NULL;
@@ -481,7 +485,7 @@ softpipe_update_derived(struct softpipe_context *softpipe, unsigned prim)
                           SP_NEW_FRAMEBUFFER |
                           SP_NEW_STIPPLE |
                           SP_NEW_FS))
-      sp_build_quad_pipeline(softpipe);
+      sp_build_quad_pipeline(softpipe, &softpipe->quad);
 
    softpipe->dirty = 0;
 }
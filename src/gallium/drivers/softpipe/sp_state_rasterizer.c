@@ -27,6 +27,7 @@
 
 #include "pipe/p_defines.h"
 #include "util/u_memory.h"
+#include "sp_band.h"
 #include "sp_context.h"
 #include "sp_state.h"
 #include "draw/draw_context.h"
@@ -50,6 +51,8 @@ softpipe_bind_rasterizer_state(struct pipe_context *pipe,
    if (softpipe->rasterizer == rasterizer)
       return;
 
+   sp_flush_bins(softpipe);
+
    /* pass-through to draw module */
    draw_set_rasterizer_state(softpipe->draw, rasterizer, rasterizer);
 
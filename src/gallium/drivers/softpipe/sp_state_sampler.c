@@ -35,6 +35,7 @@
 
 #include "draw/draw_context.h"
 
+#include "sp_band.h"
 #include "sp_context.h"
 #include "sp_state.h"
 #include "sp_texture.h"
@@ -61,6 +62,7 @@ softpipe_bind_sampler_states(struct pipe_context *pipe,
    assert(start + num <= ARRAY_SIZE(softpipe->samplers[shader]));
 
    draw_flush(softpipe->draw);
+   sp_flush_bins(softpipe);
 
    /* set the new samplers */
    for (i = 0; i < num; i++) {
@@ -109,6 +111,7 @@ softpipe_set_sampler_views(struct pipe_context *pipe,
    assert(start + num <= ARRAY_SIZE(softpipe->sampler_views[shader]));
 
    draw_flush(softpipe->draw);
+   sp_flush_bins(softpipe);
 
    /* set the new sampler views */
    for (i = 0; i < num; i++) {
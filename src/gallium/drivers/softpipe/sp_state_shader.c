@@ -25,6 +25,7 @@
  * 
  **************************************************************************/
 
+#include "sp_band.h"
 #include "sp_context.h"
 #include "sp_state.h"
 #include "sp_fs.h"
@@ -152,6 +153,7 @@ softpipe_bind_fs_state(struct pipe_context *pipe, void *fs)
       return;
 
    draw_flush(softpipe->draw);
+   sp_flush_bins(softpipe);
 
    softpipe->fs = fs;
 
@@ -190,6 +192,8 @@ softpipe_delete_fs_state(struct pipe_context *pipe, void *fs)
       draw_delete_fragment_shader(softpipe->draw, var->draw_shader);
 #endif
 
+      if (softpipe->bands)
+         sp_bands_unbind_fs_variant(softpipe->bands, var);
       var->delete(var, softpipe->fs_machine);
    }
 
@@ -26,7 +26,9 @@
  **************************************************************************/
 
 #include "util/u_format.h"
+#include "util/u_gen_mipmap.h"
 #include "util/u_surface.h"
+#include "sp_band.h"
 #include "sp_context.h"
 #include "sp_surface.h"
 #include "sp_query.h"
@@ -86,6 +88,26 @@ static void sp_blit(struct pipe_context *pipe,
    util_blitter_blit(sp->blitter, info);
 }
 
+/**
+ * Generate mipmaps on the CPU, with the bands' threads, when that gives the
+ * same results as blitting.
+ */
+static boolean
+sp_generate_mipmap(struct pipe_context *pipe,
+                   struct pipe_resource *resource,
+                   enum pipe_format format,
+                   unsigned base_level,
+                   unsigned last_level,
+                   unsigned first_layer,
+                   unsigned last_layer)
+{
+   struct softpipe_context *sp = softpipe_context(pipe);
+
+   return util_gen_mipmap_cpu(pipe, resource, format, base_level, last_level,
+                              first_layer, last_layer, PIPE_TEX_FILTER_LINEAR,
+                              sp->bands ? sp_bands_queue(sp->bands) : NULL);
+}
+
 static void
 sp_flush_resource(struct pipe_context *pipe,
                   struct pipe_resource *resource)
@@ -138,5 +160,6 @@ sp_init_surface_functions(struct softpipe_context *sp)
    sp->pipe.clear_render_target = softpipe_clear_render_target;
    sp->pipe.clear_depth_stencil = softpipe_clear_depth_stencil;
    sp->pipe.blit = sp_blit;
+   sp->pipe.generate_mipmap = sp_generate_mipmap;
    sp->pipe.flush_resource = sp_flush_resource;
 }
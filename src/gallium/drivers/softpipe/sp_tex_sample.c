@@ -41,6 +41,7 @@
 #include "util/u_format.h"
 #include "util/u_memory.h"
 #include "util/u_inlines.h"
+#include "util/u_sse.h"
 #include "sp_quad.h"   /* only for #define QUAD_* tokens */
 #include "sp_tex_sample.h"
 #include "sp_texture.h"
@@ -591,6 +592,20 @@ get_texel_2d_no_border(const struct sp_sampler_view *sp_sview,
 }
 
 
+/**
+ * The texels returned by get_texel_2d() and friends point into the tile
+ * cache.  As that is direct mapped, fetching another texel can evict the
+ * tile unless they're in neighbouring tiles, which isn't the case when
+ * wrapping around the texture.  This keeps a copy of the texel instead.
+ */
+static inline const float *
+keep_texel(const float *texel, float copy[TGSI_NUM_CHANNELS])
+{
+   memcpy(copy, texel, TGSI_NUM_CHANNELS * sizeof(float));
+   return copy;
+}
+
+
 static inline const float *
 get_texel_2d(const struct sp_sampler_view *sp_sview,
              const struct sp_sampler *sp_samp,
@@ -788,11 +803,15 @@ get_texel_quad_2d_no_border(const struct sp_sampler_view *sp_sview,
                             union tex_tile_address addr,
                             int x0, int y0,
                             int x1, int y1,
+                            float texels[3][TGSI_NUM_CHANNELS],
                             const float *out[4])
 {
-   out[0] = get_texel_2d_no_border( sp_sview, addr, x0, y0 );
-   out[1] = get_texel_2d_no_border( sp_sview, addr, x1, y0 );
-   out[2] = get_texel_2d_no_border( sp_sview, addr, x0, y1 );
+   out[0] = keep_texel(get_texel_2d_no_border( sp_sview, addr, x0, y0 ),
+                       texels[0]);
+   out[1] = keep_texel(get_texel_2d_no_border( sp_sview, addr, x1, y0 ),
+                       texels[1]);
+   out[2] = keep_texel(get_texel_2d_no_border( sp_sview, addr, x0, y1 ),
+                       texels[2]);
    out[3] = get_texel_2d_no_border( sp_sview, addr, x1, y1 );
 }
 
@@ -1013,6 +1032,7 @@ img_filter_2d_linear_repeat_POT(const struct sp_sampler_view *sp_sview,
    const int y0 = vflr & (ypot - 1);
 
    const float *tx[4];
+   float texels[3][TGSI_NUM_CHANNELS];
       
    addr.value = 0;
    addr.bits.level = args->level;
@@ -1026,7 +1046,8 @@ img_filter_2d_linear_repeat_POT(const struct sp_sampler_view *sp_sview,
    else {
       const unsigned x1 = (x0 + 1) & (xpot - 1);
       const unsigned y1 = (y0 + 1) & (ypot - 1);
-      get_texel_quad_2d_no_border(sp_sview, addr, x0, y0, x1, y1, tx);
+      get_texel_quad_2d_no_border(sp_sview, addr, x0, y0, x1, y1,
+                                  texels, tx);
    }
 
    /* interpolate R, G, B, A */
@@ -1506,6 +1527,7 @@ img_filter_2d_linear(const struct sp_sampler_view *sp_sview,
    float xw, yw; /* weights */
    union tex_tile_address addr;
    const float *tx[4];
+   float texels[3][TGSI_NUM_CHANNELS];
    int c;
 
    assert(width > 0);
@@ -1518,9 +1540,20 @@ img_filter_2d_linear(const struct sp_sampler_view *sp_sview,
    sp_samp->linear_texcoord_s(args->s, width,  args->offset[0], &x0, &x1, &xw);
    sp_samp->linear_texcoord_t(args->t, height, args->offset[1], &y0, &y1, &yw);
 
-   tx[0] = get_texel_2d(sp_sview, sp_samp, addr, x0, y0);
-   tx[1] = get_texel_2d(sp_sview, sp_samp, addr, x1, y0);
-   tx[2] = get_texel_2d(sp_sview, sp_samp, addr, x0, y1);
+   if (x1 < x0 || y1 < y0) {
+      /* wrapped around */
+      tx[0] = keep_texel(get_texel_2d(sp_sview, sp_samp, addr, x0, y0),
+                         texels[0]);
+      tx[1] = keep_texel(get_texel_2d(sp_sview, sp_samp, addr, x1, y0),
+                         texels[1]);
+      tx[2] = keep_texel(get_texel_2d(sp_sview, sp_samp, addr, x0, y1),
+                         texels[2]);
+   }
+   else {
+      tx[0] = get_texel_2d(sp_sview, sp_samp, addr, x0, y0);
+      tx[1] = get_texel_2d(sp_sview, sp_samp, addr, x1, y0);
+      tx[2] = get_texel_2d(sp_sview, sp_samp, addr, x0, y1);
+   }
    tx[3] = get_texel_2d(sp_sview, sp_samp, addr, x1, y1);
 
    if (args->gather_only) {
@@ -1553,6 +1586,7 @@ img_filter_2d_array_linear(const struct sp_sampler_view *sp_sview,
    float xw, yw; /* weights */
    union tex_tile_address addr;
    const float *tx[4];
+   float texels[3][TGSI_NUM_CHANNELS];
    int c;
 
    assert(width > 0);
@@ -1564,9 +1598,20 @@ img_filter_2d_array_linear(const struct sp_sampler_view *sp_sview,
    sp_samp->linear_texcoord_s(args->s, width,  args->offset[0], &x0, &x1, &xw);
    sp_samp->linear_texcoord_t(args->t, height, args->offset[1], &y0, &y1, &yw);
 
-   tx[0] = get_texel_2d_array(sp_sview, sp_samp, addr, x0, y0, layer);
-   tx[1] = get_texel_2d_array(sp_sview, sp_samp, addr, x1, y0, layer);
-   tx[2] = get_texel_2d_array(sp_sview, sp_samp, addr, x0, y1, layer);
+   if (x1 < x0 || y1 < y0) {
+      /* wrapped around */
+      tx[0] = keep_texel(get_texel_2d_array(sp_sview, sp_samp, addr,
+                                            x0, y0, layer), texels[0]);
+      tx[1] = keep_texel(get_texel_2d_array(sp_sview, sp_samp, addr,
+                                            x1, y0, layer), texels[1]);
+      tx[2] = keep_texel(get_texel_2d_array(sp_sview, sp_samp, addr,
+                                            x0, y1, layer), texels[2]);
+   }
+   else {
+      tx[0] = get_texel_2d_array(sp_sview, sp_samp, addr, x0, y0, layer);
+      tx[1] = get_texel_2d_array(sp_sview, sp_samp, addr, x1, y0, layer);
+      tx[2] = get_texel_2d_array(sp_sview, sp_samp, addr, x0, y1, layer);
+   }
    tx[3] = get_texel_2d_array(sp_sview, sp_samp, addr, x1, y1, layer);
 
    if (args->gather_only) {
@@ -1730,6 +1775,7 @@ img_filter_3d_linear(const struct sp_sampler_view *sp_sview,
    float xw, yw, zw; /* interpolation weights */
    union tex_tile_address addr;
    const float *tx00, *tx01, *tx02, *tx03, *tx10, *tx11, *tx12, *tx13;
+   float texels[7][TGSI_NUM_CHANNELS];
    int c;
 
    addr.value = 0;
@@ -1743,14 +1789,34 @@ img_filter_3d_linear(const struct sp_sampler_view *sp_sview,
    sp_samp->linear_texcoord_t(args->t, height, args->offset[1], &y0, &y1, &yw);
    sp_samp->linear_texcoord_p(args->p, depth,  args->offset[2], &z0, &z1, &zw);
 
-   tx00 = get_texel_3d(sp_sview, sp_samp, addr, x0, y0, z0);
-   tx01 = get_texel_3d(sp_sview, sp_samp, addr, x1, y0, z0);
-   tx02 = get_texel_3d(sp_sview, sp_samp, addr, x0, y1, z0);
-   tx03 = get_texel_3d(sp_sview, sp_samp, addr, x1, y1, z0);
-      
-   tx10 = get_texel_3d(sp_sview, sp_samp, addr, x0, y0, z1);
-   tx11 = get_texel_3d(sp_sview, sp_samp, addr, x1, y0, z1);
-   tx12 = get_texel_3d(sp_sview, sp_samp, addr, x0, y1, z1);
+   if (x1 < x0 || y1 < y0 || z1 < z0) {
+      /* wrapped around */
+      tx00 = keep_texel(get_texel_3d(sp_sview, sp_samp, addr, x0, y0, z0),
+                        texels[0]);
+      tx01 = keep_texel(get_texel_3d(sp_sview, sp_samp, addr, x1, y0, z0),
+                        texels[1]);
+      tx02 = keep_texel(get_texel_3d(sp_sview, sp_samp, addr, x0, y1, z0),
+                        texels[2]);
+      tx03 = keep_texel(get_texel_3d(sp_sview, sp_samp, addr, x1, y1, z0),
+                        texels[3]);
+
+      tx10 = keep_texel(get_texel_3d(sp_sview, sp_samp, addr, x0, y0, z1),
+                        texels[4]);
+      tx11 = keep_texel(get_texel_3d(sp_sview, sp_samp, addr, x1, y0, z1),
+                        texels[5]);
+      tx12 = keep_texel(get_texel_3d(sp_sview, sp_samp, addr, x0, y1, z1),
+                        texels[6]);
+   }
+   else {
+      tx00 = get_texel_3d(sp_sview, sp_samp, addr, x0, y0, z0);
+      tx01 = get_texel_3d(sp_sview, sp_samp, addr, x1, y0, z0);
+      tx02 = get_texel_3d(sp_sview, sp_samp, addr, x0, y1, z0);
+      tx03 = get_texel_3d(sp_sview, sp_samp, addr, x1, y1, z0);
+
+      tx10 = get_texel_3d(sp_sview, sp_samp, addr, x0, y0, z1);
+      tx11 = get_texel_3d(sp_sview, sp_samp, addr, x1, y0, z1);
+      tx12 = get_texel_3d(sp_sview, sp_samp, addr, x0, y1, z1);
+   }
    tx13 = get_texel_3d(sp_sview, sp_samp, addr, x1, y1, z1);
       
       /* interpolate R, G, B, A */
@@ -3040,6 +3106,349 @@ get_filters(const struct sp_sampler_view *sp_sview,
    }
 }
 
+#if defined(PIPE_ARCH_SSE)
+
+/*
+ * Quad sampling of 2D views with SSE2.
+ *
+ * For the common case of a 2D texture in a plain RGBA8 or RGBA32F format,
+ * with the same nearest or linear filter for minification and
+ * magnification and repeat or clamp to edge wrapping, sample_quad_2d()
+ * processes all four pixels of a quad together and reads the texels
+ * directly from the resource, in their own format, rather than from the
+ * float tiles of the texture cache.  The arithmetic is done in the same
+ * order as in the per-pixel img_filter functions, so the results are the
+ * same for the coordinates it handles.  NaN, infinite and very large
+ * coordinates are left to the generic path, as util_ifloor() and repeat()
+ * only wrap them as expected within a limited range.
+ */
+
+
+/**
+ * Largest magnitude of a normalized texcoord handled by sample_quad_2d().
+ * Scaled by the largest texture size, it stays within the range where
+ * util_ifloor() is exact and repeat() wraps negative coordinates.
+ */
+#define QUAD_2D_MAX_COORD 128.0f
+
+
+/**
+ * Floor of four floats, as integers, and as floats in *flr.
+ */
+static inline __m128i
+quad_floor(__m128 u, __m128 *flr)
+{
+   const __m128i i = _mm_cvttps_epi32(u);
+   const __m128 f = _mm_cvtepi32_ps(i);
+   /* truncation rounds negative values up */
+   const __m128 up = _mm_cmpgt_ps(f, u);
+
+   *flr = _mm_sub_ps(f, _mm_and_ps(up, _mm_set1_ps(1.0f)));
+   return _mm_add_epi32(i, _mm_castps_si128(up));
+}
+
+
+/**
+ * As wrap_nearest_repeat() and wrap_nearest_clamp_to_edge(), for four
+ * texcoords already scaled by the size.  Repeat requires a POT size.
+ */
+static inline __m128i
+quad_wrap_nearest(__m128 u, unsigned size, boolean repeat)
+{
+   __m128 flr;
+
+   if (repeat)
+      return _mm_and_si128(quad_floor(u, &flr), _mm_set1_epi32(size - 1));
+
+   /* also maps NaN to 0 */
+   u = _mm_max_ps(u, _mm_setzero_ps());
+   u = _mm_min_ps(u, _mm_set1_ps((float)size - 0.5F));
+   return quad_floor(u, &flr);
+}
+
+
+/**
+ * As wrap_linear_repeat() and wrap_linear_clamp_to_edge(), for four
+ * texcoords already scaled by the size.  Repeat requires a POT size.
+ */
+static inline void
+quad_wrap_linear(__m128 u, unsigned size, boolean repeat,
+                 __m128i *i0, __m128i *i1, __m128 *w)
+{
+   __m128 flr;
+
+   if (repeat) {
+      const __m128i mask = _mm_set1_epi32(size - 1);
+
+      u = _mm_sub_ps(u, _mm_set1_ps(0.5F));
+      *i0 = quad_floor(u, &flr);
+      *i1 = _mm_and_si128(_mm_add_epi32(*i0, _mm_set1_epi32(1)), mask);
+      *i0 = _mm_and_si128(*i0, mask);
+   }
+   else {
+      u = _mm_max_ps(u, _mm_setzero_ps());
+      u = _mm_min_ps(u, _mm_set1_ps((float)size));
+      u = _mm_sub_ps(u, _mm_set1_ps(0.5F));
+      *i0 = quad_floor(u, &flr);
+      *i1 = _mm_add_epi32(*i0, _mm_set1_epi32(1));
+      /* i0 >= -1 and i1 <= size, clamp both to the edge */
+      *i0 = _mm_andnot_si128(_mm_srai_epi32(*i0, 31), *i0);
+      *i1 = _mm_add_epi32(*i1, _mm_cmpgt_epi32(*i1, _mm_set1_epi32(size - 1)));
+   }
+
+   *w = _mm_sub_ps(u, flr);
+}
+
+
+/**
+ * Fetch the texels at (x[j], y[j]) of an image and convert them to float,
+ * as the tile cache would.
+ */
+static inline void
+quad_fetch_2d(enum pipe_format format, const uint8_t *data, unsigned stride,
+              __m128i x, __m128i y, __m128 rgba[TGSI_NUM_CHANNELS])
+{
+   union m128i xi, yi;
+
+   xi.m = x;
+   yi.m = y;
+
+   if (format == PIPE_FORMAT_R32G32B32A32_FLOAT) {
+      __m128 t0 = _mm_loadu_ps((const float *)(data + yi.ui[0] * stride) +
+                               xi.ui[0] * 4);
+      __m128 t1 = _mm_loadu_ps((const float *)(data + yi.ui[1] * stride) +
+                               xi.ui[1] * 4);
+      __m128 t2 = _mm_loadu_ps((const float *)(data + yi.ui[2] * stride) +
+                               xi.ui[2] * 4);
+      __m128 t3 = _mm_loadu_ps((const float *)(data + yi.ui[3] * stride) +
+                               xi.ui[3] * 4);
+
+      _MM_TRANSPOSE4_PS(t0, t1, t2, t3);
+      rgba[0] = t0;
+      rgba[1] = t1;
+      rgba[2] = t2;
+      rgba[3] = t3;
+   }
+   else {
+      const __m128i mask = _mm_set1_epi32(0xff);
+      const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+      const __m128i texels = _mm_setr_epi32(
+         ((const int32_t *)(data + yi.ui[0] * stride))[xi.ui[0]],
+         ((const int32_t *)(data + yi.ui[1] * stride))[xi.ui[1]],
+         ((const int32_t *)(data + yi.ui[2] * stride))[xi.ui[2]],
+         ((const int32_t *)(data + yi.ui[3] * stride))[xi.ui[3]]);
+      __m128 c0, c1, c2, c3;
+
+      c0 = _mm_cvtepi32_ps(_mm_and_si128(texels, mask));
+      c1 = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels, 8), mask));
+      c2 = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels, 16), mask));
+      c3 = _mm_cvtepi32_ps(_mm_srli_epi32(texels, 24));
+
+      switch (format) {
+      case PIPE_FORMAT_B8G8R8A8_UNORM:
+      case PIPE_FORMAT_B8G8R8X8_UNORM:
+         rgba[0] = _mm_mul_ps(c2, scale);
+         rgba[2] = _mm_mul_ps(c0, scale);
+         break;
+      default:
+         rgba[0] = _mm_mul_ps(c0, scale);
+         rgba[2] = _mm_mul_ps(c2, scale);
+         break;
+      }
+      rgba[1] = _mm_mul_ps(c1, scale);
+
+      if (format == PIPE_FORMAT_R8G8B8X8_UNORM ||
+          format == PIPE_FORMAT_B8G8R8X8_UNORM)
+         rgba[3] = _mm_set1_ps(1.0f);
+      else
+         rgba[3] = _mm_mul_ps(c3, scale);
+   }
+}
+
+
+static inline __m128
+quad_lerp(__m128 a, __m128 v0, __m128 v1)
+{
+   return _mm_add_ps(v0, _mm_mul_ps(a, _mm_sub_ps(v1, v0)));
+}
+
+
+/**
+ * Sample one mipmap level for the four pixels of a quad, with the
+ * sampler's (single) image filter.
+ */
+static void
+quad_filter_2d(const struct sp_sampler_view *sp_sview,
+               const struct sp_sampler *sp_samp,
+               unsigned level,
+               const float s[TGSI_QUAD_SIZE],
+               const float t[TGSI_QUAD_SIZE],
+               __m128 rgba[TGSI_NUM_CHANNELS])
+{
+   const struct pipe_resource *texture = sp_sview->base.texture;
+   const struct softpipe_resource *spr = softpipe_resource(sp_sview->base.texture);
+   const enum pipe_format format = sp_sview->base.format;
+   const unsigned width = u_minify(texture->width0, level);
+   const unsigned height = u_minify(texture->height0, level);
+   const unsigned stride = spr->stride[level];
+   const uint8_t *data = (const uint8_t *)spr->data +
+                         spr->level_offset[level] +
+                         sp_sview->base.u.tex.first_layer *
+                         spr->img_stride[level];
+   const __m128 u = _mm_mul_ps(_mm_loadu_ps(s), _mm_set1_ps((float)width));
+   const __m128 v = _mm_mul_ps(_mm_loadu_ps(t), _mm_set1_ps((float)height));
+   const boolean repeat_s = sp_samp->base.wrap_s == PIPE_TEX_WRAP_REPEAT;
+   const boolean repeat_t = sp_samp->base.wrap_t == PIPE_TEX_WRAP_REPEAT;
+
+   if (sp_samp->min_img_filter == PIPE_TEX_FILTER_NEAREST) {
+      quad_fetch_2d(format, data, stride,
+                    quad_wrap_nearest(u, width, repeat_s),
+                    quad_wrap_nearest(v, height, repeat_t),
+                    rgba);
+   }
+   else {
+      __m128i x0, x1, y0, y1;
+      __m128 xw, yw;
+      __m128 tx[4][TGSI_NUM_CHANNELS];
+      unsigned c;
+
+      quad_wrap_linear(u, width, repeat_s, &x0, &x1, &xw);
+      quad_wrap_linear(v, height, repeat_t, &y0, &y1, &yw);
+
+      quad_fetch_2d(format, data, stride, x0, y0, tx[0]);
+      quad_fetch_2d(format, data, stride, x1, y0, tx[1]);
+      quad_fetch_2d(format, data, stride, x0, y1, tx[2]);
+      quad_fetch_2d(format, data, stride, x1, y1, tx[3]);
+
+      /* as lerp_2d() */
+      for (c = 0; c < TGSI_NUM_CHANNELS; c++) {
+         const __m128 temp0 = quad_lerp(xw, tx[0][c], tx[1][c]);
+         const __m128 temp1 = quad_lerp(xw, tx[2][c], tx[3][c]);
+         rgba[c] = quad_lerp(yw, temp0, temp1);
+      }
+   }
+}
+
+
+/**
+ * Sample a quad with SSE2 if the view, the sampler and the coordinates
+ * allow it, doing the work of the mip filter function.
+ * \return FALSE if the generic path must be used instead.
+ */
+static boolean
+sample_quad_2d(const struct sp_sampler_view *sp_sview,
+               const struct sp_sampler *sp_samp,
+               const float s[TGSI_QUAD_SIZE],
+               const float t[TGSI_QUAD_SIZE],
+               const float p[TGSI_QUAD_SIZE],
+               const float lod_in[TGSI_QUAD_SIZE],
+               const struct filter_args *filt_args,
+               float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])
+{
+   const struct pipe_sampler_view *psview = &sp_sview->base;
+   const int first_level = psview->u.tex.first_level;
+   const int last_level = psview->u.tex.last_level;
+   const __m128 sign = _mm_set1_ps(-0.0f);
+   const __m128 max_coord = _mm_set1_ps(QUAD_2D_MAX_COORD);
+   __m128 out[TGSI_NUM_CHANNELS];
+   float lod[TGSI_QUAD_SIZE];
+   int level[TGSI_QUAD_SIZE];
+   boolean blend[TGSI_QUAD_SIZE];
+   unsigned c, j;
+
+   if (!sp_sview->quad_2d || !sp_samp->quad_2d ||
+       filt_args->control == TGSI_SAMPLER_GATHER ||
+       filt_args->offset[0] || filt_args->offset[1] ||
+       (sp_samp->quad_repeat && !sp_sview->pot2d))
+      return FALSE;
+
+   /* false for NaN too */
+   if (_mm_movemask_ps(_mm_and_ps(
+          _mm_cmplt_ps(_mm_andnot_ps(sign, _mm_loadu_ps(s)), max_coord),
+          _mm_cmplt_ps(_mm_andnot_ps(sign, _mm_loadu_ps(t)), max_coord))) != 0xf)
+      return FALSE;
+
+   if (sp_samp->base.min_mip_filter == PIPE_TEX_MIPFILTER_NONE) {
+      quad_filter_2d(sp_sview, sp_samp, first_level, s, t, out);
+   }
+   else {
+      compute_lambda_lod(sp_sview, sp_samp, s, t, p, lod_in,
+                         filt_args->control, lod);
+
+      /* Pick the levels as the mip filter functions would, the quad can
+       * only be done at once if they are the same for all pixels.
+       */
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         if (sp_samp->base.min_mip_filter == PIPE_TEX_MIPFILTER_NEAREST) {
+            blend[j] = FALSE;
+            if (lod[j] < 0.0)
+               level[j] = first_level;
+            else
+               level[j] = MIN2(first_level + (int)(lod[j] + 0.5F), last_level);
+         }
+         else if (sp_sview->pot2d & sp_samp->min_mag_equal_repeat_linear) {
+            /* as mip_filter_linear_2d_linear_repeat_POT() */
+            level[j] = first_level + (int)lod[j];
+            blend[j] = (unsigned)level[j] < (unsigned)last_level;
+            if (!blend[j])
+               level[j] = level[j] < 0 ? first_level : last_level;
+         }
+         else {
+            /* as mip_filter_linear() */
+            level[j] = first_level + (int)lod[j];
+            blend[j] = FALSE;
+            if (lod[j] < 0.0)
+               level[j] = first_level;
+            else if (level[j] >= last_level)
+               level[j] = last_level;
+            else
+               blend[j] = TRUE;
+         }
+
+         if (level[j] != level[0] || blend[j] != blend[0])
+            return FALSE;
+      }
+
+      quad_filter_2d(sp_sview, sp_samp, level[0], s, t, out);
+
+      if (blend[0]) {
+         __m128 out1[TGSI_NUM_CHANNELS];
+         __m128 level_blend;
+
+         for (j = 0; j < TGSI_QUAD_SIZE; j++)
+            lod[j] = frac(lod[j]);
+         level_blend = _mm_loadu_ps(lod);
+
+         quad_filter_2d(sp_sview, sp_samp, level[0] + 1, s, t, out1);
+         for (c = 0; c < TGSI_NUM_CHANNELS; c++)
+            out[c] = quad_lerp(level_blend, out[c], out1[c]);
+      }
+   }
+
+   for (c = 0; c < TGSI_NUM_CHANNELS; c++)
+      _mm_storeu_ps(rgba[c], out[c]);
+
+   return TRUE;
+}
+
+#else /* !PIPE_ARCH_SSE */
+
+static inline boolean
+sample_quad_2d(const struct sp_sampler_view *sp_sview,
+               const struct sp_sampler *sp_samp,
+               const float s[TGSI_QUAD_SIZE],
+               const float t[TGSI_QUAD_SIZE],
+               const float p[TGSI_QUAD_SIZE],
+               const float lod_in[TGSI_QUAD_SIZE],
+               const struct filter_args *filt_args,
+               float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])
+{
+   return FALSE;
+}
+
+#endif /* !PIPE_ARCH_SSE */
+
+
 static void
 sample_mip(const struct sp_sampler_view *sp_sview,
            const struct sp_sampler *sp_samp,
@@ -3055,11 +3464,13 @@ sample_mip(const struct sp_sampler_view *sp_sview,
    img_filter_func min_img_filter = NULL;
    img_filter_func mag_img_filter = NULL;
 
-   get_filters(sp_sview, sp_samp, filt_args->control,
-               &funcs, &min_img_filter, &mag_img_filter);
+   if (!sample_quad_2d(sp_sview, sp_samp, s, t, p, lod, filt_args, rgba)) {
+      get_filters(sp_sview, sp_samp, filt_args->control,
+                  &funcs, &min_img_filter, &mag_img_filter);
 
-   funcs->filter(sp_sview, sp_samp, min_img_filter, mag_img_filter,
-                 s, t, p, c0, lod, filt_args, rgba);
+      funcs->filter(sp_sview, sp_samp, min_img_filter, mag_img_filter,
+                    s, t, p, c0, lod, filt_args, rgba);
+   }
 
    if (sp_samp->base.compare_mode != PIPE_TEX_COMPARE_NONE) {
       sample_compare(sp_sview, sp_samp, s, t, p, c0,
@@ -3421,6 +3832,16 @@ softpipe_create_sampler_state(struct pipe_context *pipe,
       samp->min_mag_equal = TRUE;
    }
 
+   samp->quad_2d = samp->min_mag_equal &&
+                   sampler->normalized_coords &&
+                   sampler->max_anisotropy <= 1 &&
+                   (sampler->wrap_s == PIPE_TEX_WRAP_REPEAT ||
+                    sampler->wrap_s == PIPE_TEX_WRAP_CLAMP_TO_EDGE) &&
+                   (sampler->wrap_t == PIPE_TEX_WRAP_REPEAT ||
+                    sampler->wrap_t == PIPE_TEX_WRAP_CLAMP_TO_EDGE);
+   samp->quad_repeat = sampler->wrap_s == PIPE_TEX_WRAP_REPEAT ||
+                       sampler->wrap_t == PIPE_TEX_WRAP_REPEAT;
+
    return (void *)samp;
 }
 
@@ -3510,6 +3931,22 @@ softpipe_create_sampler_view(struct pipe_context *pipe,
 
       sview->xpot = util_logbase2( resource->width0 );
       sview->ypot = util_logbase2( resource->height0 );
+
+      if (spr->data && !spr->dt &&
+          (view->target == PIPE_TEXTURE_2D ||
+           view->target == PIPE_TEXTURE_RECT)) {
+         switch (view->format) {
+         case PIPE_FORMAT_R8G8B8A8_UNORM:
+         case PIPE_FORMAT_R8G8B8X8_UNORM:
+         case PIPE_FORMAT_B8G8R8A8_UNORM:
+         case PIPE_FORMAT_B8G8R8X8_UNORM:
+         case PIPE_FORMAT_R32G32B32A32_FLOAT:
+            sview->quad_2d = TRUE;
+            break;
+         default:
+            break;
+         }
+      }
    }
 
    return (struct pipe_sampler_view *) sview;
@@ -113,6 +113,11 @@ struct sp_sampler_view
    boolean pot2d;
    boolean need_cube_convert;
 
+   /* 2D view of a resource in memory, in a format sample_quad_2d() reads
+    * directly, without going through the tile cache.
+    */
+   boolean quad_2d;
+
    /* these are different per shader type */
    struct softpipe_tex_tile_cache *cache;
    compute_lambda_func compute_lambda;
@@ -131,6 +136,10 @@ struct sp_sampler {
    boolean min_mag_equal;
    unsigned min_img_filter;
 
+   /* For sample_quad_2d: */
+   boolean quad_2d;
+   boolean quad_repeat;
+
    wrap_nearest_func nearest_texcoord_s;
    wrap_nearest_func nearest_texcoord_t;
    wrap_nearest_func nearest_texcoord_p;
@@ -36,6 +36,7 @@
 #include "util/u_format.h"
 #include "util/u_memory.h"
 #include "util/u_tile.h"
+#include "sp_context.h"
 #include "sp_tile_cache.h"
 
 static struct softpipe_cached_tile *
@@ -640,6 +641,21 @@ sp_tile_cache_clear(struct softpipe_tile_cache *tc,
 
    tc->clear_color = *color;
 
+   /* When rasterizing in bands, keep the color as the surface will hold
+    * it, like the quad blend stage does, so that cleared tiles read the
+    * same from the cache and from the surface.
+    */
+   if (softpipe_context(tc->pipe)->bands && tc->surface &&
+       !util_format_is_depth_or_stencil(tc->surface->format) &&
+       !util_format_is_pure_integer(tc->surface->format)) {
+      const struct util_format_description *desc =
+         util_format_description(tc->surface->format);
+      uint8_t packed[16];
+
+      desc->pack_rgba_float(packed, 0, color->f, 0, 1, 1);
+      desc->unpack_rgba_float(tc->clear_color.f, 0, packed, 0, 1, 1);
+   }
+
    tc->clear_val = clearValue;
 
    /* set flags to indicate all the tiles are cleared */
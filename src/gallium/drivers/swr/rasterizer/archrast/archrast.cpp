@@ -73,6 +73,11 @@ namespace ArchRast
         uint32_t rasterTiles = 0;
     };
 
+    struct LoadTileStats
+    {
+        uint64_t elidedLoads = 0;
+    };
+
     struct CullStats
     {
         uint32_t degeneratePrimCount = 0;
@@ -332,6 +337,9 @@ namespace ArchRast
             // Rasterized Subspans
             EventHandlerFile::Handle(RasterTiles(drawId, rastStats.rasterTiles));
 
+            // Hottile loads skipped for fully overwritten tiles
+            EventHandlerFile::Handle(ElidedTileLoads(drawId, mLoadTileStats.elidedLoads));
+
             // Alpha Subspans
             EventHandlerFile::Handle(AlphaEvent(drawId, mAlphaStats.alphaTestCount, mAlphaStats.alphaBlendCount));
 
@@ -345,6 +353,7 @@ namespace ArchRast
             mDSNullPS = {};
 
             rastStats = {};
+            mLoadTileStats = {};
             mCullStats = {};
             mAlphaStats = {};
 
@@ -400,6 +409,12 @@ namespace ArchRast
             rastStats.rasterTiles += event.data.rasterTiles;
         }
 
+        virtual void Handle(const ElidedTileLoadCount& event)
+        {
+            mLoadTileStats.elidedLoads += event.data.elidedLoads;
+            mNeedFlush = true;
+        }
+
         virtual void Handle(const CullInfoEvent& event)
         {
             mCullStats.degeneratePrimCount += _mm_popcnt_u32(event.data.validMask ^ (event.data.validMask & ~event.data.degeneratePrimMask));
@@ -425,6 +440,7 @@ namespace ArchRast
         TEStats mTS = {};
         GSStateInfo mGS = {};
         RastStats rastStats = {};
+        LoadTileStats mLoadTileStats = {};
         CullStats mCullStats = {};
         AlphaStats mAlphaStats = {};
 
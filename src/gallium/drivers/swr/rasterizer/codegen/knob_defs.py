@@ -62,6 +62,24 @@ KNOBS = [
         'category'  : 'perf_adv',
     }],
 
+    ['ELIDE_TILE_LOADS', {
+        'type'      : 'bool',
+        'default'   : 'true',
+        'desc'      : ['Skip the surface load of invalid hottiles that are fully overwritten',
+                       'by an opaque primitive during the draw that first touches them'],
+        'category'  : 'perf_adv',
+    }],
+
+    ['STORE_TILE_STREAM_MIN_KB', {
+        'type'      : 'uint32_t',
+        'default'   : '4096',
+        'desc'      : ['Store hottiles to linear 64 and 128bpp surface LODs of at least this',
+                       'many KB with non-temporal stores.  Smaller surfaces and tiled ones',
+                       'use regular stores.',
+                       '  0 == Always stream to linear 64 and 128bpp surfaces'],
+        'category'  : 'perf_adv',
+    }],
+
     ['MAX_NUMA_NODES', {
         'type'      : 'uint32_t',
         'default'   : '1' if sys.platform == 'win32' else '0',
@@ -147,8 +165,9 @@ KNOBS = [
     ['WORKER_SPIN_LOOP_COUNT', {
         'type'      : 'uint32_t',
         'default'   : '5000',
-        'desc'      : ['Number of spin-loop iterations worker threads will perform',
-                       'before going to sleep when waiting for work'],
+        'desc'      : ['Maximum number of spin-loop iterations worker threads will perform',
+                       'before going to sleep when waiting for work. Each worker adapts',
+                       'its spin count below this limit based on how its waits end.'],
         'category'  : 'perf_adv',
     }],
 
@@ -156,10 +175,33 @@ KNOBS = [
         'type'      : 'uint32_t',
         'default'   : '256',
         'desc'      : ['Maximum number of draws outstanding before API thread blocks.',
+                       'The draw ring is allocated at this size, but only grows from',
+                       'MIN_DRAWS_IN_FLIGHT up to it on demand.',
                        'This value MUST be evenly divisible into 2^32'],
         'category'  : 'perf_adv',
     }],
 
+    ['MIN_DRAWS_IN_FLIGHT', {
+        'type'      : 'uint32_t',
+        'default'   : '32',
+        'desc'      : ['Initial number of draws outstanding before API thread blocks.',
+                       'The limit doubles, up to MAX_DRAWS_IN_FLIGHT, when the workers run',
+                       'out of draws after the API thread repeatedly had to wait for them,',
+                       'and halves again once the ring stays mostly empty.',
+                       'Set to MAX_DRAWS_IN_FLIGHT for a fixed limit.'],
+        'category'  : 'perf_adv',
+    }],
+
+    ['ARENA_CACHE_BUDGET_MB', {
+        'type'      : 'uint32_t',
+        'default'   : '128',
+        'desc'      : ['Budget in MB for freed arena blocks cached by all contexts in the',
+                       'process.  Over budget, aged blocks are released at the next draw',
+                       'ring cycle instead of waiting for the regular cleanup interval.',
+                       '  0 == No global budget'],
+        'category'  : 'perf_adv',
+    }],
+
     ['MAX_PRIMS_PER_DRAW', {
         'type'      : 'uint32_t',
         'default'   : '49152',
@@ -245,6 +245,26 @@ void AlignedFree(void* p)
 #define PRAGMA_WARNING_POP()
 
 #define ZeroMemory(dst, size) memset(dst, 0, size)
+
+#if defined(__linux__) || defined(__gnu_linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#define SWR_HAS_FUTEX 1
+
+// Sleep until *addr no longer holds 'value' or a FutexWake arrives.
+static INLINE
+int FutexWait(volatile uint32_t* addr, uint32_t value)
+{
+    return syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+static INLINE
+int FutexWake(volatile uint32_t* addr, uint32_t count)
+{
+    return syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+#endif
 #else
 
 #error Unsupported OS/system.
@@ -47,6 +47,9 @@
 
 static const SWR_RECT g_MaxScissorRect = { 0, 0, KNOB_MAX_SCISSOR_X, KNOB_MAX_SCISSOR_Y };
 
+// Full draw ring waits, since the ring last ran empty, before it may grow.
+static const uint32_t g_DrawRingGrowWaits = 8;
+
 void SetupDefaultState(SWR_CONTEXT *pContext);
 
 static INLINE SWR_CONTEXT* GetContext(HANDLE hContext)
@@ -56,7 +59,19 @@ static INLINE SWR_CONTEXT* GetContext(HANDLE hContext)
 
 void WakeAllThreads(SWR_CONTEXT *pContext)
 {
+#if defined(SWR_HAS_FUTEX)
+    // Every worker has to step past each draw before it can retire, so all parked
+    // workers are woken. The sequence bump is a full barrier, ordering the dcRing
+    // enqueue before the parked count read; workers that are still spinning need
+    // no syscall at all.
+    InterlockedIncrement(&pContext->workerWakeSeq);
+    if (pContext->numParkedWorkers)
+    {
+        FutexWake(&pContext->workerWakeSeq, INT_MAX);
+    }
+#else
     pContext->FifosNotEmpty.notify_all();
+#endif
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -83,6 +98,15 @@ HANDLE SwrCreateContext(
     pContext->dcRing.Init(pContext->MAX_DRAWS_IN_FLIGHT);
     pContext->dsRing.Init(pContext->MAX_DRAWS_IN_FLIGHT);
 
+    // Start with a small window of draws in flight and let GetDrawContext
+    // grow it when the API thread gets ahead of the workers.
+    pContext->MIN_DRAWS_IN_FLIGHT =
+        std::max(1U, std::min<uint32_t>(KNOB_MIN_DRAWS_IN_FLIGHT, pContext->MAX_DRAWS_IN_FLIGHT));
+    pContext->dcRing.SetActiveEntries(pContext->MIN_DRAWS_IN_FLIGHT);
+    pContext->dcRingStats.maxDrawsInFlight = pContext->MAX_DRAWS_IN_FLIGHT;
+
+    CachingAllocator::SetGlobalBudget(size_t(KNOB_ARENA_CACHE_BUDGET_MB) * sizeof(MEGABYTE));
+
     pContext->pMacroTileManagerArray = (MacroTileMgr*)AlignedMalloc(sizeof(MacroTileMgr) * pContext->MAX_DRAWS_IN_FLIGHT, 64);
     pContext->pDispatchQueueArray = (DispatchQueue*)AlignedMalloc(sizeof(DispatchQueue) * pContext->MAX_DRAWS_IN_FLIGHT, 64);
 
@@ -131,6 +155,8 @@ HANDLE SwrCreateContext(
     memset(&pContext->FifosNotEmpty, 0, sizeof(pContext->FifosNotEmpty));
     new (&pContext->WaitLock) std::mutex();
     new (&pContext->FifosNotEmpty) std::condition_variable();
+    pContext->workerWakeSeq = 0;
+    pContext->numParkedWorkers = 0;
 
     CreateThreadPool(pContext, &pContext->threadPool);
 
@@ -231,7 +257,9 @@ void QueueWork(SWR_CONTEXT *pContext)
 
     _ReadWriteBarrier();
     {
+#if !defined(SWR_HAS_FUTEX)
         std::unique_lock<std::mutex> lock(pContext->WaitLock);
+#endif
         pContext->dcRing.Enqueue();
     }
 
@@ -288,20 +316,63 @@ DRAW_CONTEXT* GetDrawContext(SWR_CONTEXT *pContext, bool isSplitDraw = false)
     if (pContext->pCurDrawContext == nullptr)
     {
         // Need to wait for a free entry.
-        while (pContext->dcRing.IsFull())
+        if (pContext->dcRing.IsFull())
+        {
+            uint64_t stallStart = __rdtsc();
+            while (pContext->dcRing.IsFull())
+            {
+                _mm_pause();
+            }
+            uint64_t stallCycles = __rdtsc() - stallStart;
+
+            pContext->dcRingStats.ringFullStalls++;
+            pContext->dcRingStats.stallCycles += stallCycles;
+            pContext->dcRingFullWaits++;
+
+            AR_API_EVENT(DrawRingFullEvent(pContext->dcRing.GetHead(),
+                pContext->dcRing.GetActiveEntries(), stallCycles));
+        }
+        else if (pContext->dcRing.IsEmpty())
         {
-            _mm_pause();
+            // The workers ran out of draws after holding the API thread back
+            // several times in a row. A longer queue would have let them keep
+            // going while the API thread did other work, so allow more draws
+            // in flight. Waits alone don't grow it: when the workers are the
+            // bottleneck, a longer queue only adds latency and memory.
+            uint32_t activeEntries = pContext->dcRing.GetActiveEntries();
+            if (pContext->dcRingFullWaits >= g_DrawRingGrowWaits &&
+                activeEntries < pContext->MAX_DRAWS_IN_FLIGHT)
+            {
+                pContext->dcRing.SetActiveEntries(
+                    std::min(activeEntries * 2, pContext->MAX_DRAWS_IN_FLIGHT));
+            }
+            pContext->dcRingFullWaits = 0;
         }
 
         uint64_t curDraw = pContext->dcRing.GetHead();
         uint32_t dcIndex = curDraw % pContext->MAX_DRAWS_IN_FLIGHT;
 
+        pContext->dcRingPeakEnqueued =
+            std::max(pContext->dcRingPeakEnqueued, pContext->dcRing.GetNumEnqueued() + 1);
+
         if ((pContext->frameCount - pContext->lastFrameChecked) > 2 ||
-            (curDraw - pContext->lastDrawChecked) > 0x10000)
+            (curDraw - pContext->lastDrawChecked) > 0x10000 ||
+            (CachingAllocator::IsOverBudget() &&
+             (curDraw - pContext->lastDrawChecked) > pContext->MAX_DRAWS_IN_FLIGHT))
         {
             // Take this opportunity to clean-up old arena allocations
             pContext->cachingArenaAllocator.FreeOldBlocks();
 
+            // Shrink the draw window again if demand dropped off since the
+            // last check. Fewer draws in flight keep fewer arena blocks live.
+            uint32_t activeEntries = pContext->dcRing.GetActiveEntries();
+            if (pContext->dcRingPeakEnqueued <= activeEntries / 4 &&
+                activeEntries / 2 >= pContext->MIN_DRAWS_IN_FLIGHT)
+            {
+                pContext->dcRing.SetActiveEntries(activeEntries / 2);
+            }
+            pContext->dcRingPeakEnqueued = 0;
+
             pContext->lastFrameChecked = pContext->frameCount;
             pContext->lastDrawChecked = curDraw;
         }
@@ -1033,6 +1104,50 @@ void SetupPipeline(DRAW_CONTEXT *pDC)
 
     pState->state.colorHottileEnable = hotTileEnable;
 
+    // Determine which attachments are unconditionally replaced wherever the draw has coverage.
+    // The binner uses this to flag macrotiles that a single primitive covers completely, which
+    // lets the backend skip loading those hottiles from the surface.
+    uint32_t overwriteMask = 0;
+    const SWR_DEPTH_STENCIL_STATE& dsState = pState->state.depthStencilState;
+    const uint32_t fullSampleMask = (1 << GetNumSamples(pState->state.rastState.sampleCount)) - 1;
+
+    if (KNOB_ELIDE_TILE_LOADS &&
+        (pState->state.rastState.fillMode == SWR_FILLMODE_SOLID) &&
+        (pState->state.rastState.conservativeRast == 0) &&
+        (pState->state.psState.killsPixel == 0) &&
+        (pState->state.backendState.clipDistanceMask == 0) &&
+        (pState->state.backendState.readRenderTargetArrayIndex == false) &&
+        (pState->state.depthBoundsState.depthBoundsTestEnable == false) &&
+        (dsState.stencilTestEnable == false) &&
+        (dsState.depthTestEnable == false || dsState.depthTestFunc == ZFUNC_ALWAYS) &&
+        ((pState->state.blendState.sampleMask & fullSampleMask) == fullSampleMask))
+    {
+        if (psState.pfnPixelShader != nullptr)
+        {
+            DWORD rt;
+            uint32_t rtMask = hotTileEnable;
+            while (_BitScanForward(&rt, rtMask))
+            {
+                rtMask &= ~(1 << rt);
+
+                const SWR_RENDER_TARGET_BLEND_STATE& rtBlend = pState->state.blendState.renderTarget[rt];
+                if ((pState->state.pfnBlendFunc[rt] == nullptr) &&
+                    !rtBlend.writeDisableRed && !rtBlend.writeDisableGreen &&
+                    !rtBlend.writeDisableBlue && !rtBlend.writeDisableAlpha)
+                {
+                    overwriteMask |= (1 << (SWR_ATTACHMENT_COLOR0 + rt));
+                }
+            }
+        }
+
+        if (pState->state.depthHottileEnable && dsState.depthTestEnable && dsState.depthWriteEnable)
+        {
+            overwriteMask |= SWR_ATTACHMENT_DEPTH_BIT;
+        }
+    }
+
+    pState->state.overwriteHottileMask = overwriteMask;
+
 
     // Setup depth quantization function
     if (pState->state.depthHottileEnable)
@@ -1689,6 +1804,20 @@ void SwrEnableStatsBE(
     pDC->pState->state.enableStatsBE = enable;
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Returns draw ring stall counters for the context
+/// @param hContext - Handle passed back from SwrCreateContext
+/// @param pStats - Receives the counters
+void SWR_API SwrGetDrawRingStats(
+    HANDLE hContext,
+    SWR_DRAW_RING_STATS* pStats)
+{
+    SWR_CONTEXT *pContext = GetContext(hContext);
+
+    *pStats = pContext->dcRingStats;
+    pStats->activeDrawsInFlight = pContext->dcRing.GetActiveEntries();
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// @brief Mark end of frame - used for performance profiling
 /// @param hContext - Handle passed back from SwrCreateContext
@@ -1772,6 +1901,7 @@ void SwrGetInterface(SWR_INTERFACE &out_funcs)
     out_funcs.pfnSwrAllocDrawContextMemory = SwrAllocDrawContextMemory;
     out_funcs.pfnSwrEnableStatsFE = SwrEnableStatsFE;
     out_funcs.pfnSwrEnableStatsBE = SwrEnableStatsBE;
+    out_funcs.pfnSwrGetDrawRingStats = SwrGetDrawRingStats;
     out_funcs.pfnSwrEndFrame = SwrEndFrame;
     out_funcs.pfnSwrInit = SwrInit;
     out_funcs.pfnSwrLoadHotTile = SwrLoadHotTile;
@@ -715,6 +715,26 @@ SWR_FUNC(void, SwrEnableStatsBE,
     HANDLE hContext,
     bool enable);
 
+//////////////////////////////////////////////////////////////////////////
+/// SWR_DRAW_RING_STATS
+/// @brief Counters for the API thread waiting on the draw context ring.
+/////////////////////////////////////////////////////////////////////////
+struct SWR_DRAW_RING_STATS
+{
+    uint64_t ringFullStalls;        // Times a new draw had to wait for a free entry
+    uint64_t stallCycles;           // rdtsc cycles spent waiting for a free entry
+    uint32_t activeDrawsInFlight;   // Current limit on outstanding draws
+    uint32_t maxDrawsInFlight;      // Ring capacity
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Returns draw ring stall counters for the context
+/// @param hContext - Handle passed back from SwrCreateContext
+/// @param pStats - Receives the counters
+SWR_FUNC(void, SwrGetDrawRingStats,
+    HANDLE hContext,
+    SWR_DRAW_RING_STATS* pStats);
+
 //////////////////////////////////////////////////////////////////////////
 /// @brief Mark end of frame - used for performance profiling
 /// @param hContext - Handle passed back from SwrCreateContext
@@ -818,6 +838,7 @@ struct SWR_INTERFACE
     PFNSwrAllocDrawContextMemory pfnSwrAllocDrawContextMemory;
     PFNSwrEnableStatsFE pfnSwrEnableStatsFE;
     PFNSwrEnableStatsBE pfnSwrEnableStatsBE;
+    PFNSwrGetDrawRingStats pfnSwrGetDrawRingStats;
     PFNSwrEndFrame pfnSwrEndFrame;
     PFNSwrInit pfnSwrInit;
     PFNSwrLoadHotTile pfnSwrLoadHotTile;
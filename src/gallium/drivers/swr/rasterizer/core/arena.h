@@ -114,6 +114,7 @@ struct CachingAllocatorT : DefaultAllocator
                 SWR_ASSUME_ASSERT(pPrevBlock && pPrevBlock->pNext == pBlock);
                 pPrevBlock->pNext = pBlock->pNext;
                 pBlock->pNext = nullptr;
+                s_globalCachedSize -= pBlock->blockSize;
 
                 return pBlock;
             }
@@ -150,10 +151,10 @@ struct CachingAllocatorT : DefaultAllocator
 
     void FreeOldBlocks()
     {
-        if (!m_cachedSize) { return; }
+        if (!m_cachedSize && !(m_oldCachedSize && IsOverBudget())) { return; }
         std::lock_guard<std::mutex> l(m_mutex);
 
-        bool doFree = (m_oldCachedSize > MAX_UNUSED_SIZE);
+        bool doFree = (m_oldCachedSize > MAX_UNUSED_SIZE) || IsOverBudget();
 
         for (uint32_t i = 0; i < CACHE_NUM_BUCKETS; ++i)
         {
@@ -165,6 +166,7 @@ struct CachingAllocatorT : DefaultAllocator
                     ArenaBlock* pNext = pBlock->pNext;
                     m_oldCachedSize -= pBlock->blockSize;
                     m_totalAllocated -= pBlock->blockSize;
+                    s_globalCachedSize -= pBlock->blockSize;
                     this->DefaultAllocator::Free(pBlock);
                     pBlock = pNext;
                 }
@@ -222,6 +224,8 @@ struct CachingAllocatorT : DefaultAllocator
 
     ~CachingAllocatorT()
     {
+        s_globalCachedSize -= m_cachedSize + m_oldCachedSize;
+
         // Free all cached blocks
         for (uint32_t i = 0; i < CACHE_NUM_BUCKETS; ++i)
         {
@@ -242,6 +246,17 @@ struct CachingAllocatorT : DefaultAllocator
         }
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Sets the byte budget for blocks cached by all allocators in
+    ///        the process. 0 disables the budget.
+    static void SetGlobalBudget(size_t budget) { s_globalBudget = budget; }
+
+    static bool IsOverBudget()
+    {
+        size_t budget = s_globalBudget;
+        return budget && s_globalCachedSize > budget;
+    }
+
 private:
     static uint32_t GetBucketId(size_t blockSize)
     {
@@ -296,6 +311,7 @@ private:
             }
 
             m_cachedSize += pNewBlock->blockSize;
+            s_globalCachedSize += pNewBlock->blockSize;
         }
     }
 
@@ -361,7 +377,17 @@ private:
 
     size_t                  m_cachedSize = 0;
     size_t                  m_oldCachedSize = 0;
+
+    // Cached bytes across every allocator, checked against s_globalBudget
+    static std::atomic<size_t> s_globalCachedSize;
+    static std::atomic<size_t> s_globalBudget;
 };
+
+template<uint32_t NumBucketsT, uint32_t StartBucketBitT>
+std::atomic<size_t> CachingAllocatorT<NumBucketsT, StartBucketBitT>::s_globalCachedSize(0);
+template<uint32_t NumBucketsT, uint32_t StartBucketBitT>
+std::atomic<size_t> CachingAllocatorT<NumBucketsT, StartBucketBitT>::s_globalBudget(0);
+
 typedef CachingAllocatorT<> CachingAllocator;
 
 template<typename T = DefaultAllocator, size_t BlockSizeT = 128 * sizeof(KILOBYTE)>
@@ -324,6 +324,61 @@ struct EarlyRastHelper<SIMD512>
 };
 
 #endif
+//////////////////////////////////////////////////////////////////////////
+/// @brief Returns true if the triangle covers every sample of the given
+///        macrotile and the macrotile lies completely inside the scissor.
+///        The four tile corners are tested against the edge equations, so
+///        any sample strictly inside the tile is strictly inside the triangle
+///        and the fill rules never come into play.
+/// @param aXi - x.8 fixed point X coordinates of triangle vertices
+/// @param aYi - x.8 fixed point Y coordinates of triangle vertices
+/// @param scissor - inclusive fixed point scissor rect for the triangle
+/// @param tileX, tileY - macrotile indices
+INLINE bool TriangleCoversMacroTile(
+    const int32_t (&aXi)[3],
+    const int32_t (&aYi)[3],
+    const SWR_RECT &scissor,
+    uint32_t tileX,
+    uint32_t tileY)
+{
+    const int64_t xmin = int64_t(tileX) * KNOB_MACROTILE_X_DIM_FIXED;
+    const int64_t ymin = int64_t(tileY) * KNOB_MACROTILE_Y_DIM_FIXED;
+    const int64_t xmax = xmin + KNOB_MACROTILE_X_DIM_FIXED;
+    const int64_t ymax = ymin + KNOB_MACROTILE_Y_DIM_FIXED;
+
+    if ((xmin < scissor.xmin) || (ymin < scissor.ymin) ||
+        ((xmax - 1) > scissor.xmax) || ((ymax - 1) > scissor.ymax))
+    {
+        return false;
+    }
+
+    const int64_t cornerX[4] = { xmin, xmax, xmin, xmax };
+    const int64_t cornerY[4] = { ymin, ymin, ymax, ymax };
+
+    // sign of the edge equations on the inside of the triangle
+    const int64_t det = int64_t(aYi[0] - aYi[1]) * aXi[2] + int64_t(aXi[1] - aXi[0]) * aYi[2] +
+                        int64_t(aXi[0]) * aYi[1] - int64_t(aXi[1]) * aYi[0];
+
+    for (uint32_t e = 0; e < 3; ++e)
+    {
+        const uint32_t e1 = (e + 1) % 3;
+        const int64_t a = int64_t(aYi[e]) - aYi[e1];
+        const int64_t b = int64_t(aXi[e1]) - aXi[e];
+        const int64_t c = int64_t(aXi[e]) * aYi[e1] - int64_t(aXi[e1]) * aYi[e];
+
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            const int64_t edge = a * cornerX[i] + b * cornerY[i] + c;
+            if ((det > 0) ? (edge < 0) : (edge > 0))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// @brief Early Rasterizer (ER); triangles that fit small (e.g. 4x4) tile
 ///        (ER tile) can be rasterized as early as in binner to check if
@@ -1038,6 +1093,19 @@ endBinTriangles:
     TransposeVertices(vHorizZ, tri[0].z, tri[1].z, tri[2].z);
     TransposeVertices(vHorizW, vRecipW0, vRecipW1, vRecipW2);
 
+    // fixed point verts are needed to find macrotiles fully covered by a triangle
+    const uint32_t overwriteMask = CT::IsConservativeT::value ? 0 : state.overwriteHottileMask;
+    OSALIGNSIMD16(int32_t) aXi[3][SIMD_WIDTH], aYi[3][SIMD_WIDTH];
+
+    if (overwriteMask)
+    {
+        for (uint32_t v = 0; v < 3; ++v)
+        {
+            SIMD_T::store_si(reinterpret_cast<Integer<SIMD_T> *>(aXi[v]), vXi[v]);
+            SIMD_T::store_si(reinterpret_cast<Integer<SIMD_T> *>(aYi[v]), vYi[v]);
+        }
+    }
+
     // scan remaining valid triangles and bin each separately
     while (_BitScanForward(&triIndex, triMask))
     {
@@ -1099,6 +1167,18 @@ endBinTriangles:
             ProcessUserClipDist<3>(state.backendState, pa, triIndex, &desc.pTriBuffer[12], desc.pUserClipBuffer);
         }
 
+        int32_t triXi[3], triYi[3];
+        if (overwriteMask)
+        {
+            for (uint32_t v = 0; v < 3; ++v)
+            {
+                triXi[v] = aXi[v][triIndex];
+                triYi[v] = aYi[v][triIndex];
+            }
+        }
+
+        const SWR_RECT &scissor = state.scissorsInFixedPoint[pa.viewportArrayActive ? pViewportIndex[triIndex] : 0];
+
         for (uint32_t y = aMTTop[triIndex]; y <= aMTBottom[triIndex]; ++y)
         {
             for (uint32_t x = aMTLeft[triIndex]; x <= aMTRight[triIndex]; ++x)
@@ -1108,6 +1188,11 @@ endBinTriangles:
 #endif
                 {
                     pTileMgr->enqueue(x, y, &work);
+
+                    if (overwriteMask && TriangleCoversMacroTile(triXi, triYi, scissor, x, y))
+                    {
+                        pTileMgr->markTileOverwritten(x, y, overwriteMask);
+                    }
                 }
             }
         }
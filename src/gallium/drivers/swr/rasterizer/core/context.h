@@ -305,6 +305,7 @@ OSALIGNLINE(struct) API_STATE
         uint32_t colorHottileEnable : 8;        // Bitmask of enabled color hottiles
         uint32_t depthHottileEnable: 1;         // Enable depth buffer hottile
         uint32_t stencilHottileEnable : 1;      // Enable stencil buffer hottile
+        uint32_t overwriteHottileMask : 9;      // Bitmask of attachments fully replaced by covering prims
     };
 
     PFN_QUANTIZE_DEPTH      pfnQuantizeDepth;
@@ -486,10 +487,21 @@ struct SWR_CONTEXT
     SWR_WORKER_PRIVATE_STATE workerPrivateState;
 
     uint32_t MAX_DRAWS_IN_FLIGHT;
+    uint32_t MIN_DRAWS_IN_FLIGHT;
+
+    // Draw ring occupancy, used to size dcRing's active limit (API thread only).
+    uint32_t dcRingPeakEnqueued;
+    uint32_t dcRingFullWaits;       // waits for a free entry since the ring was last empty
+    SWR_DRAW_RING_STATS dcRingStats;
 
     std::condition_variable FifosNotEmpty;
     std::mutex WaitLock;
 
+    // Idle worker parking (futex path). workerWakeSeq is bumped on every enqueue;
+    // numParkedWorkers lets the API thread skip the wake syscall when nobody sleeps.
+    volatile OSALIGNLINE(uint32_t)  workerWakeSeq;
+    volatile OSALIGNLINE(uint32_t)  numParkedWorkers;
+
     uint32_t privateStateSize;
 
     HotTileMgr *pHotTileMgr;
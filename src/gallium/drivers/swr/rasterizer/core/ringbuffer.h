@@ -34,7 +34,7 @@ class RingBuffer
 {
 public:
     RingBuffer()
-        : mpRingBuffer(nullptr), mNumEntries(0), mRingHead(0), mRingTail(0)
+        : mpRingBuffer(nullptr), mNumEntries(0), mActiveEntries(0), mRingHead(0), mRingTail(0)
     {
     }
 
@@ -48,6 +48,7 @@ public:
         SWR_ASSERT(numEntries > 0);
         SWR_ASSERT(((1ULL << 32) % numEntries) == 0, "%d is not evenly divisible into 2 ^ 32.  Wrap errors will occur!", numEntries);
         mNumEntries = numEntries;
+        mActiveEntries = numEntries;
         mpRingBuffer = (T*)AlignedMalloc(sizeof(T)*numEntries, 64);
         SWR_ASSERT(mpRingBuffer != nullptr);
         memset(mpRingBuffer, 0, sizeof(T)*numEntries);
@@ -84,18 +85,31 @@ public:
 
     INLINE bool IsFull()
     {
-        uint32_t numEnqueued = GetHead() - GetTail();
+        uint32_t numEnqueued = GetNumEnqueued();
         SWR_ASSERT(numEnqueued <= mNumEntries);
 
-        return (numEnqueued == mNumEntries);
+        return (numEnqueued >= mActiveEntries);
     }
 
+    INLINE uint32_t GetNumEnqueued() { return GetHead() - GetTail(); }
+
+    // Limit the number of entries in use without changing the storage
+    // or the index -> entry mapping. Only called by the producer.
+    INLINE void SetActiveEntries(uint32_t numEntries)
+    {
+        SWR_ASSERT(numEntries > 0 && numEntries <= mNumEntries);
+        mActiveEntries = numEntries;
+    }
+
+    INLINE uint32_t GetActiveEntries() const { return mActiveEntries; }
+
     INLINE uint32_t GetTail() volatile { return mRingTail; }
     INLINE uint32_t GetHead() volatile { return mRingHead; }
 
 protected:
     T* mpRingBuffer;
     uint32_t mNumEntries;
+    uint32_t mActiveEntries;
 
     OSALIGNLINE(volatile uint32_t) mRingHead;  // Consumer Counter
     OSALIGNLINE(volatile uint32_t) mRingTail;  // Producer Counter
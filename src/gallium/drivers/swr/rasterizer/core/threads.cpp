@@ -605,7 +605,7 @@ bool WorkOnFifoBE(
                 SWR_ASSERT(pWork);
                 if (pWork->type == DRAW)
                 {
-                    pContext->pHotTileMgr->InitializeHotTiles(pContext, pDC, workerId, tileID);
+                    pContext->pHotTileMgr->InitializeHotTiles(pContext, pDC, workerId, tileID, tile->mOverwriteMask);
                 }
                 else if (pWork->type == SHUTDOWN)
                 {
@@ -865,7 +865,9 @@ DWORD workerThreadMain(LPVOID pData)
     //    any work left by comparing the total # of binned work items and the total # of completed
     //    work items. If they are equal, then there is no more work to do for this draw, and
     //    the worker can safely increment its oldestDraw counter and move on to the next draw.
+#if !defined(SWR_HAS_FUTEX)
     std::unique_lock<std::mutex> lock(pContext->WaitLock, std::defer_lock);
+#endif
 
     auto threadHasWork = [&](uint32_t curDraw) { return curDraw != pContext->dcRing.GetHead(); };
 
@@ -874,6 +876,13 @@ DWORD workerThreadMain(LPVOID pData)
 
     bool bShutdown = false;
 
+    // The spin budget adapts to how this worker's idle periods actually end: spins that
+    // run out and park shrink it so idle workers stop burning cycles, spins that see new
+    // work arrive grow it back toward KNOB_WORKER_SPIN_LOOP_COUNT.
+    const uint32_t maxSpinCount = KNOB_WORKER_SPIN_LOOP_COUNT;
+    const uint32_t minSpinCount = std::min<uint32_t>(maxSpinCount, 64);
+    uint32_t spinCount = maxSpinCount;
+
     while (true)
     {
         if (bShutdown && !threadHasWork(curDrawBE))
@@ -882,13 +891,28 @@ DWORD workerThreadMain(LPVOID pData)
         }
 
         uint32_t loop = 0;
-        while (loop++ < KNOB_WORKER_SPIN_LOOP_COUNT && !threadHasWork(curDrawBE))
+        while (loop < spinCount && !threadHasWork(curDrawBE))
         {
             _mm_pause();
+            loop++;
         }
 
         if (!threadHasWork(curDrawBE))
         {
+            spinCount = std::max(spinCount / 2, minSpinCount);
+
+#if defined(SWR_HAS_FUTEX)
+            // Sample the wake sequence before announcing ourselves parked and re-checking
+            // for work. Any enqueue after the sample bumps the sequence, so FutexWait
+            // returns immediately instead of missing the wakeup.
+            uint32_t wakeSeq = pContext->workerWakeSeq;
+            InterlockedIncrement(&pContext->numParkedWorkers);
+            if (!threadHasWork(curDrawBE))
+            {
+                FutexWait(&pContext->workerWakeSeq, wakeSeq);
+            }
+            InterlockedDecrement(&pContext->numParkedWorkers);
+#else
             lock.lock();
 
             // check for thread idle condition again under lock
@@ -900,6 +924,11 @@ DWORD workerThreadMain(LPVOID pData)
 
             pContext->FifosNotEmpty.wait(lock);
             lock.unlock();
+#endif
+        }
+        else if (loop > 0)
+        {
+            spinCount = std::min(spinCount * 2, maxSpinCount);
         }
 
         if (IsBEThread)
@@ -59,6 +59,7 @@ void MacroTileMgr::enqueue(uint32_t x, uint32_t y, BE_WORK *pWork)
     if (tile.mWorkItemsFE == 1)
     {
         tile.clear(mArena);
+        tile.mOverwriteMask = 0;
         mDirtyTiles.push_back(&tile);
     }
 
@@ -66,6 +67,23 @@ void MacroTileMgr::enqueue(uint32_t x, uint32_t y, BE_WORK *pWork)
     tile.enqueue_try_nosync(mArena, pWork);
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Record that a primitive already enqueued to this tile replaces
+///        every pixel of the given attachments. Only called from the FE
+///        thread that owns the draw, so no synchronization is needed.
+void MacroTileMgr::markTileOverwritten(uint32_t x, uint32_t y, uint32_t attachmentMask)
+{
+    if ((x & ~(KNOB_NUM_HOT_TILES_X-1)) | (y & ~(KNOB_NUM_HOT_TILES_Y-1)))
+    {
+        return;
+    }
+
+    uint32_t id = TILE_ID(x, y);
+
+    SWR_ASSERT(mTiles.find(id) != mTiles.end());
+    mTiles[id].mOverwriteMask |= attachmentMask;
+}
+
 void MacroTileMgr::markTileComplete(uint32_t id)
 {
     SWR_ASSERT(mTiles.find(id) != mTiles.end());
@@ -376,7 +394,9 @@ void HotTileMgr::ClearStencilHotTile(const HOTTILE* pHotTile)
 /// to avoid unnecessary setup every triangle
 /// @todo support deferred clear
 /// @param pCreateInfo - pointer to creation info.
-void HotTileMgr::InitializeHotTiles(SWR_CONTEXT* pContext, DRAW_CONTEXT* pDC, uint32_t workerId, uint32_t macroID)
+/// @param overwriteMask - attachments the draw fully overwrites in this tile.
+///        Invalid hottiles for these skip the load from the surface.
+void HotTileMgr::InitializeHotTiles(SWR_CONTEXT* pContext, DRAW_CONTEXT* pDC, uint32_t workerId, uint32_t macroID, uint32_t overwriteMask)
 {
     const API_STATE& state = GetApiState(pDC);
     HANDLE hWorkerPrivateData = pDC->pContext->threadPool.pThreadData[workerId].pWorkerPrivateData;
@@ -387,6 +407,7 @@ void HotTileMgr::InitializeHotTiles(SWR_CONTEXT* pContext, DRAW_CONTEXT* pDC, ui
     y *= KNOB_MACROTILE_Y_DIM;
 
     uint32_t numSamples = GetNumSamples(state.rastState.sampleCount);
+    uint32_t numElidedLoads = 0;
 
     // check RT if enabled
     unsigned long rtSlot = 0;
@@ -395,7 +416,15 @@ void HotTileMgr::InitializeHotTiles(SWR_CONTEXT* pContext, DRAW_CONTEXT* pDC, ui
     {
         HOTTILE* pHotTile = GetHotTile(pContext, pDC, hWorkerPrivateData, macroID, (SWR_RENDERTARGET_ATTACHMENT)(SWR_ATTACHMENT_COLOR0 + rtSlot), true, numSamples);
 
-        if (pHotTile->state == HOTTILE_INVALID)
+        if (pHotTile->state == HOTTILE_INVALID &&
+            (overwriteMask & (1 << (SWR_ATTACHMENT_COLOR0 + rtSlot))) &&
+            pHotTile->renderTargetArrayIndex == 0)
+        {
+            // every pixel will be replaced by this draw, surface contents are not needed
+            pHotTile->state = HOTTILE_DIRTY;
+            numElidedLoads++;
+        }
+        else if (pHotTile->state == HOTTILE_INVALID)
         {
             RDTSC_BEGIN(BELoadTiles, pDC->drawId);
             // invalid hottile before draw requires a load from surface before we can draw to it
@@ -418,7 +447,15 @@ void HotTileMgr::InitializeHotTiles(SWR_CONTEXT* pContext, DRAW_CONTEXT* pDC, ui
     if (state.depthHottileEnable)
     {
         HOTTILE* pHotTile = GetHotTile(pContext, pDC, hWorkerPrivateData, macroID, SWR_ATTACHMENT_DEPTH, true, numSamples);
-        if (pHotTile->state == HOTTILE_INVALID)
+        if (pHotTile->state == HOTTILE_INVALID &&
+            (overwriteMask & SWR_ATTACHMENT_DEPTH_BIT) &&
+            pHotTile->renderTargetArrayIndex == 0)
+        {
+            // every pixel will be replaced by this draw, surface contents are not needed
+            pHotTile->state = HOTTILE_DIRTY;
+            numElidedLoads++;
+        }
+        else if (pHotTile->state == HOTTILE_INVALID)
         {
             RDTSC_BEGIN(BELoadTiles, pDC->drawId);
             // invalid hottile before draw requires a load from surface before we can draw to it
@@ -457,4 +494,9 @@ void HotTileMgr::InitializeHotTiles(SWR_CONTEXT* pContext, DRAW_CONTEXT* pDC, ui
             RDTSC_END(BELoadTiles, 0);
         }
     }
+
+    if (numElidedLoads)
+    {
+        AR_EVENT(ElidedTileLoadCount(pDC->drawId, numElidedLoads));
+    }
 }
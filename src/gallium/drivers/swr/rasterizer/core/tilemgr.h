@@ -96,6 +96,7 @@ struct MacroTileQueue
     uint32_t mWorkItemsFE = 0;
     uint32_t mWorkItemsBE = 0;
     uint32_t mId = 0;
+    uint32_t mOverwriteMask = 0;    // attachments fully covered by a primitive of the current draw
 
 private:
     QUEUE<BE_WORK> mFifo;
@@ -133,6 +134,7 @@ public:
     }
 
     void enqueue(uint32_t x, uint32_t y, BE_WORK *pWork);
+    void markTileOverwritten(uint32_t x, uint32_t y, uint32_t attachmentMask);
 
     static INLINE void getTileIndices(uint32_t tileID, uint32_t &x, uint32_t &y)
     {
@@ -303,7 +305,7 @@ public:
         }
     }
 
-    void InitializeHotTiles(SWR_CONTEXT* pContext, DRAW_CONTEXT* pDC, uint32_t workerId, uint32_t macroID);
+    void InitializeHotTiles(SWR_CONTEXT* pContext, DRAW_CONTEXT* pDC, uint32_t workerId, uint32_t macroID, uint32_t overwriteMask);
 
     HOTTILE *GetHotTile(SWR_CONTEXT* pContext, DRAW_CONTEXT* pDC, HANDLE hWorkerData, uint32_t macroID, SWR_RENDERTARGET_ATTACHMENT attachment, bool create, uint32_t numSamples = 1,
         uint32_t renderTargetArrayIndex = 0);
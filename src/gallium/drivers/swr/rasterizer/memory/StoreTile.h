@@ -61,6 +61,44 @@ void InitStoreTilesTable_TileY_2();
 void InitStoreTilesTable_TileW();
 void InitStoreTilesTable();
 
+//////////////////////////////////////////////////////////////////////////
+/// StoreColumn
+/// @brief 16B store for the 64 and 128bpp StorePixels specializations,
+///        whose rows always cover whole cache lines, optionally
+///        non-temporal.  StoreMacroTile fences once the whole macrotile
+///        is written.
+/// @param pDst   - 16B aligned destination
+/// @param src    - Pixels to store
+/// @param stream - Bypass the cache
+//////////////////////////////////////////////////////////////////////////
+INLINE void StoreColumn(simd4scalari* pDst, simd4scalari src, bool stream)
+{
+    if (stream)
+    {
+        SIMD128::stream_ps(reinterpret_cast<float*>(pDst), SIMD128::castsi_ps(src));
+    }
+    else
+    {
+        *pDst = src;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// StreamStores
+/// @brief Whether raster tiles are stored to the surface with non-temporal
+///        stores: only linear surfaces are, where consecutive raster tiles
+///        fill whole lines of a row, and only if the LOD is too large to
+///        stay in the cache until it is read again anyway.
+/// @param pDstSurface - Destination surface state
+//////////////////////////////////////////////////////////////////////////
+INLINE bool StreamStores(const SWR_SURFACE_STATE* pDstSurface)
+{
+    uint32_t lodHeight = std::max(pDstSurface->height >> pDstSurface->lod, 1U);
+
+    return (pDstSurface->tileMode == SWR_TILE_NONE) &&
+           ((size_t)pDstSurface->pitch * lodHeight >= (size_t)KNOB_STORE_TILE_STREAM_MIN_KB * 1024);
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// StorePixels
 /// @brief Stores a 4x2 (AVX) raster-tile to two rows.
@@ -73,7 +111,7 @@ void InitStoreTilesTable();
 template <size_t PixelSize, size_t NumDests>
 struct StorePixels
 {
-    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[NumDests]) = delete;
+    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[NumDests], bool stream = false) = delete;
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -88,7 +126,7 @@ struct StorePixels
 template <>
 struct StorePixels<8, 2>
 {
-    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[2])
+    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[2], bool = false)
     {
         // Each 4-pixel row is 4 bytes.
         const uint16_t* pPixSrc = (const uint16_t*)pSrc;
@@ -108,7 +146,7 @@ struct StorePixels<8, 2>
 template <>
 struct StorePixels<8, 4>
 {
-    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[4])
+    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[4], bool = false)
     {
         // 8 x 2 bytes = 16 bytes, 16 pixels
         const uint16_t *pSrc16 = reinterpret_cast<const uint16_t *>(pSrc);
@@ -143,7 +181,7 @@ struct StorePixels<8, 4>
 template <>
 struct StorePixels<16, 2>
 {
-    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[2])
+    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[2], bool = false)
     {
         // Each 4-pixel row is 8 bytes.
         const uint32_t* pPixSrc = (const uint32_t*)pSrc;
@@ -163,7 +201,7 @@ struct StorePixels<16, 2>
 template <>
 struct StorePixels<16, 4>
 {
-    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[4])
+    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[4], bool = false)
     {
         // 8 x 4 bytes = 32 bytes, 16 pixels
         const uint32_t *pSrc32 = reinterpret_cast<const uint32_t *>(pSrc);
@@ -198,7 +236,7 @@ struct StorePixels<16, 4>
 template <>
 struct StorePixels<32, 2>
 {
-    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[2])
+    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[2], bool = false)
     {
         // Each 4-pixel row is 16-bytes
         simd4scalari *pZRow01 = (simd4scalari*)pSrc;
@@ -217,7 +255,7 @@ struct StorePixels<32, 2>
 template <>
 struct StorePixels<32, 4>
 {
-    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[4])
+    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[4], bool = false)
     {
         // 4 x 16 bytes = 64 bytes, 16 pixels
         const simd4scalari *pSrc128 = reinterpret_cast<const simd4scalari *>(pSrc);
@@ -250,17 +288,17 @@ struct StorePixels<32, 4>
 template <>
 struct StorePixels<64, 4>
 {
-    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[4])
+    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[4], bool stream = false)
     {
         // Each 4-pixel row is 32 bytes.
         const simd4scalari* pPixSrc = (const simd4scalari*)pSrc;
 
         // order of pointers match SWR-Z layout
         simd4scalari** pvDsts = (simd4scalari**)&ppDsts[0];
-        *pvDsts[0] = pPixSrc[0];
-        *pvDsts[1] = pPixSrc[1];
-        *pvDsts[2] = pPixSrc[2];
-        *pvDsts[3] = pPixSrc[3];
+        StoreColumn(pvDsts[0], pPixSrc[0], stream);
+        StoreColumn(pvDsts[1], pPixSrc[1], stream);
+        StoreColumn(pvDsts[2], pPixSrc[2], stream);
+        StoreColumn(pvDsts[3], pPixSrc[3], stream);
     }
 };
 
@@ -268,7 +306,7 @@ struct StorePixels<64, 4>
 template <>
 struct StorePixels<64, 8>
 {
-    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[8])
+    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[8], bool stream = false)
     {
         // 8 x 16 bytes = 128 bytes, 16 pixels
         const simd4scalari *pSrc128 = reinterpret_cast<const simd4scalari *>(pSrc);
@@ -276,14 +314,14 @@ struct StorePixels<64, 8>
         simd4scalari **ppDsts128 = reinterpret_cast<simd4scalari **>(ppDsts);
 
         // order of pointers match SWR-Z layout
-        *ppDsts128[0] = pSrc128[0];     // 0 1
-        *ppDsts128[1] = pSrc128[1];     // 2 3
-        *ppDsts128[2] = pSrc128[2];     // 4 5
-        *ppDsts128[3] = pSrc128[3];     // 6 7
-        *ppDsts128[4] = pSrc128[4];     // 8 9
-        *ppDsts128[5] = pSrc128[5];     // A B
-        *ppDsts128[6] = pSrc128[6];     // C D
-        *ppDsts128[7] = pSrc128[7];     // E F
+        StoreColumn(ppDsts128[0], pSrc128[0], stream);     // 0 1
+        StoreColumn(ppDsts128[1], pSrc128[1], stream);     // 2 3
+        StoreColumn(ppDsts128[2], pSrc128[2], stream);     // 4 5
+        StoreColumn(ppDsts128[3], pSrc128[3], stream);     // 6 7
+        StoreColumn(ppDsts128[4], pSrc128[4], stream);     // 8 9
+        StoreColumn(ppDsts128[5], pSrc128[5], stream);     // A B
+        StoreColumn(ppDsts128[6], pSrc128[6], stream);     // C D
+        StoreColumn(ppDsts128[7], pSrc128[7], stream);     // E F
     }
 };
 
@@ -300,21 +338,21 @@ struct StorePixels<64, 8>
 template <>
 struct StorePixels<128, 8>
 {
-    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[8])
+    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[8], bool stream = false)
     {
         // Each 4-pixel row is 64 bytes.
         const simd4scalari* pPixSrc = (const simd4scalari*)pSrc;
 
         // Unswizzle from SWR-Z order
         simd4scalari** pvDsts = (simd4scalari**)&ppDsts[0];
-        *pvDsts[0] = pPixSrc[0];
-        *pvDsts[1] = pPixSrc[2];
-        *pvDsts[2] = pPixSrc[1];
-        *pvDsts[3] = pPixSrc[3];
-        *pvDsts[4] = pPixSrc[4];
-        *pvDsts[5] = pPixSrc[6];
-        *pvDsts[6] = pPixSrc[5];
-        *pvDsts[7] = pPixSrc[7];
+        StoreColumn(pvDsts[0], pPixSrc[0], stream);
+        StoreColumn(pvDsts[1], pPixSrc[2], stream);
+        StoreColumn(pvDsts[2], pPixSrc[1], stream);
+        StoreColumn(pvDsts[3], pPixSrc[3], stream);
+        StoreColumn(pvDsts[4], pPixSrc[4], stream);
+        StoreColumn(pvDsts[5], pPixSrc[6], stream);
+        StoreColumn(pvDsts[6], pPixSrc[5], stream);
+        StoreColumn(pvDsts[7], pPixSrc[7], stream);
     }
 };
 
@@ -322,7 +360,7 @@ struct StorePixels<128, 8>
 template <>
 struct StorePixels<128, 16>
 {
-    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[16])
+    static void Store(const uint8_t* pSrc, uint8_t* (&ppDsts)[16], bool stream = false)
     {
         // 16 x 16 bytes = 256 bytes, 16 pixels
         const simd4scalari *pSrc128 = reinterpret_cast<const simd4scalari *>(pSrc);
@@ -331,10 +369,10 @@ struct StorePixels<128, 16>
 
         for (uint32_t i = 0; i < 16; i += 4)
         {
-            *ppDsts128[i + 0] = pSrc128[i + 0];
-            *ppDsts128[i + 1] = pSrc128[i + 2];
-            *ppDsts128[i + 2] = pSrc128[i + 1];
-            *ppDsts128[i + 3] = pSrc128[i + 3];
+            StoreColumn(ppDsts128[i + 0], pSrc128[i + 0], stream);
+            StoreColumn(ppDsts128[i + 1], pSrc128[i + 2], stream);
+            StoreColumn(ppDsts128[i + 2], pSrc128[i + 1], stream);
+            StoreColumn(ppDsts128[i + 3], pSrc128[i + 3], stream);
         }
     }
 };
@@ -351,8 +389,9 @@ struct ConvertPixelsSOAtoAOS
     ///        and converts from SOA to AOS.
     /// @param pSrc - Pointer to raster tile.
     /// @param pDst - Pointer to destination surface or deswizzling buffer.
+    /// @param stream - Store with non-temporal stores, see StreamStores.
     template <size_t NumDests>
-    INLINE static void Convert(const uint8_t* pSrc, uint8_t* (&ppDsts)[NumDests])
+    INLINE static void Convert(const uint8_t* pSrc, uint8_t* (&ppDsts)[NumDests], bool stream = false)
     {
 #if USE_8x2_TILE_BACKEND
         static const uint32_t MAX_RASTER_TILE_BYTES = 16 * 16; // 16 pixels * 16 bytes per pixel
@@ -384,7 +423,7 @@ struct ConvertPixelsSOAtoAOS
 
 #endif
         // Store data into destination
-        StorePixels<FormatTraits<DstFormat>::bpp, NumDests>::Store(aosTile, ppDsts);
+        StorePixels<FormatTraits<DstFormat>::bpp, NumDests>::Store(aosTile, ppDsts, stream);
     }
 };
 
@@ -400,8 +439,9 @@ struct ConvertPixelsSOAtoAOS<Format, Format>
     ///        and converts from SOA to AOS.
     /// @param pSrc - Pointer to raster tile.
     /// @param pDst - Pointer to destination surface or deswizzling buffer.
+    /// @param stream - Store with non-temporal stores, see StreamStores.
     template <size_t NumDests>
-    INLINE static void Convert(const uint8_t* pSrc, uint8_t* (&ppDsts)[NumDests])
+    INLINE static void Convert(const uint8_t* pSrc, uint8_t* (&ppDsts)[NumDests], bool stream = false)
     {
 #if USE_8x2_TILE_BACKEND
         static const uint32_t MAX_RASTER_TILE_BYTES = 16 * 16; // 16 pixels * 16 bytes per pixel
@@ -421,7 +461,7 @@ struct ConvertPixelsSOAtoAOS<Format, Format>
 
 #endif
         // Store data into destination
-        StorePixels<FormatTraits<Format>::bpp, NumDests>::Store(aosTile, ppDsts);
+        StorePixels<FormatTraits<Format>::bpp, NumDests>::Store(aosTile, ppDsts, stream);
     }
 };
 
@@ -1496,6 +1536,7 @@ struct OptStoreRasterTile< TilingTraits<SWR_TILE_NONE, 64>, SrcFormat, DstFormat
 
         uint8_t *pDst = (uint8_t*)ComputeSurfaceAddress<false, false>(x, y, pDstSurface->arrayIndex + renderTargetArrayIndex,
             pDstSurface->arrayIndex + renderTargetArrayIndex, sampleNum, pDstSurface->lod, pDstSurface);
+        const bool stream = StreamStores(pDstSurface);
 #if USE_8x2_TILE_BACKEND
 
         const uint32_t dx = SIMD16_TILE_X_DIM * DST_BYTES_PER_PIXEL;
@@ -1521,7 +1562,7 @@ struct OptStoreRasterTile< TilingTraits<SWR_TILE_NONE, 64>, SrcFormat, DstFormat
             // Raster tile width is same as simd16 tile width
             static_assert(KNOB_TILE_X_DIM == SIMD16_TILE_X_DIM, "Invalid tile x dim");
 
-            ConvertPixelsSOAtoAOS<SrcFormat, DstFormat>::Convert(pSrc, ppDsts);
+            ConvertPixelsSOAtoAOS<SrcFormat, DstFormat>::Convert(pSrc, ppDsts, stream);
 
             pSrc += KNOB_SIMD16_WIDTH * SRC_BYTES_PER_PIXEL;
 
@@ -1552,7 +1593,7 @@ struct OptStoreRasterTile< TilingTraits<SWR_TILE_NONE, 64>, SrcFormat, DstFormat
             for (uint32_t col = 0; col < KNOB_TILE_X_DIM / SIMD_TILE_X_DIM; ++col)
             {
                 // Format conversion and convert from SOA to AOS, and store the rows.
-                ConvertPixelsSOAtoAOS<SrcFormat, DstFormat>::Convert(pSrc, ppDsts);
+                ConvertPixelsSOAtoAOS<SrcFormat, DstFormat>::Convert(pSrc, ppDsts, stream);
 
                 ppDsts[0] += DST_COLUMN_BYTES_PER_SRC;
                 ppDsts[1] += DST_COLUMN_BYTES_PER_SRC;
@@ -1606,6 +1647,7 @@ struct OptStoreRasterTile< TilingTraits<SWR_TILE_NONE, 128>, SrcFormat, DstForma
 
         uint8_t *pDst = (uint8_t*)ComputeSurfaceAddress<false, false>(x, y, pDstSurface->arrayIndex + renderTargetArrayIndex,
             pDstSurface->arrayIndex + renderTargetArrayIndex, sampleNum, pDstSurface->lod, pDstSurface);
+        const bool stream = StreamStores(pDstSurface);
 #if USE_8x2_TILE_BACKEND
 
         const uint32_t dx = SIMD16_TILE_X_DIM * DST_BYTES_PER_PIXEL;
@@ -1639,7 +1681,7 @@ struct OptStoreRasterTile< TilingTraits<SWR_TILE_NONE, 128>, SrcFormat, DstForma
             // Raster tile width is same as simd16 tile width
             static_assert(KNOB_TILE_X_DIM == SIMD16_TILE_X_DIM, "Invalid tile x dim");
 
-            ConvertPixelsSOAtoAOS<SrcFormat, DstFormat>::Convert(pSrc, ppDsts);
+            ConvertPixelsSOAtoAOS<SrcFormat, DstFormat>::Convert(pSrc, ppDsts, stream);
 
             pSrc += KNOB_SIMD16_WIDTH * SRC_BYTES_PER_PIXEL;
 
@@ -1670,7 +1712,7 @@ struct OptStoreRasterTile< TilingTraits<SWR_TILE_NONE, 128>, SrcFormat, DstForma
             for (uint32_t col = 0; col < KNOB_TILE_X_DIM / SIMD_TILE_X_DIM; ++col)
             {
                 // Format conversion and convert from SOA to AOS, and store the rows.
-                ConvertPixelsSOAtoAOS<SrcFormat, DstFormat>::Convert(pSrc, ptrs.ppDsts);
+                ConvertPixelsSOAtoAOS<SrcFormat, DstFormat>::Convert(pSrc, ptrs.ppDsts, stream);
 
                 ptrs.ppDsts[0] += DST_COLUMN_BYTES_PER_SRC;
                 ptrs.ppDsts[1] += DST_COLUMN_BYTES_PER_SRC;
@@ -2405,6 +2447,13 @@ struct StoreMacroTile
                 }
             }
         }
+
+        // Order any non-temporal StorePixels writes before the tile is
+        // reported stored.
+        if (FormatTraits<DstFormat>::bpp >= 64 && StreamStores(pDstSurface))
+        {
+            _mm_sfence();
+        }
     }
 };
 
@@ -102,8 +102,11 @@ swr_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
 
          state.stream.numDecls = num;
 
-         HANDLE hJitMgr = swr_screen(pipe->screen)->hJitMgr;
-         ctx->vs->soFunc[info->mode] = JitCompileStreamout(hJitMgr, state);
+         struct swr_screen *screen = swr_screen(pipe->screen);
+         mtx_lock(&screen->jit_mutex);
+         ctx->vs->soFunc[info->mode] =
+            JitCompileStreamout(screen->hJitMgr, state);
+         mtx_unlock(&screen->jit_mutex);
          debug_printf("so shader    %p\n", ctx->vs->soFunc[info->mode]);
          assert(ctx->vs->soFunc[info->mode] && "Error: SoShader = NULL");
       }
@@ -125,8 +128,10 @@ swr_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
    if (search != velems->map.end()) {
       velems->fsFunc = search->second;
    } else {
-      HANDLE hJitMgr = swr_screen(ctx->pipe.screen)->hJitMgr;
-      velems->fsFunc = JitCompileFetch(hJitMgr, velems->fsState);
+      struct swr_screen *screen = swr_screen(ctx->pipe.screen);
+      mtx_lock(&screen->jit_mutex);
+      velems->fsFunc = JitCompileFetch(screen->hJitMgr, velems->fsState);
+      mtx_unlock(&screen->jit_mutex);
 
       debug_printf("fetch shader %p\n", velems->fsFunc);
       assert(velems->fsFunc && "Error: FetchShader = NULL");
@@ -245,15 +250,26 @@ swr_flush(struct pipe_context *pipe,
    struct swr_context *ctx = swr_context(pipe);
    struct swr_screen *screen = swr_screen(pipe->screen);
 
+   /* Store every dirty attachment with a single StoreTiles, so each
+    * macrotile is one work item for the backend workers and only one
+    * fence is needed for the whole framebuffer. */
+   uint32_t attachment_mask = 0;
    for (int i=0; i < ctx->framebuffer.nr_cbufs; i++) {
       struct pipe_surface *cb = ctx->framebuffer.cbufs[i];
       if (cb) {
-         swr_store_dirty_resource(pipe, cb->texture, SWR_TILE_RESOLVED);
+         attachment_mask |= swr_dirty_attachment_mask(pipe, cb->texture);
       }
    }
    if (ctx->framebuffer.zsbuf) {
-      swr_store_dirty_resource(pipe, ctx->framebuffer.zsbuf->texture,
-                               SWR_TILE_RESOLVED);
+      attachment_mask |=
+         swr_dirty_attachment_mask(pipe, ctx->framebuffer.zsbuf->texture);
+   }
+
+   if (attachment_mask) {
+      swr_store_render_targets(pipe, attachment_mask, SWR_TILE_RESOLVED);
+
+      /* This fence signals StoreTiles completion */
+      swr_fence_submit(ctx, screen->flush_fence);
    }
 
    if (fence)
@@ -291,63 +307,101 @@ swr_invalidate_render_target(struct pipe_context *pipe,
 
 
 /*
- * Store SWR HotTiles back to renderTarget surface.
+ * Store SWR HotTiles back to the renderTarget surfaces in attachment_mask.
+ * The core spreads the macrotiles of a single StoreTiles across all
+ * backend workers, each storing every attachment of its macrotile.
  */
 void
-swr_store_render_target(struct pipe_context *pipe,
-                        uint32_t attachment,
-                        enum SWR_TILE_STATE post_tile_state)
+swr_store_render_targets(struct pipe_context *pipe,
+                         uint32_t attachment_mask,
+                         enum SWR_TILE_STATE post_tile_state)
 {
    struct swr_context *ctx = swr_context(pipe);
    struct swr_draw_context *pDC = &ctx->swrDC;
-   struct SWR_SURFACE_STATE *renderTarget = &pDC->renderTargets[attachment];
+   uint32_t store_mask = 0;
+   SWR_RECT full_rect = {0, 0, 0, 0};
+
+   for (uint32_t i = 0; i < SWR_NUM_ATTACHMENTS; i++) {
+      struct SWR_SURFACE_STATE *renderTarget = &pDC->renderTargets[i];
 
-   /* Only proceed if there's a valid surface to store to */
-   if (renderTarget->xpBaseAddress) {
+      /* Only proceed if there's a valid surface to store to */
+      if (!(attachment_mask & (1 << i)) || !renderTarget->xpBaseAddress)
+         continue;
+
+      store_mask |= 1 << i;
+      full_rect.xmax = MAX2(full_rect.xmax,
+         (int32_t)u_minify(renderTarget->width, renderTarget->lod));
+      full_rect.ymax = MAX2(full_rect.ymax,
+         (int32_t)u_minify(renderTarget->height, renderTarget->lod));
+   }
+
+   if (store_mask) {
       swr_update_draw_context(ctx);
-      SWR_RECT full_rect =
-         {0, 0,
-          (int32_t)u_minify(renderTarget->width, renderTarget->lod),
-          (int32_t)u_minify(renderTarget->height, renderTarget->lod)};
       ctx->api.pfnSwrStoreTiles(ctx->swrContext,
-                                1 << attachment,
+                                store_mask,
                                 post_tile_state,
                                 full_rect);
    }
 }
 
+/*
+ * Store SWR HotTiles back to renderTarget surface.
+ */
+void
+swr_store_render_target(struct pipe_context *pipe,
+                        uint32_t attachment,
+                        enum SWR_TILE_STATE post_tile_state)
+{
+   swr_store_render_targets(pipe, 1 << attachment, post_tile_state);
+}
+
+/*
+ * Return the attachments bound to resource, if it has been written to.
+ */
+uint32_t
+swr_dirty_attachment_mask(struct pipe_context *pipe,
+                          struct pipe_resource *resource)
+{
+   /* Only store resource if it has been written to */
+   if (!(swr_resource(resource)->status & SWR_RESOURCE_WRITE))
+      return 0;
+
+   struct swr_context *ctx = swr_context(pipe);
+   struct swr_resource *spr = swr_resource(resource);
+
+   swr_draw_context *pDC = &ctx->swrDC;
+   SWR_SURFACE_STATE *renderTargets = pDC->renderTargets;
+   for (uint32_t i = 0; i < SWR_NUM_ATTACHMENTS; i++)
+      if (renderTargets[i].xpBaseAddress == spr->swr.xpBaseAddress ||
+          (spr->secondary.xpBaseAddress &&
+           renderTargets[i].xpBaseAddress == spr->secondary.xpBaseAddress)) {
+         /* Mesa thinks depth/stencil are fused, so we'll never get an
+          * explicit resource for stencil.  So, if checking depth, then
+          * also check for stencil. */
+         if (spr->has_stencil && (i == SWR_ATTACHMENT_DEPTH))
+            return SWR_ATTACHMENT_DEPTH_BIT | SWR_ATTACHMENT_STENCIL_BIT;
+
+         return 1 << i;
+      }
+
+   return 0;
+}
+
 void
 swr_store_dirty_resource(struct pipe_context *pipe,
                          struct pipe_resource *resource,
                          enum SWR_TILE_STATE post_tile_state)
 {
-   /* Only store resource if it has been written to */
-   if (swr_resource(resource)->status & SWR_RESOURCE_WRITE) {
+   uint32_t attachment_mask = swr_dirty_attachment_mask(pipe, resource);
+
+   if (attachment_mask) {
       struct swr_context *ctx = swr_context(pipe);
       struct swr_screen *screen = swr_screen(pipe->screen);
-      struct swr_resource *spr = swr_resource(resource);
-
-      swr_draw_context *pDC = &ctx->swrDC;
-      SWR_SURFACE_STATE *renderTargets = pDC->renderTargets;
-      for (uint32_t i = 0; i < SWR_NUM_ATTACHMENTS; i++)
-         if (renderTargets[i].xpBaseAddress == spr->swr.xpBaseAddress ||
-             (spr->secondary.xpBaseAddress &&
-              renderTargets[i].xpBaseAddress == spr->secondary.xpBaseAddress)) {
-            swr_store_render_target(pipe, i, post_tile_state);
-
-            /* Mesa thinks depth/stencil are fused, so we'll never get an
-             * explicit resource for stencil.  So, if checking depth, then
-             * also check for stencil. */
-            if (spr->has_stencil && (i == SWR_ATTACHMENT_DEPTH)) {
-               swr_store_render_target(
-                  pipe, SWR_ATTACHMENT_STENCIL, post_tile_state);
-            }
 
-            /* This fence signals StoreTiles completion */
-            swr_fence_submit(ctx, screen->flush_fence);
+      swr_store_render_targets(pipe, attachment_mask, post_tile_state);
 
-            break;
-         }
+      /* This fence signals StoreTiles completion */
+      swr_fence_submit(ctx, screen->flush_fence);
    }
 }
 
@@ -22,6 +22,7 @@
  ***************************************************************************/
 
 #include "pipe/p_defines.h"
+#include "util/u_atomic.h"
 #include "util/u_memory.h"
 #include "util/os_time.h"
 #include "swr_context.h"
@@ -37,12 +38,40 @@ swr_query(struct pipe_query *p)
    return (struct swr_query *)p;
 }
 
+/* Current value of a driver query's counter */
+static uint64_t
+swr_driver_query_count(struct pipe_context *pipe, unsigned type)
+{
+   struct swr_screen *screen = swr_screen(pipe->screen);
+
+   switch (type) {
+   case SWR_QUERY_VARIANTS_COMPILED:
+      return p_atomic_read(&screen->jit_stats.compiled);
+   case SWR_QUERY_VARIANTS_ASYNC:
+      return p_atomic_read(&screen->jit_stats.async);
+   case SWR_QUERY_VARIANT_WAITS:
+      return p_atomic_read(&screen->jit_stats.waits);
+   case SWR_QUERY_COMPILE_TIME:
+      return p_atomic_read(&screen->jit_stats.compile_time);
+   case SWR_QUERY_VARIANTS_CACHED:
+      return p_atomic_read(&screen->jit_stats.variants);
+   case SWR_QUERY_VARIANT_HITS:
+      return p_atomic_read(&screen->jit_stats.hits);
+   case SWR_QUERY_VARIANT_MISSES:
+      return p_atomic_read(&screen->jit_stats.misses);
+   default:
+      assert(0 && "Unsupported query");
+      return 0;
+   }
+}
+
 static struct pipe_query *
 swr_create_query(struct pipe_context *pipe, unsigned type, unsigned index)
 {
    struct swr_query *pq;
 
-   assert(type < PIPE_QUERY_TYPES);
+   assert(type < PIPE_QUERY_TYPES ||
+          (type >= PIPE_QUERY_DRIVER_SPECIFIC && type < SWR_QUERY_LAST));
    assert(index < MAX_SO_STREAMS);
 
    pq = (struct swr_query *) AlignedMalloc(sizeof(struct swr_query), 64);
@@ -150,6 +179,18 @@ swr_get_query_result(struct pipe_context *pipe,
       result->b = num_primitives_written > primitives_storage_needed;
    }
       break;
+   /* Driver queries: running totals, or counts over the query */
+   case SWR_QUERY_VARIANTS_CACHED:
+      result->u64 = pq->end_count;
+      break;
+   case SWR_QUERY_VARIANTS_COMPILED:
+   case SWR_QUERY_VARIANTS_ASYNC:
+   case SWR_QUERY_VARIANT_WAITS:
+   case SWR_QUERY_COMPILE_TIME:
+   case SWR_QUERY_VARIANT_HITS:
+   case SWR_QUERY_VARIANT_MISSES:
+      result->u64 = pq->end_count - pq->begin_count;
+      break;
    default:
       assert(0 && "Unsupported query");
       break;
@@ -166,6 +207,11 @@ swr_begin_query(struct pipe_context *pipe, struct pipe_query *q)
 
    /* Initialize Results */
    memset(&pq->result, 0, sizeof(pq->result));
+   if (pq->type >= PIPE_QUERY_DRIVER_SPECIFIC) {
+      pq->begin_count = swr_driver_query_count(pipe, pq->type);
+      return true;
+   }
+
    switch (pq->type) {
    case PIPE_QUERY_GPU_FINISHED:
    case PIPE_QUERY_TIMESTAMP:
@@ -198,6 +244,11 @@ swr_end_query(struct pipe_context *pipe, struct pipe_query *q)
    struct swr_context *ctx = swr_context(pipe);
    struct swr_query *pq = swr_query(q);
 
+   if (pq->type >= PIPE_QUERY_DRIVER_SPECIFIC) {
+      pq->end_count = swr_driver_query_count(pipe, pq->type);
+      return true;
+   }
+
    switch (pq->type) {
    case PIPE_QUERY_GPU_FINISHED:
       /* nothing to do, but don't want the default */
@@ -256,6 +307,43 @@ swr_set_active_query_state(struct pipe_context *pipe, boolean enable)
 {
 }
 
+
+int
+swr_get_driver_query_info(struct pipe_screen *screen,
+                          unsigned index,
+                          struct pipe_driver_query_info *info)
+{
+#define QUERY(NAME, ENUM, UNITS, RESULT) \
+   {NAME, ENUM, {0}, UNITS, PIPE_DRIVER_QUERY_RESULT_TYPE_##RESULT, 0, 0x0}
+
+   static const struct pipe_driver_query_info queries[] = {
+      QUERY("variants-compiled", SWR_QUERY_VARIANTS_COMPILED,
+            PIPE_DRIVER_QUERY_TYPE_UINT64, CUMULATIVE),
+      QUERY("variants-async", SWR_QUERY_VARIANTS_ASYNC,
+            PIPE_DRIVER_QUERY_TYPE_UINT64, CUMULATIVE),
+      QUERY("variant-waits", SWR_QUERY_VARIANT_WAITS,
+            PIPE_DRIVER_QUERY_TYPE_UINT64, CUMULATIVE),
+      QUERY("compile-time", SWR_QUERY_COMPILE_TIME,
+            PIPE_DRIVER_QUERY_TYPE_MICROSECONDS, CUMULATIVE),
+      QUERY("variants-cached", SWR_QUERY_VARIANTS_CACHED,
+            PIPE_DRIVER_QUERY_TYPE_UINT64, AVERAGE),
+      QUERY("variant-hits", SWR_QUERY_VARIANT_HITS,
+            PIPE_DRIVER_QUERY_TYPE_UINT64, CUMULATIVE),
+      QUERY("variant-misses", SWR_QUERY_VARIANT_MISSES,
+            PIPE_DRIVER_QUERY_TYPE_UINT64, CUMULATIVE),
+   };
+#undef QUERY
+
+   if (!info)
+      return ARRAY_SIZE(queries);
+
+   if (index >= ARRAY_SIZE(queries))
+      return 0;
+
+   *info = queries[index];
+   return 1;
+}
+
 void
 swr_query_init(struct pipe_context *pipe)
 {
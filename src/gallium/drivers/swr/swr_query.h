@@ -27,6 +27,16 @@
 
 #include <limits.h>
 
+/* Driver queries, on the shader variant statistics of the screen */
+#define SWR_QUERY_VARIANTS_COMPILED  (PIPE_QUERY_DRIVER_SPECIFIC + 0)
+#define SWR_QUERY_VARIANTS_ASYNC     (PIPE_QUERY_DRIVER_SPECIFIC + 1)
+#define SWR_QUERY_VARIANT_WAITS      (PIPE_QUERY_DRIVER_SPECIFIC + 2)
+#define SWR_QUERY_COMPILE_TIME       (PIPE_QUERY_DRIVER_SPECIFIC + 3)
+#define SWR_QUERY_VARIANTS_CACHED    (PIPE_QUERY_DRIVER_SPECIFIC + 4)
+#define SWR_QUERY_VARIANT_HITS       (PIPE_QUERY_DRIVER_SPECIFIC + 5)
+#define SWR_QUERY_VARIANT_MISSES     (PIPE_QUERY_DRIVER_SPECIFIC + 6)
+#define SWR_QUERY_LAST               (PIPE_QUERY_DRIVER_SPECIFIC + 7)
+
 struct swr_query_result {
    SWR_STATS core;
    SWR_STATS_FE coreFE;
@@ -40,9 +50,17 @@ OSALIGNLINE(struct) swr_query {
 
    struct swr_query_result result;
    struct pipe_fence_handle *fence;
+
+   /* Counter values of driver queries at begin and end */
+   uint64_t begin_count;
+   uint64_t end_count;
 };
 
 extern void swr_query_init(struct pipe_context *pipe);
 
+extern int swr_get_driver_query_info(struct pipe_screen *screen,
+                                     unsigned index,
+                                     struct pipe_driver_query_info *info);
+
 extern boolean swr_check_render_cond(struct pipe_context *pipe);
 #endif
@@ -107,6 +107,13 @@ void swr_store_render_target(struct pipe_context *pipe,
                              uint32_t attachment,
                              enum SWR_TILE_STATE post_tile_state);
 
+void swr_store_render_targets(struct pipe_context *pipe,
+                              uint32_t attachment_mask,
+                              enum SWR_TILE_STATE post_tile_state);
+
+uint32_t swr_dirty_attachment_mask(struct pipe_context *pipe,
+                                   struct pipe_resource *resource);
+
 void swr_store_dirty_resource(struct pipe_context *pipe,
                               struct pipe_resource *resource,
                               enum SWR_TILE_STATE post_tile_state);
@@ -38,12 +38,21 @@ swr_copy_to_scratch_space(struct swr_context *ctx,
    assert(space);
    assert(size);
 
-   /* Allocate enough so that MAX_DRAWS_IN_FLIGHT sets fit. */
-   uint32_t max_size_in_flight = size * ctx->max_draws_in_flight;
+   /* Allocate enough so that a set fits for each draw the core currently
+    * lets into flight.  That limit grows on demand, so look it up each
+    * time; queued draws keep the old buffer until the flush fence.
+    */
+   SWR_DRAW_RING_STATS ring;
+   ctx->api.pfnSwrGetDrawRingStats(ctx->swrContext, &ring);
+   uint64_t max_size_in_flight = (uint64_t)size * ring.activeDrawsInFlight;
+
+   /* current_size is 32 bits, settle for as many whole sets as fit */
+   if (max_size_in_flight > UINT_MAX)
+      max_size_in_flight = UINT_MAX - UINT_MAX % size;
 
    /* Need to grow space */
    if (max_size_in_flight > space->current_size) {
-      space->current_size = max_size_in_flight;
+      space->current_size = (unsigned int)max_size_in_flight;
 
       if (space->base) {
          /* defer delete, use aligned-free */
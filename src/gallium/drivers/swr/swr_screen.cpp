@@ -26,6 +26,7 @@
 #include "swr_screen.h"
 #include "swr_resource.h"
 #include "swr_fence.h"
+#include "swr_query.h"
 #include "gen_knobs.h"
 
 #include "pipe/p_screen.h"
@@ -1058,7 +1059,21 @@ swr_destroy_screen_internal(struct swr_screen **screen)
    swr_fence_finish(p_screen, NULL, (*screen)->flush_fence, 0);
    swr_fence_reference(p_screen, &(*screen)->flush_fence, NULL);
 
+   if (util_queue_is_initialized(&(*screen)->compile_queue))
+      util_queue_destroy(&(*screen)->compile_queue);
+
+   if ((*screen)->print_jit_stats) {
+      fprintf(stderr, "SWR JIT: %u shader variants compiled (%u async), "
+              "%u draws waited on a pending variant, %.3f ms compiling\n",
+              (*screen)->jit_stats.compiled, (*screen)->jit_stats.async,
+              (*screen)->jit_stats.waits,
+              (*screen)->jit_stats.compile_time / 1000.0);
+      fprintf(stderr, "SWR JIT: %u variant lookups hit, %u compiled inline\n",
+              (*screen)->jit_stats.hits, (*screen)->jit_stats.misses);
+   }
+
    JitDestroyContext((*screen)->hJitMgr);
+   mtx_destroy(&(*screen)->jit_mutex);
 
    if ((*screen)->pLibrary)
       util_dl_close((*screen)->pLibrary);
@@ -1122,6 +1137,12 @@ swr_validate_env_options(struct swr_screen *screen)
          "SWR_MSAA_FORCE_ENABLE", false);
    if (screen->msaa_force_enable)
       fprintf(stderr, "SWR_MSAA_FORCE_ENABLE: true\n");
+
+   /* Shader variants for newly bound state are compiled on a background
+    * thread; validation only blocks if the variant isn't ready yet. */
+   screen->async_compile = debug_get_bool_option("SWR_ASYNC_COMPILE", true);
+
+   screen->print_jit_stats = debug_get_bool_option("SWR_PRINT_JIT_STATS", false);
 }
 
 
@@ -1151,6 +1172,7 @@ swr_create_screen_internal(struct sw_winsys *winsys)
    screen->base.get_param = swr_get_param;
    screen->base.get_shader_param = swr_get_shader_param;
    screen->base.get_paramf = swr_get_paramf;
+   screen->base.get_driver_query_info = swr_get_driver_query_info;
 
    screen->base.resource_create = swr_resource_create;
    screen->base.resource_destroy = swr_resource_destroy;
@@ -1159,11 +1181,16 @@ swr_create_screen_internal(struct sw_winsys *winsys)
 
    // Pass in "" for architecture for run-time determination
    screen->hJitMgr = JitCreateContext(KNOB_SIMD_WIDTH, "", "swr");
+   (void) mtx_init(&screen->jit_mutex, mtx_plain);
 
    swr_fence_init(&screen->base);
 
    swr_validate_env_options(screen);
 
+   if (screen->async_compile &&
+       !util_queue_init(&screen->compile_queue, "swrjit", 32, 1, 0))
+      screen->async_compile = false;
+
    return &screen->base;
 }
 
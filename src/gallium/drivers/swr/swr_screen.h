@@ -30,6 +30,8 @@
 #include "pipe/p_defines.h"
 #include "util/u_dl.h"
 #include "util/u_format.h"
+#include "util/u_queue.h"
+#include "c11/threads.h"
 #include "api.h"
 
 #include "memory/TilingFunctions.h"
@@ -48,9 +50,27 @@ struct swr_screen {
    boolean msaa_force_enable;
    uint8_t msaa_max_count;
    uint32_t client_copy_limit;
+   boolean async_compile;
+   boolean print_jit_stats;
 
    HANDLE hJitMgr;
 
+   /* hJitMgr builds one module at a time; serializes the API thread
+    * with the background shader compile thread */
+   mtx_t jit_mutex;
+   struct util_queue compile_queue;
+
+   /* Shader variant compile statistics */
+   struct {
+      unsigned compiled;       /* variants built */
+      unsigned async;          /* ... of which on the compile thread */
+      unsigned waits;          /* draws that blocked on a pending variant */
+      uint64_t compile_time;   /* microseconds spent compiling */
+      unsigned variants;       /* variants currently in the shader maps */
+      unsigned hits;           /* draw-time lookups that found a variant */
+      unsigned misses;         /* ... that had to compile one inline */
+   } jit_stats;
+
    /* Dynamic backend implementations */
    util_dl_library *pLibrary;
    PFNSwrGetInterface pfnSwrGetInterface;
@@ -38,6 +38,8 @@
 #include "tgsi/tgsi_strings.h"
 #include "util/u_format.h"
 #include "util/u_prim.h"
+#include "util/u_atomic.h"
+#include "util/os_time.h"
 #include "gallivm/lp_bld_init.h"
 #include "gallivm/lp_bld_flow.h"
 #include "gallivm/lp_bld_struct.h"
@@ -226,9 +228,17 @@ struct BuilderSWR : public Builder {
                 unsigned slot, unsigned channel);
 
    struct gallivm_state *gallivm;
-   PFN_VERTEX_FUNC CompileVS(struct swr_context *ctx, swr_jit_vs_key &key);
-   PFN_PIXEL_KERNEL CompileFS(struct swr_context *ctx, swr_jit_fs_key &key);
-   PFN_GS_FUNC CompileGS(struct swr_context *ctx, swr_jit_gs_key &key);
+   PFN_VERTEX_FUNC CompileVS(struct swr_vertex_shader *swr_vs,
+                             unsigned clip_plane_enable,
+                             swr_jit_vs_key &key);
+   PFN_PIXEL_KERNEL CompileFS(struct swr_fragment_shader *swr_fs,
+                              struct tgsi_shader_info *pPrevShader,
+                              bool has_gs,
+                              VariantFS *variant,
+                              swr_jit_fs_key &key);
+   PFN_GS_FUNC CompileGS(struct swr_geometry_shader *gs,
+                         struct tgsi_shader_info *vs_info,
+                         swr_jit_gs_key &key);
 
    LLVMValueRef
    swr_gs_llvm_fetch_input(const struct lp_build_tgsi_gs_iface *gs_iface,
@@ -541,11 +551,11 @@ BuilderSWR::swr_gs_llvm_epilogue(const struct lp_build_tgsi_gs_iface *gs_base,
    }
 }
 
-PFN_GS_FUNC
-BuilderSWR::CompileGS(struct swr_context *ctx, swr_jit_gs_key &key)
+void
+swr_init_gs_state(struct swr_geometry_shader *gs)
 {
-   SWR_GS_STATE *pGS = &ctx->gs->gsState;
-   struct tgsi_shader_info *info = &ctx->gs->info.base;
+   SWR_GS_STATE *pGS = &gs->gsState;
+   struct tgsi_shader_info *info = &gs->info.base;
 
    memset(pGS, 0, sizeof(*pGS));
 
@@ -574,8 +584,15 @@ BuilderSWR::CompileGS(struct swr_context *ctx, swr_jit_gs_key &key)
       CONTROL_HEADER_SIZE + // control header
       (SWR_VTX_NUM_SLOTS * 16) * // sizeof vertex
       pGS->maxNumVerts; // num verts
+}
 
-   struct swr_geometry_shader *gs = ctx->gs;
+PFN_GS_FUNC
+BuilderSWR::CompileGS(struct swr_geometry_shader *gs,
+                      struct tgsi_shader_info *vs_info,
+                      swr_jit_gs_key &key)
+{
+   SWR_GS_STATE *pGS = &gs->gsState;
+   struct tgsi_shader_info *info = &gs->info.base;
 
    LLVMValueRef inputs[PIPE_MAX_SHADER_INPUTS][TGSI_NUM_CHANNELS];
    LLVMValueRef outputs[PIPE_MAX_SHADER_OUTPUTS][TGSI_NUM_CHANNELS];
@@ -637,11 +654,11 @@ BuilderSWR::CompileGS(struct swr_context *ctx, swr_jit_gs_key &key)
       ubyte semantic_name = info->input_semantic_name[slot];
       ubyte semantic_idx = info->input_semantic_index[slot];
 
-      unsigned vs_slot = locate_linkage(semantic_name, semantic_idx, &ctx->vs->info.base);
+      unsigned vs_slot = locate_linkage(semantic_name, semantic_idx, vs_info);
 
       vs_slot += VERTEX_ATTRIB_START_SLOT;
 
-      if (ctx->vs->info.base.output_semantic_name[0] == TGSI_SEMANTIC_POSITION)
+      if (vs_info->output_semantic_name[0] == TGSI_SEMANTIC_POSITION)
          vs_slot--;
 
       if (semantic_name == TGSI_SEMANTIC_POSITION)
@@ -714,16 +731,157 @@ BuilderSWR::CompileGS(struct swr_context *ctx, swr_jit_gs_key &key)
    return pFunc;
 }
 
+/*
+ * Shader variants are built either inline on the API thread or as jobs on
+ * the screen's compile queue.  A job captures everything it needs from the
+ * context up front, since the bound state may change before it runs.  The
+ * JitManager builds one module at a time, so all builders run under
+ * screen->jit_mutex.
+ */
+template <typename Job>
+static void
+swr_compile_job_cleanup(void *data, int thread_index)
+{
+   delete (Job *)data;
+}
+
+static void
+swr_record_compile(struct swr_screen *screen, const char *name,
+                   int64_t *compile_time, int64_t start, int thread_index)
+{
+   *compile_time = os_time_get() - start;
+
+   p_atomic_inc(&screen->jit_stats.compiled);
+   if (thread_index >= 0)
+      p_atomic_inc(&screen->jit_stats.async);
+   p_atomic_add(&screen->jit_stats.compile_time, (uint64_t)*compile_time);
+
+   if (screen->print_jit_stats)
+      fprintf(stderr, "SWR JIT: %s variant built in %.3f ms%s\n", name,
+              *compile_time / 1000.0, thread_index >= 0 ? " (async)" : "");
+}
+
+/*
+ * Insert a variant for job->key into the shader's map and build it before
+ * returning.
+ */
+template <typename Variant, typename Job, typename Map>
+static Variant *
+swr_submit_compile(struct swr_screen *screen, Map &map, Job *job,
+                   util_queue_execute_func execute)
+{
+   Variant *variant = new Variant(&screen->jit_mutex,
+                                  &screen->jit_stats.variants);
+
+   job->screen = screen;
+   job->variant = variant;
+   map.insert(std::make_pair(job->key, std::unique_ptr<Variant>(variant)));
+
+   execute(job, -1);
+   delete job;
+
+   return variant;
+}
+
+/*
+ * Speculatively build a variant for key on the compile queue.  It stays in
+ * shader->prefetch, out of the map, until a draw asks for that key.  An
+ * older prefetch for another key is cancelled first; a new one is only
+ * queued once the old job is done with it.
+ */
+template <typename Variant, typename Shader, typename Key, typename Job>
+static void
+swr_queue_compile(struct swr_context *ctx, Shader *shader, const Key &key,
+                  Job *(*create_job)(struct swr_context *, Key &),
+                  util_queue_execute_func execute)
+{
+   struct swr_screen *screen = swr_screen(ctx->pipe.screen);
+
+   if (!screen->async_compile || shader->map.count(key))
+      return;
+
+   if (shader->prefetch) {
+      if (shader->prefetch_key == key &&
+          !p_atomic_read(&shader->prefetch->cancelled))
+         return;
+      p_atomic_set(&shader->prefetch->cancelled, 1);
+      if (!util_queue_fence_is_signalled(&shader->prefetch->ready))
+         return;
+   }
+
+   Variant *variant = new Variant(&screen->jit_mutex,
+                                  &screen->jit_stats.variants);
+   shader->prefetch_key = key;
+   Job *job = create_job(ctx, shader->prefetch_key);
+
+   job->screen = screen;
+   job->variant = variant;
+   shader->prefetch.reset(variant);
+
+   util_queue_fence_reset(&variant->ready);
+   util_queue_add_job(&screen->compile_queue, job, &variant->ready,
+                      execute, swr_compile_job_cleanup<Job>);
+}
+
+struct swr_compile_gs_job {
+   struct swr_screen *screen;
+   struct swr_geometry_shader *swr_gs;
+   struct tgsi_shader_info vs_info;
+   swr_jit_gs_key key;
+   VariantGS *variant;
+};
+
+static void
+swr_compile_gs_execute(void *data, int thread_index)
+{
+   swr_compile_gs_job *job = (swr_compile_gs_job *)data;
+   int64_t start = os_time_get();
+
+   if (p_atomic_read(&job->variant->cancelled))
+      return;
+
+   mtx_lock(&job->screen->jit_mutex);
+   {
+      BuilderSWR builder(
+         reinterpret_cast<JitManager *>(job->screen->hJitMgr),
+         "GS");
+      job->variant->shader =
+         builder.CompileGS(job->swr_gs, &job->vs_info, job->key);
+      job->variant->gallivm = builder.gallivm;
+   }
+   mtx_unlock(&job->screen->jit_mutex);
+
+   swr_record_compile(job->screen, "GS", &job->variant->compile_time,
+                      start, thread_index);
+}
+
+static swr_compile_gs_job *
+swr_create_gs_job(struct swr_context *ctx, swr_jit_gs_key &key)
+{
+   swr_compile_gs_job *job = new swr_compile_gs_job;
+
+   job->swr_gs = ctx->gs;
+   job->vs_info = ctx->vs->info.base;
+   job->key = key;
+
+   return job;
+}
+
 PFN_GS_FUNC
 swr_compile_gs(struct swr_context *ctx, swr_jit_gs_key &key)
 {
-   BuilderSWR builder(
-      reinterpret_cast<JitManager *>(swr_screen(ctx->pipe.screen)->hJitMgr),
-      "GS");
-   PFN_GS_FUNC func = builder.CompileGS(ctx, key);
+   VariantGS *variant = swr_submit_compile<VariantGS>(
+      swr_screen(ctx->pipe.screen), ctx->gs->map,
+      swr_create_gs_job(ctx, key), swr_compile_gs_execute);
 
-   ctx->gs->map.insert(std::make_pair(key, make_unique<VariantGS>(builder.gallivm, func)));
-   return func;
+   return variant->shader;
+}
+
+void
+swr_compile_gs_async(struct swr_context *ctx, swr_jit_gs_key &key)
+{
+   swr_queue_compile<VariantGS>(ctx, ctx->gs, key, swr_create_gs_job,
+                                swr_compile_gs_execute);
 }
 
 void
@@ -744,10 +902,10 @@ BuilderSWR::WriteVS(Value *pVal, Value *pVsContext, Value *pVtxOutput, unsigned
 }
 
 PFN_VERTEX_FUNC
-BuilderSWR::CompileVS(struct swr_context *ctx, swr_jit_vs_key &key)
+BuilderSWR::CompileVS(struct swr_vertex_shader *swr_vs,
+                      unsigned clip_plane_enable,
+                      swr_jit_vs_key &key)
 {
-   struct swr_vertex_shader *swr_vs = ctx->vs;
-
    LLVMValueRef inputs[PIPE_MAX_SHADER_INPUTS][TGSI_NUM_CHANNELS];
    LLVMValueRef outputs[PIPE_MAX_SHADER_OUTPUTS][TGSI_NUM_CHANNELS];
 
@@ -879,9 +1037,9 @@ BuilderSWR::CompileVS(struct swr_context *ctx, swr_jit_vs_key &key)
       }
    }
 
-   if (ctx->rasterizer->clip_plane_enable ||
+   if (clip_plane_enable ||
        swr_vs->info.base.culldist_writemask) {
-      unsigned clip_mask = ctx->rasterizer->clip_plane_enable;
+      unsigned clip_mask = clip_plane_enable;
 
       unsigned cv = 0;
       if (swr_vs->info.base.writes_clipvertex) {
@@ -965,19 +1123,71 @@ BuilderSWR::CompileVS(struct swr_context *ctx, swr_jit_vs_key &key)
    return pFunc;
 }
 
+struct swr_compile_vs_job {
+   struct swr_screen *screen;
+   struct swr_vertex_shader *swr_vs;
+   unsigned clip_plane_enable;
+   swr_jit_vs_key key;
+   VariantVS *variant;
+};
+
+static void
+swr_compile_vs_execute(void *data, int thread_index)
+{
+   swr_compile_vs_job *job = (swr_compile_vs_job *)data;
+   int64_t start = os_time_get();
+
+   if (p_atomic_read(&job->variant->cancelled))
+      return;
+
+   mtx_lock(&job->screen->jit_mutex);
+   {
+      BuilderSWR builder(
+         reinterpret_cast<JitManager *>(job->screen->hJitMgr),
+         "VS");
+      job->variant->shader =
+         builder.CompileVS(job->swr_vs, job->clip_plane_enable, job->key);
+      job->variant->gallivm = builder.gallivm;
+   }
+   mtx_unlock(&job->screen->jit_mutex);
+
+   swr_record_compile(job->screen, "VS", &job->variant->compile_time,
+                      start, thread_index);
+}
+
+static swr_compile_vs_job *
+swr_create_vs_job(struct swr_context *ctx, swr_jit_vs_key &key)
+{
+   swr_compile_vs_job *job = new swr_compile_vs_job;
+
+   job->swr_vs = ctx->vs;
+   job->clip_plane_enable = ctx->rasterizer->clip_plane_enable;
+   job->key = key;
+
+   return job;
+}
+
 PFN_VERTEX_FUNC
 swr_compile_vs(struct swr_context *ctx, swr_jit_vs_key &key)
 {
    if (!ctx->vs->pipe.tokens)
       return NULL;
 
-   BuilderSWR builder(
-      reinterpret_cast<JitManager *>(swr_screen(ctx->pipe.screen)->hJitMgr),
-      "VS");
-   PFN_VERTEX_FUNC func = builder.CompileVS(ctx, key);
+   VariantVS *variant = swr_submit_compile<VariantVS>(
+      swr_screen(ctx->pipe.screen), ctx->vs->map,
+      swr_create_vs_job(ctx, key), swr_compile_vs_execute);
+
+   return variant->shader;
+}
+
+void
+swr_compile_vs_async(struct swr_context *ctx, swr_jit_vs_key &key)
+{
+   if (!ctx->vs->pipe.tokens)
+      return;
 
-   ctx->vs->map.insert(std::make_pair(key, make_unique<VariantVS>(builder.gallivm, func)));
-   return func;
+   swr_queue_compile<VariantVS>(ctx, ctx->vs, key, swr_create_vs_job,
+                                swr_compile_vs_execute);
 }
 
 unsigned
@@ -1021,16 +1231,12 @@ locate_linkage(ubyte name, ubyte index, struct tgsi_shader_info *info)
 }
 
 PFN_PIXEL_KERNEL
-BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_fs_key &key)
+BuilderSWR::CompileFS(struct swr_fragment_shader *swr_fs,
+                      struct tgsi_shader_info *pPrevShader,
+                      bool has_gs,
+                      VariantFS *variant,
+                      swr_jit_fs_key &key)
 {
-   struct swr_fragment_shader *swr_fs = ctx->fs;
-
-   struct tgsi_shader_info *pPrevShader;
-   if (ctx->gs)
-      pPrevShader = &ctx->gs->info.base;
-   else
-      pPrevShader = &ctx->vs->info.base;
-
    LLVMValueRef inputs[PIPE_MAX_SHADER_INPUTS][TGSI_NUM_CHANNELS];
    LLVMValueRef outputs[PIPE_MAX_SHADER_OUTPUTS][TGSI_NUM_CHANNELS];
 
@@ -1083,9 +1289,9 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_fs_key &key)
    Value *pPerspAttribs =
       LOAD(pPS, {0, SWR_PS_CONTEXT_pPerspAttribs}, "pPerspAttribs");
 
-   swr_fs->constantMask = 0;
-   swr_fs->flatConstantMask = 0;
-   swr_fs->pointSpriteMask = 0;
+   variant->constantMask = 0;
+   variant->flatConstantMask = 0;
+   variant->pointSpriteMask = 0;
 
    for (int attrib = 0; attrib < PIPE_MAX_SHADER_INPUTS; attrib++) {
       const unsigned mask = swr_fs->info.base.input_usage_mask[attrib];
@@ -1168,16 +1374,16 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_fs_key &key)
          locate_linkage(semantic_name, semantic_idx, pPrevShader) - 1;
 
       uint32_t extraAttribs = 0;
-      if (semantic_name == TGSI_SEMANTIC_PRIMID && !ctx->gs) {
+      if (semantic_name == TGSI_SEMANTIC_PRIMID && !has_gs) {
          /* non-gs generated primID - need to grab from swizzleMap override */
          linkedAttrib = pPrevShader->num_outputs - 1;
-         swr_fs->constantMask |= 1 << linkedAttrib;
+         variant->constantMask |= 1 << linkedAttrib;
          extraAttribs++;
       } else if (semantic_name == TGSI_SEMANTIC_GENERIC &&
           key.sprite_coord_enable & (1 << semantic_idx)) {
          /* we add an extra attrib to the backendState in swr_update_derived. */
          linkedAttrib = pPrevShader->num_outputs + extraAttribs - 1;
-         swr_fs->pointSpriteMask |= (1 << linkedAttrib);
+         variant->pointSpriteMask |= (1 << linkedAttrib);
          extraAttribs++;
       } else if (linkedAttrib == 0xFFFFFFFF) {
          inputs[attrib][0] = wrap(VIMMED1(0.0f));
@@ -1191,9 +1397,9 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_fs_key &key)
             continue;
       } else {
          if (interpMode == TGSI_INTERPOLATE_CONSTANT) {
-            swr_fs->constantMask |= 1 << linkedAttrib;
+            variant->constantMask |= 1 << linkedAttrib;
          } else if (interpMode == TGSI_INTERPOLATE_COLOR) {
-            swr_fs->flatConstantMask |= 1 << linkedAttrib;
+            variant->flatConstantMask |= 1 << linkedAttrib;
          }
       }
 
@@ -1211,9 +1417,9 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_fs_key &key)
 
          if (bcolorAttrib != 0xFFFFFFFF) {
             if (interpMode == TGSI_INTERPOLATE_CONSTANT) {
-               swr_fs->constantMask |= 1 << bcolorAttrib;
+               variant->constantMask |= 1 << bcolorAttrib;
             } else if (interpMode == TGSI_INTERPOLATE_COLOR) {
-               swr_fs->flatConstantMask |= 1 << bcolorAttrib;
+               variant->flatConstantMask |= 1 << bcolorAttrib;
             }
 
             unsigned diff = 12 * (bcolorAttrib - linkedAttrib);
@@ -1415,17 +1621,70 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_fs_key &key)
    return kernel;
 }
 
-PFN_PIXEL_KERNEL
+struct swr_compile_fs_job {
+   struct swr_screen *screen;
+   struct swr_fragment_shader *swr_fs;
+   struct tgsi_shader_info prev_info;
+   bool has_gs;
+   swr_jit_fs_key key;
+   VariantFS *variant;
+};
+
+static void
+swr_compile_fs_execute(void *data, int thread_index)
+{
+   swr_compile_fs_job *job = (swr_compile_fs_job *)data;
+   int64_t start = os_time_get();
+
+   if (p_atomic_read(&job->variant->cancelled))
+      return;
+
+   mtx_lock(&job->screen->jit_mutex);
+   {
+      BuilderSWR builder(
+         reinterpret_cast<JitManager *>(job->screen->hJitMgr),
+         "FS");
+      job->variant->shader =
+         builder.CompileFS(job->swr_fs, &job->prev_info, job->has_gs,
+                           job->variant, job->key);
+      job->variant->gallivm = builder.gallivm;
+   }
+   mtx_unlock(&job->screen->jit_mutex);
+
+   swr_record_compile(job->screen, "FS", &job->variant->compile_time,
+                      start, thread_index);
+}
+
+static swr_compile_fs_job *
+swr_create_fs_job(struct swr_context *ctx, swr_jit_fs_key &key)
+{
+   swr_compile_fs_job *job = new swr_compile_fs_job;
+
+   job->swr_fs = ctx->fs;
+   job->prev_info = ctx->gs ? ctx->gs->info.base : ctx->vs->info.base;
+   job->has_gs = ctx->gs != NULL;
+   job->key = key;
+
+   return job;
+}
+
+VariantFS *
 swr_compile_fs(struct swr_context *ctx, swr_jit_fs_key &key)
 {
    if (!ctx->fs->pipe.tokens)
       return NULL;
 
-   BuilderSWR builder(
-      reinterpret_cast<JitManager *>(swr_screen(ctx->pipe.screen)->hJitMgr),
-      "FS");
-   PFN_PIXEL_KERNEL func = builder.CompileFS(ctx, key);
+   return swr_submit_compile<VariantFS>(
+      swr_screen(ctx->pipe.screen), ctx->fs->map,
+      swr_create_fs_job(ctx, key), swr_compile_fs_execute);
+}
+
+void
+swr_compile_fs_async(struct swr_context *ctx, swr_jit_fs_key &key)
+{
+   if (!ctx->fs->pipe.tokens)
+      return;
 
-   ctx->fs->map.insert(std::make_pair(key, make_unique<VariantFS>(builder.gallivm, func)));
-   return func;
+   swr_queue_compile<VariantFS>(ctx, ctx->fs, key, swr_create_fs_job,
+                                swr_compile_fs_execute);
 }
@@ -33,15 +33,24 @@ struct swr_jit_gs_key;
 unsigned swr_so_adjust_attrib(unsigned in_attrib,
                               swr_vertex_shader *swr_vs);
 
+struct VariantFS;
+
 PFN_VERTEX_FUNC
 swr_compile_vs(struct swr_context *ctx, swr_jit_vs_key &key);
 
-PFN_PIXEL_KERNEL
+VariantFS *
 swr_compile_fs(struct swr_context *ctx, swr_jit_fs_key &key);
 
 PFN_GS_FUNC
 swr_compile_gs(struct swr_context *ctx, swr_jit_gs_key &key);
 
+/* Speculatively build a variant on the screen's compile thread */
+void swr_compile_vs_async(struct swr_context *ctx, swr_jit_vs_key &key);
+void swr_compile_fs_async(struct swr_context *ctx, swr_jit_fs_key &key);
+void swr_compile_gs_async(struct swr_context *ctx, swr_jit_gs_key &key);
+
+void swr_init_gs_state(struct swr_geometry_shader *gs);
+
 void swr_generate_fs_key(struct swr_jit_fs_key &key,
                          struct swr_context *ctx,
                          swr_fragment_shader *swr_fs);
@@ -42,6 +42,7 @@
 #include "util/u_framebuffer.h"
 #include "util/u_viewport.h"
 #include "util/u_prim.h"
+#include "util/u_atomic.h"
 
 #include "swr_state.h"
 #include "swr_context.h"
@@ -322,6 +323,83 @@ swr_sampler_view_destroy(struct pipe_context *pipe,
    FREE(view);
 }
 
+/*
+ * Return a variant found in a shader's map, first waiting for it if it's
+ * still being built on the compile thread.
+ */
+template <typename Variant>
+static Variant *
+swr_variant_ready(struct swr_context *ctx, Variant *variant)
+{
+   struct swr_screen *screen = swr_screen(ctx->pipe.screen);
+
+   p_atomic_inc(&screen->jit_stats.hits);
+   if (!util_queue_fence_is_signalled(&variant->ready)) {
+      p_atomic_inc(&screen->jit_stats.waits);
+      util_queue_fence_wait(&variant->ready);
+   }
+   return variant;
+}
+
+/* Count a draw-time lookup that has to compile its variant inline */
+static void
+swr_variant_miss(struct swr_context *ctx)
+{
+   p_atomic_inc(&swr_screen(ctx->pipe.screen)->jit_stats.misses);
+}
+
+/* Other state each stage's variant key is generated from */
+#define SWR_VS_KEY_DEPS (SWR_NEW_RASTERIZER | /* for clip planes */ \
+                         SWR_NEW_SAMPLER | \
+                         SWR_NEW_SAMPLER_VIEW | \
+                         SWR_NEW_FRAMEBUFFER)
+#define SWR_FS_KEY_DEPS (SWR_NEW_VS | \
+                         SWR_NEW_GS | \
+                         SWR_NEW_RASTERIZER | \
+                         SWR_NEW_SAMPLER | \
+                         SWR_NEW_SAMPLER_VIEW | \
+                         SWR_NEW_FRAMEBUFFER)
+#define SWR_GS_KEY_DEPS (SWR_NEW_VS | \
+                         SWR_NEW_SAMPLER | \
+                         SWR_NEW_SAMPLER_VIEW)
+
+/*
+ * Return a shader's speculative variant if it was built for key, moving it
+ * into the map.  Otherwise the state it was keyed on changed before the
+ * draw, so cancel it; its job skips the build if it hasn't started yet.
+ */
+template <typename Variant, typename Shader, typename Key>
+static Variant *
+swr_take_prefetch(Shader *shader, const Key &key)
+{
+   if (!shader->prefetch)
+      return NULL;
+
+   if (!(shader->prefetch_key == key) ||
+       p_atomic_read(&shader->prefetch->cancelled)) {
+      p_atomic_set(&shader->prefetch->cancelled, 1);
+      return NULL;
+   }
+
+   Variant *variant = shader->prefetch.release();
+   shader->map.insert(std::make_pair(key, std::unique_ptr<Variant>(variant)));
+   return variant;
+}
+
+/* Wait for queued compiles still reading a shader's tokens */
+template <typename Shader>
+static void
+swr_finish_variants(Shader *shader)
+{
+   for (auto &variant : shader->map)
+      util_queue_fence_wait(&variant.second->ready);
+
+   if (shader->prefetch) {
+      p_atomic_set(&shader->prefetch->cancelled, 1);
+      util_queue_fence_wait(&shader->prefetch->ready);
+   }
+}
+
 static void *
 swr_create_vs_state(struct pipe_context *pipe,
                     const struct pipe_shader_state *vs)
@@ -369,12 +447,22 @@ swr_bind_vs_state(struct pipe_context *pipe, void *vs)
 
    ctx->vs = (swr_vertex_shader *)vs;
    ctx->dirty |= SWR_NEW_VS;
+
+   /* Start building the variant the next draw will most likely need,
+    * unless the state it's keyed on changed since the last draw.
+    */
+   if (ctx->vs && ctx->rasterizer && !(ctx->dirty & SWR_VS_KEY_DEPS)) {
+      swr_jit_vs_key key;
+      swr_generate_vs_key(key, ctx, ctx->vs);
+      swr_compile_vs_async(ctx, key);
+   }
 }
 
 static void
 swr_delete_vs_state(struct pipe_context *pipe, void *vs)
 {
    struct swr_vertex_shader *swr_vs = (swr_vertex_shader *)vs;
+   swr_finish_variants(swr_vs);
    FREE((void *)swr_vs->pipe.tokens);
    struct swr_screen *screen = swr_screen(pipe->screen);
 
@@ -408,12 +496,20 @@ swr_bind_fs_state(struct pipe_context *pipe, void *fs)
 
    ctx->fs = (swr_fragment_shader *)fs;
    ctx->dirty |= SWR_NEW_FS;
+
+   if (ctx->fs && ctx->vs && ctx->rasterizer &&
+       !(ctx->dirty & SWR_FS_KEY_DEPS)) {
+      swr_jit_fs_key key;
+      swr_generate_fs_key(key, ctx, ctx->fs);
+      swr_compile_fs_async(ctx, key);
+   }
 }
 
 static void
 swr_delete_fs_state(struct pipe_context *pipe, void *fs)
 {
    struct swr_fragment_shader *swr_fs = (swr_fragment_shader *)fs;
+   swr_finish_variants(swr_fs);
    FREE((void *)swr_fs->pipe.tokens);
    struct swr_screen *screen = swr_screen(pipe->screen);
 
@@ -433,6 +529,8 @@ swr_create_gs_state(struct pipe_context *pipe,
 
    lp_build_tgsi_info(gs->tokens, &swr_gs->info);
 
+   swr_init_gs_state(swr_gs);
+
    return swr_gs;
 }
 
@@ -447,12 +545,19 @@ swr_bind_gs_state(struct pipe_context *pipe, void *gs)
 
    ctx->gs = (swr_geometry_shader *)gs;
    ctx->dirty |= SWR_NEW_GS;
+
+   if (ctx->gs && ctx->vs && !(ctx->dirty & SWR_GS_KEY_DEPS)) {
+      swr_jit_gs_key key;
+      swr_generate_gs_key(key, ctx, ctx->gs);
+      swr_compile_gs_async(ctx, key);
+   }
 }
 
 static void
 swr_delete_gs_state(struct pipe_context *pipe, void *gs)
 {
    struct swr_geometry_shader *swr_gs = (swr_geometry_shader *)gs;
+   swr_finish_variants(swr_gs);
    FREE((void *)swr_gs->pipe.tokens);
    struct swr_screen *screen = swr_screen(pipe->screen);
 
@@ -1389,18 +1494,19 @@ swr_update_derived(struct pipe_context *pipe,
    }
 
    /* GeometryShader */
-   if (ctx->dirty & (SWR_NEW_GS |
-                     SWR_NEW_VS |
-                     SWR_NEW_SAMPLER |
-                     SWR_NEW_SAMPLER_VIEW)) {
+   if (ctx->dirty & (SWR_NEW_GS | SWR_GS_KEY_DEPS)) {
       if (ctx->gs) {
          swr_jit_gs_key key;
          swr_generate_gs_key(key, ctx, ctx->gs);
          auto search = ctx->gs->map.find(key);
+         VariantGS *variant;
          PFN_GS_FUNC func;
          if (search != ctx->gs->map.end()) {
-            func = search->second->shader;
+            func = swr_variant_ready(ctx, search->second.get())->shader;
+         } else if ((variant = swr_take_prefetch<VariantGS>(ctx->gs, key))) {
+            func = swr_variant_ready(ctx, variant)->shader;
          } else {
+            swr_variant_miss(ctx);
             func = swr_compile_gs(ctx, key);
          }
          ctx->api.pfnSwrSetGsFunc(ctx->swrContext, func);
@@ -1430,18 +1536,18 @@ swr_update_derived(struct pipe_context *pipe,
    }
 
    /* VertexShader */
-   if (ctx->dirty & (SWR_NEW_VS |
-                     SWR_NEW_RASTERIZER | // for clip planes
-                     SWR_NEW_SAMPLER |
-                     SWR_NEW_SAMPLER_VIEW |
-                     SWR_NEW_FRAMEBUFFER)) {
+   if (ctx->dirty & (SWR_NEW_VS | SWR_VS_KEY_DEPS)) {
       swr_jit_vs_key key;
       swr_generate_vs_key(key, ctx, ctx->vs);
       auto search = ctx->vs->map.find(key);
+      VariantVS *variant;
       PFN_VERTEX_FUNC func;
       if (search != ctx->vs->map.end()) {
-         func = search->second->shader;
+         func = swr_variant_ready(ctx, search->second.get())->shader;
+      } else if ((variant = swr_take_prefetch<VariantVS>(ctx->vs, key))) {
+         func = swr_variant_ready(ctx, variant)->shader;
       } else {
+         swr_variant_miss(ctx);
          func = swr_compile_vs(ctx, key);
       }
       ctx->api.pfnSwrSetVertexFunc(ctx->swrContext, func);
@@ -1477,25 +1583,31 @@ swr_update_derived(struct pipe_context *pipe,
    }
 
    /* FragmentShader */
-   if (ctx->dirty & (SWR_NEW_FS |
-                     SWR_NEW_VS |
-                     SWR_NEW_GS |
-                     SWR_NEW_RASTERIZER |
-                     SWR_NEW_SAMPLER |
-                     SWR_NEW_SAMPLER_VIEW |
-                     SWR_NEW_FRAMEBUFFER)) {
+   if (ctx->dirty & (SWR_NEW_FS | SWR_FS_KEY_DEPS)) {
       swr_jit_fs_key key;
       swr_generate_fs_key(key, ctx, ctx->fs);
       auto search = ctx->fs->map.find(key);
-      PFN_PIXEL_KERNEL func;
+      VariantFS *variant;
       if (search != ctx->fs->map.end()) {
-         func = search->second->shader;
+         variant = swr_variant_ready(ctx, search->second.get());
+      } else if ((variant = swr_take_prefetch<VariantFS>(ctx->fs, key))) {
+         variant = swr_variant_ready(ctx, variant);
       } else {
-         func = swr_compile_fs(ctx, key);
+         swr_variant_miss(ctx);
+         variant = swr_compile_fs(ctx, key);
+      }
+      PFN_PIXEL_KERNEL func = NULL;
+      if (variant) {
+         func = variant->shader;
+         ctx->fs->constantMask = variant->constantMask;
+         ctx->fs->flatConstantMask = variant->flatConstantMask;
+         ctx->fs->pointSpriteMask = variant->pointSpriteMask;
       }
       SWR_PS_STATE psState = {0};
       psState.pfnPixelShader = func;
-      psState.killsPixel = ctx->fs->info.base.uses_kill;
+      /* The polygon stipple is applied by the shader, through its mask */
+      psState.killsPixel = ctx->fs->info.base.uses_kill ||
+                           key.poly_stipple_enable;
       psState.inputCoverage = SWR_INPUT_COVERAGE_NORMAL;
       psState.writesODepth = ctx->fs->info.base.writes_z;
       psState.usesSourceDepth = ctx->fs->info.base.reads_z;
@@ -1717,7 +1829,9 @@ swr_update_derived(struct pipe_context *pipe,
                func = search->second;
             } else {
                HANDLE hJitMgr = screen->hJitMgr;
+               mtx_lock(&screen->jit_mutex);
                func = JitCompileBlend(hJitMgr, compileState);
+               mtx_unlock(&screen->jit_mutex);
                debug_printf("BLEND shader %p\n", func);
                assert(func && "Error: BlendShader = NULL");
 
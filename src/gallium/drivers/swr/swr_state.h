@@ -31,6 +31,8 @@
 #include "gallivm/lp_bld_init.h"
 #include "gallivm/lp_bld_tgsi.h"
 #include "util/crc32.h"
+#include "util/u_atomic.h"
+#include "util/u_queue.h"
 #include "api.h"
 #include "swr_tex_sample.h"
 #include "swr_shader.h"
@@ -42,19 +44,56 @@ struct ShaderVariant {
    struct gallivm_state *gallivm;
    T shader;
 
-   ShaderVariant(struct gallivm_state *gs, T code) : gallivm(gs), shader(code) {}
-   ~ShaderVariant() { gallivm_destroy(gallivm); }
+   /* Signalled once gallivm/shader are valid; variants compiled on the
+    * screen's compile queue are inserted into the map before that. */
+   struct util_queue_fence ready;
+   int64_t compile_time; /* microseconds */
+   mtx_t *jit_mutex;
+   unsigned *num_variants; /* the screen's count of live variants */
+   int cancelled; /* a queued build that no draw will use, skip it */
+
+   ShaderVariant(mtx_t *mutex, unsigned *count)
+      : gallivm(NULL), shader(NULL), compile_time(0), jit_mutex(mutex),
+        num_variants(count), cancelled(0)
+   {
+      util_queue_fence_init(&ready);
+      p_atomic_inc(num_variants);
+   }
+   ~ShaderVariant()
+   {
+      util_queue_fence_wait(&ready);
+      util_queue_fence_destroy(&ready);
+      p_atomic_dec(num_variants);
+      if (gallivm) {
+         mtx_lock(jit_mutex);
+         gallivm_destroy(gallivm);
+         mtx_unlock(jit_mutex);
+      }
+   }
 };
 
 typedef ShaderVariant<PFN_VERTEX_FUNC> VariantVS;
-typedef ShaderVariant<PFN_PIXEL_KERNEL> VariantFS;
 typedef ShaderVariant<PFN_GS_FUNC> VariantGS;
 
+struct VariantFS : ShaderVariant<PFN_PIXEL_KERNEL> {
+   /* attribute interpolation derived from fs/vs linkage */
+   uint32_t constantMask;
+   uint32_t flatConstantMask;
+   uint32_t pointSpriteMask;
+
+   VariantFS(mtx_t *mutex, unsigned *count)
+      : ShaderVariant(mutex, count),
+        constantMask(0), flatConstantMask(0), pointSpriteMask(0) {}
+};
+
 /* skeleton */
 struct swr_vertex_shader {
    struct pipe_shader_state pipe;
    struct lp_tgsi_info info;
    std::unordered_map<swr_jit_vs_key, std::unique_ptr<VariantVS>> map;
+   /* built at bind time, moved into map once a draw wants prefetch_key */
+   swr_jit_vs_key prefetch_key;
+   std::unique_ptr<VariantVS> prefetch;
    SWR_STREAMOUT_STATE soState;
    PFN_SO_FUNC soFunc[PIPE_PRIM_MAX] {0};
 };
@@ -66,6 +105,9 @@ struct swr_fragment_shader {
    uint32_t flatConstantMask;
    uint32_t pointSpriteMask;
    std::unordered_map<swr_jit_fs_key, std::unique_ptr<VariantFS>> map;
+   /* built at bind time, moved into map once a draw wants prefetch_key */
+   swr_jit_fs_key prefetch_key;
+   std::unique_ptr<VariantFS> prefetch;
 };
 
 struct swr_geometry_shader {
@@ -74,6 +116,9 @@ struct swr_geometry_shader {
    SWR_GS_STATE gsState;
 
    std::unordered_map<swr_jit_gs_key, std::unique_ptr<VariantGS>> map;
+   /* built at bind time, moved into map once a draw wants prefetch_key */
+   swr_jit_gs_key prefetch_key;
+   std::unique_ptr<VariantGS> prefetch;
 };
 
 /* Vertex element state */
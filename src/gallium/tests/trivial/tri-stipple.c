@@ -0,0 +1,312 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Draws a red quad over the whole render target, then a green one with a
+ * checkerboard polygon stipple.  The pixels the stipple leaves out must
+ * still be red: a stippled draw doesn't overwrite what it covers, so a
+ * driver must not drop the earlier contents (swr skips loading tiles
+ * which a draw replaces completely).
+ */
+
+#define WIDTH 256
+#define HEIGHT 256
+
+#include <stdio.h>
+
+/* pipe_*_state structs */
+#include "pipe/p_state.h"
+/* pipe_context */
+#include "pipe/p_context.h"
+/* pipe_screen */
+#include "pipe/p_screen.h"
+/* PIPE_* */
+#include "pipe/p_defines.h"
+/* TGSI_SEMANTIC_{POSITION|GENERIC} */
+#include "pipe/p_shader_tokens.h"
+/* pipe_buffer_* helpers */
+#include "util/u_inlines.h"
+
+/* constant state object helper */
+#include "cso_cache/cso_context.h"
+
+/* u_box_2d */
+#include "util/u_box.h"
+/* util_draw_vertex_buffer helper */
+#include "util/u_draw_quad.h"
+/* FREE & CALLOC_STRUCT */
+#include "util/u_memory.h"
+/* util_make_[fragment|vertex]_passthrough_shader */
+#include "util/u_simple_shaders.h"
+/* to get a hardware pipe driver */
+#include "pipe-loader/pipe_loader.h"
+
+/* B8G8R8A8_UNORM texels, as read on a little-endian machine */
+#define RED   0xffff0000
+#define GREEN 0xff00ff00
+
+struct program
+{
+	struct pipe_loader_device *dev;
+	struct pipe_screen *screen;
+	struct pipe_context *pipe;
+	struct cso_context *cso;
+
+	struct pipe_blend_state blend;
+	struct pipe_depth_stencil_alpha_state depthstencil;
+	struct pipe_rasterizer_state rasterizer;
+	struct pipe_poly_stipple stipple;
+	struct pipe_viewport_state viewport;
+	struct pipe_framebuffer_state framebuffer;
+	struct pipe_vertex_element velem[2];
+
+	void *vs;
+	void *fs;
+
+	struct pipe_resource *vbuf[2];
+	struct pipe_resource *target;
+};
+
+static struct pipe_resource *
+create_quad(struct program *p, float r, float g, float b)
+{
+	struct pipe_resource *vbuf;
+	float vertices[4][2][4] = {
+		{ { -1.0f, -1.0f, 0.0f, 1.0f }, { r, g, b, 1.0f } },
+		{ {  1.0f, -1.0f, 0.0f, 1.0f }, { r, g, b, 1.0f } },
+		{ {  1.0f,  1.0f, 0.0f, 1.0f }, { r, g, b, 1.0f } },
+		{ { -1.0f,  1.0f, 0.0f, 1.0f }, { r, g, b, 1.0f } },
+	};
+
+	vbuf = pipe_buffer_create(p->screen, PIPE_BIND_VERTEX_BUFFER,
+				  PIPE_USAGE_DEFAULT, sizeof(vertices));
+	pipe_buffer_write(p->pipe, vbuf, 0, sizeof(vertices), vertices);
+	return vbuf;
+}
+
+static void init_prog(struct program *p)
+{
+	struct pipe_surface surf_tmpl;
+	unsigned i;
+	int ret;
+
+	/* find a hardware device */
+	ret = pipe_loader_probe(&p->dev, 1);
+	assert(ret);
+
+	/* init a pipe screen */
+	p->screen = pipe_loader_create_screen(p->dev);
+	assert(p->screen);
+
+	/* create the pipe driver context and cso context */
+	p->pipe = p->screen->context_create(p->screen, NULL, 0);
+	p->cso = cso_create_context(p->pipe, 0);
+
+	/* vertex buffers */
+	p->vbuf[0] = create_quad(p, 1.0f, 0.0f, 0.0f);
+	p->vbuf[1] = create_quad(p, 0.0f, 1.0f, 0.0f);
+
+	/* render target texture */
+	{
+		struct pipe_resource tmplt;
+		memset(&tmplt, 0, sizeof(tmplt));
+		tmplt.target = PIPE_TEXTURE_2D;
+		tmplt.format = PIPE_FORMAT_B8G8R8A8_UNORM; /* All drivers support this */
+		tmplt.width0 = WIDTH;
+		tmplt.height0 = HEIGHT;
+		tmplt.depth0 = 1;
+		tmplt.array_size = 1;
+		tmplt.last_level = 0;
+		tmplt.bind = PIPE_BIND_RENDER_TARGET;
+
+		p->target = p->screen->resource_create(p->screen, &tmplt);
+	}
+
+	/* disabled blending/masking */
+	memset(&p->blend, 0, sizeof(p->blend));
+	p->blend.rt[0].colormask = PIPE_MASK_RGBA;
+
+	/* no-op depth/stencil/alpha */
+	memset(&p->depthstencil, 0, sizeof(p->depthstencil));
+
+	/* rasterizer */
+	memset(&p->rasterizer, 0, sizeof(p->rasterizer));
+	p->rasterizer.cull_face = PIPE_FACE_NONE;
+	p->rasterizer.half_pixel_center = 1;
+	p->rasterizer.bottom_edge_rule = 1;
+	p->rasterizer.depth_clip = 1;
+
+	/* checkerboard stipple */
+	for (i = 0; i < ARRAY_SIZE(p->stipple.stipple); i++)
+		p->stipple.stipple[i] = i & 1 ? 0xaaaaaaaa : 0x55555555;
+
+	surf_tmpl.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+	surf_tmpl.u.tex.level = 0;
+	surf_tmpl.u.tex.first_layer = 0;
+	surf_tmpl.u.tex.last_layer = 0;
+	/* drawing destination */
+	memset(&p->framebuffer, 0, sizeof(p->framebuffer));
+	p->framebuffer.width = WIDTH;
+	p->framebuffer.height = HEIGHT;
+	p->framebuffer.nr_cbufs = 1;
+	p->framebuffer.cbufs[0] = p->pipe->create_surface(p->pipe, p->target, &surf_tmpl);
+
+	/* viewport */
+	memset(&p->viewport, 0, sizeof(p->viewport));
+	p->viewport.scale[0] = (float)WIDTH / 2.0f;
+	p->viewport.scale[1] = (float)HEIGHT / 2.0f;
+	p->viewport.scale[2] = 1.0f;
+	p->viewport.translate[0] = (float)WIDTH / 2.0f;
+	p->viewport.translate[1] = (float)HEIGHT / 2.0f;
+
+	/* vertex elements state */
+	memset(p->velem, 0, sizeof(p->velem));
+	p->velem[0].src_offset = 0 * 4 * sizeof(float); /* offset 0, first element */
+	p->velem[0].instance_divisor = 0;
+	p->velem[0].vertex_buffer_index = 0;
+	p->velem[0].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+
+	p->velem[1].src_offset = 1 * 4 * sizeof(float); /* offset 16, second element */
+	p->velem[1].instance_divisor = 0;
+	p->velem[1].vertex_buffer_index = 0;
+	p->velem[1].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+
+	/* vertex shader */
+	{
+		const enum tgsi_semantic semantic_names[] =
+			{ TGSI_SEMANTIC_POSITION, TGSI_SEMANTIC_COLOR };
+		const uint semantic_indexes[] = { 0, 0 };
+		p->vs = util_make_vertex_passthrough_shader(p->pipe, 2, semantic_names, semantic_indexes, FALSE);
+	}
+
+	/* fragment shader */
+	p->fs = util_make_fragment_passthrough_shader(p->pipe,
+                    TGSI_SEMANTIC_COLOR, TGSI_INTERPOLATE_PERSPECTIVE, TRUE);
+}
+
+static void close_prog(struct program *p)
+{
+	cso_destroy_context(p->cso);
+
+	p->pipe->delete_vs_state(p->pipe, p->vs);
+	p->pipe->delete_fs_state(p->pipe, p->fs);
+
+	pipe_surface_reference(&p->framebuffer.cbufs[0], NULL);
+	pipe_resource_reference(&p->target, NULL);
+	pipe_resource_reference(&p->vbuf[0], NULL);
+	pipe_resource_reference(&p->vbuf[1], NULL);
+
+	p->pipe->destroy(p->pipe);
+	p->screen->destroy(p->screen);
+	pipe_loader_release(&p->dev, 1);
+
+	FREE(p);
+}
+
+static void draw_quad(struct program *p, struct pipe_resource *vbuf)
+{
+	util_draw_vertex_buffer(p->pipe, p->cso,
+	                        vbuf, 0, 0,
+	                        PIPE_PRIM_TRIANGLE_FAN,
+	                        4,  /* verts */
+	                        2); /* attribs/vert */
+}
+
+static void draw(struct program *p)
+{
+	/* set the render target */
+	cso_set_framebuffer(p->cso, &p->framebuffer);
+
+	/* set misc state we care about */
+	cso_set_blend(p->cso, &p->blend);
+	cso_set_depth_stencil_alpha(p->cso, &p->depthstencil);
+	cso_set_viewport(p->cso, &p->viewport);
+
+	/* shaders */
+	cso_set_fragment_shader_handle(p->cso, p->fs);
+	cso_set_vertex_shader_handle(p->cso, p->vs);
+
+	/* vertex element data */
+	cso_set_vertex_elements(p->cso, 2, p->velem);
+
+	/* opaque red, stored to the render target */
+	cso_set_rasterizer(p->cso, &p->rasterizer);
+	draw_quad(p, p->vbuf[0]);
+	p->pipe->flush(p->pipe, NULL, 0);
+
+	/* stippled green on top */
+	p->rasterizer.poly_stipple_enable = 1;
+	cso_set_rasterizer(p->cso, &p->rasterizer);
+	p->pipe->set_polygon_stipple(p->pipe, &p->stipple);
+	draw_quad(p, p->vbuf[1]);
+	p->pipe->flush(p->pipe, NULL, 0);
+}
+
+static int check(struct program *p)
+{
+	struct pipe_transfer *transfer;
+	struct pipe_box box;
+	const uint8_t *map;
+	unsigned red = 0, green = 0, other = 0;
+	unsigned x, y;
+
+	u_box_2d(0, 0, WIDTH, HEIGHT, &box);
+	map = p->pipe->transfer_map(p->pipe, p->target, 0, PIPE_TRANSFER_READ,
+				    &box, &transfer);
+
+	for (y = 0; y < HEIGHT; y++) {
+		const uint32_t *row = (const uint32_t *)(map + y * transfer->stride);
+
+		for (x = 0; x < WIDTH; x++) {
+			if (row[x] == RED)
+				red++;
+			else if (row[x] == GREEN)
+				green++;
+			else
+				other++;
+		}
+	}
+
+	p->pipe->transfer_unmap(p->pipe, transfer);
+
+	printf("red %u, green %u, other %u\n", red, green, other);
+	if (red != WIDTH * HEIGHT / 2 || green != WIDTH * HEIGHT / 2) {
+		printf("FAIL\n");
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	struct program *p = CALLOC_STRUCT(program);
+	int ret;
+
+	init_prog(p);
+	draw(p);
+	ret = check(p);
+	close_prog(p);
+
+	return ret;
+}
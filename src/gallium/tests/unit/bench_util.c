@@ -0,0 +1,385 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench_util.h"
+
+#include "cso_cache/cso_context.h"
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "softpipe/sp_public.h"
+#include "sw/null/null_sw_winsys.h"
+#include "util/os_time.h"
+#include "util/u_box.h"
+#include "util/u_draw_quad.h"
+#include "util/u_format.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+
+struct pipe_screen *
+bench_create_screen(void)
+{
+   return softpipe_create_screen(null_sw_create());
+}
+
+
+/**
+ * Whether the command line asks for the named case: all of them without
+ * arguments.
+ */
+boolean
+bench_selected(int argc, char **argv, const char *name)
+{
+   int i;
+
+   if (argc <= 1)
+      return TRUE;
+
+   for (i = 1; i < argc; i++) {
+      if (strcmp(argv[i], name) == 0)
+         return TRUE;
+   }
+
+   return FALSE;
+}
+
+
+/**
+ * Call func repeatedly, and return how many times count items it handles
+ * per second, in the best of a few runs, to filter out noise from the rest
+ * of the system.
+ */
+double
+bench_measure(void (*func)(void *data), void *data, unsigned count)
+{
+   double best = 0.0;
+   unsigned r;
+
+   for (r = 0; r < BENCH_NUM_RUNS; r++) {
+      int64_t start, elapsed;
+      unsigned calls = 0;
+
+      start = os_time_get_nano();
+      do {
+         func(data);
+         calls++;
+         elapsed = os_time_get_nano() - start;
+      } while (elapsed < BENCH_MIN_NSECS);
+
+      best = MAX2(best, (double)calls * count / (elapsed / 1e9));
+   }
+
+   return best;
+}
+
+
+float
+bench_frand(float min, float max)
+{
+   return min + (max - min) * (rand() % 65536) / 65536.0f;
+}
+
+
+/**
+ * Random clip space positions, stride bytes apart, for primitives of
+ * verts_per_prim vertices each.  The first vertex of a primitive lands
+ * anywhere on screen, the others up to size away from it.
+ */
+void
+bench_random_positions(float *pos, unsigned stride, unsigned num_verts,
+                       unsigned verts_per_prim, float size)
+{
+   const float *first = pos;
+   unsigned i;
+
+   for (i = 0; i < num_verts; i++) {
+      float *v = (float *)((uint8_t *)pos + i * stride);
+
+      if (i % verts_per_prim == 0) {
+         v[0] = bench_frand(-1.1f, 1.1f);
+         v[1] = bench_frand(-1.1f, 1.1f);
+         first = v;
+      }
+      else {
+         v[0] = first[0] + bench_frand(-size, size);
+         v[1] = first[1] + bench_frand(-size, size);
+      }
+      v[2] = bench_frand(-0.5f, 0.5f);
+      v[3] = 1.0f;
+   }
+}
+
+
+/**
+ * Create a texture from templ, with random contents in all its levels and
+ * layers: bytes, or floats between 0 and 1 for float formats.
+ */
+struct pipe_resource *
+bench_create_texture(struct pipe_screen *screen, struct pipe_context *pipe,
+                     const struct pipe_resource *templ)
+{
+   const unsigned stride =
+      util_format_get_stride(templ->format, templ->width0);
+   const unsigned layer_stride =
+      util_format_get_2d_size(templ->format, stride, templ->height0);
+   struct pipe_resource *tex;
+   unsigned level, i;
+   uint8_t *data;
+
+   tex = screen->resource_create(screen, templ);
+   if (!tex)
+      return NULL;
+
+   data = MALLOC(layer_stride * MAX2(templ->depth0, templ->array_size));
+   for (level = 0; level <= templ->last_level; level++) {
+      const unsigned size = layer_stride * util_num_layers(tex, level);
+      struct pipe_box box;
+
+      if (util_format_is_float(templ->format)) {
+         float *f = (float *)data;
+
+         for (i = 0; i < size / 4; i++)
+            f[i] = rand() / (float) RAND_MAX;
+      }
+      else {
+         for (i = 0; i < size; i++)
+            data[i] = rand();
+      }
+
+      u_box_3d(0, 0, 0, u_minify(templ->width0, level),
+               u_minify(templ->height0, level), util_num_layers(tex, level),
+               &box);
+      pipe->texture_subdata(pipe, tex, level, 0, &box, data, stride,
+                            layer_stride);
+   }
+   FREE(data);
+
+   return tex;
+}
+
+
+/**
+ * Compare all layers of a level of two resources, which may belong to
+ * different contexts, and report the first difference.
+ */
+boolean
+bench_compare(struct pipe_context *pipe_a, struct pipe_resource *a,
+              struct pipe_context *pipe_b, struct pipe_resource *b,
+              unsigned level, const char *name)
+{
+   const unsigned width = u_minify(a->width0, level);
+   const unsigned height = u_minify(a->height0, level);
+   const unsigned layers = util_num_layers(a, level);
+   const unsigned blocksize = util_format_get_blocksize(a->format);
+   const unsigned row_size = util_format_get_stride(a->format, width);
+   struct pipe_transfer *transfer_a, *transfer_b;
+   const uint8_t *map_a, *map_b;
+   struct pipe_box box;
+   boolean success = TRUE;
+   unsigned layer, y;
+
+   u_box_3d(0, 0, 0, width, height, layers, &box);
+   map_a = pipe_a->transfer_map(pipe_a, a, level, PIPE_TRANSFER_READ, &box,
+                                &transfer_a);
+   map_b = pipe_b->transfer_map(pipe_b, b, level, PIPE_TRANSFER_READ, &box,
+                                &transfer_b);
+
+   for (layer = 0; layer < layers && success; layer++) {
+      for (y = 0; y < height; y++) {
+         const uint8_t *row_a = map_a + layer * transfer_a->layer_stride +
+                                y * transfer_a->stride;
+         const uint8_t *row_b = map_b + layer * transfer_b->layer_stride +
+                                y * transfer_b->stride;
+         unsigned x;
+
+         if (memcmp(row_a, row_b, row_size) == 0)
+            continue;
+
+         for (x = 0; row_a[x] == row_b[x]; x++)
+            ;
+         printf("%s: %s mismatch in level %u, layer %u at %u,%u\n",
+                name, util_format_short_name(a->format), level, layer,
+                x / blocksize, y);
+         success = FALSE;
+         break;
+      }
+   }
+
+   pipe_a->transfer_unmap(pipe_a, transfer_a);
+   pipe_b->transfer_unmap(pipe_b, transfer_b);
+
+   return success;
+}
+
+
+static struct pipe_resource *
+create_target(struct pipe_screen *screen, unsigned width, unsigned height,
+              enum pipe_format format, unsigned bind)
+{
+   struct pipe_resource templ;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = format;
+   templ.width0 = width;
+   templ.height0 = height;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = bind;
+
+   return screen->resource_create(screen, &templ);
+}
+
+
+/**
+ * Create a context rendering to a color buffer, and to a depth buffer
+ * unless zsbuf_format is PIPE_FORMAT_NONE.
+ */
+struct bench_context *
+bench_create_context(struct pipe_screen *screen, unsigned width,
+                     unsigned height, enum pipe_format cbuf_format,
+                     enum pipe_format zsbuf_format)
+{
+   struct bench_context *ctx = CALLOC_STRUCT(bench_context);
+   struct pipe_surface surf_templ;
+
+   ctx->pipe = screen->context_create(screen, NULL, 0);
+   if (!ctx->pipe)
+      return NULL;
+   ctx->cso = cso_create_context(ctx->pipe, 0);
+   ctx->cbuf = create_target(screen, width, height, cbuf_format,
+                             PIPE_BIND_RENDER_TARGET);
+   if (zsbuf_format != PIPE_FORMAT_NONE)
+      ctx->zsbuf = create_target(screen, width, height, zsbuf_format,
+                                 PIPE_BIND_DEPTH_STENCIL);
+   if (!ctx->cso || !ctx->cbuf ||
+       (zsbuf_format != PIPE_FORMAT_NONE && !ctx->zsbuf))
+      return NULL;
+
+   memset(&surf_templ, 0, sizeof surf_templ);
+   surf_templ.format = cbuf_format;
+   ctx->framebuffer.width = width;
+   ctx->framebuffer.height = height;
+   ctx->framebuffer.nr_cbufs = 1;
+   ctx->framebuffer.cbufs[0] =
+      ctx->pipe->create_surface(ctx->pipe, ctx->cbuf, &surf_templ);
+   if (ctx->zsbuf) {
+      surf_templ.format = zsbuf_format;
+      ctx->framebuffer.zsbuf =
+         ctx->pipe->create_surface(ctx->pipe, ctx->zsbuf, &surf_templ);
+   }
+
+   return ctx;
+}
+
+
+void
+bench_destroy_context(struct bench_context *ctx)
+{
+   cso_destroy_context(ctx->cso);
+   pipe_surface_reference(&ctx->framebuffer.cbufs[0], NULL);
+   pipe_surface_reference(&ctx->framebuffer.zsbuf, NULL);
+   pipe_resource_reference(&ctx->cbuf, NULL);
+   pipe_resource_reference(&ctx->zsbuf, NULL);
+   ctx->pipe->destroy(ctx->pipe);
+   FREE(ctx);
+}
+
+
+/** Filled triangles, no culling, GL rules */
+void
+bench_init_rasterizer(struct pipe_rasterizer_state *rast)
+{
+   memset(rast, 0, sizeof *rast);
+   rast->cull_face = PIPE_FACE_NONE;
+   rast->half_pixel_center = 1;
+   rast->bottom_edge_rule = 1;
+   rast->depth_clip = 1;
+   rast->line_width = 1.0f;
+   rast->point_size = 1.0f;
+}
+
+
+/** Bilinear filtering of a repeating texture, without mipmaps */
+void
+bench_init_sampler(struct pipe_sampler_state *sampler)
+{
+   memset(sampler, 0, sizeof *sampler);
+   sampler->wrap_s = PIPE_TEX_WRAP_REPEAT;
+   sampler->wrap_t = PIPE_TEX_WRAP_REPEAT;
+   sampler->wrap_r = PIPE_TEX_WRAP_CLAMP_TO_EDGE;
+   sampler->min_img_filter = PIPE_TEX_FILTER_LINEAR;
+   sampler->mag_img_filter = PIPE_TEX_FILTER_LINEAR;
+   sampler->min_mip_filter = PIPE_TEX_MIPFILTER_NONE;
+   sampler->normalized_coords = 1;
+}
+
+
+/** Bind the framebuffer, and a viewport covering it */
+void
+bench_bind_framebuffer(struct bench_context *ctx)
+{
+   struct pipe_viewport_state viewport;
+
+   viewport.scale[0] = ctx->framebuffer.width / 2.0f;
+   viewport.scale[1] = ctx->framebuffer.height / 2.0f;
+   viewport.scale[2] = 0.5f;
+   viewport.translate[0] = ctx->framebuffer.width / 2.0f;
+   viewport.translate[1] = ctx->framebuffer.height / 2.0f;
+   viewport.translate[2] = 0.5f;
+
+   cso_set_framebuffer(ctx->cso, &ctx->framebuffer);
+   cso_set_viewport(ctx->cso, &viewport);
+}
+
+
+/**
+ * Clear the framebuffer, and draw from a vertex buffer of num_attribs
+ * float[4] attributes per vertex, with the bound state.
+ */
+void
+bench_draw(struct bench_context *ctx, struct pipe_resource *vbuf,
+           enum pipe_prim_type prim, unsigned num_verts,
+           unsigned num_attribs)
+{
+   static const union pipe_color_union clear_color = {
+      .f = { 0.2f, 0.3f, 0.4f, 1.0f }
+   };
+   unsigned buffers = PIPE_CLEAR_COLOR;
+
+   if (ctx->zsbuf)
+      buffers |= PIPE_CLEAR_DEPTHSTENCIL;
+
+   ctx->pipe->clear(ctx->pipe, buffers, &clear_color, 1.0, 0);
+   util_draw_vertex_buffer(ctx->pipe, ctx->cso, vbuf, 0, 0, prim,
+                           num_verts, num_attribs);
+   ctx->pipe->flush(ctx->pipe, NULL, 0);
+}
@@ -0,0 +1,111 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+
+/*
+ * Helpers shared by the benchmarks in this directory: measurement loops,
+ * random input, and a softpipe context rendering to a framebuffer of its
+ * own, whose contents two contexts can compare.
+ */
+
+
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+
+#include "pipe/p_compiler.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_state.h"
+
+
+struct cso_context;
+struct pipe_context;
+struct pipe_screen;
+
+
+/** Each run of a measurement lasts at least this long, best run wins */
+#define BENCH_MIN_NSECS (200 * 1000 * 1000)
+#define BENCH_NUM_RUNS 3
+
+
+/** A context with a cso_context and the color and depth buffers it renders to */
+struct bench_context
+{
+   struct pipe_context *pipe;
+   struct cso_context *cso;
+   struct pipe_resource *cbuf, *zsbuf;
+   struct pipe_framebuffer_state framebuffer;
+};
+
+
+struct pipe_screen *
+bench_create_screen(void);
+
+boolean
+bench_selected(int argc, char **argv, const char *name);
+
+double
+bench_measure(void (*func)(void *data), void *data, unsigned count);
+
+float
+bench_frand(float min, float max);
+
+void
+bench_random_positions(float *pos, unsigned stride, unsigned num_verts,
+                       unsigned verts_per_prim, float size);
+
+struct pipe_resource *
+bench_create_texture(struct pipe_screen *screen, struct pipe_context *pipe,
+                     const struct pipe_resource *templ);
+
+boolean
+bench_compare(struct pipe_context *pipe_a, struct pipe_resource *a,
+              struct pipe_context *pipe_b, struct pipe_resource *b,
+              unsigned level, const char *name);
+
+struct bench_context *
+bench_create_context(struct pipe_screen *screen, unsigned width,
+                     unsigned height, enum pipe_format cbuf_format,
+                     enum pipe_format zsbuf_format);
+
+void
+bench_destroy_context(struct bench_context *ctx);
+
+void
+bench_init_rasterizer(struct pipe_rasterizer_state *rast);
+
+void
+bench_init_sampler(struct pipe_sampler_state *sampler);
+
+void
+bench_bind_framebuffer(struct bench_context *ctx);
+
+void
+bench_draw(struct bench_context *ctx, struct pipe_resource *vbuf,
+           enum pipe_prim_type prim, unsigned num_verts,
+           unsigned num_attribs);
+
+
+#endif /* BENCH_UTIL_H */
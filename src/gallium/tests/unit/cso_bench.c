@@ -0,0 +1,273 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Cost of the cso_context state lookups when an application keeps
+ * switching between a set of states, on softpipe.
+ *
+ * Usage: cso_bench [workload...]
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_util.h"
+
+#include "cso_cache/cso_context.h"
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "util/u_memory.h"
+
+
+#define NUM_STATES 64
+#define NUM_THRASH_STATES 6000   /* more than the cache keeps */
+#define NUM_SAMPLERS 8
+#define BATCH_SIZE 1024
+
+
+struct states
+{
+   struct pipe_blend_state blend[NUM_THRASH_STATES];
+   unsigned thrash_order[NUM_THRASH_STATES];
+   struct pipe_depth_stencil_alpha_state dsa[NUM_STATES];
+   struct pipe_rasterizer_state rast[NUM_STATES];
+   struct pipe_sampler_state sampler[NUM_STATES * NUM_SAMPLERS];
+   struct pipe_vertex_element velems[NUM_STATES][4];
+};
+
+
+static void
+init_states(struct states *s)
+{
+   unsigned i, j;
+
+   memset(s, 0, sizeof *s);
+
+   for (i = 0; i < NUM_THRASH_STATES; i++) {
+      struct pipe_blend_state *blend = &s->blend[i];
+      blend->rt[0].blend_enable = 1;
+      blend->rt[0].rgb_func = i % 5;
+      blend->rt[0].rgb_src_factor = PIPE_BLENDFACTOR_ONE + (i / 5) % 0x15;
+      blend->rt[0].rgb_dst_factor = PIPE_BLENDFACTOR_ONE + (i / 105) % 0x15;
+      blend->rt[0].alpha_func = blend->rt[0].rgb_func;
+      blend->rt[0].alpha_src_factor = blend->rt[0].rgb_src_factor;
+      blend->rt[0].alpha_dst_factor = blend->rt[0].rgb_dst_factor;
+      blend->rt[0].colormask = 0xf - (i / 2205) % 4;
+   }
+
+   /* a fixed shuffle, so neighbouring states aren't set one after another */
+   for (i = 0; i < NUM_THRASH_STATES; i++) {
+      j = rand() % (i + 1);
+      s->thrash_order[i] = s->thrash_order[j];
+      s->thrash_order[j] = i;
+   }
+
+   for (i = 0; i < NUM_STATES; i++) {
+      struct pipe_depth_stencil_alpha_state *dsa = &s->dsa[i];
+      dsa->depth.enabled = 1;
+      dsa->depth.writemask = i & 1;
+      dsa->depth.func = (i >> 1) % 8;
+      dsa->stencil[0].enabled = 1;
+      dsa->stencil[0].func = PIPE_FUNC_ALWAYS;
+      dsa->stencil[0].zpass_op = PIPE_STENCIL_OP_REPLACE;
+      dsa->stencil[0].valuemask = 0xff;
+      dsa->stencil[0].writemask = i;
+   }
+
+   for (i = 0; i < NUM_STATES; i++) {
+      struct pipe_rasterizer_state *rast = &s->rast[i];
+      rast->cull_face = i % 4;
+      rast->front_ccw = (i / 4) & 1;
+      rast->scissor = (i / 8) & 1;
+      rast->half_pixel_center = 1;
+      rast->bottom_edge_rule = 1;
+      rast->depth_clip = 1;
+      rast->line_width = 1.0f + (i / 16);
+      rast->point_size = 1.0f;
+   }
+
+   for (i = 0; i < NUM_STATES * NUM_SAMPLERS; i++) {
+      struct pipe_sampler_state *sampler = &s->sampler[i];
+      sampler->wrap_s = i % 3;
+      sampler->wrap_t = (i / 3) % 3;
+      sampler->wrap_r = PIPE_TEX_WRAP_CLAMP_TO_EDGE;
+      sampler->min_img_filter = (i / 9) & 1;
+      sampler->mag_img_filter = (i / 9) & 1;
+      sampler->min_mip_filter = (i / 18) % 3;
+      sampler->normalized_coords = 1;
+      sampler->lod_bias = (i / 54) * 0.25f;
+      sampler->max_lod = 16.0f;
+   }
+
+   for (i = 0; i < NUM_STATES; i++) {
+      for (j = 0; j < 4; j++) {
+         struct pipe_vertex_element *velem = &s->velems[i][j];
+         velem->src_offset = j * 16 + (i % 4) * 4;
+         velem->vertex_buffer_index = (i / 4) % 2;
+         velem->src_format = PIPE_FORMAT_R32G32B32A32_FLOAT - (i / 8) % 3;
+      }
+   }
+}
+
+
+static void
+run_blend(struct cso_context *cso, const struct states *s, unsigned i)
+{
+   cso_set_blend(cso, &s->blend[i % NUM_STATES]);
+}
+
+static void
+run_dsa(struct cso_context *cso, const struct states *s, unsigned i)
+{
+   cso_set_depth_stencil_alpha(cso, &s->dsa[i % NUM_STATES]);
+}
+
+static void
+run_rasterizer(struct cso_context *cso, const struct states *s, unsigned i)
+{
+   cso_set_rasterizer(cso, &s->rast[i % NUM_STATES]);
+}
+
+static void
+run_samplers(struct cso_context *cso, const struct states *s, unsigned i)
+{
+   const struct pipe_sampler_state *samplers[NUM_SAMPLERS];
+   unsigned j;
+
+   for (j = 0; j < NUM_SAMPLERS; j++)
+      samplers[j] = &s->sampler[(i * 7 + j * NUM_STATES) %
+                                (NUM_STATES * NUM_SAMPLERS)];
+   cso_set_samplers(cso, PIPE_SHADER_FRAGMENT, NUM_SAMPLERS, samplers);
+}
+
+static void
+run_velems(struct cso_context *cso, const struct states *s, unsigned i)
+{
+   cso_set_vertex_elements(cso, 4, s->velems[i % NUM_STATES]);
+}
+
+static void
+run_draw(struct cso_context *cso, const struct states *s, unsigned i)
+{
+   run_blend(cso, s, i);
+   run_dsa(cso, s, i * 3);
+   run_rasterizer(cso, s, i * 5);
+   run_samplers(cso, s, i);
+   run_velems(cso, s, i * 11);
+}
+
+static void
+run_thrash(struct cso_context *cso, const struct states *s, unsigned i)
+{
+   cso_set_blend(cso, &s->blend[i % NUM_THRASH_STATES]);
+}
+
+static void
+run_thrash_random(struct cso_context *cso, const struct states *s, unsigned i)
+{
+   cso_set_blend(cso, &s->blend[s->thrash_order[i % NUM_THRASH_STATES]]);
+}
+
+
+static const struct {
+   const char *name;
+   void (*run)(struct cso_context *cso, const struct states *s, unsigned i);
+} workloads[] = {
+   { "blend", run_blend },
+   { "dsa", run_dsa },
+   { "rasterizer", run_rasterizer },
+   { "samplers", run_samplers },
+   { "velems", run_velems },
+   { "draw", run_draw },
+   { "thrash", run_thrash },
+   { "thrash_random", run_thrash_random },
+};
+
+
+struct workload_args
+{
+   struct cso_context *cso;
+   const struct states *states;
+   void (*run)(struct cso_context *cso, const struct states *s, unsigned i);
+   unsigned iterations;
+};
+
+static void
+run_batch(void *data)
+{
+   struct workload_args *args = data;
+   unsigned i;
+
+   for (i = 0; i < BATCH_SIZE; i++)
+      args->run(args->cso, args->states, args->iterations + i);
+   args->iterations += BATCH_SIZE;
+}
+
+
+int main(int argc, char **argv)
+{
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   struct cso_context *cso;
+   struct states *states;
+   unsigned w;
+
+   screen = bench_create_screen();
+   if (!screen)
+      return 1;
+   pipe = screen->context_create(screen, NULL, 0);
+   cso = pipe ? cso_create_context(pipe, 0) : NULL;
+   states = MALLOC_STRUCT(states);
+   if (!cso || !states)
+      return 1;
+
+   init_states(states);
+
+   printf("%-14s %10s\n", "workload", "ns/call");
+
+   for (w = 0; w < ARRAY_SIZE(workloads); w++) {
+      struct workload_args args = { cso, states, workloads[w].run, 0 };
+      unsigned i;
+
+      if (!bench_selected(argc, argv, workloads[w].name))
+         continue;
+
+      /* create the states outside of the measurement */
+      for (i = 0; i < NUM_STATES; i++)
+         workloads[w].run(cso, states, i);
+
+      printf("%-14s %10.1f\n", workloads[w].name,
+             1e9 / bench_measure(run_batch, &args, BATCH_SIZE));
+   }
+
+   FREE(states);
+   cso_destroy_context(cso);
+   pipe->destroy(pipe);
+   screen->destroy(screen);
+
+   return 0;
+}
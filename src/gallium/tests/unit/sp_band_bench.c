@@ -0,0 +1,354 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Softpipe rendering speed with the rasterization done in bands by
+ * SOFTPIPE_NUM_THREADS extra threads (3 if not set), versus done by the
+ * calling thread alone.  The depth buffer must come out the same.  Colors
+ * are only rounded to the color buffer's precision when rasterizing in
+ * bands, so the color buffer must come out the same as with a single band
+ * thread.
+ *
+ * Usage: sp_band_bench [scene...]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench_util.h"
+
+#include "cso_cache/cso_context.h"
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "util/u_debug.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_prim.h"
+#include "util/u_sampler.h"
+#include "util/u_simple_shaders.h"
+
+
+#define WIDTH 1024
+#define HEIGHT 768
+#define TEX_SIZE 256
+
+
+/** A vertex: clip space position, and color or texcoords */
+struct vertex
+{
+   float pos[4];
+   float attr[4];
+};
+
+
+struct scene
+{
+   const char *name;
+   unsigned prim;
+   unsigned num_verts;
+   boolean textured;
+   boolean blend;
+   boolean depth;
+   float line_width;
+   float point_size;
+};
+
+static const struct scene scenes[] = {
+   /* big overlapping triangles, like most piglit tests draw */
+   { "fill", PIPE_PRIM_TRIANGLES, 3 * 64, FALSE, FALSE, FALSE, 1.0f, 1.0f },
+   { "blend", PIPE_PRIM_TRIANGLES, 3 * 64, FALSE, TRUE, FALSE, 1.0f, 1.0f },
+   { "textured", PIPE_PRIM_TRIANGLES, 3 * 64, TRUE, FALSE, TRUE, 1.0f, 1.0f },
+   /* lots of small primitives */
+   { "small_tris", PIPE_PRIM_TRIANGLES, 3 * 20000, FALSE, FALSE, TRUE,
+     1.0f, 1.0f },
+   { "lines", PIPE_PRIM_LINES, 2 * 4000, FALSE, TRUE, FALSE, 3.0f, 1.0f },
+   { "points", PIPE_PRIM_POINTS, 20000, TRUE, FALSE, TRUE, 1.0f, 6.0f },
+};
+
+
+/** Everything one context renders with */
+struct program
+{
+   struct bench_context *ctx;
+   struct pipe_sampler_view *view;
+   void *vs, *fs_color, *fs_tex;
+   /* what draw() draws */
+   const struct scene *scene;
+   struct pipe_resource *vbuf;
+};
+
+
+static struct vertex *
+create_vertices(const struct scene *s)
+{
+   struct vertex *verts = MALLOC(s->num_verts * sizeof *verts);
+   /* how big the primitives are, in clip space */
+   const float size = s->num_verts > 1000 ? 0.05f : 1.5f;
+   unsigned i, j;
+
+   srand(s->num_verts + s->prim);
+
+   bench_random_positions(verts[0].pos, sizeof *verts, s->num_verts,
+                          u_vertices_per_prim(s->prim), size);
+
+   /* colors, or texcoords which wrap around a bit */
+   for (i = 0; i < s->num_verts; i++) {
+      for (j = 0; j < 4; j++)
+         verts[i].attr[j] = s->textured ? bench_frand(-0.5f, 1.5f) :
+                                          bench_frand(0.0f, 1.0f);
+   }
+
+   return verts;
+}
+
+
+/**
+ * Create a context, with or without rasterizer threads.
+ */
+static struct program *
+create_program(struct pipe_screen *screen, unsigned nr_threads)
+{
+   static const enum tgsi_semantic semantic_names[] =
+      { TGSI_SEMANTIC_POSITION, TGSI_SEMANTIC_GENERIC };
+   static const uint semantic_indexes[] = { 0, 0 };
+   struct program *p = CALLOC_STRUCT(program);
+   struct pipe_context *pipe;
+   char value[16];
+
+   /* the option is read when the context is created */
+   snprintf(value, sizeof value, "%u", nr_threads);
+   setenv("SOFTPIPE_NUM_THREADS", value, 1);
+   p->ctx = bench_create_context(screen, WIDTH, HEIGHT,
+                                 PIPE_FORMAT_B8G8R8A8_UNORM,
+                                 PIPE_FORMAT_Z24_UNORM_S8_UINT);
+   if (!p->ctx)
+      return NULL;
+   pipe = p->ctx->pipe;
+
+   p->vs = util_make_vertex_passthrough_shader(pipe, 2, semantic_names,
+                                               semantic_indexes, FALSE);
+   p->fs_color = util_make_fragment_passthrough_shader(pipe,
+                                                       TGSI_SEMANTIC_GENERIC,
+                                                       TGSI_INTERPOLATE_PERSPECTIVE,
+                                                       FALSE);
+   p->fs_tex = util_make_fragment_tex_shader(pipe, TGSI_TEXTURE_2D,
+                                             TGSI_INTERPOLATE_PERSPECTIVE,
+                                             TGSI_RETURN_TYPE_FLOAT,
+                                             TGSI_RETURN_TYPE_FLOAT,
+                                             false, false);
+
+   return p;
+}
+
+
+static void
+destroy_program(struct program *p)
+{
+   struct pipe_context *pipe = p->ctx->pipe;
+
+   cso_set_vertex_shader_handle(p->ctx->cso, NULL);
+   cso_set_fragment_shader_handle(p->ctx->cso, NULL);
+   pipe->delete_vs_state(pipe, p->vs);
+   pipe->delete_fs_state(pipe, p->fs_color);
+   pipe->delete_fs_state(pipe, p->fs_tex);
+   pipe_sampler_view_reference(&p->view, NULL);
+   bench_destroy_context(p->ctx);
+   FREE(p);
+}
+
+
+static void
+bind_state(struct program *p, const struct scene *s,
+           struct pipe_resource *vbuf)
+{
+   struct cso_context *cso = p->ctx->cso;
+   struct pipe_blend_state blend;
+   struct pipe_depth_stencil_alpha_state dsa;
+   struct pipe_rasterizer_state rast;
+   struct pipe_sampler_state sampler;
+   const struct pipe_sampler_state *samplers[1] = { &sampler };
+   struct pipe_vertex_element velems[2];
+
+   memset(&blend, 0, sizeof blend);
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   if (s->blend) {
+      blend.rt[0].blend_enable = 1;
+      blend.rt[0].rgb_func = PIPE_BLEND_ADD;
+      blend.rt[0].rgb_src_factor = PIPE_BLENDFACTOR_SRC_ALPHA;
+      blend.rt[0].rgb_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+      blend.rt[0].alpha_func = PIPE_BLEND_ADD;
+      blend.rt[0].alpha_src_factor = PIPE_BLENDFACTOR_ONE;
+      blend.rt[0].alpha_dst_factor = PIPE_BLENDFACTOR_ONE;
+   }
+
+   memset(&dsa, 0, sizeof dsa);
+   if (s->depth) {
+      dsa.depth.enabled = 1;
+      dsa.depth.writemask = 1;
+      dsa.depth.func = PIPE_FUNC_LESS;
+   }
+
+   bench_init_rasterizer(&rast);
+   rast.line_width = s->line_width;
+   rast.point_size = s->point_size;
+   rast.point_quad_rasterization = s->textured;
+   rast.sprite_coord_enable = s->prim == PIPE_PRIM_POINTS && s->textured;
+
+   bench_init_sampler(&sampler);
+
+   memset(velems, 0, sizeof velems);
+   velems[0].src_offset = 0;
+   velems[0].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   velems[1].src_offset = 4 * sizeof(float);
+   velems[1].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+
+   bench_bind_framebuffer(p->ctx);
+   cso_set_blend(cso, &blend);
+   cso_set_depth_stencil_alpha(cso, &dsa);
+   cso_set_rasterizer(cso, &rast);
+   cso_set_samplers(cso, PIPE_SHADER_FRAGMENT, 1, samplers);
+   cso_set_sampler_views(cso, PIPE_SHADER_FRAGMENT, 1, &p->view);
+   cso_set_vertex_elements(cso, 2, velems);
+   cso_set_vertex_shader_handle(cso, p->vs);
+   cso_set_fragment_shader_handle(cso, s->textured ? p->fs_tex :
+                                                     p->fs_color);
+
+   p->scene = s;
+   p->vbuf = vbuf;
+}
+
+
+/** Draw one frame of the bound scene */
+static void
+draw(void *data)
+{
+   struct program *p = data;
+
+   bench_draw(p->ctx, p->vbuf, p->scene->prim, p->scene->num_verts, 2);
+}
+
+
+static boolean
+bench_scene(struct pipe_screen *screen, struct program *single,
+            struct program *banded, struct program *threaded,
+            const struct scene *s)
+{
+   struct vertex *verts = create_vertices(s);
+   const unsigned size = s->num_verts * sizeof *verts;
+   struct pipe_resource *vbuf;
+   double single_rate, threaded_rate;
+   boolean success;
+
+   vbuf = pipe_buffer_create(screen, PIPE_BIND_VERTEX_BUFFER,
+                             PIPE_USAGE_DEFAULT, size);
+   pipe_buffer_write(single->ctx->pipe, vbuf, 0, size, verts);
+   FREE(verts);
+
+   bind_state(single, s, vbuf);
+   bind_state(banded, s, vbuf);
+   bind_state(threaded, s, vbuf);
+
+   draw(single);
+   draw(banded);
+   draw(threaded);
+   success = bench_compare(banded->ctx->pipe, banded->ctx->cbuf,
+                           threaded->ctx->pipe, threaded->ctx->cbuf,
+                           0, s->name) &&
+             bench_compare(single->ctx->pipe, single->ctx->zsbuf,
+                           threaded->ctx->pipe, threaded->ctx->zsbuf,
+                           0, s->name);
+
+   single_rate = bench_measure(draw, single, 1);
+   threaded_rate = bench_measure(draw, threaded, 1);
+   printf("%-12s %10.1f %10.1f %8.2fx\n", s->name, single_rate,
+          threaded_rate, threaded_rate / single_rate);
+
+   pipe_resource_reference(&vbuf, NULL);
+
+   return success;
+}
+
+
+int main(int argc, char **argv)
+{
+   struct pipe_screen *screen;
+   struct pipe_resource templ, *tex;
+   struct pipe_sampler_view view_templ;
+   struct program *single, *banded, *threaded;
+   boolean success = TRUE;
+   unsigned nr_threads;
+   unsigned i;
+
+   nr_threads = debug_get_num_option("SOFTPIPE_NUM_THREADS", 3);
+
+   screen = bench_create_screen();
+   if (!screen)
+      return 1;
+   single = create_program(screen, 0);
+   banded = create_program(screen, 1);
+   threaded = create_program(screen, nr_threads);
+   if (!single || !banded || !threaded)
+      return 1;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = PIPE_FORMAT_R8G8B8A8_UNORM;
+   templ.width0 = TEX_SIZE;
+   templ.height0 = TEX_SIZE;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = PIPE_BIND_SAMPLER_VIEW;
+   tex = bench_create_texture(screen, single->ctx->pipe, &templ);
+   if (!tex)
+      return 1;
+   u_sampler_view_default_template(&view_templ, tex, tex->format);
+   single->view = single->ctx->pipe->create_sampler_view(single->ctx->pipe,
+                                                         tex, &view_templ);
+   banded->view = banded->ctx->pipe->create_sampler_view(banded->ctx->pipe,
+                                                         tex, &view_templ);
+   threaded->view =
+      threaded->ctx->pipe->create_sampler_view(threaded->ctx->pipe, tex,
+                                               &view_templ);
+
+   printf("%u rasterizer threads\n", nr_threads);
+   printf("%-12s %10s %10s %9s\n", "scene", "single", "threaded", "");
+   printf("%-12s %10s %10s\n", "", "fps", "fps");
+
+   for (i = 0; i < ARRAY_SIZE(scenes); i++) {
+      if (bench_selected(argc, argv, scenes[i].name))
+         success &= bench_scene(screen, single, banded, threaded,
+                                &scenes[i]);
+   }
+
+   destroy_program(single);
+   destroy_program(banded);
+   destroy_program(threaded);
+   pipe_resource_reference(&tex, NULL);
+   screen->destroy(screen);
+
+   return success ? 0 : 1;
+}
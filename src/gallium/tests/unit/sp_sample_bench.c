@@ -0,0 +1,318 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Fragment shader texture sampling throughput of softpipe, through the
+ * per-pixel filters and the tile cache, and through the quad path which
+ * reads 2D textures directly.  Both must give the same texels.
+ *
+ * Usage: sp_sample_bench [case...]
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench_util.h"
+
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "softpipe/sp_context.h"
+#include "softpipe/sp_tex_sample.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_sampler.h"
+
+
+#define QUADS_X 64
+#define QUADS_Y 64
+#define NUM_QUADS (QUADS_X * QUADS_Y)
+
+
+struct sample_case
+{
+   const char *name;
+   enum pipe_format format;
+   unsigned width, height;
+   unsigned img_filter;
+   unsigned mip_filter;
+   unsigned wrap;
+   float scale;   /* texels per pixel */
+   boolean extreme;   /* also NaN, infinite and huge texcoords */
+};
+
+static const struct sample_case cases[] = {
+   { "nearest", PIPE_FORMAT_R8G8B8A8_UNORM, 256, 256,
+     PIPE_TEX_FILTER_NEAREST, PIPE_TEX_MIPFILTER_NONE,
+     PIPE_TEX_WRAP_REPEAT, 1.0f },
+   { "bilinear", PIPE_FORMAT_R8G8B8A8_UNORM, 256, 256,
+     PIPE_TEX_FILTER_LINEAR, PIPE_TEX_MIPFILTER_NONE,
+     PIPE_TEX_WRAP_REPEAT, 0.8f },
+   { "bilinear_npot", PIPE_FORMAT_B8G8R8A8_UNORM, 300, 200,
+     PIPE_TEX_FILTER_LINEAR, PIPE_TEX_MIPFILTER_NONE,
+     PIPE_TEX_WRAP_CLAMP_TO_EDGE, 1.3f },
+   { "mip_nearest", PIPE_FORMAT_B8G8R8X8_UNORM, 300, 200,
+     PIPE_TEX_FILTER_LINEAR, PIPE_TEX_MIPFILTER_NEAREST,
+     PIPE_TEX_WRAP_CLAMP_TO_EDGE, 2.3f },
+   { "trilinear", PIPE_FORMAT_R8G8B8A8_UNORM, 256, 256,
+     PIPE_TEX_FILTER_LINEAR, PIPE_TEX_MIPFILTER_LINEAR,
+     PIPE_TEX_WRAP_REPEAT, 1.7f },
+   { "trilinear_mag", PIPE_FORMAT_R8G8B8X8_UNORM, 300, 200,
+     PIPE_TEX_FILTER_LINEAR, PIPE_TEX_MIPFILTER_LINEAR,
+     PIPE_TEX_WRAP_CLAMP_TO_EDGE, 0.7f },
+   { "float_nearest", PIPE_FORMAT_R32G32B32A32_FLOAT, 256, 256,
+     PIPE_TEX_FILTER_NEAREST, PIPE_TEX_MIPFILTER_NONE,
+     PIPE_TEX_WRAP_CLAMP_TO_EDGE, 1.0f },
+   { "float_trilinear", PIPE_FORMAT_R32G32B32A32_FLOAT, 256, 256,
+     PIPE_TEX_FILTER_LINEAR, PIPE_TEX_MIPFILTER_LINEAR,
+     PIPE_TEX_WRAP_REPEAT, 3.1f },
+   { "repeat_extreme", PIPE_FORMAT_R8G8B8A8_UNORM, 256, 256,
+     PIPE_TEX_FILTER_LINEAR, PIPE_TEX_MIPFILTER_NONE,
+     PIPE_TEX_WRAP_REPEAT, 0.8f, TRUE },
+   { "clamp_extreme", PIPE_FORMAT_B8G8R8A8_UNORM, 300, 200,
+     PIPE_TEX_FILTER_NEAREST, PIPE_TEX_MIPFILTER_NONE,
+     PIPE_TEX_WRAP_CLAMP_TO_EDGE, 1.3f, TRUE },
+};
+
+
+struct quads
+{
+   float s[NUM_QUADS][TGSI_QUAD_SIZE];
+   float t[NUM_QUADS][TGSI_QUAD_SIZE];
+   float rgba[NUM_QUADS][TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
+};
+
+
+static struct pipe_resource *
+create_texture(struct pipe_screen *screen, struct pipe_context *pipe,
+               const struct sample_case *c)
+{
+   struct pipe_resource templ;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = c->format;
+   templ.width0 = c->width;
+   templ.height0 = c->height;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.last_level = util_logbase2(MAX2(c->width, c->height));
+   templ.bind = PIPE_BIND_SAMPLER_VIEW;
+
+   return bench_create_texture(screen, pipe, &templ);
+}
+
+
+/**
+ * Texcoords of a screen-aligned quad grid, slightly offset so that the
+ * texture wraps or is clamped on the left and top.  For the extreme cases,
+ * one pixel in every other quad gets one of the values below instead.
+ */
+static void
+init_coords(const struct sample_case *c, struct quads *q)
+{
+   static const float extreme[] = {
+      INFINITY, -INFINITY, NAN, 1e9f, -1e9f, 3e5f, -3e5f, 127.9f, -128.0f
+   };
+   const float ds = c->scale / c->width;
+   const float dt = c->scale / c->height;
+   unsigned qx, qy, j;
+
+   for (qy = 0; qy < QUADS_Y; qy++) {
+      for (qx = 0; qx < QUADS_X; qx++) {
+         const unsigned n = qy * QUADS_X + qx;
+         for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+            const float x = qx * 2 + (j & 1) + 0.5f;
+            const float y = qy * 2 + (j >> 1) + 0.5f;
+            q->s[n][j] = x * ds - 0.13f;
+            q->t[n][j] = y * dt - 0.21f;
+         }
+         if (c->extreme && n % 2) {
+            const float e = extreme[n / 2 % ARRAY_SIZE(extreme)];
+            if (n / 2 % 3 == 0)
+               q->s[n][n / 2 % TGSI_QUAD_SIZE] = e;
+            else if (n / 2 % 3 == 1)
+               q->t[n][n / 2 % TGSI_QUAD_SIZE] = e;
+            else
+               q->s[n][n / 2 % TGSI_QUAD_SIZE] =
+                  q->t[n][n / 2 % TGSI_QUAD_SIZE] = e;
+         }
+      }
+   }
+}
+
+
+struct run_args
+{
+   struct tgsi_sampler *sampler;
+   struct quads *q;
+};
+
+static void
+run(void *data)
+{
+   static const float zero[TGSI_QUAD_SIZE] = { 0.0f };
+   static const int8_t offset[3] = { 0 };
+   struct run_args *args = data;
+   struct quads *q = args->q;
+   float derivs[3][2][TGSI_QUAD_SIZE];
+   unsigned n;
+
+   for (n = 0; n < NUM_QUADS; n++)
+      args->sampler->get_samples(args->sampler, 0, 0, q->s[n], q->t[n],
+                                 zero, zero, zero, derivs, offset,
+                                 TGSI_SAMPLER_LOD_NONE, q->rgba[n]);
+}
+
+
+/** Millions of pixels per second */
+static double
+measure(struct run_args *args)
+{
+   return bench_measure(run, args, NUM_QUADS * TGSI_QUAD_SIZE) / 1e6;
+}
+
+
+static boolean
+bench_case(struct pipe_screen *screen, struct pipe_context *pipe,
+           const struct sample_case *c, struct quads *q)
+{
+   struct sp_tgsi_sampler *sampler =
+      softpipe_context(pipe)->tgsi.sampler[PIPE_SHADER_FRAGMENT];
+   struct pipe_sampler_state state;
+   struct pipe_sampler_view templ, *view;
+   struct pipe_resource *tex;
+   struct run_args args;
+   float (*reference)[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
+   double generic_rate, quad_rate = 0.0;
+   boolean success = TRUE;
+   void *cso;
+   unsigned n;
+
+   tex = create_texture(screen, pipe, c);
+   if (!tex)
+      return FALSE;
+
+   u_sampler_view_default_template(&templ, tex, c->format);
+   view = pipe->create_sampler_view(pipe, tex, &templ);
+
+   memset(&state, 0, sizeof state);
+   state.wrap_s = c->wrap;
+   state.wrap_t = c->wrap;
+   state.wrap_r = PIPE_TEX_WRAP_CLAMP_TO_EDGE;
+   state.min_img_filter = c->img_filter;
+   state.mag_img_filter = c->img_filter;
+   state.min_mip_filter = c->mip_filter;
+   state.normalized_coords = 1;
+   state.max_lod = 16.0f;
+   cso = pipe->create_sampler_state(pipe, &state);
+
+   pipe->bind_sampler_states(pipe, PIPE_SHADER_FRAGMENT, 0, 1, &cso);
+   pipe->set_sampler_views(pipe, PIPE_SHADER_FRAGMENT, 0, 1, &view);
+   /* normally done when validating the state for a draw */
+   sampler->sp_sampler[0] = cso;
+
+   init_coords(c, q);
+   args.sampler = &sampler->base;
+   args.q = q;
+
+   /* per-pixel filters, through the tile cache */
+   sampler->sp_sview[0].quad_2d = FALSE;
+   run(&args);
+   reference = MALLOC(sizeof q->rgba);
+   memcpy(reference, q->rgba, sizeof q->rgba);
+   generic_rate = measure(&args);
+
+   /* quad path, if it applies at all */
+   sampler->sp_sview[0].quad_2d = ((struct sp_sampler_view *)view)->quad_2d;
+   if (sampler->sp_sview[0].quad_2d) {
+      memset(q->rgba, 0, sizeof q->rgba);
+      run(&args);
+      for (n = 0; n < NUM_QUADS * TGSI_NUM_CHANNELS * TGSI_QUAD_SIZE; n++) {
+         const float *out = &q->rgba[0][0][0];
+         const float *ref = &reference[0][0][0];
+         if (memcmp(&out[n], &ref[n], sizeof(float)) != 0) {
+            printf("%s: mismatch in quad %u, pixel %u, channel %u: %a, "
+                   "expected %a\n", c->name,
+                   n / (TGSI_NUM_CHANNELS * TGSI_QUAD_SIZE),
+                   n % TGSI_QUAD_SIZE,
+                   n / TGSI_QUAD_SIZE % TGSI_NUM_CHANNELS,
+                   out[n], ref[n]);
+            success = FALSE;
+            break;
+         }
+      }
+      quad_rate = measure(&args);
+   }
+
+   if (quad_rate)
+      printf("%-16s %10.1f %10.1f %8.2fx\n",
+             c->name, generic_rate, quad_rate, quad_rate / generic_rate);
+   else
+      printf("%-16s %10.1f %10s\n", c->name, generic_rate, "n/a");
+
+   FREE(reference);
+   pipe_sampler_view_reference(&view, NULL);
+   pipe->set_sampler_views(pipe, PIPE_SHADER_FRAGMENT, 0, 1, &view);
+   pipe->delete_sampler_state(pipe, cso);
+   pipe_resource_reference(&tex, NULL);
+
+   return success;
+}
+
+
+int main(int argc, char **argv)
+{
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   struct quads *quads;
+   boolean success = TRUE;
+   unsigned i;
+
+   screen = bench_create_screen();
+   if (!screen)
+      return 1;
+   pipe = screen->context_create(screen, NULL, 0);
+   quads = MALLOC_STRUCT(quads);
+   if (!pipe || !quads)
+      return 1;
+
+   printf("%-16s %10s %10s %9s\n", "case", "generic", "quad", "");
+   printf("%-16s %10s %10s\n", "", "Mpix/s", "Mpix/s");
+
+   srand(0);
+   for (i = 0; i < ARRAY_SIZE(cases); i++) {
+      if (bench_selected(argc, argv, cases[i].name))
+         success &= bench_case(screen, pipe, &cases[i], quads);
+   }
+
+   FREE(quads);
+   pipe->destroy(pipe);
+   screen->destroy(screen);
+
+   return success ? 0 : 1;
+}
@@ -0,0 +1,497 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Softpipe rendering speed with shader-heavy vertex, geometry and fragment
+ * shaders, run by tgsi_exec with its pre-decoded instructions versus with
+ * TGSI_EXEC_PREDECODE=0.  The float color buffer must come out the same.
+ *
+ * Usage: tgsi_exec_bench [scene...]
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench_util.h"
+
+#include "cso_cache/cso_context.h"
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "tgsi/tgsi_text.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_sampler.h"
+#include "util/u_simple_shaders.h"
+
+
+#define WIDTH 512
+#define HEIGHT 512
+#define TEX_SIZE 256
+#define NUM_CONSTS 16
+
+
+/**
+ * Vertex shader transforming the position, eye position and normal, and
+ * lighting with two lights, like fixed function would.
+ */
+static const char vs_text[] =
+   "VERT\n"
+   "DCL IN[0]\n"
+   "DCL IN[1]\n"
+   "DCL IN[2]\n"
+   "DCL OUT[0], POSITION\n"
+   "DCL OUT[1], GENERIC[0]\n"
+   "DCL OUT[2], GENERIC[1]\n"
+   "DCL OUT[3], GENERIC[2]\n"
+   "DCL CONST[0..15]\n"
+   "DCL TEMP[0..3]\n"
+   "IMM[0] FLT32 { 0.0, 1.0, 0.5, 16.0 }\n"
+   "MUL TEMP[0], CONST[0], IN[0].xxxx\n"
+   "MAD TEMP[0], CONST[1], IN[0].yyyy, TEMP[0]\n"
+   "MAD TEMP[0], CONST[2], IN[0].zzzz, TEMP[0]\n"
+   "MAD OUT[0], CONST[3], IN[0].wwww, TEMP[0]\n"
+   "DP4 TEMP[1].x, IN[0], CONST[4]\n"
+   "DP4 TEMP[1].y, IN[0], CONST[5]\n"
+   "DP4 TEMP[1].z, IN[0], CONST[6]\n"
+   "MOV TEMP[1].w, IMM[0].yyyy\n"
+   "DP3 TEMP[2].x, IN[1], CONST[8]\n"
+   "DP3 TEMP[2].y, IN[1], CONST[9]\n"
+   "DP3 TEMP[2].z, IN[1], CONST[10]\n"
+   "DP3 TEMP[3].x, TEMP[2], TEMP[2]\n"
+   "RSQ TEMP[3].x, TEMP[3].xxxx\n"
+   "MUL TEMP[2].xyz, TEMP[2], TEMP[3].xxxx\n"
+   "DP3 TEMP[3].x, TEMP[2], CONST[11]\n"
+   "DP3 TEMP[3].y, TEMP[2], CONST[12]\n"
+   "MAX TEMP[3].xy, TEMP[3], IMM[0].xxxx\n"
+   "MUL TEMP[0], CONST[13], TEMP[3].xxxx\n"
+   "MAD TEMP[0], CONST[14], TEMP[3].yyyy, TEMP[0]\n"
+   "ADD_SAT OUT[1], TEMP[0], CONST[15]\n"
+   "MAD OUT[2], IN[2], CONST[7].xyxy, CONST[7].zwzw\n"
+   "MAD OUT[3], TEMP[2], IMM[0].zzzz, IMM[0].zzzz\n"
+   "END\n";
+
+/** Per-pixel lighting */
+static const char fs_alu_text[] =
+   "FRAG\n"
+   "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+   "DCL IN[1], GENERIC[1], PERSPECTIVE\n"
+   "DCL IN[2], GENERIC[2], PERSPECTIVE\n"
+   "DCL OUT[0], COLOR\n"
+   "DCL CONST[0..15]\n"
+   "DCL TEMP[0..3]\n"
+   "IMM[0] FLT32 { 0.0, 1.0, 2.0, 0.25 }\n"
+   "MAD TEMP[0], IN[2], IMM[0].zzzz, -IMM[0].yyyy\n"
+   "DP3 TEMP[1].x, TEMP[0], TEMP[0]\n"
+   "RSQ TEMP[1].x, TEMP[1].xxxx\n"
+   "MUL TEMP[0].xyz, TEMP[0], TEMP[1].xxxx\n"
+   "DP3 TEMP[1].x, TEMP[0], CONST[8]\n"
+   "DP3 TEMP[1].y, TEMP[0], CONST[9]\n"
+   "DP3 TEMP[1].z, TEMP[0], CONST[10]\n"
+   "MAX TEMP[1].xyz, TEMP[1], IMM[0].xxxx\n"
+   "MUL TEMP[2], CONST[11], TEMP[1].xxxx\n"
+   "MAD TEMP[2], CONST[12], TEMP[1].yyyy, TEMP[2]\n"
+   "MAD TEMP[2], CONST[13], TEMP[1].zzzz, TEMP[2]\n"
+   "MAD TEMP[3], IN[1], CONST[7].xyxy, CONST[7].zwzw\n"
+   "MUL TEMP[3], TEMP[3], TEMP[3]\n"
+   "ADD TEMP[2], TEMP[2], TEMP[3]\n"
+   "MAD TEMP[2], IN[0], |CONST[14]|, TEMP[2]\n"
+   "MUL_SAT OUT[0], TEMP[2], IMM[0].wwww\n"
+   "END\n";
+
+/** Two texture lookups with transformed coordinates, modulated */
+static const char fs_tex_text[] =
+   "FRAG\n"
+   "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+   "DCL IN[1], GENERIC[1], PERSPECTIVE\n"
+   "DCL OUT[0], COLOR\n"
+   "DCL SAMP[0]\n"
+   "DCL SVIEW[0], 2D, FLOAT\n"
+   "DCL CONST[0..15]\n"
+   "DCL TEMP[0..2]\n"
+   "MAD TEMP[0], IN[1], CONST[7].xyxy, CONST[7].zwzw\n"
+   "TEX TEMP[1], TEMP[0], SAMP[0], 2D\n"
+   "MAD TEMP[0], IN[1].yxyx, CONST[7].zwzw, CONST[7].xyxy\n"
+   "TEX TEMP[2], TEMP[0], SAMP[0], 2D\n"
+   "MUL TEMP[1], TEMP[1], CONST[13]\n"
+   "MAD TEMP[1], TEMP[2], CONST[14], TEMP[1]\n"
+   "MUL OUT[0], TEMP[1], IN[0]\n"
+   "END\n";
+
+
+/**
+ * Passes the triangles through, computing the color in the output, which
+ * is read back after the first EMIT.
+ */
+static const char gs_text[] =
+   "GEOM\n"
+   "PROPERTY GS_INPUT_PRIMITIVE TRIANGLES\n"
+   "PROPERTY GS_OUTPUT_PRIMITIVE TRIANGLE_STRIP\n"
+   "PROPERTY GS_MAX_OUTPUT_VERTICES 3\n"
+   "DCL IN[][0], POSITION\n"
+   "DCL IN[][1], GENERIC[0]\n"
+   "DCL OUT[0], POSITION\n"
+   "DCL OUT[1], GENERIC[0]\n"
+   "DCL CONST[0..15]\n"
+   "IMM[0] INT32 { 0, 0, 0, 0 }\n"
+   "MOV OUT[0], IN[0][0]\n"
+   "MUL OUT[1], IN[0][1], CONST[13]\n"
+   "ADD OUT[1], OUT[1], CONST[14]\n"
+   "EMIT IMM[0].xxxx\n"
+   "MOV OUT[0], IN[1][0]\n"
+   "MUL OUT[1], IN[1][1], CONST[13]\n"
+   "ADD OUT[1], OUT[1], CONST[14]\n"
+   "EMIT IMM[0].xxxx\n"
+   "MOV OUT[0], IN[2][0]\n"
+   "MUL OUT[1], IN[2][1], CONST[13]\n"
+   "ADD OUT[1], OUT[1], CONST[14]\n"
+   "EMIT IMM[0].xxxx\n"
+   "END\n";
+
+
+/** A vertex: object space position, normal and texcoords */
+struct vertex
+{
+   float pos[4];
+   float normal[4];
+   float texcoord[4];
+};
+
+
+enum fs_kind
+{
+   FS_COLOR,
+   FS_ALU,
+   FS_TEX,
+   NUM_FS
+};
+
+struct scene
+{
+   const char *name;
+   unsigned num_verts;
+   enum fs_kind fs;
+   boolean gs;
+};
+
+static const struct scene scenes[] = {
+   /* lots of small triangles: mostly vertex shading */
+   { "vs", 3 * 20000, FS_COLOR },
+   /* big triangles: mostly fragment shading */
+   { "fs_alu", 3 * 16, FS_ALU },
+   { "fs_tex", 3 * 16, FS_TEX },
+   { "gs", 3 * 10000, FS_COLOR, TRUE },
+};
+
+
+/** Everything one context renders with */
+struct program
+{
+   struct bench_context *ctx;
+   struct pipe_sampler_view *view;
+   void *vs, *gs, *fs[NUM_FS];
+   /* what draw() draws */
+   const struct scene *scene;
+   struct pipe_resource *vbuf;
+};
+
+
+static struct vertex *
+create_vertices(const struct scene *s)
+{
+   struct vertex *verts = MALLOC(s->num_verts * sizeof *verts);
+   /* how big the triangles are, in object space */
+   const float size = s->num_verts > 1000 ? 0.05f : 1.5f;
+   unsigned i, j;
+
+   srand(s->num_verts);
+
+   bench_random_positions(verts[0].pos, sizeof *verts, s->num_verts, 3,
+                          size);
+
+   for (i = 0; i < s->num_verts; i++) {
+      for (j = 0; j < 4; j++) {
+         verts[i].normal[j] = bench_frand(-1.0f, 1.0f);
+         verts[i].texcoord[j] = bench_frand(-0.5f, 1.5f);
+      }
+   }
+
+   return verts;
+}
+
+
+static void
+init_constants(float (*consts)[4])
+{
+   static const float mvp[4][4] = {
+      { 0.9f, 0.1f, 0.0f, 0.0f },
+      { -0.1f, 0.9f, 0.05f, 0.0f },
+      { 0.0f, -0.05f, 0.8f, 0.2f },
+      { 0.02f, -0.03f, 0.1f, 1.0f },
+   };
+   unsigned i, j;
+
+   srand(1);
+   for (i = 0; i < NUM_CONSTS; i++) {
+      for (j = 0; j < 4; j++)
+         consts[i][j] = bench_frand(-1.0f, 1.0f);
+   }
+   memcpy(consts, mvp, sizeof mvp);
+   /* texcoord scale and offset */
+   consts[7][0] = 1.5f;
+   consts[7][1] = -2.0f;
+   consts[7][2] = 0.25f;
+   consts[7][3] = 0.125f;
+}
+
+
+static void *
+create_shader(struct pipe_context *pipe, const char *text,
+              enum pipe_shader_type type)
+{
+   struct tgsi_token tokens[1000];
+   struct pipe_shader_state state;
+
+   if (!tgsi_text_translate(text, tokens, ARRAY_SIZE(tokens))) {
+      printf("can't compile shader:\n%s", text);
+      return NULL;
+   }
+   pipe_shader_state_from_tgsi(&state, tokens);
+
+   switch (type) {
+   case PIPE_SHADER_VERTEX:
+      return pipe->create_vs_state(pipe, &state);
+   case PIPE_SHADER_GEOMETRY:
+      return pipe->create_gs_state(pipe, &state);
+   default:
+      return pipe->create_fs_state(pipe, &state);
+   }
+}
+
+
+/**
+ * Create a context, with or without pre-decoded shader instructions.
+ */
+static struct program *
+create_program(struct pipe_screen *screen, boolean predecode)
+{
+   struct program *p = CALLOC_STRUCT(program);
+   struct pipe_context *pipe;
+
+   /* the option is read when the shader machines are created */
+   setenv("TGSI_EXEC_PREDECODE", predecode ? "1" : "0", 1);
+   /* float, for the differences not to be rounded away */
+   p->ctx = bench_create_context(screen, WIDTH, HEIGHT,
+                                 PIPE_FORMAT_R32G32B32A32_FLOAT,
+                                 PIPE_FORMAT_NONE);
+   if (!p->ctx)
+      return NULL;
+   pipe = p->ctx->pipe;
+
+   p->vs = create_shader(pipe, vs_text, PIPE_SHADER_VERTEX);
+   p->gs = create_shader(pipe, gs_text, PIPE_SHADER_GEOMETRY);
+   p->fs[FS_COLOR] =
+      util_make_fragment_passthrough_shader(pipe, TGSI_SEMANTIC_GENERIC,
+                                            TGSI_INTERPOLATE_PERSPECTIVE,
+                                            FALSE);
+   p->fs[FS_ALU] = create_shader(pipe, fs_alu_text, PIPE_SHADER_FRAGMENT);
+   p->fs[FS_TEX] = create_shader(pipe, fs_tex_text, PIPE_SHADER_FRAGMENT);
+   if (!p->vs || !p->gs || !p->fs[FS_ALU] || !p->fs[FS_TEX])
+      return NULL;
+
+   return p;
+}
+
+
+static void
+destroy_program(struct program *p)
+{
+   struct pipe_context *pipe = p->ctx->pipe;
+   unsigned i;
+
+   cso_set_vertex_shader_handle(p->ctx->cso, NULL);
+   cso_set_geometry_shader_handle(p->ctx->cso, NULL);
+   cso_set_fragment_shader_handle(p->ctx->cso, NULL);
+   pipe->delete_vs_state(pipe, p->vs);
+   pipe->delete_gs_state(pipe, p->gs);
+   for (i = 0; i < NUM_FS; i++)
+      pipe->delete_fs_state(pipe, p->fs[i]);
+   pipe_sampler_view_reference(&p->view, NULL);
+   bench_destroy_context(p->ctx);
+   FREE(p);
+}
+
+
+static void
+bind_state(struct program *p, const struct scene *s,
+           struct pipe_resource *vbuf, const float (*consts)[4])
+{
+   struct pipe_context *pipe = p->ctx->pipe;
+   struct cso_context *cso = p->ctx->cso;
+   struct pipe_blend_state blend;
+   struct pipe_depth_stencil_alpha_state dsa;
+   struct pipe_rasterizer_state rast;
+   struct pipe_sampler_state sampler;
+   const struct pipe_sampler_state *samplers[1] = { &sampler };
+   struct pipe_vertex_element velems[3];
+   struct pipe_constant_buffer cb;
+   unsigned i;
+
+   memset(&blend, 0, sizeof blend);
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+
+   memset(&dsa, 0, sizeof dsa);
+
+   bench_init_rasterizer(&rast);
+   bench_init_sampler(&sampler);
+
+   memset(velems, 0, sizeof velems);
+   for (i = 0; i < 3; i++) {
+      velems[i].src_offset = i * 4 * sizeof(float);
+      velems[i].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   }
+
+   memset(&cb, 0, sizeof cb);
+   cb.buffer_size = NUM_CONSTS * 4 * sizeof(float);
+   cb.user_buffer = consts;
+
+   bench_bind_framebuffer(p->ctx);
+   cso_set_blend(cso, &blend);
+   cso_set_depth_stencil_alpha(cso, &dsa);
+   cso_set_rasterizer(cso, &rast);
+   cso_set_samplers(cso, PIPE_SHADER_FRAGMENT, 1, samplers);
+   cso_set_sampler_views(cso, PIPE_SHADER_FRAGMENT, 1, &p->view);
+   cso_set_vertex_elements(cso, 3, velems);
+   cso_set_vertex_shader_handle(cso, p->vs);
+   cso_set_geometry_shader_handle(cso, s->gs ? p->gs : NULL);
+   cso_set_fragment_shader_handle(cso, p->fs[s->fs]);
+   pipe->set_constant_buffer(pipe, PIPE_SHADER_VERTEX, 0, &cb);
+   pipe->set_constant_buffer(pipe, PIPE_SHADER_GEOMETRY, 0, &cb);
+   pipe->set_constant_buffer(pipe, PIPE_SHADER_FRAGMENT, 0, &cb);
+
+   p->scene = s;
+   p->vbuf = vbuf;
+}
+
+
+/** Draw one frame of the bound scene */
+static void
+draw(void *data)
+{
+   struct program *p = data;
+
+   bench_draw(p->ctx, p->vbuf, PIPE_PRIM_TRIANGLES, p->scene->num_verts, 3);
+}
+
+
+static boolean
+bench_scene(struct pipe_screen *screen, struct program *plain,
+            struct program *predecoded, const struct scene *s)
+{
+   float consts[NUM_CONSTS][4];
+   struct vertex *verts = create_vertices(s);
+   const unsigned size = s->num_verts * sizeof *verts;
+   struct pipe_resource *vbuf;
+   double plain_rate, predecoded_rate;
+   boolean success;
+
+   vbuf = pipe_buffer_create(screen, PIPE_BIND_VERTEX_BUFFER,
+                             PIPE_USAGE_DEFAULT, size);
+   pipe_buffer_write(plain->ctx->pipe, vbuf, 0, size, verts);
+   FREE(verts);
+
+   init_constants(consts);
+   bind_state(plain, s, vbuf, (const float (*)[4]) consts);
+   bind_state(predecoded, s, vbuf, (const float (*)[4]) consts);
+
+   draw(plain);
+   draw(predecoded);
+   success = bench_compare(plain->ctx->pipe, plain->ctx->cbuf,
+                           predecoded->ctx->pipe, predecoded->ctx->cbuf,
+                           0, s->name);
+
+   plain_rate = bench_measure(draw, plain, 1);
+   predecoded_rate = bench_measure(draw, predecoded, 1);
+   printf("%-12s %10.1f %10.1f %8.2fx\n", s->name, plain_rate,
+          predecoded_rate, predecoded_rate / plain_rate);
+
+   pipe_resource_reference(&vbuf, NULL);
+
+   return success;
+}
+
+
+int main(int argc, char **argv)
+{
+   struct pipe_screen *screen;
+   struct pipe_resource templ, *tex;
+   struct pipe_sampler_view view_templ;
+   struct program *plain, *predecoded;
+   boolean success = TRUE;
+   unsigned i;
+
+   screen = bench_create_screen();
+   if (!screen)
+      return 1;
+   plain = create_program(screen, FALSE);
+   predecoded = create_program(screen, TRUE);
+   if (!plain || !predecoded)
+      return 1;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = PIPE_FORMAT_R8G8B8A8_UNORM;
+   templ.width0 = TEX_SIZE;
+   templ.height0 = TEX_SIZE;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = PIPE_BIND_SAMPLER_VIEW;
+   tex = bench_create_texture(screen, plain->ctx->pipe, &templ);
+   if (!tex)
+      return 1;
+   u_sampler_view_default_template(&view_templ, tex, tex->format);
+   plain->view = plain->ctx->pipe->create_sampler_view(plain->ctx->pipe, tex,
+                                                       &view_templ);
+   predecoded->view =
+      predecoded->ctx->pipe->create_sampler_view(predecoded->ctx->pipe, tex,
+                                                 &view_templ);
+
+   printf("%-12s %10s %10s %9s\n", "scene", "plain", "predecoded", "");
+   printf("%-12s %10s %10s\n", "", "fps", "fps");
+
+   for (i = 0; i < ARRAY_SIZE(scenes); i++) {
+      if (bench_selected(argc, argv, scenes[i].name))
+         success &= bench_scene(screen, plain, predecoded, &scenes[i]);
+   }
+
+   destroy_program(plain);
+   destroy_program(predecoded);
+   pipe_resource_reference(&tex, NULL);
+   screen->destroy(screen);
+
+   return success ? 0 : 1;
+}
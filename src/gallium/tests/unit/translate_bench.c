@@ -0,0 +1,237 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Vertex throughput of translate_sse against translate_generic for some
+ * typical vertex layouts.  Both must produce the same vertices.
+ *
+ * Usage: translate_bench [layout...]
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench_util.h"
+
+#include "translate/translate.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_format.h"
+#include "util/u_memory.h"
+
+
+#define COUNT 4099   /* not a multiple of anything in particular */
+#define MAX_ELEMENTS 4
+
+
+struct layout
+{
+   const char *name;
+   unsigned nr_elements;
+   struct {
+      enum pipe_format input;
+      enum pipe_format output;
+   } element[MAX_ELEMENTS];
+};
+
+static const struct layout layouts[] = {
+   { "float", 3, {
+      { PIPE_FORMAT_R32G32B32_FLOAT, PIPE_FORMAT_R32G32B32_FLOAT },
+      { PIPE_FORMAT_R32G32B32_FLOAT, PIPE_FORMAT_R32G32B32_FLOAT },
+      { PIPE_FORMAT_R32G32_FLOAT, PIPE_FORMAT_R32G32_FLOAT } } },
+   { "unorm", 3, {
+      { PIPE_FORMAT_R32G32B32_FLOAT, PIPE_FORMAT_R32G32B32A32_FLOAT },
+      { PIPE_FORMAT_R16G16_UNORM, PIPE_FORMAT_R32G32_FLOAT },
+      { PIPE_FORMAT_B8G8R8A8_UNORM, PIPE_FORMAT_R32G32B32A32_FLOAT } } },
+   { "half", 3, {
+      { PIPE_FORMAT_R16G16B16A16_FLOAT, PIPE_FORMAT_R32G32B32A32_FLOAT },
+      { PIPE_FORMAT_R16G16B16_FLOAT, PIPE_FORMAT_R32G32B32A32_FLOAT },
+      { PIPE_FORMAT_R16G16_FLOAT, PIPE_FORMAT_R32G32_FLOAT } } },
+   { "1010102", 4, {
+      { PIPE_FORMAT_R10G10B10A2_UNORM, PIPE_FORMAT_R32G32B32A32_FLOAT },
+      { PIPE_FORMAT_B10G10R10A2_SNORM, PIPE_FORMAT_R32G32B32A32_FLOAT },
+      { PIPE_FORMAT_R10G10B10A2_USCALED, PIPE_FORMAT_R32G32B32_FLOAT },
+      { PIPE_FORMAT_B10G10R10A2_SSCALED, PIPE_FORMAT_R32G32B32A32_FLOAT } } },
+   { "mixed", 4, {
+      { PIPE_FORMAT_R32G32B32_FLOAT, PIPE_FORMAT_R32G32B32A32_FLOAT },
+      { PIPE_FORMAT_R10G10B10A2_SNORM, PIPE_FORMAT_R32G32B32_FLOAT },
+      { PIPE_FORMAT_R16G16_FLOAT, PIPE_FORMAT_R32G32_FLOAT },
+      { PIPE_FORMAT_R8G8B8A8_UNORM, PIPE_FORMAT_R32G32B32A32_FLOAT } } },
+};
+
+
+static void
+fill_input(const struct util_format_description *desc, uint8_t *data,
+           unsigned size)
+{
+   unsigned i;
+
+   for (i = 0; i < size; i++)
+      data[i] = rand();
+
+   if (desc->channel[0].type != UTIL_FORMAT_TYPE_FLOAT)
+      return;
+
+   if (desc->channel[0].size == 16) {
+      /* no NaNs, whose payload is not preserved the same way */
+      uint16_t *h = (uint16_t *)data;
+      for (i = 0; i < size / 2; i++) {
+         if ((h[i] & 0x7c00) == 0x7c00)
+            h[i] &= ~0x3ff;
+      }
+   }
+   else {
+      float *f = (float *)data;
+      for (i = 0; i < size / 4; i++)
+         f[i] = (rand() % 2048) / 1024.0f - 1.0f;
+   }
+}
+
+
+struct run_args
+{
+   struct translate *translate;
+   void *output;
+};
+
+static void
+run_measured(void *data)
+{
+   struct run_args *args = data;
+
+   args->translate->run(args->translate, 0, COUNT, 0, 0, args->output);
+}
+
+
+/** Mverts/s of a translate */
+static double
+measure(struct translate *translate, void *output)
+{
+   struct run_args args = { translate, output };
+
+   return bench_measure(run_measured, &args, COUNT) / 1e6;
+}
+
+
+static boolean
+bench_layout(const struct layout *layout)
+{
+   struct translate_key key;
+   struct translate *generic, *sse;
+   uint8_t *inputs[MAX_ELEMENTS];
+   uint8_t *output, *reference;
+   double generic_rate, sse_rate = 0.0;
+   boolean success = TRUE;
+   unsigned i, offset = 0;
+
+   memset(&key, 0, sizeof key);
+   key.nr_elements = layout->nr_elements;
+   for (i = 0; i < layout->nr_elements; i++) {
+      key.element[i].type = TRANSLATE_ELEMENT_NORMAL;
+      key.element[i].input_format = layout->element[i].input;
+      key.element[i].output_format = layout->element[i].output;
+      key.element[i].input_buffer = i;
+      key.element[i].input_offset = 0;
+      key.element[i].instance_divisor = 0;
+      key.element[i].output_offset = offset;
+      offset += util_format_get_blocksize(layout->element[i].output);
+   }
+   key.output_stride = offset;
+
+   generic = translate_generic_create(&key);
+   sse = translate_sse2_create(&key);
+   if (!generic)
+      return FALSE;
+
+   srand(0);
+   for (i = 0; i < layout->nr_elements; i++) {
+      const struct util_format_description *desc =
+         util_format_description(layout->element[i].input);
+      unsigned stride = util_format_get_blocksize(layout->element[i].input);
+
+      inputs[i] = MALLOC(stride * COUNT);
+      fill_input(desc, inputs[i], stride * COUNT);
+      generic->set_buffer(generic, i, inputs[i], stride, COUNT - 1);
+      if (sse)
+         sse->set_buffer(sse, i, inputs[i], stride, COUNT - 1);
+   }
+
+   output = MALLOC(key.output_stride * COUNT);
+   reference = MALLOC(key.output_stride * COUNT);
+
+   generic->run(generic, 0, COUNT, 0, 0, reference);
+   generic_rate = measure(generic, output);
+
+   if (sse) {
+      memset(output, 0, key.output_stride * COUNT);
+      sse->run(sse, 0, COUNT, 0, 0, output);
+      for (i = 0; i < key.output_stride * COUNT; i++) {
+         if (output[i] != reference[i]) {
+            printf("%s: mismatch in vertex %u, byte %u: %02x, expected %02x\n",
+                   layout->name, i / key.output_stride,
+                   i % key.output_stride, output[i], reference[i]);
+            success = FALSE;
+            break;
+         }
+      }
+      sse_rate = measure(sse, output);
+   }
+
+   if (sse)
+      printf("%-10s %10.1f %10.1f %8.2fx\n",
+             layout->name, generic_rate, sse_rate, sse_rate / generic_rate);
+   else
+      printf("%-10s %10.1f %10s\n", layout->name, generic_rate, "n/a");
+
+   for (i = 0; i < layout->nr_elements; i++)
+      FREE(inputs[i]);
+   FREE(output);
+   FREE(reference);
+   if (sse)
+      sse->release(sse);
+   generic->release(generic);
+
+   return success;
+}
+
+
+int main(int argc, char **argv)
+{
+   boolean success = TRUE;
+   unsigned i;
+
+   util_cpu_detect();
+
+   printf("%-10s %10s %10s %9s\n", "layout", "generic", "sse", "");
+   printf("%-10s %10s %10s\n", "", "Mverts/s", "Mverts/s");
+
+   for (i = 0; i < ARRAY_SIZE(layouts); i++) {
+      if (bench_selected(argc, argv, layouts[i].name))
+         success &= bench_layout(&layouts[i]);
+   }
+
+   return success ? 0 : 1;
+}
@@ -0,0 +1,358 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Throughput of the generated pack/unpack row functions, with and without
+ * the SSE2 kernels, which must also give the same results as the scalar
+ * code.
+ *
+ * Usage: u_format_bench [format...]
+ *
+ * Without arguments all formats with SSE2 kernels are measured.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench_util.h"
+
+#include "util/u_cpu_detect.h"
+#include "util/u_format.h"
+#include "util/u_memory.h"
+
+
+#define WIDTH 1027   /* not a multiple of 4, to cover the scalar tail */
+#define HEIGHT 64
+
+
+enum bench_func
+{
+   UNPACK_8UNORM,
+   PACK_8UNORM,
+   UNPACK_FLOAT,
+   PACK_FLOAT,
+   NUM_FUNCS
+};
+
+static const char *func_names[NUM_FUNCS] = {
+   "unpack_rgba_8unorm",
+   "pack_rgba_8unorm",
+   "unpack_rgba_float",
+   "pack_rgba_float",
+};
+
+
+struct buffers
+{
+   uint8_t *packed;
+   unsigned packed_stride;
+   uint8_t *rgba8;
+   float *rgbaf;
+};
+
+
+/**
+ * Same rule u_format_pack.py uses to decide which formats get SSE2 kernels.
+ */
+static boolean
+has_simd_kernels(const struct util_format_description *desc)
+{
+   const struct util_format_channel_description *channel;
+   unsigned i;
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB ||
+       !desc->is_array)
+      return FALSE;
+
+   channel = &desc->channel[0];
+   for (i = 0; i < 4; i++) {
+      if (desc->channel[i].type != UTIL_FORMAT_TYPE_VOID) {
+         channel = &desc->channel[i];
+         break;
+      }
+   }
+
+   if (channel->pure_integer || desc->block.bits != 4 * channel->size)
+      return FALSE;
+
+   if (channel->type == UTIL_FORMAT_TYPE_UNSIGNED && channel->normalized)
+      return channel->size == 8 || channel->size == 16;
+
+   return channel->type == UTIL_FORMAT_TYPE_FLOAT && channel->size == 32;
+}
+
+
+static void
+run(const struct util_format_description *desc, enum bench_func func,
+    struct buffers *buf)
+{
+   switch (func) {
+   case UNPACK_8UNORM:
+      desc->unpack_rgba_8unorm(buf->rgba8, WIDTH * 4,
+                               buf->packed, buf->packed_stride,
+                               WIDTH, HEIGHT);
+      break;
+   case PACK_8UNORM:
+      desc->pack_rgba_8unorm(buf->packed, buf->packed_stride,
+                             buf->rgba8, WIDTH * 4,
+                             WIDTH, HEIGHT);
+      break;
+   case UNPACK_FLOAT:
+      desc->unpack_rgba_float(buf->rgbaf, WIDTH * 4 * sizeof(float),
+                              buf->packed, buf->packed_stride,
+                              WIDTH, HEIGHT);
+      break;
+   case PACK_FLOAT:
+      desc->pack_rgba_float(buf->packed, buf->packed_stride,
+                            buf->rgbaf, WIDTH * 4 * sizeof(float),
+                            WIDTH, HEIGHT);
+      break;
+   default:
+      assert(0);
+   }
+}
+
+
+static void
+fill_inputs(const struct util_format_description *desc, enum bench_func func,
+            struct buffers *buf)
+{
+   unsigned i;
+
+   srand(func);
+
+   switch (func) {
+   case UNPACK_8UNORM:
+   case UNPACK_FLOAT:
+      for (i = 0; i < buf->packed_stride * HEIGHT; i++)
+         buf->packed[i] = rand();
+      if (desc->channel[0].type == UTIL_FORMAT_TYPE_FLOAT) {
+         /* keep most floats in a sensible range */
+         float *f = (float *)buf->packed;
+         for (i = 0; i < buf->packed_stride * HEIGHT / 4; i++) {
+            if (rand() % 8)
+               f[i] = (rand() % 2048) / 1024.0f - 0.5f;
+         }
+      }
+      break;
+   case PACK_8UNORM:
+      for (i = 0; i < WIDTH * HEIGHT * 4; i++)
+         buf->rgba8[i] = rand();
+      break;
+   case PACK_FLOAT:
+      for (i = 0; i < WIDTH * HEIGHT * 4; i++)
+         buf->rgbaf[i] = (rand() % 2048) / 1024.0f - 0.5f;
+      break;
+   default:
+      assert(0);
+   }
+}
+
+
+/**
+ * Return the output buffer of a function, and a mask of the bytes within
+ * each element which must match.
+ */
+static const uint8_t *
+get_output(const struct util_format_description *desc, enum bench_func func,
+           const struct buffers *buf, unsigned *size,
+           unsigned *element_size, uint8_t *mask)
+{
+   unsigned i, bit;
+
+   if (func == PACK_8UNORM || func == PACK_FLOAT) {
+      /* unused channels are undefined */
+      *element_size = desc->block.bits / 8;
+      memset(mask, 0, *element_size);
+      for (i = 0; i < 4; i++) {
+         const struct util_format_channel_description *channel =
+            &desc->channel[i];
+         if (channel->type == UTIL_FORMAT_TYPE_VOID)
+            continue;
+         for (bit = channel->shift; bit < channel->shift + channel->size; bit++)
+            mask[bit / 8] = 0xff;
+      }
+      *size = buf->packed_stride * HEIGHT;
+      return buf->packed;
+   }
+
+   *element_size = 1;
+   mask[0] = 0xff;
+   if (func == UNPACK_8UNORM) {
+      *size = WIDTH * HEIGHT * 4;
+      return buf->rgba8;
+   }
+   *size = WIDTH * HEIGHT * 4 * sizeof(float);
+   return (const uint8_t *)buf->rgbaf;
+}
+
+
+struct run_args
+{
+   const struct util_format_description *desc;
+   enum bench_func func;
+   struct buffers *buf;
+};
+
+static void
+run_measured(void *data)
+{
+   struct run_args *args = data;
+
+   run(args->desc, args->func, args->buf);
+}
+
+
+/** Mpixels/s of a function */
+static double
+measure(const struct util_format_description *desc, enum bench_func func,
+        struct buffers *buf)
+{
+   struct run_args args = { desc, func, buf };
+
+   return bench_measure(run_measured, &args, WIDTH * HEIGHT) / 1e6;
+}
+
+
+static boolean
+bench_format(const struct util_format_description *desc, struct buffers *buf)
+{
+   const boolean has_sse2 = util_cpu_caps.has_sse2;
+   boolean success = TRUE;
+   unsigned func;
+
+   buf->packed_stride = WIDTH * desc->block.bits / 8;
+
+   for (func = 0; func < NUM_FUNCS; func++) {
+      const uint8_t *output;
+      uint8_t *reference;
+      uint8_t mask[16];
+      unsigned size, element_size, i;
+      double scalar_rate, simd_rate = 0.0;
+
+      /* scalar reference */
+      util_cpu_caps.has_sse2 = 0;
+      fill_inputs(desc, func, buf);
+      run(desc, func, buf);
+      output = get_output(desc, func, buf, &size, &element_size, mask);
+      reference = MALLOC(size);
+      memcpy(reference, output, size);
+      scalar_rate = measure(desc, func, buf);
+
+      if (has_sse2) {
+         util_cpu_caps.has_sse2 = 1;
+         fill_inputs(desc, func, buf);
+         run(desc, func, buf);
+         for (i = 0; i < size; i++) {
+            if ((output[i] ^ reference[i]) & mask[i % element_size]) {
+               printf("%s %s: mismatch at byte %u: %02x, expected %02x\n",
+                      desc->short_name, func_names[func], i,
+                      output[i], reference[i]);
+               success = FALSE;
+               break;
+            }
+         }
+         simd_rate = measure(desc, func, buf);
+      }
+
+      FREE(reference);
+
+      printf("%-28s %-20s %10.1f %10.1f %8.2fx\n",
+             desc->short_name, func_names[func],
+             scalar_rate, simd_rate, simd_rate / scalar_rate);
+   }
+
+   util_cpu_caps.has_sse2 = has_sse2;
+   return success;
+}
+
+
+static const struct util_format_description *
+find_format(const char *name)
+{
+   enum pipe_format format;
+
+   for (format = 1; format < PIPE_FORMAT_COUNT; format++) {
+      const struct util_format_description *desc =
+         util_format_description(format);
+      if (desc && (strcmp(name, desc->name) == 0 ||
+                   strcmp(name, desc->short_name) == 0))
+         return desc;
+   }
+   return NULL;
+}
+
+
+int main(int argc, char **argv)
+{
+   struct buffers buf;
+   boolean success = TRUE;
+   enum pipe_format format;
+   int i;
+
+   util_cpu_detect();
+
+   /* large enough for the widest format */
+   buf.packed = MALLOC(WIDTH * HEIGHT * 16);
+   buf.rgba8 = MALLOC(WIDTH * HEIGHT * 4);
+   buf.rgbaf = MALLOC(WIDTH * HEIGHT * 4 * sizeof(float));
+   if (!buf.packed || !buf.rgba8 || !buf.rgbaf)
+      return 1;
+
+   printf("%-28s %-20s %10s %10s %9s\n",
+          "format", "function", "scalar", "sse2", "");
+
+   if (argc > 1) {
+      for (i = 1; i < argc; i++) {
+         const struct util_format_description *desc = find_format(argv[i]);
+         if (!desc || desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+             desc->block.width != 1 || desc->block.height != 1 ||
+             !desc->unpack_rgba_8unorm || !desc->pack_rgba_8unorm ||
+             !desc->unpack_rgba_float || !desc->pack_rgba_float) {
+            fprintf(stderr, "%s: unknown or unsupported format\n", argv[i]);
+            success = FALSE;
+            continue;
+         }
+         success &= bench_format(desc, &buf);
+      }
+   }
+   else {
+      for (format = 1; format < PIPE_FORMAT_COUNT; format++) {
+         const struct util_format_description *desc =
+            util_format_description(format);
+         if (desc && has_simd_kernels(desc))
+            success &= bench_format(desc, &buf);
+      }
+   }
+
+   FREE(buf.packed);
+   FREE(buf.rgba8);
+   FREE(buf.rgbaf);
+
+   return success ? 0 : 1;
+}
@@ -0,0 +1,215 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Mipmap generation speed on softpipe, by blitting (util_gen_mipmap) versus
+ * on the CPU (util_gen_mipmap_cpu) with GEN_MIPMAP_THREADS threads besides
+ * the calling one.  All levels must come out the same.  Textures that
+ * util_gen_mipmap_cpu doesn't support are blitted by both.
+ *
+ * Usage: u_gen_mipmap_bench [texture...]
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench_util.h"
+
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "util/u_debug.h"
+#include "util/u_gen_mipmap.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_queue.h"
+
+
+struct texture
+{
+   const char *name;
+   enum pipe_format format;
+   enum pipe_texture_target target;
+   unsigned width, height, layers;
+};
+
+static const struct texture textures[] = {
+   { "rgba8",       PIPE_FORMAT_R8G8B8A8_UNORM,     PIPE_TEXTURE_2D,
+     1024, 1024, 1 },
+   { "bgra8",       PIPE_FORMAT_B8G8R8A8_UNORM,     PIPE_TEXTURE_2D,
+     2048, 512, 1 },
+   { "rgba8_npot",  PIPE_FORMAT_R8G8B8A8_UNORM,     PIPE_TEXTURE_2D,
+     640, 480, 1 },
+   { "rgba8_thin",  PIPE_FORMAT_R8G8B8A8_UNORM,     PIPE_TEXTURE_2D,
+     1024, 4, 1 },
+   { "rgba8_array", PIPE_FORMAT_R8G8B8A8_UNORM,     PIPE_TEXTURE_2D_ARRAY,
+     256, 256, 6 },
+   { "r8",          PIPE_FORMAT_R8_UNORM,           PIPE_TEXTURE_2D,
+     1024, 1024, 1 },
+   { "rg8",         PIPE_FORMAT_R8G8_UNORM,         PIPE_TEXTURE_2D,
+     512, 1024, 1 },
+   { "rgba32f",     PIPE_FORMAT_R32G32B32A32_FLOAT, PIPE_TEXTURE_2D,
+     512, 512, 1 },
+   { "r32f",        PIPE_FORMAT_R32_FLOAT,          PIPE_TEXTURE_2D,
+     1024, 1024, 1 },
+};
+
+
+static struct pipe_resource *
+create_texture(struct pipe_screen *screen, struct pipe_context *pipe,
+               const struct texture *t)
+{
+   struct pipe_resource templ;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = t->target;
+   templ.format = t->format;
+   templ.width0 = t->width;
+   templ.height0 = t->height;
+   templ.depth0 = 1;
+   templ.array_size = t->layers;
+   templ.last_level = util_logbase2(MAX2(t->width, t->height));
+   templ.bind = PIPE_BIND_SAMPLER_VIEW | PIPE_BIND_RENDER_TARGET;
+
+   srand(1);
+   return bench_create_texture(screen, pipe, &templ);
+}
+
+
+static boolean
+gen_mipmap(struct pipe_context *pipe, struct pipe_resource *tex,
+           struct util_queue *queue, boolean cpu)
+{
+   /* unsupported textures are blitted, like the state tracker would */
+   if (cpu &&
+       util_gen_mipmap_cpu(pipe, tex, tex->format, 0, tex->last_level,
+                           0, tex->array_size - 1,
+                           PIPE_TEX_FILTER_LINEAR, queue))
+      return TRUE;
+   return util_gen_mipmap(pipe, tex, tex->format, 0, tex->last_level,
+                          0, tex->array_size - 1, PIPE_TEX_FILTER_LINEAR);
+}
+
+
+struct gen_mipmap_args
+{
+   struct pipe_context *pipe;
+   struct pipe_resource *tex;
+   struct util_queue *queue;
+   boolean cpu;
+};
+
+static void
+run(void *data)
+{
+   struct gen_mipmap_args *args = data;
+
+   gen_mipmap(args->pipe, args->tex, args->queue, args->cpu);
+   args->pipe->flush(args->pipe, NULL, 0);
+}
+
+
+/** Mipmap chains per second */
+static double
+measure(struct pipe_context *pipe, struct pipe_resource *tex,
+        struct util_queue *queue, boolean cpu)
+{
+   struct gen_mipmap_args args = { pipe, tex, queue, cpu };
+
+   return bench_measure(run, &args, 1);
+}
+
+
+static boolean
+bench_texture(struct pipe_screen *screen, struct pipe_context *pipe,
+              struct util_queue *queue, const struct texture *t)
+{
+   struct pipe_resource *blitted, *filtered;
+   double blit_rate, cpu_rate;
+   boolean success;
+   unsigned level;
+
+   blitted = create_texture(screen, pipe, t);
+   filtered = create_texture(screen, pipe, t);
+   if (!blitted || !filtered)
+      return FALSE;
+
+   success = gen_mipmap(pipe, blitted, queue, FALSE) &&
+             gen_mipmap(pipe, filtered, queue, TRUE);
+   for (level = 1; level <= blitted->last_level && success; level++)
+      success = bench_compare(pipe, blitted, pipe, filtered, level, t->name);
+
+   blit_rate = measure(pipe, blitted, queue, FALSE);
+   cpu_rate = measure(pipe, filtered, queue, TRUE);
+   printf("%-12s %10.1f %10.1f %8.2fx\n", t->name, blit_rate, cpu_rate,
+          cpu_rate / blit_rate);
+
+   pipe_resource_reference(&blitted, NULL);
+   pipe_resource_reference(&filtered, NULL);
+
+   return success;
+}
+
+
+int main(int argc, char **argv)
+{
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   struct util_queue queue;
+   boolean success = TRUE;
+   unsigned nr_threads;
+   unsigned i;
+
+   nr_threads = debug_get_num_option("GEN_MIPMAP_THREADS", 3);
+
+   screen = bench_create_screen();
+   if (!screen)
+      return 1;
+   pipe = screen->context_create(screen, NULL, 0);
+   if (!pipe)
+      return 1;
+   if (nr_threads &&
+       !util_queue_init(&queue, "genmip", nr_threads, nr_threads, 0))
+      return 1;
+
+   printf("%u threads\n", nr_threads);
+   printf("%-12s %10s %10s %9s\n", "texture", "blit", "cpu", "");
+   printf("%-12s %10s %10s\n", "", "chains/s", "chains/s");
+
+   for (i = 0; i < ARRAY_SIZE(textures); i++) {
+      if (bench_selected(argc, argv, textures[i].name))
+         success &= bench_texture(screen, pipe, nr_threads ? &queue : NULL,
+                                  &textures[i]);
+   }
+
+   if (nr_threads)
+      util_queue_destroy(&queue);
+   pipe->destroy(pipe);
+   screen->destroy(screen);
+
+   return success ? 0 : 1;
+}
@@ -662,6 +662,14 @@ static uint64_t radeon_query_value(struct radeon_winsys *rws,
         return retval;
     case RADEON_CS_THREAD_TIME:
         return util_queue_get_thread_time_nano(&ws->cs_queue, 0);
+    case RADEON_BO_CACHE_HITS:
+        return ws->bo_cache.num_hits;
+    case RADEON_BO_CACHE_MISSES:
+        return ws->bo_cache.num_misses;
+    case RADEON_BO_CACHE_EVICTIONS:
+        return ws->bo_cache.num_evictions;
+    case RADEON_BO_CACHE_SIZE:
+        return ws->bo_cache.cache_size;
     }
     return 0;
 }
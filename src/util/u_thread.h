@@ -36,6 +36,10 @@
 #include <signal.h>
 #endif
 
+#ifdef __linux__
+#include <sched.h>
+#endif
+
 
 static inline thrd_t u_thread_create(int (*routine)(void *), void *param)
 {
@@ -70,6 +74,45 @@ static inline void u_thread_setname( const char *name )
    (void)name;
 }
 
+/**
+ * Restrict the calling thread to those of the cpus set in the bitmask, 32
+ * cpus per word, which it is allowed to run on already.  Returns false,
+ * leaving the affinity alone, if there are none or where thread affinity
+ * isn't supported.
+ */
+static inline bool
+u_thread_setaffinity(const uint32_t *mask, unsigned num_words)
+{
+#if defined(HAVE_PTHREAD)
+#  if defined(__GNU_LIBRARY__) && defined(__GLIBC__) && defined(__GLIBC_MINOR__) && \
+      (__GLIBC__ >= 3 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 4)) && \
+      defined(__linux__)
+   cpu_set_t allowed, cpuset;
+   bool any = false;
+   unsigned i;
+
+   /* e.g. taskset or cgroup cpusets may exclude some of the cpus */
+   if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+      return false;
+
+   CPU_ZERO(&cpuset);
+   for (i = 0; i < num_words * 32 && i < CPU_SETSIZE; i++) {
+      if ((mask[i / 32] & (1u << (i % 32))) && CPU_ISSET(i, &allowed)) {
+         CPU_SET(i, &cpuset);
+         any = true;
+      }
+   }
+   if (!any)
+      return false;
+
+   return pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0;
+#  endif
+#endif
+   (void)mask;
+   (void)num_words;
+   return false;
+}
+
 /*
  * Thread statistics.
  */